@@ -2,11 +2,19 @@
 #define lesstimate_H
 
 #include "lesstimate/common_headers.h"
+#include "lesstimate/traits.h"
+#include "lesstimate/parameterTable.h"
 #include "lesstimate/ista_class.h"
 #include "lesstimate/ista_penalties.h"
+#include "lesstimate/ista_batched.h"
 #include "lesstimate/glmnet_class.h"
 #include "lesstimate/glmnet_penalties.h"
 #include "lesstimate/bfgsOptim.h"
+#include "lesstimate/crossValidation.h"
+#include "lesstimate/leaveOneOut.h"
+#include "lesstimate/homotopy.h"
+#include "lesstimate/multiStart.h"
+#include "lesstimate/admm.h"
 #include "lesstimate/simplified_interfaces.h"
 
 namespace less = lessSEM;
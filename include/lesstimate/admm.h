@@ -0,0 +1,441 @@
+#ifndef ADMM_H
+#define ADMM_H
+#include <cmath>
+#include <string>
+#include <vector>
+#include "common_headers.h"
+#include "fitResults.h"
+#include "parallel.h"
+#include "traits.h"
+#include "finiteDifferenceHessian.h"
+
+// Consensus ADMM for penalties on linear transformations of the parameters.
+//
+// Penalties on linear combinations of the parameters (e.g., all pairwise differences between
+// the groups of a multi-group model or the differences along the edges of a graph) do not have
+// a cheap proximal operator. The ADMM (Boyd et al., 2011) splits
+//    f(theta) + sum_s g_s(D_s theta)
+// into the smooth model f and the penalties g_s of the split variables z_s = D_s theta:
+//
+//  - theta-update: minimize f(theta) + rho/2 sum_s ||D_s theta - z_s + u_s||^2. The update uses
+//    Newton-type steps with the fixed matrix H + rho * D'D, where H is an approximation of the
+//    Hessian of f. The Cholesky factorization of this matrix is cached and only recomputed when
+//    rho changes.
+//  - z-update: z_s = prox_{g_s / rho}(D_s theta + u_s) with any of the existing proximal operators.
+//    The splits are independent of each other and are updated in parallel.
+//  - u-update: u_s = u_s + D_s theta - z_s.
+//
+// rho is adapted with residual balancing (Boyd et al., 2011, Section 3.4.1): if the primal
+// residual is much larger than the dual residual, rho is increased and vice versa.
+//
+// Boyd, S., Parikh, N., Chu, E., Peleato, B., & Eckstein, J. (2011). Distributed optimization and
+// statistical learning via the alternating direction method of multipliers. Foundations and
+// Trends in Machine Learning, 3(1), 1–122.
+
+namespace lessSEM
+{
+
+  /**
+   * @struct admmSplit
+   * @brief one split of the ADMM: the penalty is applied to z = transformation * theta
+   *
+   * @var transformation matrix D with one row for each split variable and one column for each parameter
+   * @var tuningParameters tuning parameters of the penalty of the split variables
+   */
+  template <typename T>
+  struct admmSplit
+  {
+    arma::mat transformation;
+    T tuningParameters;
+  };
+
+  /**
+   * @struct controlADMM
+   * @brief Allows you to adapt the optimizer settings for the ADMM
+   *
+   * @var rho initial penalty parameter of the augmented Lagrangian
+   * @var initialHessian Hessian approximation H used in the theta-update. If it is a 1x1 matrix,
+   * a diagonal matrix with this value is used (see controlGLMNET).
+   * @var initialHessianEstimate settings for approximating H with finite differences of the
+   * gradients at the starting values (see finiteDifferenceHessian.h). If the type is not userHessian, the
+   * approximation replaces the initialHessian.
+   * @var maxIterOut maximal number of ADMM iterations
+   * @var maxIterIn maximal number of Newton-type steps in each theta-update
+   * @var maxIterLine maximal number of step halvings in the line search of the theta-update
+   * @var sigma sufficient decrease parameter of the line search
+   * @var breakInner the theta-update stops if no gradient of the augmented Lagrangian is larger than breakInner
+   * @var absoluteTolerance absolute tolerance of the primal and dual residuals
+   * @var relativeTolerance relative tolerance of the primal and dual residuals
+   * @var residualBalancing should rho be adapted?
+   * @var balancingFactor rho is adapted if one residual is balancingFactor times larger than the other
+   * @var rhoScale factor by which rho is increased or decreased
+   * @var threads number of threads used to update the splits (see parallel.h). 0 uses all available cores.
+   * @var verbose 0 prints no additional information, > 0 prints the fit every verbose iterations
+   */
+  struct controlADMM
+  {
+    double rho;
+    arma::mat initialHessian;
+    controlInitialHessian initialHessianEstimate;
+    int maxIterOut;
+    int maxIterIn;
+    int maxIterLine;
+    double sigma;
+    double breakInner;
+    double absoluteTolerance;
+    double relativeTolerance;
+    bool residualBalancing;
+    double balancingFactor;
+    double rhoScale;
+    int threads;
+    int verbose;
+  };
+
+  /**
+   * @brief Returns the default settings for the ADMM. H is approximated with finite differences.
+   *
+   * @return controlADMM
+   */
+  inline controlADMM controlADMMDefault()
+  {
+    arma::mat initialHessian(1, 1);
+    initialHessian.fill(1.0);
+    controlInitialHessian initialHessianEstimate = controlInitialHessianDefault();
+    initialHessianEstimate.type = finiteDifferenceFull;
+    initialHessianEstimate.threads = 1; // the model is not required to be thread-safe
+
+    controlADMM defaultIs = {
+        1.0,                    // rho
+        initialHessian,         // initialHessian
+        initialHessianEstimate, // initialHessianEstimate
+        1000,                   // maxIterOut
+        10,                     // maxIterIn
+        30,                     // maxIterLine
+        1e-4,                   // sigma
+        1e-8,                   // breakInner
+        1e-6,                   // absoluteTolerance
+        1e-4,                   // relativeTolerance
+        true,                   // residualBalancing
+        10.0,                   // balancingFactor
+        2.0,                    // rhoScale
+        1,                      // threads
+        0                       // verbose
+    };
+    return (defaultIs);
+  }
+
+  /**
+   * @struct admmResults
+   * @brief results of the ADMM
+   *
+   * @var result fit results. fit is the model fit plus the penalties of the split variables.
+   * @var splitValues final split variables z_s. These are exactly sparse, while the
+   * corresponding D_s theta are only close to zero.
+   * @var rho final penalty parameter
+   * @var iterations number of ADMM iterations
+   * @var factorizations number of Cholesky factorizations
+   */
+  struct admmResults
+  {
+    fitResults result;
+    std::vector<arma::rowvec> splitValues;
+    double rho;
+    int iterations;
+    int factorizations;
+  };
+
+  /**
+   * @brief creates a transformation matrix with one row for each pair of parameters within
+   * each group (e.g., the loadings of one item in all groups of a multi-group model), so that
+   * the penalty is applied to all pairwise differences.
+   *
+   * @param groups positions of the parameters in each group
+   * @param numberParameters number of parameters
+   * @return arma::mat
+   */
+  inline arma::mat pairwiseDifferences(const std::vector<arma::uvec> &groups,
+                                       const unsigned int numberParameters)
+  {
+    unsigned int numberPairs = 0;
+    for (const arma::uvec &group : groups)
+      numberPairs += group.n_elem > 1 ? group.n_elem * (group.n_elem - 1) / 2 : 0;
+
+    arma::mat transformation(numberPairs, numberParameters, arma::fill::zeros);
+    unsigned int row = 0;
+    for (const arma::uvec &group : groups)
+    {
+      for (arma::uword i = 0; i < group.n_elem; i++)
+      {
+        for (arma::uword j = i + 1; j < group.n_elem; j++)
+        {
+          if (group.at(i) >= numberParameters || group.at(j) >= numberParameters)
+            error("Groups can only contain positions smaller than the number of parameters.");
+          transformation.at(row, group.at(i)) = 1.0;
+          transformation.at(row, group.at(j)) = -1.0;
+          row++;
+        }
+      }
+    }
+    return (transformation);
+  }
+
+  /**
+   * @brief Optimize a model with penalties on linear transformations of the parameters
+   * using the ADMM
+   *
+   * @tparam modelClass the model (see traits.h)
+   * @tparam proximalOperatorClass proximal operator used for the split variables (e.g., proximalOperatorLasso)
+   * @tparam penaltyClass penalty of the split variables (e.g., penaltyLASSO)
+   * @tparam T type of the tuning parameters
+   * @param model_ the model object derived from the model class in model.h or any class with the methods fit and gradients (see traits.h)
+   * @param startingValues an arma::rowvec numeric vector with starting values
+   * @param parameterLabels a stringVector with parameter labels
+   * @param proximalOperator_ proximal operator used for the split variables. It is shared by all splits and must
+   * not store any intermediate results if threads != 1.
+   * @param penalty_ penalty of the split variables
+   * @param splits the splits z_s = D_s theta with their tuning parameters
+   * @param control_ settings for the ADMM (see controlADMM)
+   * @return admmResults
+   */
+  template <class modelClass, class proximalOperatorClass, class penaltyClass, typename T>
+  inline admmResults admm(modelClass &model_,
+                          const arma::rowvec &startingValues,
+                          const stringVector &parameterLabels,
+                          proximalOperatorClass &proximalOperator_,
+                          penaltyClass &penalty_,
+                          const std::vector<admmSplit<T>> &splits,
+                          const controlADMM &control_ = controlADMMDefault())
+  {
+    const unsigned int numberParameters = startingValues.n_elem;
+    const unsigned int numberSplits = splits.size();
+
+    if (numberSplits == 0)
+      error("The ADMM requires at least one split.");
+    if (control_.rho <= 0.0 || control_.rhoScale <= 1.0 || control_.balancingFactor <= 1.0)
+      error("rho must be positive and rhoScale as well as balancingFactor must be larger than 1.");
+
+    // transposed transformations and labels of the split variables
+    std::vector<arma::mat> transposed(numberSplits);
+    std::vector<stringVector> splitLabels;
+    arma::mat DtD(numberParameters, numberParameters, arma::fill::zeros);
+    unsigned int numberSplitVariables = 0;
+    for (unsigned int s = 0; s < numberSplits; s++)
+    {
+      const arma::mat &transformation = splits.at(s).transformation;
+      if (transformation.n_cols != numberParameters)
+        error("Each transformation must have one column for each parameter.");
+      transposed.at(s) = arma::trans(transformation);
+      DtD += transposed.at(s) * transformation;
+      numberSplitVariables += transformation.n_rows;
+
+      std::vector<std::string> labels(transformation.n_rows);
+      for (unsigned int r = 0; r < transformation.n_rows; r++)
+        labels.at(r) = "split" + std::to_string(s) + "_" + std::to_string(r);
+      splitLabels.push_back(toStringVector(labels));
+    }
+
+    // Hessian approximation of the model
+    arma::mat H(numberParameters, numberParameters, arma::fill::zeros);
+    if (control_.initialHessianEstimate.type != userHessian)
+    {
+      H = approximateInitialHessian(model_,
+                                    startingValues,
+                                    parameterLabels,
+                                    control_.initialHessianEstimate);
+    }
+    else if ((control_.initialHessian.n_cols == 1) && (control_.initialHessian.n_rows == 1))
+    {
+      H.diag().fill(control_.initialHessian(0, 0));
+    }
+    else
+    {
+      H = control_.initialHessian;
+    }
+
+    admmResults results;
+    results.rho = control_.rho;
+    results.factorizations = 0;
+
+    // cached factorization of H + rho * D'D = R'R
+    arma::mat R;
+    auto factorize = [&]()
+    {
+      if (!arma::chol(R, H + results.rho * DtD))
+        error("H + rho * D'D is not positive definite.");
+      results.factorizations++;
+    };
+    factorize();
+
+    // initialize the split variables and the scaled dual variables
+    arma::rowvec parameters_k = startingValues;
+    std::vector<arma::rowvec> Dtheta(numberSplits), z(numberSplits), zOld(numberSplits), u(numberSplits);
+    for (unsigned int s = 0; s < numberSplits; s++)
+    {
+      Dtheta.at(s) = parameters_k * transposed.at(s);
+      z.at(s) = Dtheta.at(s);
+      u.at(s) = arma::rowvec(Dtheta.at(s).n_elem, arma::fill::zeros);
+    }
+
+    double fit_k = modelFit(model_, parameters_k, parameterLabels);
+    arma::rowvec gradients_k = modelGradients(model_, parameters_k, parameterLabels);
+    if (!std::isfinite(fit_k) || !arma::is_finite(gradients_k))
+      error("Infinite fit or gradients at the starting values.");
+
+    auto penalizedFit = [&](const double fit)
+    {
+      double penalizedFit_ = fit;
+      for (unsigned int s = 0; s < numberSplits; s++)
+        penalizedFit_ += penaltyValue(penalty_, z.at(s), splitLabels.at(s), splits.at(s).tuningParameters);
+      return (penalizedFit_);
+    };
+
+    arma::rowvec fits(control_.maxIterOut + 1);
+    fits.fill(NA_REAL);
+    fits(0) = penalizedFit(fit_k);
+
+    bool convergence = false;
+    int outer_iteration = 0;
+    for (; outer_iteration < control_.maxIterOut; outer_iteration++)
+    {
+      // theta-update: minimize f(theta) + rho/2 ||D theta - c||^2 with c = z - u
+      arma::rowvec cD(numberParameters, arma::fill::zeros); // c'D
+      double cc = 0.0;
+      for (unsigned int s = 0; s < numberSplits; s++)
+      {
+        const arma::rowvec c = z.at(s) - u.at(s);
+        cD += c * splits.at(s).transformation;
+        cc += arma::dot(c, c);
+      }
+      // ||D theta - c||^2 = theta D'D theta' - 2 c'D theta' + c'c
+      auto augmentedFit = [&](const double fit, const arma::rowvec &parameters)
+      {
+        return (fit + .5 * results.rho *
+                          (arma::as_scalar(parameters * DtD * arma::trans(parameters)) -
+                           2.0 * arma::dot(cD, parameters) + cc));
+      };
+
+      for (int inner_iteration = 0; inner_iteration < control_.maxIterIn; inner_iteration++)
+      {
+        const arma::rowvec augmentedGradients = gradients_k +
+                                                results.rho * (parameters_k * DtD - cD);
+        if (arma::max(arma::abs(augmentedGradients)) <= control_.breakInner)
+          break;
+
+        const arma::colvec direction = -arma::solve(arma::trimatu(R),
+                                                    arma::solve(arma::trimatl(arma::trans(R)),
+                                                                arma::trans(augmentedGradients)));
+        const double decrease = arma::dot(augmentedGradients, direction);
+        const double augmentedFit_k = augmentedFit(fit_k, parameters_k);
+
+        double stepSize = 1.0;
+        bool accepted = false;
+        arma::rowvec parameters_new;
+        double fit_new = fit_k;
+        for (int line = 0; line < control_.maxIterLine; line++, stepSize *= .5)
+        {
+          parameters_new = parameters_k + stepSize * arma::trans(direction);
+          fit_new = modelFit(model_, parameters_new, parameterLabels);
+          if (std::isfinite(fit_new) &&
+              augmentedFit(fit_new, parameters_new) <= augmentedFit_k + control_.sigma * stepSize * decrease)
+          {
+            accepted = true;
+            break;
+          }
+        }
+        if (!accepted)
+          break;
+
+        parameters_k = parameters_new;
+        fit_k = fit_new;
+        gradients_k = modelGradients(model_, parameters_k, parameterLabels);
+        if (!arma::is_finite(gradients_k))
+          error("Infinite gradients in the theta-update of the ADMM.");
+      }
+
+      // z-update: independent proximal operators of the splits
+      zOld = z;
+      parallelFor(numberSplits,
+                  control_.threads,
+                  [&](const unsigned int s)
+                  {
+                    Dtheta.at(s) = parameters_k * transposed.at(s);
+                    const arma::rowvec v = Dtheta.at(s) + u.at(s);
+                    z.at(s) = proximalParameters(proximalOperator_,
+                                                 v,
+                                                 arma::rowvec(v.n_elem, arma::fill::zeros),
+                                                 splitLabels.at(s),
+                                                 results.rho,
+                                                 splits.at(s).tuningParameters);
+                  });
+
+      // u-update and residuals
+      double primalResidual = 0.0, normDtheta = 0.0, normZ = 0.0;
+      arma::rowvec dualResidual(numberParameters, arma::fill::zeros), Dtu(numberParameters, arma::fill::zeros);
+      for (unsigned int s = 0; s < numberSplits; s++)
+      {
+        const arma::rowvec difference = Dtheta.at(s) - z.at(s);
+        u.at(s) += difference;
+        primalResidual += arma::dot(difference, difference);
+        normDtheta += arma::dot(Dtheta.at(s), Dtheta.at(s));
+        normZ += arma::dot(z.at(s), z.at(s));
+        dualResidual += (z.at(s) - zOld.at(s)) * splits.at(s).transformation;
+        Dtu += u.at(s) * splits.at(s).transformation;
+      }
+      primalResidual = std::sqrt(primalResidual);
+      const double dualResidualNorm = results.rho * arma::norm(dualResidual, 2);
+
+      fits(outer_iteration + 1) = penalizedFit(fit_k);
+
+      if ((control_.verbose > 0) && (outer_iteration % control_.verbose == 0))
+      {
+        print << "Fit in ADMM iteration " << outer_iteration + 1 << ": " << fits(outer_iteration + 1)
+              << " (primal residual: " << primalResidual << ", dual residual: " << dualResidualNorm
+              << ", rho: " << results.rho << ")" << std::endl;
+      }
+
+      const double primalTolerance = std::sqrt((double)numberSplitVariables) * control_.absoluteTolerance +
+                                     control_.relativeTolerance * std::max(std::sqrt(normDtheta), std::sqrt(normZ));
+      const double dualTolerance = std::sqrt((double)numberParameters) * control_.absoluteTolerance +
+                                   control_.relativeTolerance * results.rho * arma::norm(Dtu, 2);
+      if (primalResidual <= primalTolerance && dualResidualNorm <= dualTolerance)
+      {
+        convergence = true;
+        outer_iteration++;
+        break;
+      }
+
+      // residual balancing. The scaled dual variables u = y / rho have to be rescaled as well.
+      if (control_.residualBalancing)
+      {
+        double scale = 1.0;
+        if (primalResidual > control_.balancingFactor * dualResidualNorm)
+          scale = control_.rhoScale;
+        else if (dualResidualNorm > control_.balancingFactor * primalResidual)
+          scale = 1.0 / control_.rhoScale;
+
+        if (scale != 1.0)
+        {
+          results.rho *= scale;
+          for (unsigned int s = 0; s < numberSplits; s++)
+            u.at(s) /= scale;
+          factorize();
+        }
+      }
+    }
+
+    if (!convergence)
+      warn("ADMM did not converge.");
+
+    results.result.fit = penalizedFit(fit_k);
+    results.result.fits = fits;
+    results.result.convergence = convergence;
+    results.result.parameterValues = parameters_k;
+    results.splitValues = z;
+    results.iterations = outer_iteration;
+
+    return (results);
+  }
+
+} // end namespace
+
+#endif
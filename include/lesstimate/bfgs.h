@@ -1,7 +1,11 @@
 #ifndef BFGS_H
 #define BFGS_H
 
+#include <type_traits>
 #include "common_headers.h"
+#include "packedSymmetric.h"
+#include "smoothPenalty.h"
+#include "traits.h"
 
 namespace lessSEM
 {
@@ -117,6 +121,385 @@ namespace lessSEM
     return (Hessian_k);
   }
 
+  /**
+   * @brief computes the BFGS Hessian approximation for a Hessian stored as packed upper triangle.
+   * This requires half the memory of the dense version and the update is computed with two
+   * symmetric rank one updates of the stored elements.
+   *
+   * @param parameters_kMinus1 parameters of previous iteration
+   * @param gradients_kMinus1 gradients of previous iteration
+   * @param Hessian_kMinus1 packed Hessian of previous iteration
+   * @param parameters_k parameters of current iteration
+   * @param gradients_k gradients of current iteration
+   * @param cautious boolean: should the update be skipped if it would result in a non positive definite Hessian?
+   * @param hessianEps controls when the update of the Hessian approximation is skipped
+   * @param verbose if set to true, will print more details
+   * @return packedSymmetricMatrix: returns the updated packed Hessian
+   */
+  inline packedSymmetricMatrix BFGS(
+      const arma::rowvec &parameters_kMinus1,
+      const arma::rowvec &gradients_kMinus1,
+      const packedSymmetricMatrix &Hessian_kMinus1,
+      const arma::rowvec &parameters_k,
+      const arma::rowvec &gradients_k,
+      const bool cautious,
+      const double hessianEps,
+      bool verbose)
+  {
+
+    arma::colvec y = arma::trans(gradients_k - gradients_kMinus1);
+    arma::colvec d = arma::trans(parameters_k - parameters_kMinus1);
+    const double yTimesD = arma::dot(y, d);
+    const bool skipUpdate = (yTimesD < hessianEps) && cautious;
+
+    if (yTimesD < 0)
+    {
+      if (verbose)
+        warn("Hessian update possibly non-positive definite.");
+      if (skipUpdate)
+        return (Hessian_kMinus1);
+    }
+
+    // see e.g., Nocedal, J., & Wright, S. J. (2006). Numerical optimization (2nd ed).
+    // Springer, p. 537 Equation 18.16
+    arma::colvec Hd = Hessian_kMinus1.times(d);
+    const double dHd = arma::dot(d, Hd);
+
+    packedSymmetricMatrix Hessian_k = Hessian_kMinus1;
+    Hessian_k.rankOneUpdate(-1.0 / dHd, Hd);
+    Hessian_k.rankOneUpdate(1.0 / yTimesD, y);
+
+    if (!arma::is_finite(Hessian_k.packed))
+    {
+      if (verbose)
+        warn("Non-finite Hessian. Returning previous Hessian");
+      return (Hessian_kMinus1);
+    }
+
+    // the packed Hessian is symmetric by construction. As in the dense version,
+    // positive definiteness is not tested for symmetric updates.
+    return (Hessian_k);
+  }
+
+  /**
+   * @brief computes the BFGS Hessian approximation for a Hessian with a compile time
+   * dimension (see fixedSize.h). All temporaries are stored on the stack.
+   *
+   * @tparam N number of parameters
+   * @param parameters_kMinus1 parameters of previous iteration
+   * @param gradients_kMinus1 gradients of previous iteration
+   * @param Hessian_kMinus1 Hessian of previous iteration
+   * @param parameters_k parameters of current iteration
+   * @param gradients_k gradients of current iteration
+   * @param cautious boolean: should the update be skipped if it would result in a non positive definite Hessian?
+   * @param hessianEps controls when the update of the Hessian approximation is skipped
+   * @param verbose if set to true, will print more details
+   * @return arma::mat::fixed<N, N>: returns the updated Hessian
+   */
+  template <arma::uword N>
+  inline typename arma::mat::template fixed<N, N> BFGS(
+      const arma::rowvec &parameters_kMinus1,
+      const arma::rowvec &gradients_kMinus1,
+      const typename arma::mat::template fixed<N, N> &Hessian_kMinus1,
+      const arma::rowvec &parameters_k,
+      const arma::rowvec &gradients_k,
+      const bool cautious,
+      const double hessianEps,
+      bool verbose)
+  {
+    double y[N], d[N], Hd[N];
+    double yTimesD = 0.0;
+    for (arma::uword p = 0; p < N; p++)
+    {
+      y[p] = gradients_k.at(p) - gradients_kMinus1.at(p);
+      d[p] = parameters_k.at(p) - parameters_kMinus1.at(p);
+      yTimesD += y[p] * d[p];
+    }
+    const bool skipUpdate = (yTimesD < hessianEps) && cautious;
+
+    if (yTimesD < 0)
+    {
+      if (verbose)
+        warn("Hessian update possibly non-positive definite.");
+      if (skipUpdate)
+        return (Hessian_kMinus1);
+    }
+
+    // see e.g., Nocedal, J., & Wright, S. J. (2006). Numerical optimization (2nd ed).
+    // Springer, p. 537 Equation 18.16
+    double dHd = 0.0;
+    for (arma::uword r = 0; r < N; r++)
+    {
+      Hd[r] = 0.0;
+      for (arma::uword c = 0; c < N; c++)
+        Hd[r] += Hessian_kMinus1.at(r, c) * d[c];
+      dHd += d[r] * Hd[r];
+    }
+
+    // the update is computed for the upper triangle and mirrored, so that the
+    // Hessian is symmetric by construction (see the packed version above)
+    typename arma::mat::template fixed<N, N> Hessian_k;
+    for (arma::uword c = 0; c < N; c++)
+    {
+      for (arma::uword r = 0; r <= c; r++)
+      {
+        const double element = .5 * (Hessian_kMinus1.at(r, c) + Hessian_kMinus1.at(c, r)) -
+                               Hd[r] * Hd[c] / dHd +
+                               y[r] * y[c] / yTimesD;
+        if (!std::isfinite(element))
+        {
+          if (verbose)
+            warn("Non-finite Hessian. Returning previous Hessian");
+          return (Hessian_kMinus1);
+        }
+        Hessian_k.at(r, c) = element;
+        Hessian_k.at(c, r) = element;
+      }
+    }
+
+    return (Hessian_k);
+  }
+
+  /**
+   * @brief computes the BFGS Hessian approximation for a Hessian stored in single precision
+   * (arma::fmat or arma::fmat::fixed, see precision.h). The secant pairs and all sums are
+   * computed in double; only the updated elements are rounded to the scalar type of the Hessian.
+   *
+   * @param parameters_kMinus1 parameters of previous iteration
+   * @param gradients_kMinus1 gradients of previous iteration
+   * @param Hessian_kMinus1 Hessian of previous iteration
+   * @param parameters_k parameters of current iteration
+   * @param gradients_k gradients of current iteration
+   * @param cautious boolean: should the update be skipped if it would result in a non positive definite Hessian?
+   * @param hessianEps controls when the update of the Hessian approximation is skipped
+   * @param verbose if set to true, will print more details
+   * @return hessianType: returns the updated Hessian
+   */
+  template <class hessianType>
+  inline typename std::enable_if<!std::is_same<typename hessianType::elem_type, double>::value, hessianType>::type BFGS(
+      const arma::rowvec &parameters_kMinus1,
+      const arma::rowvec &gradients_kMinus1,
+      const hessianType &Hessian_kMinus1,
+      const arma::rowvec &parameters_k,
+      const arma::rowvec &gradients_k,
+      const bool cautious,
+      const double hessianEps,
+      bool verbose)
+  {
+    using eT = typename hessianType::elem_type;
+
+    const arma::colvec y = arma::trans(gradients_k - gradients_kMinus1);
+    const arma::colvec d = arma::trans(parameters_k - parameters_kMinus1);
+    const double yTimesD = arma::dot(y, d);
+    const bool skipUpdate = (yTimesD < hessianEps) && cautious;
+
+    if (yTimesD < 0)
+    {
+      if (verbose)
+        warn("Hessian update possibly non-positive definite.");
+      if (skipUpdate)
+        return (Hessian_kMinus1);
+    }
+
+    // see e.g., Nocedal, J., & Wright, S. J. (2006). Numerical optimization (2nd ed).
+    // Springer, p. 537 Equation 18.16
+    arma::colvec Hd(d.n_elem, arma::fill::zeros);
+    for (arma::uword c = 0; c < d.n_elem; c++)
+    {
+      for (arma::uword r = 0; r < d.n_elem; r++)
+        Hd.at(r) += static_cast<double>(Hessian_kMinus1.at(r, c)) * d.at(c);
+    }
+    const double dHd = arma::dot(d, Hd);
+
+    // the update is computed for the upper triangle and mirrored (see the fixed size version above)
+    hessianType Hessian_k = Hessian_kMinus1;
+    for (arma::uword c = 0; c < d.n_elem; c++)
+    {
+      for (arma::uword r = 0; r <= c; r++)
+      {
+        const eT element = static_cast<eT>(.5 * (static_cast<double>(Hessian_kMinus1.at(r, c)) +
+                                                 static_cast<double>(Hessian_kMinus1.at(c, r))) -
+                                           Hd.at(r) * Hd.at(c) / dHd +
+                                           y.at(r) * y.at(c) / yTimesD);
+        if (!std::isfinite(element))
+        {
+          if (verbose)
+            warn("Non-finite Hessian. Returning previous Hessian");
+          return (Hessian_kMinus1);
+        }
+        Hessian_k.at(r, c) = element;
+        Hessian_k.at(c, r) = element;
+      }
+    }
+
+    return (Hessian_k);
+  }
+
+  /**
+   * @brief adds the exact Hessian of a smooth penalty to the Hessian approximation of the model.
+   * If exactPenaltyHessian is false or the smooth penalty does not provide its Hessian (see
+   * smoothPenalty::hasHessianDiagonal), the Hessian is returned unchanged.
+   *
+   * @param modelHessian Hessian approximation of the model
+   * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
+   * @param parameterValues current parameter values
+   * @param parameterLabels names of the parameters
+   * @param tuningParameters tuning parameters for the smoothPenalty function
+   * @param exactPenaltyHessian should the exact Hessian of the smooth penalty be used?
+   * @return Hessian of model and smooth penalty (arma::mat, arma::mat::fixed, or a single precision version, see fixedSize.h and precision.h)
+   */
+  template <class smoothPenaltyClass, typename T, class hessianType>
+  inline hessianType addSmoothPenaltyHessian(const hessianType &modelHessian,
+                                           smoothPenaltyClass &smoothPenalty_,
+                                           const arma::rowvec &parameterValues,
+                                           const stringVector &parameterLabels,
+                                           const T &tuningParameters,
+                                           const bool exactPenaltyHessian)
+  {
+    if constexpr (hasHessianDiagonal<smoothPenaltyClass>::value)
+    {
+      if (!exactPenaltyHessian || !smoothPenalty_.hasHessianDiagonal())
+        return (modelHessian);
+      hessianType Hessian = modelHessian;
+      const arma::rowvec penaltyHessian = penaltyHessianDiagonal(smoothPenalty_,
+                                                                 parameterValues,
+                                                                 parameterLabels,
+                                                                 tuningParameters);
+      // element-wise to support Hessians stored in single precision (see precision.h)
+      for (arma::uword p = 0; p < penaltyHessian.n_elem; p++)
+        Hessian.at(p, p) += penaltyHessian.at(p);
+      return (Hessian);
+    }
+    else
+    {
+      static_cast<void>(exactPenaltyHessian); // is unused
+      return (modelHessian);
+    }
+  }
+
+  /**
+   * @brief removes the exact Hessian of a smooth penalty from the Hessian of model and smooth penalty.
+   * If exactPenaltyHessian is false or the smooth penalty does not provide its Hessian (see
+   * smoothPenalty::hasHessianDiagonal), the Hessian is returned unchanged.
+   *
+   * @param Hessian Hessian of model and smooth penalty
+   * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
+   * @param parameterValues current parameter values
+   * @param parameterLabels names of the parameters
+   * @param tuningParameters tuning parameters for the smoothPenalty function
+   * @param exactPenaltyHessian should the exact Hessian of the smooth penalty be used?
+   * @return Hessian approximation of the model (arma::mat, arma::mat::fixed, or a single precision version, see fixedSize.h and precision.h)
+   */
+  template <class smoothPenaltyClass, typename T, class hessianType>
+  inline hessianType removeSmoothPenaltyHessian(const hessianType &Hessian,
+                                              smoothPenaltyClass &smoothPenalty_,
+                                              const arma::rowvec &parameterValues,
+                                              const stringVector &parameterLabels,
+                                              const T &tuningParameters,
+                                              const bool exactPenaltyHessian)
+  {
+    if constexpr (hasHessianDiagonal<smoothPenaltyClass>::value)
+    {
+      if (!exactPenaltyHessian || !smoothPenalty_.hasHessianDiagonal())
+        return (Hessian);
+      hessianType modelHessian = Hessian;
+      const arma::rowvec penaltyHessian = penaltyHessianDiagonal(smoothPenalty_,
+                                                                 parameterValues,
+                                                                 parameterLabels,
+                                                                 tuningParameters);
+      for (arma::uword p = 0; p < penaltyHessian.n_elem; p++)
+        modelHessian.at(p, p) -= penaltyHessian.at(p);
+      return (modelHessian);
+    }
+    else
+    {
+      static_cast<void>(exactPenaltyHessian); // is unused
+      return (Hessian);
+    }
+  }
+
+  /**
+   * @brief computes the BFGS Hessian approximation of a fit function which consists of a model and
+   * a smooth penalty (e.g., ridge). If exactPenaltyHessian is true and the smooth penalty provides the
+   * diagonal of its exact Hessian (see smoothPenalty::hasHessianDiagonal), only the model part is approximated with BFGS and the
+   * Hessian of the smooth penalty is added analytically. The secant pairs are then not
+   * contaminated by the curvature of the penalty, which is often much larger than that of the
+   * model for elastic net paths. Otherwise, the combined Hessian is approximated with BFGS.
+   *
+   * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
+   * @param parameterLabels names of the parameters
+   * @param tuningParameters tuning parameters for the smoothPenalty function
+   * @param exactPenaltyHessian should the exact Hessian of the smooth penalty be used?
+   * @param parameters_kMinus1 parameters of previous iteration
+   * @param gradients_kMinus1 gradients (model + smooth penalty) of previous iteration
+   * @param Hessian_kMinus1 Hessian (model + smooth penalty) of previous iteration
+   * @param parameters_k parameters of current iteration
+   * @param gradients_k gradients (model + smooth penalty) of current iteration
+   * @param cautious boolean: should the update be skipped if it would result in a non positive definite Hessian?
+   * @param hessianEps controls when the update of the Hessian approximation is skipped
+   * @param verbose if set to true, will print more details
+   * @return Hessian (model + smooth penalty) of the current iteration (arma::mat, arma::mat::fixed, or a single precision version, see fixedSize.h and precision.h)
+   */
+  template <class smoothPenaltyClass, typename T, class hessianType>
+  inline hessianType BFGS(
+      smoothPenaltyClass &smoothPenalty_,
+      const stringVector &parameterLabels,
+      const T &tuningParameters,
+      const bool exactPenaltyHessian,
+      const arma::rowvec &parameters_kMinus1,
+      const arma::rowvec &gradients_kMinus1,
+      const hessianType &Hessian_kMinus1,
+      const arma::rowvec &parameters_k,
+      const arma::rowvec &gradients_k,
+      const bool cautious,
+      const double hessianEps,
+      bool verbose)
+  {
+    if (!exactPenaltyHessian || !providesHessianDiagonal(smoothPenalty_))
+      return (BFGS(parameters_kMinus1,
+                   gradients_kMinus1,
+                   Hessian_kMinus1,
+                   parameters_k,
+                   gradients_k,
+                   cautious,
+                   hessianEps,
+                   verbose));
+
+    // remove the smooth penalty from gradients and Hessian
+    const hessianType modelHessian_kMinus1 = removeSmoothPenaltyHessian(Hessian_kMinus1,
+                                                                      smoothPenalty_,
+                                                                      parameters_kMinus1,
+                                                                      parameterLabels,
+                                                                      tuningParameters,
+                                                                      exactPenaltyHessian);
+    const arma::rowvec modelGradients_kMinus1 = gradients_kMinus1 -
+                                                penaltyGradients(smoothPenalty_,
+                                                                 parameters_kMinus1,
+                                                                 parameterLabels,
+                                                                 tuningParameters);
+    const arma::rowvec modelGradients_k = gradients_k -
+                                          penaltyGradients(smoothPenalty_,
+                                                           parameters_k,
+                                                           parameterLabels,
+                                                           tuningParameters);
+
+    const hessianType modelHessian_k = BFGS(parameters_kMinus1,
+                                          modelGradients_kMinus1,
+                                          modelHessian_kMinus1,
+                                          parameters_k,
+                                          modelGradients_k,
+                                          cautious,
+                                          hessianEps,
+                                          verbose);
+
+    return (addSmoothPenaltyHessian(modelHessian_k,
+                                    smoothPenalty_,
+                                    parameters_k,
+                                    parameterLabels,
+                                    tuningParameters,
+                                    exactPenaltyHessian));
+  }
+
 }
 
 #endif
\ No newline at end of file
@@ -7,10 +7,20 @@
 #include "proximalOperator.h"
 #include "glmnet_ridge.h"
 #include "bfgs.h"
+#include "checkpoint.h"
+#include "optimizerState.h"
+#include "finiteDifferenceHessian.h"
+#include "modelCache.h"
+#include "traits.h"
+#include "fixedSize.h"
+#include "precision.h"
 
 // The design follows ensmallen (https://github.com/mlpack/ensmallen) in that the
 // user supplies a C++ class with methods fit and gradients which is used
 // by the optimizer.
+// The optimizer is a template on the classes of the model and the smooth
+// penalty. Any class with the required methods can be used (see traits.h);
+// classes derived from model and smoothPenalty are one instantiation.
 
 // Important: This is not the same implementation of BFGS as that used in, for instance,
 // optim. Instead, the objective was to create a BFGS optimizer for smooth functions
@@ -60,6 +70,22 @@ namespace lessSEM
    * Note that in case of gradients and GLMNET, we divide the gradients (and the Hessian) of the log-Likelihood by N as it would otherwise be
    * considerably more difficult for larger sample sizes to reach the convergence criteria.
    * @var verbose 0 prints no additional information, > 0 prints GLMNET iterations
+   * @var checkpoint settings for writing checkpoints and resuming from them (see checkpoint.h)
+   * @var returnHessian which form of the final Hessian should be returned? possible are returnFullHessian,
+   * returnDiagonalHessian, returnPackedHessian, and returnNoHessian (see fitResults.h).
+   * @var warmStart state of a previous fit used to initialize the optimizer (see optimizerState.h). The Hessian
+   * of the warm start replaces the initialHessian.
+   * @var returnState should the final state of the optimizer be returned in fitResults::state?
+   * @var initialHessianEstimate settings for approximating the initial Hessian with finite differences of the
+   * gradients at the starting values (see finiteDifferenceHessian.h). If the type is not userHessian, the
+   * approximation replaces the initialHessian.
+   * @var exactPenaltyHessian should the exact Hessian of the smooth penalty be added analytically instead of
+   * being approximated with BFGS? Only used if the smooth penalty provides it (see smoothPenalty::hasHessianDiagonal).
+   * The initialHessian, the Hessian of the warmStart, and the Hessian of the returned state then refer to the
+   * model only.
+   * @var packedHessian should the Hessian approximation be stored as packed upper triangle (see packedSymmetric.h)?
+   * This halves the memory of the Hessian and of the BFGS update; the step direction is then computed with a packed
+   * Cholesky decomposition. Only supported for N = 0 and a double precision Hessian.
    */
   struct controlBFGS
   {
@@ -76,6 +102,13 @@ namespace lessSEM
     // breaking condition.
     const int verbose; // if set to a value > 0, the fit every verbose iterations
     // is printed.
+    const controlCheckpoint checkpoint; // write checkpoints / resume from a checkpoint
+    const hessianReturn returnHessian;  // full, diagonal, packed, or no Hessian
+    const optimizerState warmStart;     // state of a previous fit
+    const bool returnState;             // return the final state for warm starts
+    const controlInitialHessian initialHessianEstimate; // finite difference initial Hessian
+    const bool exactPenaltyHessian;                     // add the exact Hessian of the smooth penalty
+    const bool packedHessian;                           // store only the upper triangle of the Hessian
   };
 
   /**
@@ -101,16 +134,20 @@ namespace lessSEM
    * @param verbose 0 prints no additional information, > 0 prints GLMNET iterations
    * @return vector with updated parameters (parameters_k)
    */
-  template <typename T> // T is the type of the tuning parameters
-  inline arma::rowvec bfgsLineSearch(
-      model &model_,
-      smoothPenalty<T> &smoothPenalty_,
-      const arma::rowvec &parameters_kMinus1,
+  template <typename T, // T is the type of the tuning parameters
+            class modelClass,
+            class smoothPenaltyClass,
+            class hessianType,
+            class rowvecType> // vector type of the parameters (see fixedSize.h)
+  inline rowvecType bfgsLineSearch(
+      modelClass &model_,
+      smoothPenaltyClass &smoothPenalty_,
+      const rowvecType &parameters_kMinus1,
       const stringVector &parameterLabels,
       const arma::rowvec &direction,
       const double fit_kMinus1,
       const arma::rowvec &gradients_kMinus1,
-      const arma::mat &Hessian_kMinus1,
+      const hessianType &Hessian_kMinus1,
 
       const T &tuningParameters,
 
@@ -121,9 +158,9 @@ namespace lessSEM
       const int verbose)
   {
 
-    arma::rowvec gradients_k(gradients_kMinus1.n_rows);
+    rowvecType gradients_k = parameters_kMinus1;
     gradients_k.fill(arma::datum::nan);
-    arma::rowvec parameters_k(gradients_kMinus1.n_rows);
+    rowvecType parameters_k = parameters_kMinus1;
     parameters_k.fill(arma::datum::nan);
 
     numericVector randomNumber;
@@ -170,6 +207,9 @@ namespace lessSEM
 
     bool converged = false;
 
+    const int batchSize = modelBatchSize(model_);
+    arma::colvec batchFits;
+
     for (int iteration = 0; iteration < maxIterLine; iteration++)
     {
 
@@ -179,11 +219,29 @@ namespace lessSEM
 
       parameters_k = parameters_kMinus1 + currentStepSize * direction;
 
-      fit_k = model_.fit(parameters_k,
-                         parameterLabels) +
-              smoothPenalty_.getValue(parameters_k,
-                                      parameterLabels,
-                                      tuningParameters);
+      // models which evaluate several points at once get the fits of the
+      // next batchSize step sizes in a single call (see model::fitBatch)
+      if (batchSize > 1)
+      {
+        if (iteration % batchSize == 0)
+        {
+          arma::mat points(std::min(batchSize, maxIterLine - iteration), parameters_kMinus1.n_elem);
+          for (unsigned int b = 0; b < points.n_rows; b++)
+            points.row(b) = parameters_kMinus1 + std::pow(stepSize, iteration + b) * direction;
+          batchFits = modelFitBatch(model_, points, parameterLabels, 1);
+        }
+        fit_k = batchFits.at(iteration % batchSize);
+      }
+      else
+      {
+        fit_k = modelFit(model_,
+                         parameters_k,
+                         parameterLabels);
+      }
+      fit_k += penaltyValue(smoothPenalty_,
+                            parameters_k,
+                            parameterLabels,
+                            tuningParameters);
 
       if (!arma::is_finite(fit_k))
       {
@@ -206,22 +264,23 @@ namespace lessSEM
       // The Journal of Machine Learning Research, 13, 1999–2030.
       // https://doi.org/10.1145/2020408.2020421
 
-      arma::mat compareTo =
-          gradients_kMinus1 * arma::trans(direction) + // gradients and direction typically show
+      const double compareTo =
+          arma::dot(gradients_kMinus1, direction) + // gradients and direction typically show
           // in the same direction -> positive
-          gamma * (direction * Hessian_kMinus1 * arma::trans(direction)) + // always positive
+          gamma * quadraticForm(direction, Hessian_kMinus1) + // always positive
           pen_d - pen_0;
       // gamma is set to zero by Yuan et al. (2012)
       // if sigma is 0, no decrease is necessary
 
-      converged = f_k - f_0 <= sigma * currentStepSize * compareTo(0, 0);
+      converged = f_k - f_0 <= sigma * currentStepSize * compareTo;
 
       if (converged)
       {
         // check if gradients can be computed at the new location;
         // this can often cause issues
-        gradients_k = model_.gradients(parameters_k,
-                                       parameterLabels);
+        gradients_k = modelGradients(model_,
+                                     parameters_k,
+                                     parameterLabels);
 
         if (!arma::is_finite(gradients_k))
         {
@@ -246,23 +305,44 @@ namespace lessSEM
   // the use of Rcpp::NumericVectors that combine values and labels similar to an R vector. Thus, interfacing to this
   // second function call can be easier when coming from R.
 
+  template <arma::uword N, typename eT, typename T, class modelClass, class smoothPenaltyClass>
+  inline lessSEM::fitResults bfgsOptim(modelClass &model_,
+                                       numericVector startingValuesRcpp,
+                                       smoothPenaltyClass &smoothPenalty_,
+                                       const T &tuningParameters,
+                                       const controlBFGS &control_);
+
   /**
-   * @brief Optimize a model using the BFGS procedure.
+   * @brief Optimize a model using the BFGS procedure with the Hessian stored in matType. Called
+   * by bfgsOptim, which selects the storage.
    *
-   * @param model_ the model object derived from the model class in model.h
+   * @tparam N number of parameters if known at compile time; 0 uses dynamic storage (see fixedSize.h)
+   * @tparam eT scalar type of the Hessian (see precision.h)
+   * @tparam matType storage of the Hessian (see fixedSize.h and packedSymmetric.h)
+   * @param model_ the model object derived from the model class in model.h or any class with the methods fit and gradients (see traits.h)
    * @param startingValuesRcpp an Rcpp numeric vector with starting values
    * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
    * @param tuningParameters tuning parameters for the smoothPenalty function
    * @param control_ settings for the BFGS optimizer. Must be of struct controlBFGS. This can be created with controlBFGS.
    * @return fit result
    */
-  template <typename T> // T is the type of the tuning parameters
-  inline lessSEM::fitResults bfgsOptim(model &model_,
-                                       numericVector startingValuesRcpp,
-                                       smoothPenalty<T> &smoothPenalty_,
-                                       const T &tuningParameters, // tuning parameters are of type T
-                                       const controlBFGS &control_)
+  template <arma::uword N,
+            typename eT,
+            class matType,
+            typename T,
+            class modelClass,
+            class smoothPenaltyClass>
+  inline lessSEM::fitResults bfgsOptimWithHessian(modelClass &model_,
+                                                  numericVector startingValuesRcpp,
+                                                  smoothPenaltyClass &smoothPenalty_,
+                                                  const T &tuningParameters,
+                                                  const controlBFGS &control_)
   {
+    static_assert(isModel<modelClass>::value,
+                  "The model must provide the methods fit and gradients (see model.h).");
+    static_assert(isSmoothPenalty<smoothPenaltyClass, T>::value,
+                  "The smooth penalty must provide the methods getValue and getGradients (see smoothPenalty.h).");
+
     if (control_.verbose != 0)
     {
       print << "Optimizing with bfgs.\n";
@@ -272,23 +352,34 @@ namespace lessSEM
     arma::rowvec startingValues = toArmaVector(startingValuesRcpp);
     const stringVector parameterLabels = startingValuesRcpp.names();
 
+    // parameters, gradients, and Hessian are stored on the stack if the
+    // number of parameters is known at compile time
+    checkFixedSize<N>(startingValues.n_elem);
+    using rowvecType = typename fixedSize<N>::rowvec;
+
+    // the model is often evaluated repeatedly at the same parameter values;
+    // cachedModel_ returns stored results in this case (see modelCache.h)
+    cachedModel<modelClass, rowvecType> cachedModel_(model_);
+
     // prepare parameter vectors
-    arma::rowvec parameters_k = startingValues,
-                 parameters_kMinus1 = startingValues;
-    arma::rowvec direction(startingValues.n_elem);
+    rowvecType parameters_k = startingValues,
+               parameters_kMinus1 = startingValues;
+    rowvecType direction = startingValues;
 
     // prepare fit elements
     // fit of the smooth part of the fit function
-    double fit_k = model_.fit(parameters_k,
+    double fit_k = cachedModel_.fit(parameters_k,
                               parameterLabels) +
-                   smoothPenalty_.getValue(parameters_k,
-                                           parameterLabels,
-                                           tuningParameters);
-    double fit_kMinus1 = model_.fit(parameters_kMinus1,
+                   penaltyValue(smoothPenalty_,
+                                parameters_k,
+                                parameterLabels,
+                                tuningParameters);
+    double fit_kMinus1 = cachedModel_.fit(parameters_kMinus1,
                                     parameterLabels) +
-                         smoothPenalty_.getValue(parameters_kMinus1,
-                                                 parameterLabels,
-                                                 tuningParameters);
+                         penaltyValue(smoothPenalty_,
+                                      parameters_kMinus1,
+                                      parameterLabels,
+                                      tuningParameters);
     // add non-differentiable part -> there is none here
     double penalizedFit_k = fit_k;
 
@@ -302,27 +393,78 @@ namespace lessSEM
     // prepare gradient elements
     // NOTE: We combine the gradients of the smooth functions (the log-Likelihood)
     // of the model and the smooth penalty function (e.g., ridge)
-    arma::rowvec gradients_k = model_.gradients(parameters_k,
-                                                parameterLabels) +
-                               smoothPenalty_.getGradients(parameters_k,
-                                                           parameterLabels,
-                                                           tuningParameters); // ridge part
-    arma::rowvec gradients_kMinus1 = model_.gradients(parameters_kMinus1,
-                                                      parameterLabels) +
-                                     smoothPenalty_.getGradients(parameters_kMinus1,
-                                                                 parameterLabels,
-                                                                 tuningParameters); // ridge part
+    rowvecType gradients_k = cachedModel_.gradients(parameters_k,
+                                                    parameterLabels) +
+                               penaltyGradients(smoothPenalty_,
+                                                parameters_k,
+                                                parameterLabels,
+                                                tuningParameters); // ridge part
+    rowvecType gradients_kMinus1 = cachedModel_.gradients(parameters_kMinus1,
+                                                          parameterLabels) +
+                                     penaltyGradients(smoothPenalty_,
+                                                      parameters_kMinus1,
+                                                      parameterLabels,
+                                                      tuningParameters); // ridge part
 
     // prepare Hessian elements
-    arma::mat Hessian_k = control_.initialHessian,
-              Hessian_kMinus1 = control_.initialHessian;
+    matType Hessian_k = toHessianType<matType>(control_.initialHessian),
+            Hessian_kMinus1 = Hessian_k;
+
+    // approximate the initial Hessian with finite differences. The unwrapped model is used
+    // because the gradients may be evaluated in parallel and cachedModel is not thread-safe
+    if ((control_.initialHessianEstimate.type != userHessian) &&
+        (control_.warmStart.Hessian.n_elem == 0))
+    {
+      Hessian_k = toHessianType<matType>(approximateInitialHessian(model_,
+                                                                   startingValues,
+                                                                   parameterLabels,
+                                                                   control_.initialHessianEstimate));
+      Hessian_kMinus1 = Hessian_k;
+    }
+
+    // warm start from a previous fit
+    if (hasWarmStartHessian(control_.warmStart, startingValues.n_elem))
+    {
+      Hessian_k = toHessianType<matType>(control_.warmStart.Hessian);
+      Hessian_kMinus1 = Hessian_k;
+    }
+
+    // with exactPenaltyHessian, the initial Hessian refers to the model only. The exact
+    // Hessian of the smooth penalty is added here and BFGS only approximates the model part.
+    Hessian_k = addSmoothPenaltyHessian(Hessian_k,
+                                        smoothPenalty_,
+                                        parameters_k,
+                                        parameterLabels,
+                                        tuningParameters,
+                                        control_.exactPenaltyHessian);
+    Hessian_kMinus1 = Hessian_k;
 
     // breaking flags
     bool breakOuter = false; // if true, the outer iteration is exited
 
+    // resume from a checkpoint
+    int firstIteration = 0;
+    if (!control_.checkpoint.resumeFrom.empty())
+    {
+      optimizerCheckpoint checkpoint_ = readCheckpoint(control_.checkpoint.resumeFrom,
+                                                       checkpointBfgs,
+                                                       startingValues.n_elem);
+      firstIteration = checkpoint_.iteration + 1;
+      fit_k = fit_kMinus1 = checkpoint_.fit_kMinus1;
+      penalizedFit_k = penalizedFit_kMinus1 = checkpoint_.penalizedFit_kMinus1;
+      parameters_k = parameters_kMinus1 = checkpoint_.parameters_kMinus1;
+      gradients_k = gradients_kMinus1 = checkpoint_.gradients_kMinus1;
+      Hessian_k = Hessian_kMinus1 = toHessianType<matType>(checkpoint_.Hessian_kMinus1);
+      fits = restoreFits(checkpoint_.fits, control_.maxIterOut);
+      setRandomState(checkpoint_.randomState);
+    }
+    std::unique_ptr<checkpointWriter> checkpointWriter_ = makeCheckpointWriter(control_.checkpoint);
+
     // outer iteration
-    for (int outer_iteration = 0; outer_iteration < control_.maxIterOut; outer_iteration++)
+    int numberIterations = firstIteration; // number of outer iterations
+    for (int outer_iteration = firstIteration; outer_iteration < control_.maxIterOut; outer_iteration++)
     {
+      numberIterations = outer_iteration + 1;
 
       // check if user wants to stop the computation:
 #if USE_R
@@ -331,14 +473,14 @@ namespace lessSEM
 
       // the gradients will be used by the inner iteration to compute the new
       // parameters
-      gradients_kMinus1 = model_.gradients(parameters_kMinus1, parameterLabels) +
-                          smoothPenalty_.getGradients(parameters_kMinus1, parameterLabels, tuningParameters); // ridge part
+      gradients_kMinus1 = cachedModel_.gradients(parameters_kMinus1, parameterLabels) +
+                          penaltyGradients(smoothPenalty_, parameters_kMinus1, parameterLabels, tuningParameters); // ridge part
 
       // find step direction -> simple quasi-Newton step
-      direction = -arma::trans(arma::solve(Hessian_kMinus1, arma::trans(gradients_kMinus1)));
+      direction = quasiNewtonDirection(Hessian_kMinus1, gradients_kMinus1);
 
       // find length of step in direction
-      parameters_k = bfgsLineSearch(model_,
+      parameters_k = bfgsLineSearch(cachedModel_,
                                     smoothPenalty_,
                                     parameters_kMinus1,
                                     parameterLabels,
@@ -356,17 +498,19 @@ namespace lessSEM
                                     control_.verbose);
 
       // get gradients of differentiable part
-      gradients_k = model_.gradients(parameters_k,
+      gradients_k = cachedModel_.gradients(parameters_k,
                                      parameterLabels) +
-                    smoothPenalty_.getGradients(parameters_k,
-                                                parameterLabels,
-                                                tuningParameters);
+                    penaltyGradients(smoothPenalty_,
+                                     parameters_k,
+                                     parameterLabels,
+                                     tuningParameters);
       // fit of the smooth part of the fit function
-      fit_k = model_.fit(parameters_k,
+      fit_k = cachedModel_.fit(parameters_k,
                          parameterLabels) +
-              smoothPenalty_.getValue(parameters_k,
-                                      parameterLabels,
-                                      tuningParameters);
+              penaltyValue(smoothPenalty_,
+                           parameters_k,
+                           parameterLabels,
+                           tuningParameters);
       // add non-differentiable part -> there is none here
       penalizedFit_k = fit_k;
 
@@ -386,6 +530,10 @@ namespace lessSEM
 
       // Approximate Hessian using BFGS
       Hessian_k = lessSEM::BFGS(
+          smoothPenalty_,
+          parameterLabels,
+          tuningParameters,
+          control_.exactPenaltyHessian,
           parameters_kMinus1,
           gradients_kMinus1,
           Hessian_kMinus1,
@@ -398,13 +546,9 @@ namespace lessSEM
       // check convergence
       if (control_.convergenceCriterion == GLMNET_)
       {
-        arma::mat HessDiag = arma::eye(Hessian_k.n_rows,
-                                       Hessian_k.n_cols);
-        HessDiag.fill(0.0);
-        HessDiag.diag() = Hessian_k.diag();
         try
         {
-          breakOuter = max(HessDiag * arma::pow(arma::trans(direction), 2)) < control_.breakOuter;
+          breakOuter = arma::max(hessianDiagonal(Hessian_k) % arma::pow(arma::trans(direction), 2)) < control_.breakOuter;
         }
         catch (...)
         {
@@ -452,6 +596,24 @@ namespace lessSEM
       gradients_kMinus1 = gradients_k;
       Hessian_kMinus1 = Hessian_k;
 
+      if (checkpointWriter_ && writeCheckpointNow(control_.checkpoint, outer_iteration))
+      {
+        checkpointWriter_->submit(
+            {checkpointBfgs,
+             outer_iteration,
+             fit_kMinus1,
+             penalizedFit_kMinus1,
+             0.0, // L_kMinus1 is not used by bfgs
+             parameters_kMinus1,
+             parameters_kMinus1,
+             gradients_kMinus1,
+             fits,
+             toDoubleMatrix(Hessian_kMinus1),
+             getRandomState(),
+             screeningResults(), // bfgs does not use screening
+             0});                // momentumIteration is only used by ista
+      }
+
     } // end outer iteration
 
     if (!breakOuter)
@@ -465,7 +627,65 @@ namespace lessSEM
     fitResults_.fit = penalizedFit_k;
     fitResults_.fits = fits;
     fitResults_.parameterValues = parameters_k;
-    fitResults_.Hessian = Hessian_k;
+    setHessian(fitResults_, toDoubleMatrix(Hessian_k), control_.returnHessian);
+    if (control_.returnState)
+    {
+      // with exactPenaltyHessian, the Hessian of the state refers to the model only;
+      // the next fit adds the Hessian of its own smooth penalty (see initialHessian)
+      fitResults_.state.Hessian = toDoubleMatrix(removeSmoothPenaltyHessian(Hessian_k,
+                                                                            smoothPenalty_,
+                                                                            parameters_k,
+                                                                            parameterLabels,
+                                                                            tuningParameters,
+                                                                            control_.exactPenaltyHessian));
+      fitResults_.state.gradients = gradients_k;
+      fitResults_.state.activeSet = getActiveSet(parameters_k);
+    }
+    fitResults_.phaseIterations = {numberIterations};
+
+    if constexpr (!std::is_same<eT, double>::value)
+    {
+      // polish the single precision solution with a few iterations in double precision. The
+      // Hessian of the single precision fit is used as warm start.
+      optimizerState polishState;
+      polishState.Hessian = toDoubleMatrix(removeSmoothPenaltyHessian(Hessian_k,
+                                                                      smoothPenalty_,
+                                                                      parameters_k,
+                                                                      parameterLabels,
+                                                                      tuningParameters,
+                                                                      control_.exactPenaltyHessian));
+      const controlBFGS polishControl = {
+          control_.initialHessian,
+          control_.stepSize,
+          control_.sigma,
+          control_.gamma,
+          std::min(control_.maxIterOut, maxPolishIterations),
+          control_.maxIterIn,
+          control_.maxIterLine,
+          control_.breakOuter,
+          control_.breakInner,
+          control_.convergenceCriterion,
+          control_.verbose,
+          controlCheckpointDefault(), // checkpoints refer to the single precision iterations
+          control_.returnHessian,
+          polishState,
+          control_.returnState,
+          controlInitialHessianDefault(),
+          control_.exactPenaltyHessian,
+          false}; // packedHessian
+
+      numericVector polishStart = toNumericVector(parameters_k);
+      polishStart.names() = parameterLabels;
+      fitResults polished = bfgsOptim<N, double>(model_,
+                                                 polishStart,
+                                                 smoothPenalty_,
+                                                 tuningParameters,
+                                                 polishControl);
+      // fits of the single precision iterations followed by those of the polishing iterations
+      polished.fits = arma::join_rows(fits, polished.fits);
+      polished.phaseIterations = {numberIterations, polished.phaseIterations.at(0)};
+      return (polished);
+    }
 
     return (fitResults_);
 
@@ -474,8 +694,55 @@ namespace lessSEM
   /**
    * @brief Optimize a model using the BFGS procedure.
    *
+   * @tparam N number of parameters if known at compile time; 0 uses dynamic storage (see fixedSize.h)
+   * @tparam eT scalar type of the Hessian. float stores the Hessian in single precision and polishes
+   * the solution in double precision (see precision.h).
+   * @param model_ the model object derived from the model class in model.h or any class with the methods fit and gradients (see traits.h)
+   * @param startingValuesRcpp an Rcpp numeric vector with starting values
+   * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
+   * @param tuningParameters tuning parameters for the smoothPenalty function
+   * @param control_ settings for the BFGS optimizer. Must be of struct controlBFGS. This can be created with controlBFGS.
+   * @return fit result
+   */
+  template <arma::uword N = 0,     // number of parameters if known at compile time (see fixedSize.h)
+            typename eT = double, // scalar type of the Hessian (see precision.h)
+            typename T,           // T is the type of the tuning parameters
+            class modelClass,
+            class smoothPenaltyClass>
+  inline lessSEM::fitResults bfgsOptim(modelClass &model_,
+                                       numericVector startingValuesRcpp,
+                                       smoothPenaltyClass &smoothPenalty_,
+                                       const T &tuningParameters, // tuning parameters are of type T
+                                       const controlBFGS &control_)
+  {
+    // the packed Hessian stores only the upper triangle (see packedSymmetric.h)
+    if constexpr (N == 0 && std::is_same<eT, double>::value)
+    {
+      if (control_.packedHessian)
+        return (bfgsOptimWithHessian<N, eT, packedSymmetricMatrix>(model_,
+                                                                   startingValuesRcpp,
+                                                                   smoothPenalty_,
+                                                                   tuningParameters,
+                                                                   control_));
+    }
+    else if (control_.packedHessian)
+    {
+      error("packedHessian is only supported for a dynamic number of parameters and a double precision Hessian.");
+    }
+    return (bfgsOptimWithHessian<N, eT, typename fixedSize<N, eT>::mat>(model_,
+                                                                        startingValuesRcpp,
+                                                                        smoothPenalty_,
+                                                                        tuningParameters,
+                                                                        control_));
+  }
+
+  /**
+   * @brief Optimize a model using the BFGS procedure.
+   *
+   * @tparam N number of parameters if known at compile time; 0 uses dynamic storage (see fixedSize.h)
+   * @tparam eT scalar type of the Hessian (see precision.h)
    * @tparam T type of the tuning parameters
-   * @param model_ the model object derived from the model class in model.h
+   * @param model_ the model object derived from the model class in model.h or any class with the methods fit and gradients (see traits.h)
    * @param startingValues an arma::rowvec numeric vector with starting values
    * @param parameterLabels a lessSEM::stringVector with labels for parameters
    * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
@@ -483,11 +750,15 @@ namespace lessSEM
    * @param control_ settings for the BFGS optimizer. Must be of struct controlBFGS. This can be created with controlBFGS.
    * @return fit result
    */
-  template <typename T> // T is the type of the tuning parameters
-  inline lessSEM::fitResults bfgsOptim(model &model_,
+  template <arma::uword N = 0,     // number of parameters if known at compile time (see fixedSize.h)
+            typename eT = double, // scalar type of the Hessian (see precision.h)
+            typename T,           // T is the type of the tuning parameters
+            class modelClass,
+            class smoothPenaltyClass>
+  inline lessSEM::fitResults bfgsOptim(modelClass &model_,
                                        arma::rowvec startingValues,
                                        stringVector parameterLabels,
-                                       smoothPenalty<T> &smoothPenalty_,
+                                       smoothPenaltyClass &smoothPenalty_,
                                        const T &tuningParameters, // tuning parameters are of type T
                                        const controlBFGS &control_)
   {
@@ -496,11 +767,11 @@ namespace lessSEM
     startingValuesNumVec.names() = parameterLabels;
 
     return (
-        bfgsOptim(model_,
-                  startingValuesNumVec,
-                  smoothPenalty_,
-                  tuningParameters, // tuning parameters are of type T
-                  control_));
+        bfgsOptim<N, eT>(model_,
+                         startingValuesNumVec,
+                         smoothPenalty_,
+                         tuningParameters, // tuning parameters are of type T
+                         control_));
   }
 
 } // end namespace
@@ -0,0 +1,482 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "common_headers.h"
+#include "screening.h"
+
+// Long optimizations may be interrupted (e.g., when a job is pre-empted on a
+// cluster). The following allows the optimizers to write their state to a
+// binary file at regular intervals and to resume from such a file later on.
+// Checkpoints are written by a background thread so that the outer iterations
+// are not stalled by the file system.
+
+namespace lessSEM
+{
+
+  /**
+   * @brief specifies which optimizer created a checkpoint
+   *
+   */
+  enum checkpointOptimizer
+  {
+    checkpointIsta = 1,   ///> checkpoint written by ista
+    checkpointGlmnet = 2, ///> checkpoint written by glmnet
+    checkpointBfgs = 3    ///> checkpoint written by bfgsOptim
+  };
+  const std::vector<std::string> checkpointOptimizer_txt = {
+      "",
+      "ista",
+      "glmnet",
+      "bfgs"};
+
+  /**
+   * @struct controlCheckpoint
+   * @brief Settings for writing and reading checkpoints
+   *
+   * @var file file to which checkpoints are written. An empty string disables checkpoints.
+   * @var interval a checkpoint is written every interval outer iterations. 0 disables checkpoints.
+   * @var resumeFrom checkpoint file to resume the optimization from. An empty string starts a new optimization.
+   */
+  struct controlCheckpoint
+  {
+    std::string file;
+    int interval;
+    std::string resumeFrom;
+  };
+
+  /**
+   * @brief Returns the default checkpoint settings (no checkpoints).
+   *
+   * @return controlCheckpoint
+   */
+  inline controlCheckpoint controlCheckpointDefault()
+  {
+    controlCheckpoint defaultIs = {
+        "", // file
+        0,  // interval
+        ""  // resumeFrom
+    };
+    return (defaultIs);
+  }
+
+  /**
+   * @struct optimizerCheckpoint
+   * @brief The state of an optimizer at the end of an outer iteration. All elements
+   * refer to the values after the previous values have been replaced with the
+   * current ones (i.e., the state at the start of the next outer iteration).
+   *
+   * @var optimizer which optimizer wrote the checkpoint
+   * @var iteration last outer iteration that was completed
+   * @var fit_kMinus1 fit of the smooth part of the fitting function
+   * @var penalizedFit_kMinus1 fit including the non-differentiable penalty
+   * @var L_kMinus1 step size of ista; radius of the trust region of glmnet (0 if unused; unused by bfgs)
+   * @var parameters_kMinus1 current parameter values
+   * @var parameters_kMinus2 previous parameter values (required for the acceleration in ista)
+   * @var gradients_kMinus1 gradients of the smooth part of the fitting function
+   * @var fits fits of all outer iterations so far
+   * @var Hessian_kMinus1 BFGS Hessian approximation (unused by ista)
+   * @var randomState state of the random number generator (see getRandomState)
+   * @var screening statistics of the safe screening including the removed parameters (unused by bfgs)
+   * @var momentumIteration number of iterations since the momentum of ista was (re)started (unused by glmnet and bfgs)
+   */
+  struct optimizerCheckpoint
+  {
+    checkpointOptimizer optimizer;
+    int iteration;
+    double fit_kMinus1;
+    double penalizedFit_kMinus1;
+    double L_kMinus1;
+    arma::rowvec parameters_kMinus1;
+    arma::rowvec parameters_kMinus2;
+    arma::rowvec gradients_kMinus1;
+    arma::rowvec fits;
+    arma::mat Hessian_kMinus1;
+    std::string randomState;
+    screeningResults screening;
+    int momentumIteration;
+  };
+
+  // The binary format is given by:
+  // magic "LSCK" | uint32 version | uint32 byte order mark | uint8 optimizer | int32 iteration |
+  // 3 x double (fit_kMinus1, penalizedFit_kMinus1, L_kMinus1) |
+  // 4 x vector (uint64 length followed by the doubles) |
+  // matrix (uint64 rows, uint64 cols followed by the doubles in column-major order) |
+  // string (uint64 length followed by the characters) |
+  // screening (uint64 number of removed parameters followed by uint32 index and int32 iteration of each,
+  // int32 checks, double gap, uint8 gapConverged; since version 2) |
+  // int32 momentumIteration (since version 3)
+  const char checkpointMagic[4] = {'L', 'S', 'C', 'K'};
+  const std::uint32_t checkpointVersion = 3;
+  const std::uint32_t checkpointByteOrder = 0x01020304;
+
+  /**
+   * @brief write a single value in binary format
+   *
+   * @tparam T type of the value
+   * @param out output stream
+   * @param value value to write
+   */
+  template <typename T>
+  inline void writeBinary(std::ostream &out, const T &value)
+  {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  /**
+   * @brief read a single value in binary format
+   *
+   * @tparam T type of the value
+   * @param in input stream
+   * @return T
+   */
+  template <typename T>
+  inline T readBinary(std::istream &in)
+  {
+    T value;
+    in.read(reinterpret_cast<char *>(&value), sizeof(T));
+    if (!in)
+      error("Unexpected end of checkpoint file.");
+    return (value);
+  }
+
+  /**
+   * @brief write an armadillo matrix (or vector) in binary format
+   *
+   * @param out output stream
+   * @param matrix matrix to write
+   */
+  inline void writeBinaryMatrix(std::ostream &out, const arma::mat &matrix)
+  {
+    writeBinary<std::uint64_t>(out, matrix.n_rows);
+    writeBinary<std::uint64_t>(out, matrix.n_cols);
+    out.write(reinterpret_cast<const char *>(matrix.memptr()),
+              sizeof(double) * matrix.n_elem);
+  }
+
+  /**
+   * @brief read an armadillo matrix in binary format
+   *
+   * @param in input stream
+   * @return arma::mat
+   */
+  inline arma::mat readBinaryMatrix(std::istream &in)
+  {
+    std::uint64_t nRows = readBinary<std::uint64_t>(in);
+    std::uint64_t nCols = readBinary<std::uint64_t>(in);
+    arma::mat matrix(nRows, nCols);
+    in.read(reinterpret_cast<char *>(matrix.memptr()),
+            sizeof(double) * matrix.n_elem);
+    if (!in)
+      error("Unexpected end of checkpoint file.");
+    return (matrix);
+  }
+
+  /**
+   * @brief write an armadillo row vector in binary format
+   *
+   * @param out output stream
+   * @param vector vector to write
+   */
+  inline void writeBinaryVector(std::ostream &out, const arma::rowvec &vector)
+  {
+    writeBinary<std::uint64_t>(out, vector.n_elem);
+    out.write(reinterpret_cast<const char *>(vector.memptr()),
+              sizeof(double) * vector.n_elem);
+  }
+
+  /**
+   * @brief read an armadillo row vector in binary format
+   *
+   * @param in input stream
+   * @return arma::rowvec
+   */
+  inline arma::rowvec readBinaryVector(std::istream &in)
+  {
+    std::uint64_t nElem = readBinary<std::uint64_t>(in);
+    arma::rowvec vector(nElem);
+    in.read(reinterpret_cast<char *>(vector.memptr()),
+            sizeof(double) * vector.n_elem);
+    if (!in)
+      error("Unexpected end of checkpoint file.");
+    return (vector);
+  }
+
+  /**
+   * @brief write a checkpoint to a file. The checkpoint is first written to
+   * a temporary file which is then renamed. Therefore, an interruption while
+   * writing does not corrupt a previous checkpoint.
+   *
+   * @param checkpoint_ checkpoint to write
+   * @param file name of the file
+   * @return true if the checkpoint was written successfully
+   */
+  inline bool writeCheckpoint(const optimizerCheckpoint &checkpoint_,
+                              const std::string &file)
+  {
+    const std::string tmpFile = file + ".tmp";
+    {
+      std::ofstream out(tmpFile, std::ios::binary | std::ios::trunc);
+      if (!out)
+        return (false);
+
+      out.write(checkpointMagic, 4);
+      writeBinary<std::uint32_t>(out, checkpointVersion);
+      writeBinary<std::uint32_t>(out, checkpointByteOrder);
+      writeBinary<std::uint8_t>(out, static_cast<std::uint8_t>(checkpoint_.optimizer));
+      writeBinary<std::int32_t>(out, checkpoint_.iteration);
+      writeBinary<double>(out, checkpoint_.fit_kMinus1);
+      writeBinary<double>(out, checkpoint_.penalizedFit_kMinus1);
+      writeBinary<double>(out, checkpoint_.L_kMinus1);
+      writeBinaryVector(out, checkpoint_.parameters_kMinus1);
+      writeBinaryVector(out, checkpoint_.parameters_kMinus2);
+      writeBinaryVector(out, checkpoint_.gradients_kMinus1);
+      writeBinaryVector(out, checkpoint_.fits);
+      writeBinaryMatrix(out, checkpoint_.Hessian_kMinus1);
+      writeBinary<std::uint64_t>(out, checkpoint_.randomState.size());
+      out.write(checkpoint_.randomState.data(), checkpoint_.randomState.size());
+      writeBinary<std::uint64_t>(out, checkpoint_.screening.screened.size());
+      for (std::size_t i = 0; i < checkpoint_.screening.screened.size(); i++)
+      {
+        writeBinary<std::uint32_t>(out, checkpoint_.screening.screened.at(i));
+        writeBinary<std::int32_t>(out, checkpoint_.screening.screenedInIteration.at(i));
+      }
+      writeBinary<std::int32_t>(out, checkpoint_.screening.checks);
+      writeBinary<double>(out, checkpoint_.screening.gap);
+      writeBinary<std::uint8_t>(out, checkpoint_.screening.gapConverged);
+      writeBinary<std::int32_t>(out, checkpoint_.momentumIteration);
+
+      out.flush();
+      if (!out)
+        return (false);
+    }
+#ifdef _WIN32
+    // std::rename does not replace existing files on Windows
+    std::remove(file.c_str());
+#endif
+    return (std::rename(tmpFile.c_str(), file.c_str()) == 0);
+  }
+
+  /**
+   * @brief read a checkpoint from a file
+   *
+   * @param file name of the file
+   * @return optimizerCheckpoint
+   */
+  inline optimizerCheckpoint readCheckpoint(const std::string &file)
+  {
+    std::ifstream in(file, std::ios::binary);
+    if (!in)
+      error("Could not open checkpoint file " + file);
+
+    char magic[4];
+    in.read(magic, 4);
+    if (!in || !std::equal(magic, magic + 4, checkpointMagic))
+      error(file + " is not a lesstimate checkpoint.");
+    // version 1 did not store the screening, version 2 not the momentum of ista
+    const std::uint32_t version = readBinary<std::uint32_t>(in);
+    if (version < 1 || version > checkpointVersion)
+      error("Unsupported checkpoint version in " + file);
+    if (readBinary<std::uint32_t>(in) != checkpointByteOrder)
+      error("The checkpoint " + file + " was written on a machine with a different byte order.");
+
+    optimizerCheckpoint checkpoint_;
+    checkpoint_.optimizer = static_cast<checkpointOptimizer>(readBinary<std::uint8_t>(in));
+    checkpoint_.iteration = readBinary<std::int32_t>(in);
+    checkpoint_.fit_kMinus1 = readBinary<double>(in);
+    checkpoint_.penalizedFit_kMinus1 = readBinary<double>(in);
+    checkpoint_.L_kMinus1 = readBinary<double>(in);
+    checkpoint_.parameters_kMinus1 = readBinaryVector(in);
+    checkpoint_.parameters_kMinus2 = readBinaryVector(in);
+    checkpoint_.gradients_kMinus1 = readBinaryVector(in);
+    checkpoint_.fits = readBinaryVector(in);
+    checkpoint_.Hessian_kMinus1 = readBinaryMatrix(in);
+    std::uint64_t stateLength = readBinary<std::uint64_t>(in);
+    checkpoint_.randomState.resize(stateLength);
+    in.read(&checkpoint_.randomState[0], stateLength);
+    if (!in)
+      error("Unexpected end of checkpoint file.");
+    if (version >= 2)
+    {
+      std::uint64_t numberScreened = readBinary<std::uint64_t>(in);
+      for (std::uint64_t i = 0; i < numberScreened; i++)
+      {
+        checkpoint_.screening.screened.push_back(readBinary<std::uint32_t>(in));
+        checkpoint_.screening.screenedInIteration.push_back(readBinary<std::int32_t>(in));
+      }
+      checkpoint_.screening.checks = readBinary<std::int32_t>(in);
+      checkpoint_.screening.gap = readBinary<double>(in);
+      checkpoint_.screening.gapConverged = readBinary<std::uint8_t>(in) != 0;
+    }
+    checkpoint_.momentumIteration = 0;
+    if (version >= 3)
+      checkpoint_.momentumIteration = readBinary<std::int32_t>(in);
+
+    return (checkpoint_);
+  }
+
+  /**
+   * @brief read a checkpoint and check that it fits to the current optimization
+   *
+   * @param file name of the file
+   * @param optimizer optimizer that wants to resume
+   * @param numberParameters number of parameters in the current optimization
+   * @return optimizerCheckpoint
+   */
+  inline optimizerCheckpoint readCheckpoint(const std::string &file,
+                                            const checkpointOptimizer optimizer,
+                                            const unsigned int numberParameters)
+  {
+    optimizerCheckpoint checkpoint_ = readCheckpoint(file);
+    if (checkpoint_.optimizer != optimizer)
+      error("The checkpoint " + file + " was written by " +
+            checkpointOptimizer_txt.at(checkpoint_.optimizer) +
+            " and cannot be used by " + checkpointOptimizer_txt.at(optimizer) + ".");
+    if (checkpoint_.parameters_kMinus1.n_elem != numberParameters)
+      error("The number of parameters in the checkpoint " + file +
+            " does not match the number of starting values.");
+    return (checkpoint_);
+  }
+
+  /**
+   * @brief resize the fits vector of a checkpoint to the number of outer iterations
+   * of the current optimization.
+   *
+   * @param checkpointFits fits saved in the checkpoint
+   * @param maxIterOut maximal number of outer iterations
+   * @return arma::rowvec
+   */
+  inline arma::rowvec restoreFits(const arma::rowvec &checkpointFits,
+                                  const int maxIterOut)
+  {
+    arma::rowvec fits(maxIterOut + 1);
+    fits.fill(arma::datum::nan);
+    const unsigned int nCopy = std::min<unsigned int>(fits.n_elem, checkpointFits.n_elem);
+    for (unsigned int i = 0; i < nCopy; i++)
+      fits(i) = checkpointFits(i);
+    return (fits);
+  }
+
+  /**
+   * @brief writes checkpoints in a background thread. Only the most recent
+   * checkpoint is kept in the queue: if the optimizer is faster than the file
+   * system, older snapshots which have not been written yet are replaced.
+   *
+   */
+  class checkpointWriter
+  {
+  public:
+    /**
+     * @brief Construct a new checkpoint writer
+     *
+     * @param file_ file the checkpoints are written to
+     */
+    explicit checkpointWriter(const std::string &file_) : file(file_)
+    {
+      worker = std::thread(&checkpointWriter::run, this);
+    }
+
+    checkpointWriter(const checkpointWriter &) = delete;
+    checkpointWriter &operator=(const checkpointWriter &) = delete;
+
+    /**
+     * @brief Destroy the checkpoint writer. Waits for pending checkpoints to be written.
+     *
+     */
+    ~checkpointWriter()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop = true;
+      }
+      condition.notify_one();
+      if (worker.joinable())
+        worker.join();
+      if (failed)
+        warn("Could not write checkpoint to " + file + "\n");
+    }
+
+    /**
+     * @brief hand a new checkpoint to the writer thread
+     *
+     * @param checkpoint_ checkpoint to write
+     */
+    void submit(optimizerCheckpoint checkpoint_)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending = std::move(checkpoint_);
+        hasPending = true;
+      }
+      condition.notify_one();
+    }
+
+  private:
+    std::string file;
+    std::mutex mutex_;
+    std::condition_variable condition;
+    optimizerCheckpoint pending;
+    bool hasPending = false;
+    bool stop = false;
+    bool failed = false;
+    std::thread worker;
+
+    void run()
+    {
+      optimizerCheckpoint current;
+      while (true)
+      {
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          condition.wait(lock, [this]
+                         { return hasPending || stop; });
+          if (!hasPending && stop)
+            return;
+          current = std::move(pending);
+          hasPending = false;
+        }
+        // the file is written outside of the lock so that the optimizer
+        // can hand over the next checkpoint in the meantime
+        if (!writeCheckpoint(current, file))
+          failed = true;
+      }
+    }
+  };
+
+  /**
+   * @brief returns true if a checkpoint should be written after the current outer iteration
+   *
+   * @param control_ checkpoint settings
+   * @param outer_iteration current outer iteration
+   * @return bool
+   */
+  inline bool writeCheckpointNow(const controlCheckpoint &control_,
+                                 const int outer_iteration)
+  {
+    return (!control_.file.empty() &&
+            control_.interval > 0 &&
+            (outer_iteration + 1) % control_.interval == 0);
+  }
+
+  /**
+   * @brief creates a checkpoint writer if checkpoints are requested
+   *
+   * @param control_ checkpoint settings
+   * @return std::unique_ptr<checkpointWriter>
+   */
+  inline std::unique_ptr<checkpointWriter> makeCheckpointWriter(const controlCheckpoint &control_)
+  {
+    if (control_.file.empty() || control_.interval <= 0)
+      return (nullptr);
+    return (std::make_unique<checkpointWriter>(control_.file));
+  }
+
+} // end namespace
+
+#endif
@@ -105,6 +105,29 @@ namespace lessSEM
   {
     return (Rcpp::runif(n, min, max));
   }
+
+  /**
+   * @brief returns the state of the random number generator as a string.
+   * When using R, the random number generator is owned by R and its state
+   * is stored in .Random.seed. We therefore return an empty string.
+   *
+   * @return std::string
+   */
+  inline std::string getRandomState()
+  {
+    return (std::string());
+  }
+
+  /**
+   * @brief restores the state of the random number generator. When using R,
+   * this is a no-op; restore .Random.seed in R instead.
+   *
+   * @param state string returned by getRandomState
+   */
+  inline void setRandomState(const std::string &state)
+  {
+    static_cast<void>(state); // is unused
+  }
 }
 
 #else
@@ -118,6 +141,7 @@ namespace lessSEM
 
 // include headers:
 #include <armadillo>
+#include <sstream>
 
 // define print, warnings, and errors:
 #define print std::cout
@@ -423,6 +447,48 @@ namespace lessSEM
     return (numericVector(vec));
   }
 
+  /**
+   * @brief returns the random number generator used by lesstimate. All random
+   * numbers drawn by the optimizers come from this generator so that its state
+   * can be stored and restored (e.g., when checkpointing an optimizer). The generator
+   * is independent of armadillo's random number generator: arma::arma_rng::set_seed
+   * does not change it; use randomEngine().seed(...) instead.
+   *
+   * @return std::mt19937_64&
+   */
+  inline std::mt19937_64 &randomEngine()
+  {
+    static thread_local std::mt19937_64 engine;
+    return (engine);
+  }
+
+  /**
+   * @brief returns the state of the random number generator as a string.
+   *
+   * @return std::string
+   */
+  inline std::string getRandomState()
+  {
+    std::ostringstream state;
+    state << randomEngine();
+    return (state.str());
+  }
+
+  /**
+   * @brief restores the state of the random number generator.
+   *
+   * @param state string returned by getRandomState
+   */
+  inline void setRandomState(const std::string &state)
+  {
+    if (state.empty())
+      return;
+    std::istringstream stateStream(state);
+    stateStream >> randomEngine();
+    if (stateStream.fail())
+      error("Could not restore the state of the random number generator.");
+  }
+
   /**
    * @brief sample randomly elements from a vector
    *
@@ -441,7 +507,7 @@ namespace lessSEM
     for (int i = 0; i < vec.length(); i++)
       positions(i) = i;
 
-    positions = arma::shuffle(positions);
+    std::shuffle(positions.begin(), positions.end(), randomEngine());
     for (unsigned int i = 0; i < nSamples; i++)
     {
       vec.values(i) = values(positions(i));
@@ -460,12 +526,10 @@ namespace lessSEM
    */
   inline numericVector unif(int n, double min, double max)
   {
-    std::default_random_engine generator;
     std::uniform_real_distribution<double> unif_dist(min, max);
-    arma::vec tst(n);
     numericVector ret(n);
     for (int i = 0; i < n; i++)
-      ret(i) = unif_dist(generator);
+      ret(i) = unif_dist(randomEngine());
     return (ret);
   }
 }
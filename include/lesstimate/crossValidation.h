@@ -0,0 +1,484 @@
+#ifndef CROSSVALIDATION_H
+#define CROSSVALIDATION_H
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "common_headers.h"
+#include "fitResults.h"
+#include "optimizerState.h"
+#include "parallel.h"
+#include "traits.h"
+#include "glmnet_class.h"
+#include "ista_class.h"
+
+// k-fold cross-validation of the tuning parameters.
+//
+// Copying the data for each fold is often more expensive than fitting the model.
+// The cross-validation therefore works on views: the model must provide a method
+// subset(rows) which returns a model using only the observations in rows of the same
+// (shared) data, and a method numberObservations(). observationView below is a small
+// helper which stores the data by pointer and the rows as indices.
+//
+// The folds are fitted in parallel (see parallel.h). Within each fold, the tuning
+// parameters are fitted in the order of the grid and each fit is warm started with the
+// parameters and the state of the previous fit (see optimizerState.h). The grid should
+// therefore be sorted (e.g., from the largest to the smallest lambda). The held-out loss
+// is the fit of the held-out view at the parameters estimated on the training view.
+// Finally, the model is refitted on all observations with the selected tuning parameters.
+
+namespace lessSEM
+{
+
+  /**
+   * @brief the observations of a data set which are used by a model. The data are not
+   * copied; the view stores a pointer to the data and the indices of the rows.
+   * The data must outlive the view.
+   *
+   * @tparam dataType type of the data (e.g., arma::mat)
+   */
+  template <class dataType = arma::mat>
+  class observationView
+  {
+  public:
+    /**
+     * @brief Construct a new view with all rows of the data
+     *
+     * @param data_ the data
+     */
+    explicit observationView(const dataType &data_)
+        : data(&data_),
+          rows(arma::regspace<arma::uvec>(0, data_.n_rows - 1))
+    {
+    }
+
+    /**
+     * @brief Construct a new view with the rows of the data listed in rows_
+     *
+     * @param data_ the data
+     * @param rows_ indices of the rows
+     */
+    observationView(const dataType &data_, const arma::uvec &rows_)
+        : data(&data_),
+          rows(rows_)
+    {
+    }
+
+    /**
+     * @brief returns a view with a subset of the rows of this view
+     *
+     * @param which positions of the rows within this view
+     * @return observationView
+     */
+    observationView subset(const arma::uvec &which) const
+    {
+      return (observationView(*data, rows.elem(which)));
+    }
+
+    /**
+     * @brief number of observations in the view
+     *
+     * @return arma::uword
+     */
+    arma::uword n_rows() const
+    {
+      return (rows.n_elem);
+    }
+
+    /**
+     * @brief returns row i of the view
+     *
+     * @param i position of the row within the view
+     * @return row of the data
+     */
+    auto row(const arma::uword i) const
+    {
+      return (data->row(rows.at(i)));
+    }
+
+    /**
+     * @brief returns the element in row i and column j of the view
+     *
+     * @param i position of the row within the view
+     * @param j column
+     * @return element of the data
+     */
+    auto at(const arma::uword i, const arma::uword j) const
+    {
+      return (data->at(rows.at(i), j));
+    }
+
+  private:
+    const dataType *data;
+    arma::uvec rows;
+  };
+
+  /**
+   * @brief checks if modelClass has the methods subset(arma::uvec), which returns a model
+   * using a subset of the observations, and numberObservations()
+   *
+   * @tparam modelClass class of the model
+   */
+  template <class modelClass, class = void>
+  struct isSubsettableModel : std::false_type
+  {
+  };
+  template <class modelClass>
+  struct isSubsettableModel<modelClass,
+                            std::void_t<decltype(std::declval<const modelClass &>().subset(std::declval<const arma::uvec &>())),
+                                        decltype(static_cast<unsigned int>(std::declval<const modelClass &>().numberObservations()))>>
+      : isModel<decltype(std::declval<const modelClass &>().subset(std::declval<const arma::uvec &>()))>
+  {
+  };
+
+  /**
+   * @struct controlCV
+   * @brief settings for the cross-validation
+   *
+   * @var folds number of folds
+   * @var foldAssignment fold (0, ..., folds-1) of each observation. If empty, the observations
+   * are assigned to the folds at random (see randomFoldAssignment).
+   * @var threads number of threads used to fit the folds (see parallel.h). 0 uses all available cores.
+   * @var refit should the model be refitted on all observations with the selected tuning parameters?
+   */
+  struct controlCV
+  {
+    unsigned int folds;
+    arma::uvec foldAssignment;
+    int threads;
+    bool refit;
+  };
+
+  /**
+   * @brief Returns the default settings for the cross-validation
+   *
+   * @return controlCV
+   */
+  inline controlCV controlCVDefault()
+  {
+    controlCV defaultIs = {
+        5,           // folds
+        arma::uvec(), // foldAssignment
+        0,           // threads
+        true         // refit
+    };
+    return (defaultIs);
+  }
+
+  /**
+   * @struct cvResults
+   * @brief results of the cross-validation
+   *
+   * @var foldAssignment fold of each observation
+   * @var heldOutLoss held-out fit for each fold (rows) and tuning parameter (columns)
+   * @var convergence did the optimizer converge for each fold (rows) and tuning parameter (columns)?
+   * @var cvLoss cross-validated loss per observation for each tuning parameter (sum of the held-out
+   * fits divided by the number of observations)
+   * @var standardError standard error of cvLoss computed from the losses per observation of the folds
+   * @var selected index of the tuning parameter with the smallest cvLoss
+   * @var refit fit on all observations with the selected tuning parameters (only if refit is used)
+   */
+  struct cvResults
+  {
+    arma::uvec foldAssignment;
+    arma::mat heldOutLoss;
+    arma::umat convergence;
+    arma::rowvec cvLoss;
+    arma::rowvec standardError;
+    unsigned int selected;
+    fitResults refit;
+  };
+
+  /**
+   * @brief assigns the observations to the folds. Fold f gets the observations at the positions
+   * f, f + folds, f + 2*folds, ... of a random permutation. When using R, the permutation
+   * is drawn with R's random number generator (see set.seed); otherwise with randomEngine.
+   *
+   * @param numberObservations number of observations
+   * @param folds number of folds
+   * @return arma::uvec
+   */
+  inline arma::uvec randomFoldAssignment(const unsigned int numberObservations,
+                                         const unsigned int folds)
+  {
+    std::vector<unsigned int> positions(numberObservations);
+#if USE_R
+    numericVector sampleFrom(numberObservations);
+    for (unsigned int i = 0; i < numberObservations; i++)
+      sampleFrom.at(i) = i;
+    numericVector permutation = sample(sampleFrom, numberObservations, false);
+    for (unsigned int i = 0; i < numberObservations; i++)
+      positions.at(i) = permutation.at(i);
+#else
+    for (unsigned int i = 0; i < numberObservations; i++)
+      positions.at(i) = i;
+    std::shuffle(positions.begin(), positions.end(), randomEngine());
+#endif
+
+    arma::uvec foldAssignment(numberObservations);
+    for (unsigned int i = 0; i < numberObservations; i++)
+      foldAssignment.at(positions.at(i)) = i % folds;
+    return (foldAssignment);
+  }
+
+  /**
+   * @brief returns the indices of the observations which are (inFold = true) or are not
+   * (inFold = false) in fold
+   *
+   * @param foldAssignment fold of each observation
+   * @param fold fold
+   * @param inFold should the observations in the fold or all other observations be returned?
+   * @return arma::uvec
+   */
+  inline arma::uvec foldRows(const arma::uvec &foldAssignment,
+                             const unsigned int fold,
+                             const bool inFold)
+  {
+    unsigned int numberRows = 0;
+    for (unsigned int i = 0; i < foldAssignment.n_elem; i++)
+      numberRows += (foldAssignment.at(i) == fold) == inFold;
+
+    arma::uvec rows(numberRows);
+    unsigned int r = 0;
+    for (unsigned int i = 0; i < foldAssignment.n_elem; i++)
+    {
+      if ((foldAssignment.at(i) == fold) == inFold)
+        rows.at(r++) = i;
+    }
+    return (rows);
+  }
+
+  /**
+   * @brief k-fold cross-validation of a grid of tuning parameters with any optimizer.
+   *
+   * @tparam modelClass class of the model. Must provide subset and numberObservations (see isSubsettableModel)
+   * @tparam tuning tuning parameters
+   * @tparam fitFunction function with the arguments (model, startingValues, tuningParameters, warmStart)
+   * which returns the fitResults of the optimizer. The model is either a view returned by subset or model_.
+   * @param model_ the model using all observations
+   * @param startingValues starting values of the first fit in each fold
+   * @param parameterLabels labels of the parameters
+   * @param tuningGrid tuning parameters in the order in which they should be fitted
+   * @param fit_ function which fits the model
+   * @param control_ settings for the cross-validation
+   * @return cvResults
+   */
+  template <class modelClass, typename tuning, class fitFunction>
+  inline cvResults crossValidate(modelClass &model_,
+                                 const arma::rowvec &startingValues,
+                                 const stringVector &parameterLabels,
+                                 const std::vector<tuning> &tuningGrid,
+                                 fitFunction fit_,
+                                 const controlCV &control_ = controlCVDefault())
+  {
+    static_assert(isSubsettableModel<modelClass>::value,
+                  "The model must provide the methods subset and numberObservations (see crossValidation.h).");
+
+    const unsigned int numberObservations = model_.numberObservations();
+    const unsigned int numberTuning = tuningGrid.size();
+    const unsigned int folds = control_.folds;
+
+    if (numberTuning == 0)
+      error("The tuning parameter grid is empty.");
+    if (folds < 2 || folds > numberObservations)
+      error("The number of folds must be between 2 and the number of observations.");
+
+    cvResults cvResults_;
+    if (control_.foldAssignment.n_elem == 0)
+    {
+      cvResults_.foldAssignment = randomFoldAssignment(numberObservations, folds);
+    }
+    else
+    {
+      if (control_.foldAssignment.n_elem != numberObservations)
+        error("foldAssignment must have one element for each observation.");
+      if (arma::max(control_.foldAssignment) >= folds)
+        error("foldAssignment must only contain values between 0 and folds-1.");
+      cvResults_.foldAssignment = control_.foldAssignment;
+    }
+
+    cvResults_.heldOutLoss.set_size(folds, numberTuning);
+    cvResults_.convergence.set_size(folds, numberTuning);
+    // parameter estimates of each fold; used as starting values for the refit
+    std::vector<arma::mat> foldParameters(folds, arma::mat(numberTuning, startingValues.n_elem));
+    arma::colvec foldSize(folds);
+
+    parallelFor(folds, control_.threads, [&](const unsigned int fold)
+                {
+      const arma::uvec heldOutRows = foldRows(cvResults_.foldAssignment, fold, true);
+      if (heldOutRows.n_elem == 0)
+        error("Fold " + std::to_string(fold) + " has no observations.");
+      foldSize.at(fold) = heldOutRows.n_elem;
+
+      auto training = model_.subset(foldRows(cvResults_.foldAssignment, fold, false));
+      auto heldOut = model_.subset(heldOutRows);
+
+      // warm start along the grid
+      arma::rowvec parameterValues = startingValues;
+      optimizerState warmStart;
+      for (unsigned int t = 0; t < numberTuning; t++)
+      {
+        fitResults fitResults_ = fit_(training, parameterValues, tuningGrid.at(t), warmStart);
+
+        cvResults_.heldOutLoss.at(fold, t) = modelFit(heldOut, fitResults_.parameterValues, parameterLabels);
+        cvResults_.convergence.at(fold, t) = fitResults_.convergence;
+        foldParameters.at(fold).row(t) = fitResults_.parameterValues;
+
+        parameterValues = fitResults_.parameterValues;
+        warmStart = std::move(fitResults_.state);
+      } });
+
+    cvResults_.cvLoss.set_size(numberTuning);
+    cvResults_.standardError.set_size(numberTuning);
+    for (unsigned int t = 0; t < numberTuning; t++)
+    {
+      const arma::colvec lossPerObservation = cvResults_.heldOutLoss.col(t) / foldSize;
+      cvResults_.cvLoss.at(t) = arma::accu(cvResults_.heldOutLoss.col(t)) / numberObservations;
+      cvResults_.standardError.at(t) = arma::stddev(lossPerObservation) / std::sqrt((double)folds);
+    }
+
+    // non-finite losses (e.g., failed fits) are never selected
+    cvResults_.selected = 0;
+    double smallestLoss = arma::datum::inf;
+    for (unsigned int t = 0; t < numberTuning; t++)
+    {
+      if (std::isfinite(cvResults_.cvLoss.at(t)) && cvResults_.cvLoss.at(t) < smallestLoss)
+      {
+        smallestLoss = cvResults_.cvLoss.at(t);
+        cvResults_.selected = t;
+      }
+    }
+
+    if (control_.refit)
+    {
+      // start the refit at the average of the fold estimates for the selected tuning parameters
+      arma::rowvec refitStart(startingValues.n_elem, arma::fill::zeros);
+      for (unsigned int fold = 0; fold < folds; fold++)
+        refitStart += foldParameters.at(fold).row(cvResults_.selected) / folds;
+      cvResults_.refit = fit_(model_, refitStart, tuningGrid.at(cvResults_.selected), optimizerState());
+    }
+
+    return (cvResults_);
+  }
+
+  /**
+   * @brief k-fold cross-validation of a grid of tuning parameters with the glmnet optimizer.
+   * The penalties are shared by the folds, which are fitted in parallel. All penalties provided
+   * by lesstimate can be used from multiple threads.
+   *
+   * @tparam nonsmoothPenalty class of type nonsmoothPenalty (e.g., lasso, scad, lsp)
+   * @tparam smoothPenalty class of type smooth penalty (e.g., ridge)
+   * @tparam tuning tuning parameters used by both, the nonsmootPenalty and the smoothPenalty
+   * @tparam modelClass class of the model. Must provide subset and numberObservations (see isSubsettableModel)
+   * @param model_ the model using all observations
+   * @param startingValues an arma::rowvec vector with starting values
+   * @param parameterLabels a stringVector with parameter labels
+   * @param penalty_ a penalty derived from the penalty class in penalty.h
+   * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
+   * @param tuningGrid tuning parameters in the order in which they should be fitted
+   * @param controlOptimizer settings for the glmnet optimizer. Checkpoints are not written and the
+   * warm starts are set by the cross-validation.
+   * @param control_ settings for the cross-validation
+   * @return cvResults
+   */
+  template <typename nonsmoothPenalty, typename smoothPenalty,
+            typename tuning, typename modelClass>
+  inline cvResults crossValidateGlmnet(modelClass &model_,
+                                       const arma::rowvec &startingValues,
+                                       const stringVector &parameterLabels,
+                                       nonsmoothPenalty &penalty_,
+                                       smoothPenalty &smoothPenalty_,
+                                       const std::vector<tuning> &tuningGrid,
+                                       const controlGLMNET &controlOptimizer = controlGlmnetDefault(),
+                                       const controlCV &control_ = controlCVDefault())
+  {
+    auto fit_ = [&](auto &currentModel,
+                    const arma::rowvec &parameterValues,
+                    const tuning &tuningParameters,
+                    const optimizerState &warmStart)
+    {
+      controlGLMNET controlFit = controlOptimizer;
+      controlFit.checkpoint = controlCheckpointDefault();
+      controlFit.warmStart = warmStart;
+      controlFit.returnState = true;
+      return (glmnet(currentModel,
+                     parameterValues,
+                     parameterLabels,
+                     penalty_,
+                     smoothPenalty_,
+                     tuningParameters,
+                     controlFit));
+    };
+    return (crossValidate(model_,
+                          startingValues,
+                          parameterLabels,
+                          tuningGrid,
+                          fit_,
+                          control_));
+  }
+
+  /**
+   * @brief k-fold cross-validation of a grid of tuning parameters with the ista optimizer.
+   * The proximal operator and the penalties are shared by the folds, which are fitted in parallel.
+   * All penalties provided by lesstimate can be used from multiple threads.
+   *
+   * @tparam T type of the tuning parameters of the proximal operator and the penalty
+   * @tparam U type of the tuning parameters of the smooth penalty
+   * @tparam modelClass class of the model. Must provide subset and numberObservations (see isSubsettableModel)
+   * @param model_ the model using all observations
+   * @param startingValues an arma::rowvec vector with starting values
+   * @param parameterLabels a stringVector with parameter labels
+   * @param proximalOperator_ proximal operator used to compute the next parameters
+   * @param penalty_ non-smooth penalty
+   * @param smoothPenalty_ smooth penalty
+   * @param tuningGrid tuning parameters of the proximal operator and the penalty in the order in which
+   * they should be fitted
+   * @param smoothTuningParameters tuning parameters of the smooth penalty (the same for all fits)
+   * @param controlOptimizer settings for the ista optimizer. Checkpoints are not written and the
+   * warm starts are set by the cross-validation.
+   * @param control_ settings for the cross-validation
+   * @return cvResults
+   */
+  template <typename T, typename U, class modelClass,
+            class proximalOperatorClass, class penaltyClass, class smoothPenaltyClass>
+  inline cvResults crossValidateIsta(modelClass &model_,
+                                     const arma::rowvec &startingValues,
+                                     const stringVector &parameterLabels,
+                                     proximalOperatorClass &proximalOperator_,
+                                     penaltyClass &penalty_,
+                                     smoothPenaltyClass &smoothPenalty_,
+                                     const std::vector<T> &tuningGrid,
+                                     const U &smoothTuningParameters,
+                                     const control &controlOptimizer = controlDefault(),
+                                     const controlCV &control_ = controlCVDefault())
+  {
+    auto fit_ = [&](auto &currentModel,
+                    const arma::rowvec &parameterValues,
+                    const T &tuningParameters,
+                    const optimizerState &warmStart)
+    {
+      control controlFit = controlOptimizer;
+      controlFit.checkpoint = controlCheckpointDefault();
+      controlFit.warmStart = warmStart;
+      controlFit.returnState = true;
+      return (ista(currentModel,
+                   parameterValues,
+                   parameterLabels,
+                   proximalOperator_,
+                   penalty_,
+                   smoothPenalty_,
+                   tuningParameters,
+                   smoothTuningParameters,
+                   controlFit));
+    };
+    return (crossValidate(model_,
+                          startingValues,
+                          parameterLabels,
+                          tuningGrid,
+                          fit_,
+                          control_));
+  }
+
+} // end namespace
+
+#endif
@@ -0,0 +1,213 @@
+#ifndef FINITEDIFFERENCEHESSIAN_H
+#define FINITEDIFFERENCEHESSIAN_H
+#include <algorithm>
+#include <vector>
+#include "common_headers.h"
+#include "model.h"
+#include "traits.h"
+
+// glmnet and bfgsOptim start with an initial Hessian which is the identity matrix
+// if the user does not provide one. The BFGS updates then need many iterations to
+// learn the curvature of the model. The following approximates the initial Hessian
+// with finite differences of model::gradients at the starting values instead:
+//
+// H[, j] = (g(x + h_j e_j) - g(x)) / h_j
+//
+// The gradient evaluations are independent of each other and are passed to
+// model::gradientsBatch, which distributes them over several threads by default.
+// The result is symmetrised and projected to the positive definite matrices so
+// that it can be used by the quasi-Newton optimizers.
+
+namespace lessSEM
+{
+
+  /**
+   * @brief specifies how the initial Hessian is obtained
+   *
+   */
+  enum initialHessianType
+  {
+    userHessian,              ///> use the initialHessian of the optimizer settings
+    finiteDifferenceFull,     ///> full finite difference approximation (p gradient evaluations)
+    finiteDifferenceDiagonal, ///> only the diagonal of the finite difference approximation (p gradient evaluations)
+    finiteDifferenceBanded    ///> banded approximation (2 * bandwidth + 1 gradient evaluations)
+  };
+  const std::vector<std::string> initialHessianType_txt = {
+      "userHessian",
+      "finiteDifferenceFull",
+      "finiteDifferenceDiagonal",
+      "finiteDifferenceBanded"};
+
+  /**
+   * @struct controlInitialHessian
+   * @brief settings for the finite difference approximation of the initial Hessian
+   *
+   * @var type how should the initial Hessian be obtained? See initialHessianType.
+   * @var bandwidth number of off-diagonals on each side of the diagonal used by finiteDifferenceBanded.
+   * Elements outside of the band are assumed to be zero. In this case, parameters which are more than
+   * 2 * bandwidth apart are perturbed simultaneously (Curtis, Powell, & Reid, 1974), so that only
+   * 2 * bandwidth + 1 gradient evaluations are required.
+   * @var stepSize relative step size h_j = stepSize * max(1, |x_j|)
+   * @var minEigenvalue eigenvalues smaller than minEigenvalue times the largest absolute eigenvalue
+   * are set to this value to ensure positive definiteness
+   * @var threads number of threads used for the gradient evaluations. 0 uses all available cores. The
+   * gradients function of the model must be thread-safe if threads != 1. Defaults to 1 because most models
+   * are not thread-safe. In R, the gradients are always evaluated sequentially.
+   */
+  struct controlInitialHessian
+  {
+    initialHessianType type;
+    int bandwidth;
+    double stepSize;
+    double minEigenvalue;
+    int threads;
+  };
+
+  /**
+   * @brief Returns the default settings for the initial Hessian (use the initialHessian
+   * of the optimizer settings)
+   *
+   * @return controlInitialHessian
+   */
+  inline controlInitialHessian controlInitialHessianDefault()
+  {
+    controlInitialHessian defaultIs = {
+        userHessian, // type
+        1,           // bandwidth
+        1e-5,        // stepSize
+        1e-4,        // minEigenvalue
+        1            // threads
+    };
+    return (defaultIs);
+  }
+
+  /**
+   * @brief symmetrises a Hessian and projects it to the positive definite matrices
+   * by raising small eigenvalues.
+   *
+   * @param Hessian Hessian matrix
+   * @param minEigenvalue eigenvalues smaller than minEigenvalue times the largest absolute
+   * eigenvalue are set to this value
+   * @return arma::mat
+   */
+  inline arma::mat makePositiveDefinite(const arma::mat &Hessian,
+                                        const double minEigenvalue)
+  {
+    arma::mat symmetric = .5 * (Hessian + arma::trans(Hessian));
+
+    arma::vec eigenValues;
+    arma::mat eigenVectors;
+    if (!arma::eig_sym(eigenValues, eigenVectors, symmetric))
+      error("Could not compute the eigenvalues of the initial Hessian.");
+
+    const double largest = arma::max(arma::abs(eigenValues));
+    const double lowerBound = largest > 0.0 ? minEigenvalue * largest : 1.0;
+    if (arma::min(eigenValues) >= lowerBound)
+      return (symmetric);
+
+    eigenValues = arma::clamp(eigenValues, lowerBound, arma::datum::inf);
+    symmetric = eigenVectors * arma::diagmat(eigenValues) * arma::trans(eigenVectors);
+    return (.5 * (symmetric + arma::trans(symmetric)));
+  }
+
+  /**
+   * @brief approximates the Hessian of the model with finite differences of the gradients.
+   *
+   * @param model_ the model object derived from the model class in model.h or any class with the methods fit and gradients (see traits.h)
+   * @param parameterValues parameter values at which the Hessian is approximated (e.g., starting values)
+   * @param parameterLabels names of the parameters
+   * @param control_ settings for the approximation (see controlInitialHessian)
+   * @return arma::mat positive definite Hessian approximation
+   */
+  template <class modelClass>
+  inline arma::mat approximateInitialHessian(modelClass &model_,
+                                             const arma::rowvec &parameterValues,
+                                             const stringVector &parameterLabels,
+                                             const controlInitialHessian &control_)
+  {
+    const unsigned int numberParameters = parameterValues.n_elem;
+    if (control_.type == userHessian)
+      error("approximateInitialHessian called with type userHessian.");
+    if (control_.stepSize <= 0.0)
+      error("The step size for the initial Hessian must be positive.");
+    if ((control_.type == finiteDifferenceBanded) && (control_.bandwidth < 0))
+      error("The bandwidth for the initial Hessian must be non-negative.");
+
+    arma::rowvec stepSizes(numberParameters);
+    for (unsigned int p = 0; p < numberParameters; p++)
+      stepSizes.at(p) = control_.stepSize * std::max(1.0, std::abs(parameterValues.at(p)));
+
+    // parameters which are perturbed together
+    std::vector<std::vector<unsigned int>> groups;
+    if (control_.type == finiteDifferenceBanded)
+    {
+      const unsigned int nGroups = std::min<unsigned int>(2 * control_.bandwidth + 1, numberParameters);
+      groups.resize(nGroups);
+      for (unsigned int p = 0; p < numberParameters; p++)
+        groups.at(p % nGroups).push_back(p);
+    }
+    else
+    {
+      groups.resize(numberParameters);
+      for (unsigned int p = 0; p < numberParameters; p++)
+        groups.at(p).push_back(p);
+    }
+
+    const arma::rowvec gradients = modelGradients(model_, parameterValues, parameterLabels);
+    if (!arma::is_finite(gradients))
+      error("Non-finite gradients at the starting values. Cannot approximate the initial Hessian.");
+
+    // each row perturbs the parameters of one group
+    arma::mat points(groups.size(), numberParameters);
+    for (unsigned int g = 0; g < groups.size(); g++)
+    {
+      points.row(g) = parameterValues;
+      for (unsigned int p : groups.at(g))
+        points.at(g, p) += stepSizes.at(p);
+    }
+    const arma::mat perturbed = modelGradientsBatch(model_,
+                                                    points,
+                                                    parameterLabels,
+                                                    control_.threads);
+
+    arma::mat Hessian(numberParameters, numberParameters, arma::fill::zeros);
+    for (unsigned int g = 0; g < groups.size(); g++)
+    {
+      if (!arma::is_finite(perturbed.row(g)))
+        error("Non-finite gradients when approximating the initial Hessian. Try a smaller stepSize.");
+
+      for (unsigned int column : groups.at(g))
+      {
+        const double h = stepSizes.at(column);
+        if (control_.type == finiteDifferenceDiagonal)
+        {
+          Hessian.at(column, column) = (perturbed.at(g, column) - gradients.at(column)) / h;
+          continue;
+        }
+        unsigned int first = 0, last = numberParameters - 1;
+        if (control_.type == finiteDifferenceBanded)
+        {
+          first = column > (unsigned int)control_.bandwidth ? column - control_.bandwidth : 0;
+          last = std::min<unsigned int>(column + control_.bandwidth, numberParameters - 1);
+        }
+        for (unsigned int row = first; row <= last; row++)
+          Hessian.at(row, column) = (perturbed.at(g, row) - gradients.at(row)) / h;
+      }
+    }
+
+    if (control_.type == finiteDifferenceDiagonal)
+    {
+      // a diagonal matrix is positive definite if all diagonal elements are positive
+      arma::vec diagonal = Hessian.diag();
+      const double largest = arma::max(arma::abs(diagonal));
+      const double lowerBound = largest > 0.0 ? control_.minEigenvalue * largest : 1.0;
+      Hessian.diag() = arma::clamp(diagonal, lowerBound, arma::datum::inf);
+      return (Hessian);
+    }
+
+    return (makePositiveDefinite(Hessian, control_.minEigenvalue));
+  }
+
+} // end namespace
+
+#endif
@@ -1,10 +1,36 @@
 #ifndef FITRESULTS_H
 #define FITRESULTS_H
 #include "common_headers.h"
+#include "packedSymmetric.h"
+#include "optimizerState.h"
+#include "screening.h"
 
 namespace lessSEM
 {
 
+  /**
+   * @brief Specifies which form of the final Hessian is returned in the fitResults.
+   * Returning the full Hessian requires O(p^2) memory per result. This can be avoided
+   * if only the parameter estimates are of interest.
+   *
+   * @var returnFullHessian the dense Hessian is returned in fitResults::Hessian
+   * @var returnDiagonalHessian only the diagonal is returned in fitResults::HessianDiagonal
+   * @var returnPackedHessian the upper triangle is returned in fitResults::HessianPacked
+   * @var returnNoHessian no Hessian is returned
+   */
+  enum hessianReturn
+  {
+    returnFullHessian,
+    returnDiagonalHessian,
+    returnPackedHessian,
+    returnNoHessian
+  };
+  const std::vector<std::string> hessianReturn_txt = {
+      "returnFullHessian",
+      "returnDiagonalHessian",
+      "returnPackedHessian",
+      "returnNoHessian"};
+
   /**
    *
    * @struct fitResults
@@ -14,6 +40,12 @@ namespace lessSEM
    * @var convergence was the outer breaking condition met?
    * @var parameterValues final parameter values
    * @var Hessian final Hessian approximation (optional)
+   * @var HessianDiagonal diagonal of the final Hessian approximation (only if returnDiagonalHessian is used)
+   * @var HessianPacked upper triangle of the final Hessian approximation (only if returnPackedHessian is used)
+   * @var state final state of the optimizer which can be used as warm start for the next fit (only if returnState is used)
+   * @var screening statistics of the safe screening (only if screening is used)
+   * @var phaseIterations number of outer iterations (only bfgsOptim). With a single precision Hessian, the number of outer
+   * iterations of the single precision phase is followed by that of the double precision polishing (see precision.h).
    */
   struct fitResults
   {
@@ -22,8 +54,42 @@ namespace lessSEM
     bool convergence;
     arma::rowvec parameterValues;
     arma::mat Hessian;
+    arma::colvec HessianDiagonal;
+    packedSymmetricMatrix HessianPacked;
+    optimizerState state;
+    screeningResults screening;
+    std::vector<int> phaseIterations;
   };
 
+  /**
+   * @brief saves the final Hessian in the form requested by returnHessian
+   *
+   * @param fitResults_ fit results
+   * @param Hessian final Hessian
+   * @param returnHessian which form of the Hessian should be returned?
+   */
+  inline void setHessian(fitResults &fitResults_,
+                         const arma::mat &Hessian,
+                         const hessianReturn returnHessian)
+  {
+    switch (returnHessian)
+    {
+    case returnFullHessian:
+      fitResults_.Hessian = Hessian;
+      break;
+    case returnDiagonalHessian:
+      fitResults_.HessianDiagonal = Hessian.diag();
+      break;
+    case returnPackedHessian:
+      fitResults_.HessianPacked = packedSymmetricMatrix(Hessian);
+      break;
+    case returnNoHessian:
+      break;
+    default:
+      error("Unknown hessianReturn.");
+    }
+  }
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,309 @@
+#ifndef FIXEDSIZE_H
+#define FIXEDSIZE_H
+#include "common_headers.h"
+#include "enet.h" // for definition of tuning parameters
+#include "subgradients.h"
+
+// Most models in simulation studies have few parameters (e.g., <= 32) and are
+// fitted millions of times. For such models, the allocations of the parameter
+// vectors and Hessian matrices can take longer than the computations themselves.
+// The optimizers ista and bfgsOptim therefore take the number of parameters as an
+// optional template parameter N (e.g., less::bfgsOptim<8>(...)). If N > 0,
+// parameters, gradients, and Hessian are stored in arma::rowvec::fixed<N> and
+// arma::mat::fixed<N, N>, which live on the stack and allow the compiler to unroll
+// the loops. N = 0 (the default) uses the dynamic arma::rowvec and arma::mat.
+//
+// The penalties below are fixed size versions of the lasso and ridge penalties
+// for ista. They do not have virtual functions and can be passed to ista directly
+// (see traits.h). The dispatch functions in traits.h and the model cache keep the
+// fixed size return types, so the inner loop of ista does not allocate as long as
+// the model returns fixed size gradients as well.
+
+namespace lessSEM
+{
+
+  /**
+   * @brief storage used by the optimizers for N parameters
+   *
+   * @tparam N number of parameters. 0 uses dynamic storage.
+   * @tparam eT scalar type of the Hessian (double or float, see precision.h). Parameters
+   * and gradients are always stored in double.
+   */
+  template <arma::uword N, typename eT = double>
+  struct fixedSize
+  {
+    using rowvec = typename arma::rowvec::template fixed<N>;
+    using mat = typename arma::Mat<eT>::template fixed<N, N>;
+  };
+
+  template <typename eT>
+  struct fixedSize<0, eT>
+  {
+    using rowvec = arma::rowvec;
+    using mat = arma::Mat<eT>;
+  };
+
+  /**
+   * @brief throws an error if the number of parameters does not match the compile time dimension
+   *
+   * @tparam N compile time dimension. 0 accepts any number of parameters.
+   * @param numberParameters number of parameters
+   */
+  template <arma::uword N>
+  inline void checkFixedSize(const arma::uword numberParameters)
+  {
+    if constexpr (N != 0)
+    {
+      if (numberParameters != N)
+        error("The number of parameters does not match the fixed size of the optimizer.");
+    }
+    else
+    {
+      static_cast<void>(numberParameters);
+    }
+  }
+
+  /**
+   * @brief proximal operator for the lasso penalty function with N parameters
+   *
+   * @tparam N number of parameters
+   */
+  template <arma::uword N>
+  class proximalOperatorLassoFixed final
+  {
+  public:
+    /**
+     * @brief update the parameter vector
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param parameterLabels parameter labels
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @return arma::rowvec::fixed<N> updated parameters
+     */
+    typename fixedSize<N>::rowvec getParameters(const arma::rowvec &parameterValues,
+                                                const arma::rowvec &gradientValues,
+                                                const stringVector &parameterLabels,
+                                                const double L,
+                                                const tuningParametersEnet &tuningParameters)
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (getParameters(parameterValues, gradientValues, L, tuningParameters));
+    }
+
+    /**
+     * @brief update the parameter vector. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @return arma::rowvec::fixed<N> updated parameters
+     */
+    typename fixedSize<N>::rowvec getParameters(const arma::rowvec &parameterValues,
+                                                const arma::rowvec &gradientValues,
+                                                const double L,
+                                                const tuningParametersEnet &tuningParameters)
+    {
+      typename fixedSize<N>::rowvec parameters_kp1;
+      const double lambda = tuningParameters.alpha * tuningParameters.lambda;
+      for (arma::uword p = 0; p < N; p++)
+      {
+        const double u_k = parameterValues.at(p) - gradientValues.at(p) / L;
+        const double shrunken = std::max(0.0, std::abs(u_k) - lambda * tuningParameters.weights.at(p) / L);
+        parameters_kp1.at(p) = u_k > 0 ? shrunken : (u_k < 0 ? -shrunken : 0.0);
+      }
+      return (parameters_kp1);
+    }
+  };
+
+  /**
+   * @brief lasso penalty for ista with N parameters (see penaltyLASSO)
+   *
+   * @tparam N number of parameters
+   */
+  template <arma::uword N>
+  class penaltyLASSOFixed final
+  {
+  public:
+    /**
+     * @brief Get the value of the penalty function
+     *
+     * @param parameterValues current parameter values
+     * @param parameterLabels names of the parameters
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const stringVector &parameterLabels,
+                    const tuningParametersEnet &tuningParameters)
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (getValue(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the value of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const tuningParametersEnet &tuningParameters)
+    {
+      double penaltyValue = 0.0;
+      for (arma::uword p = 0; p < N; p++)
+        penaltyValue += tuningParameters.weights.at(p) * std::abs(parameterValues.at(p));
+
+      return (tuningParameters.alpha * tuningParameters.lambda * penaltyValue);
+    }
+
+    /**
+     * @brief Get the subgradients of the penalized fit function (see subgradients.h)
+     *
+     * @param parameterValues current parameter values
+     * @param gradients gradients of the smooth part of the fit function
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec::fixed<N>
+     */
+    typename fixedSize<N>::rowvec getSubgradients(const arma::rowvec &parameterValues,
+                                                  const arma::rowvec &gradients,
+                                                  const tuningParametersEnet &tuningParameters)
+    {
+      typename fixedSize<N>::rowvec subgradients;
+      for (arma::uword p = 0; p < N; p++)
+      {
+        // if not regularized: nothing to do here
+        if (tuningParameters.weights.at(p) == 0)
+        {
+          subgradients.at(p) = gradients.at(p);
+          continue;
+        }
+        subgradients.at(p) = subgradientLasso(parameterValues.at(p),
+                                              gradients.at(p),
+                                              tuningParameters.weights.at(p) * tuningParameters.alpha * tuningParameters.lambda);
+      }
+      return (subgradients);
+    }
+  };
+
+  /**
+   * @brief ridge penalty for ista with N parameters (see penaltyRidge)
+   *
+   * @tparam N number of parameters
+   */
+  template <arma::uword N>
+  class penaltyRidgeFixed final
+  {
+  public:
+    /**
+     * @brief Get the value of the penalty function
+     *
+     * @param parameterValues current parameter values
+     * @param parameterLabels names of the parameters
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const stringVector &parameterLabels,
+                    const tuningParametersEnet &tuningParameters)
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (getValue(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the value of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const tuningParametersEnet &tuningParameters)
+    {
+      double penaltyValue = 0.0;
+      for (arma::uword p = 0; p < N; p++)
+        penaltyValue += tuningParameters.weights.at(p) * parameterValues.at(p) * parameterValues.at(p);
+
+      return ((1.0 - tuningParameters.alpha) * tuningParameters.lambda * penaltyValue);
+    }
+
+    /**
+     * @brief Get the gradients of the penalty function
+     *
+     * @param parameterValues current parameter values
+     * @param parameterLabels names of the parameters
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec::fixed<N>
+     */
+    typename fixedSize<N>::rowvec getGradients(const arma::rowvec &parameterValues,
+                                               const stringVector &parameterLabels,
+                                               const tuningParametersEnet &tuningParameters)
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (getGradients(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the gradients of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec::fixed<N>
+     */
+    typename fixedSize<N>::rowvec getGradients(const arma::rowvec &parameterValues,
+                                               const tuningParametersEnet &tuningParameters)
+    {
+      typename fixedSize<N>::rowvec gradients;
+      const double lambda = (1.0 - tuningParameters.alpha) * tuningParameters.lambda;
+      for (arma::uword p = 0; p < N; p++)
+        gradients.at(p) = 2.0 * lambda * tuningParameters.weights.at(p) * parameterValues.at(p);
+      return (gradients);
+    }
+
+    bool hasHessianDiagonal()
+    {
+      return (true);
+    }
+
+    /**
+     * @brief Get the diagonal of the Hessian of the penalty function
+     *
+     * @param parameterValues current parameter values
+     * @param parameterLabels names of the parameters
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec::fixed<N>
+     */
+    typename fixedSize<N>::rowvec getHessianDiagonal(const arma::rowvec &parameterValues,
+                                                     const stringVector &parameterLabels,
+                                                     const tuningParametersEnet &tuningParameters)
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (getHessianDiagonal(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the diagonal of the Hessian of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec::fixed<N>
+     */
+    typename fixedSize<N>::rowvec getHessianDiagonal(const arma::rowvec &parameterValues,
+                                                     const tuningParametersEnet &tuningParameters)
+    {
+      static_cast<void>(parameterValues); // the Hessian of the ridge penalty is constant
+      typename fixedSize<N>::rowvec hessianDiagonal;
+      const double lambda = (1.0 - tuningParameters.alpha) * tuningParameters.lambda;
+      for (arma::uword p = 0; p < N; p++)
+        hessianDiagonal.at(p) = 2.0 * lambda * tuningParameters.weights.at(p);
+      return (hessianDiagonal);
+    }
+  };
+
+} // end namespace
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef FUSEDLASSO_H
+#define FUSEDLASSO_H
+#include <cmath>
+#include <vector>
+#include "common_headers.h"
+
+// The fused lasso penalizes the differences between successive parameters of
+// user-defined chains (e.g., the loadings of one item in groups 1, 2, ..., G):
+//    p(x) = lambda * sum_j w_j |x_j| + lambdaFused * sum_c sum_k |x_{c_(k+1)} - x_{c_k}|.
+// The proximal operator of the difference part of a single chain (the total variation
+// denoising problem) is computed with the dynamic programming algorithm of Johnson (2013),
+// which is linear in the length of the chain. If the lasso weights are identical within
+// each chain, the proximal operator of the full penalty is given by soft thresholding the
+// result (Friedman et al., 2007).
+//
+// Friedman, J., Hastie, T., Höfling, H., & Tibshirani, R. (2007). Pathwise coordinate
+// optimization. The Annals of Applied Statistics, 1(2), 302–332.
+// Johnson, N. A. (2013). A dynamic programming algorithm for the fused lasso and
+// L0-segmentation. Journal of Computational and Graphical Statistics, 22(2), 246–260.
+
+namespace lessSEM
+{
+  /**
+   * @brief tuning parameters of the fused lasso penalty
+   *
+   */
+  class tuningParametersFusedLasso
+  {
+  public:
+    double lambda;                  ///> lambda value >= 0 of the lasso part
+    double lambdaFused;             ///> lambda value >= 0 of the differences
+    arma::rowvec weights;           ///> parameter-specific weights of the lasso part; must be identical within each chain
+    std::vector<arma::uvec> chains; ///> positions of the parameters in each chain; chains must not overlap
+  };
+
+  /**
+   * @brief checks that the chains do not overlap and only contain existing parameters
+   *
+   * @param chains positions of the parameters in each chain
+   * @param numberParameters number of parameters
+   */
+  inline void checkFusedChains(const std::vector<arma::uvec> &chains,
+                               const unsigned int numberParameters)
+  {
+    std::vector<bool> used(numberParameters, false);
+    for (const arma::uvec &chain : chains)
+    {
+      for (arma::uword k = 0; k < chain.n_elem; k++)
+      {
+        if (chain.at(k) >= numberParameters)
+          error("Chains can only contain positions smaller than the number of parameters.");
+        if (used.at(chain.at(k)))
+          error("Chains must not overlap.");
+        used.at(chain.at(k)) = true;
+      }
+    }
+  }
+
+  /**
+   * @brief proximal operator of lambda * sum_k |beta_(k+1) - beta_k| (total variation denoising):
+   * returns the minimizer of 0.5 * ||y - beta||^2 + lambda * sum_k |beta_(k+1) - beta_k|.
+   *
+   * The derivative of the optimal partial objective of the first k elements as a function
+   * of beta_k is piecewise linear. Its knots are stored in x and the changes of slope
+   * (a) and intercept (b) in a and b. The knots are only added at the two ends, so that
+   * each knot is visited at most once over all iterations and the algorithm is linear
+   * in the length of y (Johnson, 2013).
+   *
+   * @param y values
+   * @param lambda threshold >= 0
+   * @return std::vector<double>
+   */
+  inline std::vector<double> proximalTotalVariation(const std::vector<double> &y,
+                                                    const double lambda)
+  {
+    const int n = y.size();
+    if (n < 2 || lambda == 0.0)
+      return (y);
+
+    std::vector<double> x(2 * n), a(2 * n), b(2 * n);
+    // back-pointers: beta_k is beta_(k+1) clamped to [lower_k, upper_k]
+    std::vector<double> lower(n - 1), upper(n - 1);
+
+    lower.at(0) = y.at(0) - lambda;
+    upper.at(0) = y.at(0) + lambda;
+    int left = n - 1;
+    int right = n;
+    x.at(left) = lower.at(0);
+    x.at(right) = upper.at(0);
+    a.at(left) = 1.0;
+    b.at(left) = lambda - y.at(0);
+    a.at(right) = -1.0;
+    b.at(right) = lambda + y.at(0);
+    double aFirst = 1.0, bFirst = -lambda - y.at(1);
+    double aLast = -1.0, bLast = y.at(1) - lambda;
+
+    double aLow, bLow, aHigh, bHigh;
+    int low, high;
+    for (int k = 1; k < n - 1; k++)
+    {
+      // step up from the left until the derivative is larger than -lambda
+      aLow = aFirst;
+      bLow = bFirst;
+      for (low = left; low <= right; low++)
+      {
+        if (aLow * x.at(low) + bLow > -lambda)
+          break;
+        aLow += a.at(low);
+        bLow += b.at(low);
+      }
+      lower.at(k) = (-lambda - bLow) / aLow;
+      left = low - 1;
+      x.at(left) = lower.at(k);
+
+      // step down from the right until the derivative is smaller than lambda
+      aHigh = aLast;
+      bHigh = bLast;
+      for (high = right; high >= left; high--)
+      {
+        if (-aHigh * x.at(high) - bHigh < lambda)
+          break;
+        aHigh += a.at(high);
+        bHigh += b.at(high);
+      }
+      upper.at(k) = (lambda + bHigh) / (-aHigh);
+      right = high + 1;
+      x.at(right) = upper.at(k);
+
+      a.at(left) = aLow;
+      b.at(left) = bLow + lambda;
+      a.at(right) = aHigh;
+      b.at(right) = bHigh + lambda;
+      aFirst = 1.0;
+      bFirst = -lambda - y.at(k + 1);
+      aLast = -1.0;
+      bLast = y.at(k + 1) - lambda;
+    }
+
+    // the last element is where the derivative is zero
+    aLow = aFirst;
+    bLow = bFirst;
+    for (low = left; low <= right; low++)
+    {
+      if (aLow * x.at(low) + bLow > 0.0)
+        break;
+      aLow += a.at(low);
+      bLow += b.at(low);
+    }
+
+    std::vector<double> beta(n);
+    beta.at(n - 1) = -bLow / aLow;
+    for (int k = n - 2; k >= 0; k--)
+      beta.at(k) = std::min(std::max(beta.at(k + 1), lower.at(k)), upper.at(k));
+
+    return (beta);
+  }
+
+  /**
+   * @brief applies the total variation proximal operator to each chain of parameters
+   *
+   * @param parameterValues parameter values; the parameters in the chains are replaced
+   * @param chains positions of the parameters in each chain
+   * @param threshold threshold of the differences (lambdaFused / L)
+   */
+  inline void proximalFusedChains(arma::rowvec &parameterValues,
+                                  const std::vector<arma::uvec> &chains,
+                                  const double threshold)
+  {
+    std::vector<double> chainValues;
+    for (const arma::uvec &chain : chains)
+    {
+      chainValues.resize(chain.n_elem);
+      for (arma::uword k = 0; k < chain.n_elem; k++)
+        chainValues.at(k) = parameterValues.at(chain.at(k));
+
+      chainValues = proximalTotalVariation(chainValues, threshold);
+
+      for (arma::uword k = 0; k < chain.n_elem; k++)
+        parameterValues.at(chain.at(k)) = chainValues.at(k);
+    }
+  }
+
+  /**
+   * @brief sum of the absolute differences between successive parameters of each chain
+   *
+   * @param parameterValues parameter values
+   * @param chains positions of the parameters in each chain
+   * @return double
+   */
+  inline double fusedDifferences(const arma::rowvec &parameterValues,
+                                 const std::vector<arma::uvec> &chains)
+  {
+    double differences = 0.0;
+    for (const arma::uvec &chain : chains)
+    {
+      for (arma::uword k = 1; k < chain.n_elem; k++)
+        differences += std::abs(parameterValues.at(chain.at(k)) - parameterValues.at(chain.at(k - 1)));
+    }
+    return (differences);
+  }
+
+} // end namespace
+
+#endif
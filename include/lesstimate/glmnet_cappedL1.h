@@ -49,8 +49,20 @@ namespace lessSEM
                         const tuningParametersCappedL1Glmnet &tuningParameters)
             override
         {
+            static_cast<void>(parameterLabels); // is unused
+            return (getValue(parameterValues, tuningParameters));
+        }
 
-            static_cast<void>(parameterLabels); // is unused, but necessary for the interface to be consistent
+        /**
+         * @brief Get the value of the penalty function. Version without parameter labels (see traits.h)
+         *
+         * @param parameterValues current parameter values
+         * @param tuningParameters values of the tuning parmameters
+         * @return double
+         */
+        double getValue(const arma::rowvec &parameterValues,
+                        const tuningParametersCappedL1Glmnet &tuningParameters)
+        {
 
             double penaltyValue = 0.0;
             double lambda_i;
@@ -202,21 +214,34 @@ namespace lessSEM
         }
 
         /**
-         * @brief Get the subgradients of the penalty function
+         * @brief Get the subgradients of the penalized fit function (see subgradients.h)
          *
          * @param parameterValues current parameter values
-         * @param parameterLabels names of the parameters
+         * @param gradients gradients of the smooth part of the fit function
          * @param tuningParameters values of the tuning parmameters
          * @return arma::rowvec
          */
         arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
                                      const arma::rowvec &gradients,
                                      const tuningParametersCappedL1Glmnet &tuningParameters)
+            override
         {
-            static_cast<void>(parameterValues); // is unused
-            static_cast<void>(gradients); // is unused
-            static_cast<void>(tuningParameters); // is unused
-            error("Subgradients not yet implemented for cappedL1 penalty. Use different convergence criterion.");
+
+            arma::rowvec subgradients = gradients;
+
+            for (unsigned int p = 0; p < parameterValues.n_elem; p++)
+            {
+                // if not regularized: nothing to do here
+                if (tuningParameters.weights.at(p) == 0)
+                    continue;
+
+                subgradients.at(p) = subgradientCappedL1(parameterValues.at(p),
+                                                         gradients.at(p),
+                                                         tuningParameters.weights.at(p) * tuningParameters.lambda,
+                                                         tuningParameters.theta);
+            }
+
+            return (subgradients);
         }
     };
 }
@@ -8,10 +8,19 @@
 #include "glmnet_ridge.h"
 #include "enet.h"
 #include "bfgs.h"
+#include "checkpoint.h"
+#include "optimizerState.h"
+#include "screening.h"
+#include "trustRegion.h"
+#include "finiteDifferenceHessian.h"
+#include "modelCache.h"
+#include "traits.h"
 
 // The design follows ensmallen (https://github.com/mlpack/ensmallen) in that the
 // user supplies a C++ class with methods fit and gradients which is used
-// by the optimizer
+// by the optimizer. The model and the penalties are template parameters; any class
+// with the required methods can be used (see traits.h) and the calls are then
+// resolved at compile time. Classes derived from model are one instantiation.
 
 // The implementation of GLMNET follows that outlined in
 // 1) Friedman, J., Hastie, T., & Tibshirani, R. (2010).
@@ -59,6 +68,28 @@ namespace lessSEM
    * Note that in case of gradients and GLMNET, we divide the gradients (and the Hessian) of the log-Likelihood by N as it would otherwise be
    * considerably more difficult for larger sample sizes to reach the convergence criteria.
    * @var verbose 0 prints no additional information, > 0 prints GLMNET iterations
+   * @var checkpoint settings for writing checkpoints and resuming from them (see checkpoint.h)
+   * @var returnHessian which form of the final Hessian should be returned? possible are returnFullHessian,
+   * returnDiagonalHessian, returnPackedHessian, and returnNoHessian (see fitResults.h).
+   * @var warmStart state of a previous fit used to initialize the optimizer (see optimizerState.h). The Hessian
+   * of the warm start replaces the initialHessian.
+   * @var returnState should the final state of the optimizer be returned in fitResults::state?
+   * @var screening settings for the safe screening of parameters and the gap stopping criterion (see screening.h).
+   * Only supported for penaltyLASSOGlmnet combined with penaltyRidgeGlmnet.
+   * @var initialHessianEstimate settings for approximating the initial Hessian with finite differences of the
+   * gradients at the starting values (see finiteDifferenceHessian.h). If the type is not userHessian, the
+   * approximation replaces the initialHessian.
+   * @var forcingMax largest forcing term of the adaptive inner stopping rule (see innerTolerance). Early outer
+   * iterations only solve the quadratic approximation roughly; the tolerance tightens as the outer iteration
+   * converges. Defaults to 0, which always uses breakInner.
+   * @var trustRegion settings for the trust-region globalization of the outer iteration (see trustRegion.h).
+   * By default, the line search is used.
+   * @var warnNotConverged should a warning be issued if the outer iterations did not converge? Drivers which
+   * deliberately stop the optimizer early (e.g., the multi-start optimization) disable the warning.
+   * @var exactPenaltyHessian should the exact Hessian of the smooth penalty be added analytically instead of
+   * being approximated with BFGS? Only used if the smooth penalty provides it (see smoothPenalty::hasHessianDiagonal).
+   * The initialHessian, the Hessian of the warmStart, and the Hessian of the returned state then refer to the
+   * model only. Defaults to false.
    */
   struct controlGLMNET
   {
@@ -75,6 +106,16 @@ namespace lessSEM
     // breaking condition.
     int verbose; // if set to a value > 0, the fit every verbose iterations
     // is printed.
+    controlCheckpoint checkpoint; // write checkpoints / resume from a checkpoint
+    hessianReturn returnHessian;  // full, diagonal, packed, or no Hessian
+    optimizerState warmStart;     // state of a previous fit
+    bool returnState;             // return the final state for warm starts
+    controlScreening screening;   // safe screening for lasso and elastic net
+    controlInitialHessian initialHessianEstimate; // finite difference initial Hessian
+    double forcingMax;                            // adaptive inner stopping rule
+    controlTrustRegion trustRegion;               // trust region instead of line search
+    bool warnNotConverged;                        // warn if the outer iterations did not converge
+    bool exactPenaltyHessian;                     // add the exact Hessian of the smooth penalty
   };
 
   /**
@@ -98,15 +139,60 @@ namespace lessSEM
         1e-10,          // breakInner;
         fitChange,      // convergenceCriterion; // this is related to the inner
         // breaking condition.
-        0 // verbose; // if set to a value > 0, the fit every verbose iterations
-          // is printed.
+        0, // verbose; // if set to a value > 0, the fit every verbose iterations
+           // is printed.
+        controlCheckpointDefault(), // checkpoint
+        returnFullHessian,          // returnHessian
+        optimizerState(),           // warmStart
+        false,                      // returnState
+        controlScreeningDefault(),  // screening
+        controlInitialHessianDefault(), // initialHessianEstimate
+        0.0,                            // forcingMax
+        controlTrustRegionDefault(),    // trustRegion
+        true,                           // warnNotConverged
+        false                           // exactPenaltyHessian
     };
     return (defaultIs);
   }
 
+  /**
+   * @brief tolerance of the inner iterations of glmnet (inexact proximal Newton; Lee et al., 2014).
+   * The change in the first sweep of the inner iteration, max_j(H_jj * z_j^2), measures how far the
+   * outer iteration is from the optimum. The inner iteration stops once the change of a sweep is
+   * small relative to the first one. The forcing term min(forcingMax, sqrt(firstChange)) goes to zero
+   * as the outer iteration converges, so that the tolerance tightens. As the changes are squared, the
+   * forcing term is squared as well.
+   *
+   * Lee et al. (2014) compare the norms of the composite gradient steps of the quadratic approximation
+   * and of the fit function instead. Computing these residuals would require an additional pass over the
+   * Hessian in each sweep. The sweep changes are used as proxies: the first sweep starts at direction = 0
+   * and its coordinate steps approximate the scaled composite gradient steps of the fit function at the current
+   * parameters; the change of a later sweep measures the remaining residual of the quadratic approximation
+   * at the current direction. This only decides when the inner iteration stops. Each step direction
+   * still reduces the quadratic approximation, the line search (or trust region) still ensures a
+   * decrease of the penalized fit, and the outer convergence criteria are unchanged.
+   *
+   * * Lee, J. D., Sun, Y., & Saunders, M. A. (2014). Proximal Newton-type methods for minimizing
+   * composite functions. SIAM Journal on Optimization, 24(3), 1420–1443.
+   *
+   * @param firstChange change in the first sweep of the inner iteration
+   * @param breakInner smallest tolerance
+   * @param forcingMax largest forcing term. If 0, breakInner is returned.
+   * @return double
+   */
+  inline double innerTolerance(const double firstChange,
+                               const double breakInner,
+                               const double forcingMax)
+  {
+    if (forcingMax <= 0.0)
+      return (breakInner);
+    const double forcing = std::min(forcingMax, std::sqrt(firstChange));
+    return (std::max(breakInner, forcing * forcing * firstChange));
+  }
+
   /**
    * @brief The glmnet optimizer has an outer and an inner optimization loop. This function implements
-   * the inner optimization loop which returns the step direction.
+   * the inner optimization loop for penalties which update one parameter at a time and returns the step direction.
    * To this end, the function q_k(direction) = direction * gradients_kMinus1 + .5*direction*Hessian_kMinus1 * direction + sum_j(lambda_j*alpha_j*|parameters_kMinus1_j + direction_j| - lambda_j*alpha_j*|parameters_kMinus1_j|) is minimized.
    * @param parameters_kMinus1 parameter estimates from previous iteration k-1
    * @param gradients_kMinus1 gradients from previous iteration
@@ -117,18 +203,28 @@ namespace lessSEM
    * @param maxIterIn Maximal number of inner iterations
    * @param breakInner Stopping criterion for inner iterations
    * @param verbose 0 prints no additional information, > 0 prints GLMNET iterations
+   * @param activeSet indices of parameters which are expected to be non-zero (e.g., from a warm start). If
+   * provided, these parameters are optimized first before all parameters are updated.
+   * @param screened parameters which were removed by the safe screening. These parameters are zero at
+   * the optimum and are not updated.
+   * @param forcingMax largest forcing term of the adaptive inner stopping rule (see innerTolerance)
+   * @param radius radius of the box trust region (see trustRegion.h)
    * @return arma::rowvec with parameters
    */
   template <typename nonsmoothPenalty,
             typename tuning>
-  inline arma::rowvec glmnetInner(const arma::rowvec &parameters_kMinus1,
-                                  const arma::rowvec &gradients_kMinus1,
-                                  const arma::mat &Hessian,
-                                  nonsmoothPenalty &penalty_,
-                                  const tuning &tuningParameters,
-                                  const int maxIterIn,
-                                  const double breakInner,
-                                  const int verbose)
+  inline arma::rowvec glmnetInnerCoordinates(const arma::rowvec &parameters_kMinus1,
+                                              const arma::rowvec &gradients_kMinus1,
+                                              const arma::mat &Hessian,
+                                              nonsmoothPenalty &penalty_,
+                                              const tuning &tuningParameters,
+                                              const int maxIterIn,
+                                              const double breakInner,
+                                              const int verbose,
+                                              const std::vector<unsigned int> &activeSet = std::vector<unsigned int>(),
+                                              const std::vector<bool> &screened = std::vector<bool>(),
+                                              const double forcingMax = 0.0,
+                                              const double radius = arma::datum::inf)
   {
 
     static_cast<void>(verbose); // currently not used; for later use
@@ -146,12 +242,65 @@ namespace lessSEM
 
     HessDiag.diag() = Hessian.diag();
 
-    // the order in which parameters are updated should be random
-    numericVector randOrder(stepDirection.n_elem);
-    numericVector sampleFrom(stepDirection.n_elem);
+    // parameters removed by the screening are not updated
+    std::vector<unsigned int> freeParameters;
     for (unsigned int i = 0; i < stepDirection.n_elem; i++)
-      sampleFrom.at(i) = i;
+    {
+      if (screened.empty() || !screened.at(i))
+        freeParameters.push_back(i);
+    }
+    if (freeParameters.empty())
+      return (stepDirection);
+
+    // the order in which parameters are updated should be random
+    numericVector randOrder(freeParameters.size());
+    numericVector sampleFrom(freeParameters.size());
+    for (unsigned int i = 0; i < freeParameters.size(); i++)
+      sampleFrom.at(i) = freeParameters.at(i);
+
+    std::vector<unsigned int> activeFree;
+    for (unsigned int p : activeSet)
+    {
+      if (screened.empty() || !screened.at(p))
+        activeFree.push_back(p);
+    }
+
+    if (!activeFree.empty())
+    {
+      // optimize the active parameters first. The full sweeps below
+      // then start close to the solution.
+      numericVector activeOrder(activeFree.size());
+      numericVector sampleFromActive(activeFree.size());
+      for (unsigned int i = 0; i < activeFree.size(); i++)
+        sampleFromActive.at(i) = activeFree.at(i);
+
+      for (int it = 0; it < maxIterIn; it++)
+      {
+        double maxChange = 0.0;
+        activeOrder = sample(sampleFromActive, activeFree.size(), false);
 
+        for (unsigned int p = 0; p < activeFree.size(); p++)
+        {
+          z_j = penalty_.getZ(
+              activeOrder.at(p),
+              parameters_kMinus1,
+              gradients_kMinus1,
+              stepDirection,
+              Hessian,
+              tuningParameters);
+          if (radius < arma::datum::inf)
+            z_j = restrictToTrustRegion(stepDirection.at(activeOrder.at(p)), z_j, radius);
+          stepDirection.col(activeOrder.at(p)) += z_j;
+          maxChange = std::max(maxChange,
+                               Hessian.at(activeOrder.at(p), activeOrder.at(p)) * z_j * z_j);
+        }
+
+        if (maxChange < breakInner)
+          break;
+      }
+    }
+
+    double tolerance = breakInner;
     for (int it = 0; it < maxIterIn; it++)
     {
 
@@ -160,9 +309,9 @@ namespace lessSEM
       // z_old.fill(arma::fill::zeros);
 
       // iterate over parameters in random order
-      randOrder = sample(sampleFrom, stepDirection.n_elem, false);
+      randOrder = sample(sampleFrom, freeParameters.size(), false);
 
-      for (unsigned int p = 0; p < stepDirection.n_elem; p++)
+      for (unsigned int p = 0; p < freeParameters.size(); p++)
       {
         // get the update to the parameter:
         z_j = penalty_.getZ(
@@ -172,6 +321,8 @@ namespace lessSEM
             stepDirection,
             Hessian,
             tuningParameters);
+        if (radius < arma::datum::inf)
+          z_j = restrictToTrustRegion(stepDirection.at(randOrder.at(p)), z_j, radius);
         z.col(randOrder.at(p)) = z_j;
         stepDirection.col(randOrder.at(p)) += z_j;
       }
@@ -184,7 +335,10 @@ namespace lessSEM
       //   break;
       // }
 
-      if (HessTimesZ.max() < breakInner)
+      if (it == 0)
+        tolerance = innerTolerance(HessTimesZ.max(), breakInner, forcingMax);
+
+      if (HessTimesZ.max() < tolerance)
       {
         break;
       }
@@ -194,6 +348,137 @@ namespace lessSEM
     return (stepDirection);
   }
 
+  /**
+   * @brief inner iteration of glmnet for penalties which update blocks of parameters (e.g., the group lasso;
+   * see glmnet_groupLasso.h). The blocks are defined in the tuning parameters. Each update of a block uses
+   * the product of the step direction with the columns of the Hessian belonging to the block.
+   *
+   * @param parameters_kMinus1 parameter estimates from previous iteration k-1
+   * @param gradients_kMinus1 gradients from previous iteration
+   * @param Hessian Hessian_kMinus1 Hessian from previous iteration
+   * @param tuningParameters tuning parameters with the blocks (numberBlocks, blockFirst, blockLast)
+   * @param maxIterIn Maximal number of inner iterations
+   * @param breakInner Stopping criterion for inner iterations
+   * @param forcingMax largest forcing term of the adaptive inner stopping rule (see innerTolerance)
+   * @param radius radius of the box trust region (see trustRegion.h). The block update is projected on the box.
+   * @return arma::rowvec with step direction
+   */
+  template <typename nonsmoothPenalty,
+            typename tuning>
+  inline arma::rowvec glmnetInnerBlocks(const arma::rowvec &parameters_kMinus1,
+                                        const arma::rowvec &gradients_kMinus1,
+                                        const arma::mat &Hessian,
+                                        nonsmoothPenalty &penalty_,
+                                        const tuning &tuningParameters,
+                                        const int maxIterIn,
+                                        const double breakInner,
+                                        const double forcingMax = 0.0,
+                                        const double radius = arma::datum::inf)
+  {
+    tuningParameters.checkBlocks(parameters_kMinus1.n_elem);
+
+    arma::rowvec stepDirection(parameters_kMinus1.n_elem, arma::fill::zeros);
+
+    double tolerance = breakInner;
+    for (int it = 0; it < maxIterIn; it++)
+    {
+      double maxChange = 0.0;
+      for (unsigned int b = 0; b < tuningParameters.numberBlocks(); b++)
+      {
+        const arma::uword first = tuningParameters.blockFirst(b);
+        const arma::uword last = tuningParameters.blockLast(b);
+        arma::rowvec z = penalty_.getBlockZ(b,
+                                            parameters_kMinus1,
+                                            gradients_kMinus1,
+                                            stepDirection,
+                                            Hessian,
+                                            tuningParameters);
+        if (radius < arma::datum::inf)
+        {
+          for (arma::uword j = first; j <= last; j++)
+            z.at(j - first) = restrictToTrustRegion(stepDirection.at(j), z.at(j - first), radius);
+        }
+        stepDirection.cols(first, last) += z;
+        for (arma::uword j = first; j <= last; j++)
+          maxChange = std::max(maxChange, Hessian.at(j, j) * z.at(j - first) * z.at(j - first));
+      }
+
+      if (it == 0)
+        tolerance = innerTolerance(maxChange, breakInner, forcingMax);
+
+      if (maxChange < tolerance)
+        break;
+    }
+
+    return (stepDirection);
+  }
+
+  /**
+   * @brief The glmnet optimizer has an outer and an inner optimization loop. This function implements
+   * the inner optimization loop which returns the step direction. Penalties with block updates
+   * (see hasBlockUpdates) are optimized with glmnetInnerBlocks, all other penalties with
+   * glmnetInnerCoordinates.
+   * @param parameters_kMinus1 parameter estimates from previous iteration k-1
+   * @param gradients_kMinus1 gradients from previous iteration
+   * @param Hessian Hessian_kMinus1 Hessian from previous iteration
+   * @param penalty_ the non-smooth penalty
+   * @param tuningParameters tuning parameters of the penalty
+   * @param maxIterIn Maximal number of inner iterations
+   * @param breakInner Stopping criterion for inner iterations
+   * @param verbose 0 prints no additional information, > 0 prints GLMNET iterations
+   * @param activeSet indices of parameters which are expected to be non-zero (only used by glmnetInnerCoordinates)
+   * @param screened parameters which were removed by the safe screening (only used by glmnetInnerCoordinates)
+   * @param forcingMax largest forcing term of the adaptive inner stopping rule (see innerTolerance)
+   * @param radius radius of the box trust region (see trustRegion.h)
+   * @return arma::rowvec with parameters
+   */
+  template <typename nonsmoothPenalty,
+            typename tuning>
+  inline arma::rowvec glmnetInner(const arma::rowvec &parameters_kMinus1,
+                                  const arma::rowvec &gradients_kMinus1,
+                                  const arma::mat &Hessian,
+                                  nonsmoothPenalty &penalty_,
+                                  const tuning &tuningParameters,
+                                  const int maxIterIn,
+                                  const double breakInner,
+                                  const int verbose,
+                                  const std::vector<unsigned int> &activeSet = std::vector<unsigned int>(),
+                                  const std::vector<bool> &screened = std::vector<bool>(),
+                                  const double forcingMax = 0.0,
+                                  const double radius = arma::datum::inf)
+  {
+    if constexpr (hasBlockUpdates<nonsmoothPenalty, tuning>::value)
+    {
+      static_cast<void>(verbose);
+      static_cast<void>(activeSet);
+      static_cast<void>(screened);
+      return (glmnetInnerBlocks(parameters_kMinus1,
+                                gradients_kMinus1,
+                                Hessian,
+                                penalty_,
+                                tuningParameters,
+                                maxIterIn,
+                                breakInner,
+                                forcingMax,
+                                radius));
+    }
+    else
+    {
+      return (glmnetInnerCoordinates(parameters_kMinus1,
+                                     gradients_kMinus1,
+                                     Hessian,
+                                     penalty_,
+                                     tuningParameters,
+                                     maxIterIn,
+                                     breakInner,
+                                     verbose,
+                                     activeSet,
+                                     screened,
+                                     forcingMax,
+                                     radius));
+    }
+  }
+
   /**
    * @brief Given a step direction "direction", the line search procedure will find an adequate
    * step length s in this direction. The new parameter values are then given by
@@ -202,7 +487,8 @@ namespace lessSEM
    * @tparam nonsmoothPenalty class of type nonsmoothPenalty (e.g., lasso, scad, lsp)
    * @tparam smoothPenalty class of type smooth penalty (e.g., ridge)
    * @tparam tuning tuning parameters used by both, the nonsmootPenalty and the smoothPenalty
-   * @param model_ the model object derived from the model class in model.h
+   * @tparam modelClass class of the model (e.g., derived from model)
+   * @param model_ the model object derived from the model class in model.h or any class with the methods fit and gradients (see traits.h)
    * @param penalty_ a penalty derived from the penalty class in penalty.h
    * @param smoothPenalty a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
    * @param parameters_kMinus1 parameter estimates from previous iteration k-1
@@ -220,9 +506,9 @@ namespace lessSEM
    * @return vector with updated parameters (parameters_k)
    */
   template <typename nonsmoothPenalty, typename smoothPenalty,
-            typename tuning>
+            typename tuning, typename modelClass>
   inline arma::rowvec glmnetLineSearch(
-      model &model_,
+      modelClass &model_,
       nonsmoothPenalty &penalty_,
       smoothPenalty &smoothPenalty_,
       const arma::rowvec &parameters_kMinus1,
@@ -255,17 +541,19 @@ namespace lessSEM
 
     // get penalized M2LL for step size 0:
 
-    double pen_0 = penalty_.getValue(parameters_kMinus1,
-                                     parameterLabels,
-                                     tuningParameters);
+    double pen_0 = penaltyValue(penalty_,
+                                parameters_kMinus1,
+                                parameterLabels,
+                                tuningParameters);
     // Note: we see the smooth penalty as part of the smooth
     // objective function and not as part of the non-differentiable
     // penalty
     double f_0 = fit_kMinus1 + pen_0;
     // needed for convergence criterion (see Yuan et al. (2012), Eq. 20)
-    double pen_d = penalty_.getValue(parameters_kMinus1 + direction,
-                                     parameterLabels,
-                                     tuningParameters);
+    double pen_d = penaltyValue(penalty_,
+                                parameters_kMinus1 + direction,
+                                parameterLabels,
+                                tuningParameters);
 
     double currentStepSize;
     // a step size of >= 1 would result in no change or in an increasing step
@@ -288,6 +576,9 @@ namespace lessSEM
 
     bool converged = false;
 
+    const int batchSize = modelBatchSize(model_);
+    arma::colvec batchFits;
+
     for (int iteration = 0; iteration < maxIterLine; iteration++)
     {
 
@@ -297,11 +588,29 @@ namespace lessSEM
 
       parameters_k = parameters_kMinus1 + currentStepSize * direction;
 
-      fit_k = model_.fit(parameters_k,
-                         parameterLabels) +
-              smoothPenalty_.getValue(parameters_k,
-                                      parameterLabels,
-                                      tuningParameters);
+      // models which evaluate several points at once get the fits of the
+      // next batchSize step sizes in a single call (see model::fitBatch)
+      if (batchSize > 1)
+      {
+        if (iteration % batchSize == 0)
+        {
+          arma::mat points(std::min(batchSize, maxIterLine - iteration), parameters_kMinus1.n_elem);
+          for (unsigned int b = 0; b < points.n_rows; b++)
+            points.row(b) = parameters_kMinus1 + std::pow(stepSize, iteration + b) * direction;
+          batchFits = modelFitBatch(model_, points, parameterLabels, 1);
+        }
+        fit_k = batchFits.at(iteration % batchSize);
+      }
+      else
+      {
+        fit_k = modelFit(model_,
+                         parameters_k,
+                         parameterLabels);
+      }
+      fit_k += penaltyValue(smoothPenalty_,
+                            parameters_k,
+                            parameterLabels,
+                            tuningParameters);
 
       if (!arma::is_finite(fit_k))
       {
@@ -312,9 +621,10 @@ namespace lessSEM
       // compute g(stepSize) = g(x+td) + p(x+td) - g(x) - p(x),
       // where g is the differentiable part and p the non-differentiable part
       // p(x+td):
-      p_k = penalty_.getValue(parameters_k,
-                              parameterLabels,
-                              tuningParameters);
+      p_k = penaltyValue(penalty_,
+                         parameters_k,
+                         parameterLabels,
+                         tuningParameters);
 
       // g(x+td) + p(x+td)
       f_k = fit_k + p_k;
@@ -340,8 +650,9 @@ namespace lessSEM
       {
         // check if gradients can be computed at the new location;
         // this can often cause issues
-        gradients_k = model_.gradients(parameters_k,
-                                       parameterLabels);
+        gradients_k = modelGradients(model_,
+                                     parameters_k,
+                                     parameterLabels);
 
         if (!arma::is_finite(gradients_k))
         {
@@ -369,7 +680,8 @@ namespace lessSEM
    * @tparam nonsmoothPenalty class of type nonsmoothPenalty (e.g., lasso, scad, lsp)
    * @tparam smoothPenalty class of type smooth penalty (e.g., ridge)
    * @tparam tuning tuning parameters used by both, the nonsmootPenalty and the smoothPenalty
-   * @param model_ the model object derived from the model class in model.h
+   * @tparam modelClass class of the model (e.g., derived from model)
+   * @param model_ the model object derived from the model class in model.h or any class with the methods fit and gradients (see traits.h)
    * @param startingValuesRcpp an Rcpp numeric vector with starting values
    * @param penalty_ a penalty derived from the penalty class in penalty.h
    * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
@@ -379,14 +691,18 @@ namespace lessSEM
    * @return fit result
    */
   template <typename nonsmoothPenalty, typename smoothPenalty,
-            typename tuning>
-  inline lessSEM::fitResults glmnet(model &model_,
+            typename tuning, typename modelClass>
+  inline lessSEM::fitResults glmnet(modelClass &model_,
                                     numericVector startingValuesRcpp,
                                     nonsmoothPenalty &penalty_,
                                     smoothPenalty &smoothPenalty_,
                                     const tuning &tuningParameters,
                                     const controlGLMNET &control_ = controlGlmnetDefault())
   {
+    static_assert(isModel<modelClass>::value,
+                  "The model must provide the methods fit and gradients (see model.h).");
+    static_assert(isSmoothPenalty<smoothPenalty, tuning>::value,
+                  "The smooth penalty must provide the methods getValue and getGradients (see smoothPenalty.h).");
 
     if (control_.verbose != 0)
     {
@@ -397,6 +713,10 @@ namespace lessSEM
     arma::rowvec startingValues = toArmaVector(startingValuesRcpp);
     stringVector parameterLabels = startingValuesRcpp.names();
 
+    // the model is often evaluated repeatedly at the same parameter values;
+    // cachedModel_ returns stored results in this case (see modelCache.h)
+    cachedModel cachedModel_(model_);
+
     // prepare parameter vectors
     arma::rowvec parameters_k = startingValues,
                  parameters_kMinus1 = startingValues;
@@ -404,26 +724,30 @@ namespace lessSEM
 
     // prepare fit elements
     // fit of the smooth part of the fit function
-    double fit_k = model_.fit(parameters_k,
+    double fit_k = cachedModel_.fit(parameters_k,
                               parameterLabels) +
-                   smoothPenalty_.getValue(parameters_k,
-                                           parameterLabels,
-                                           tuningParameters);
-    double fit_kMinus1 = model_.fit(parameters_kMinus1,
+                   penaltyValue(smoothPenalty_,
+                                parameters_k,
+                                parameterLabels,
+                                tuningParameters);
+    double fit_kMinus1 = cachedModel_.fit(parameters_kMinus1,
                                     parameterLabels) +
-                         smoothPenalty_.getValue(parameters_kMinus1,
-                                                 parameterLabels,
-                                                 tuningParameters);
+                         penaltyValue(smoothPenalty_,
+                                      parameters_kMinus1,
+                                      parameterLabels,
+                                      tuningParameters);
     // add non-differentiable part
     double penalizedFit_k = fit_k +
-                            penalty_.getValue(parameters_k,
-                                              parameterLabels,
-                                              tuningParameters);
+                            penaltyValue(penalty_,
+                                         parameters_k,
+                                         parameterLabels,
+                                         tuningParameters);
 
     double penalizedFit_kMinus1 = fit_kMinus1 +
-                                  penalty_.getValue(parameters_kMinus1,
-                                                    parameterLabels,
-                                                    tuningParameters);
+                                  penaltyValue(penalty_,
+                                               parameters_kMinus1,
+                                               parameterLabels,
+                                               tuningParameters);
 
     // the following vector will save the fits of all iterations:
     arma::rowvec fits(control_.maxIterOut + 1);
@@ -433,16 +757,18 @@ namespace lessSEM
     // prepare gradient elements
     // NOTE: We combine the gradients of the smooth functions (the log-Likelihood)
     // of the model and the smooth penalty function (e.g., ridge)
-    arma::rowvec gradients_k = model_.gradients(parameters_k,
+    arma::rowvec gradients_k = cachedModel_.gradients(parameters_k,
                                                 parameterLabels) +
-                               smoothPenalty_.getGradients(parameters_k,
-                                                           parameterLabels,
-                                                           tuningParameters); // ridge part
-    arma::rowvec gradients_kMinus1 = model_.gradients(parameters_kMinus1,
+                               penaltyGradients(smoothPenalty_,
+                                                parameters_k,
+                                                parameterLabels,
+                                                tuningParameters); // ridge part
+    arma::rowvec gradients_kMinus1 = cachedModel_.gradients(parameters_kMinus1,
                                                       parameterLabels) +
-                                     smoothPenalty_.getGradients(parameters_kMinus1,
-                                                                 parameterLabels,
-                                                                 tuningParameters); // ridge part
+                                     penaltyGradients(smoothPenalty_,
+                                                      parameters_kMinus1,
+                                                      parameterLabels,
+                                                      tuningParameters); // ridge part
 
     // prepare Hessian elements
     arma::mat Hessian_k(startingValues.n_elem, startingValues.n_elem, arma::fill::zeros),
@@ -460,11 +786,94 @@ namespace lessSEM
       Hessian_kMinus1 = control_.initialHessian;
     }
 
+    // approximate the initial Hessian with finite differences. The unwrapped model is used
+    // because the gradients may be evaluated in parallel and cachedModel is not thread-safe
+    if ((control_.initialHessianEstimate.type != userHessian) &&
+        (control_.warmStart.Hessian.n_elem == 0))
+    {
+      Hessian_k = approximateInitialHessian(model_,
+                                            startingValues,
+                                            parameterLabels,
+                                            control_.initialHessianEstimate);
+      Hessian_kMinus1 = Hessian_k;
+    }
+
+    // warm start from a previous fit
+    if (hasWarmStartHessian(control_.warmStart, startingValues.n_elem))
+    {
+      Hessian_k = control_.warmStart.Hessian;
+      Hessian_kMinus1 = control_.warmStart.Hessian;
+    }
+
+    // with exactPenaltyHessian, the initial Hessian refers to the model only. The exact
+    // Hessian of the smooth penalty is added here and BFGS only approximates the model part.
+    Hessian_k = addSmoothPenaltyHessian(Hessian_k,
+                                        smoothPenalty_,
+                                        parameters_k,
+                                        parameterLabels,
+                                        tuningParameters,
+                                        control_.exactPenaltyHessian);
+    Hessian_kMinus1 = Hessian_k;
+    std::vector<unsigned int> activeSet = control_.warmStart.activeSet;
+    for (unsigned int p : activeSet)
+    {
+      if (p >= startingValues.n_elem)
+        error("The active set of the warm start does not match the number of parameters.");
+    }
+
+    // safe screening (lasso and elastic net only)
+    std::unique_ptr<gapSafeScreening> screening_;
+    if (usesScreening(control_.screening))
+    {
+      if constexpr (std::is_same<nonsmoothPenalty, penaltyLASSOGlmnet>::value &&
+                    std::is_same<smoothPenalty, penaltyRidgeGlmnet>::value)
+      {
+        screening_ = std::make_unique<gapSafeScreening>(control_.screening,
+                                                        lassoLambda(tuningParameters),
+                                                        ridgeCurvature(tuningParameters),
+                                                        1.0);
+      }
+      else
+      {
+        error("Screening is only supported for penaltyLASSOGlmnet combined with penaltyRidgeGlmnet.");
+      }
+    }
+
     // breaking flags
     bool breakOuter = false; // if true, the outer iteration is exited
+    bool collapsedTrustRegion = false; // if true, the trust region radius fell below minRadius
+
+    // trust region instead of line search (see trustRegion.h)
+    const bool useTrustRegion = control_.trustRegion.initialRadius > 0.0;
+    double radius = useTrustRegion ? control_.trustRegion.initialRadius : arma::datum::inf;
+
+    // resume from a checkpoint
+    int firstIteration = 0;
+    if (!control_.checkpoint.resumeFrom.empty())
+    {
+      optimizerCheckpoint checkpoint_ = readCheckpoint(control_.checkpoint.resumeFrom,
+                                                       checkpointGlmnet,
+                                                       startingValues.n_elem);
+      firstIteration = checkpoint_.iteration + 1;
+      fit_k = fit_kMinus1 = checkpoint_.fit_kMinus1;
+      penalizedFit_k = penalizedFit_kMinus1 = checkpoint_.penalizedFit_kMinus1;
+      parameters_k = parameters_kMinus1 = checkpoint_.parameters_kMinus1;
+      gradients_k = gradients_kMinus1 = checkpoint_.gradients_kMinus1;
+      Hessian_k = Hessian_kMinus1 = checkpoint_.Hessian_kMinus1;
+      fits = restoreFits(checkpoint_.fits, control_.maxIterOut);
+      setRandomState(checkpoint_.randomState);
+      // the radius of the trust region is stored in place of the step size of ista
+      if (useTrustRegion && checkpoint_.L_kMinus1 > 0.0)
+        radius = checkpoint_.L_kMinus1;
+      if (screening_)
+        screening_->restore(checkpoint_.screening);
+      // the active set of the warm start was already used in the first iteration
+      activeSet.clear();
+    }
+    std::unique_ptr<checkpointWriter> checkpointWriter_ = makeCheckpointWriter(control_.checkpoint);
 
     // outer iteration
-    for (int outer_iteration = 0; outer_iteration < control_.maxIterOut; outer_iteration++)
+    for (int outer_iteration = firstIteration; outer_iteration < control_.maxIterOut; outer_iteration++)
     {
 
       // check if user wants to stop the computation:
@@ -474,8 +883,8 @@ namespace lessSEM
 
       // the gradients will be used by the inner iteration to compute the new
       // parameters
-      gradients_kMinus1 = model_.gradients(parameters_kMinus1, parameterLabels) +
-                          smoothPenalty_.getGradients(parameters_kMinus1, parameterLabels, tuningParameters); // ridge part
+      gradients_kMinus1 = cachedModel_.gradients(parameters_kMinus1, parameterLabels) +
+                          penaltyGradients(smoothPenalty_, parameters_kMinus1, parameterLabels, tuningParameters); // ridge part
 
       // find step direction
       direction = glmnetInner(parameters_kMinus1,
@@ -485,115 +894,191 @@ namespace lessSEM
                               tuningParameters,
                               control_.maxIterIn,
                               control_.breakInner,
-                              control_.verbose);
+                              control_.verbose,
+                              activeSet,
+                              screening_ ? screening_->mask() : std::vector<bool>(),
+                              control_.forcingMax,
+                              radius);
+      // the active set of the warm start is only used in the first iteration
+      activeSet.clear();
+
+      bool rejected = false; // if true, the trust region rejected the step
+      if (useTrustRegion)
+      {
+        // the full step is evaluated once and accepted or rejected based on the ratio
+        // of the actual to the predicted reduction of the penalized fit
+        parameters_k = parameters_kMinus1 + direction;
+        const double penalty_k = penaltyValue(penalty_,
+                                              parameters_k,
+                                              parameterLabels,
+                                              tuningParameters);
+        const double predictedReduction = -(arma::dot(gradients_kMinus1, direction) +
+                                            .5 * arma::as_scalar(direction * Hessian_kMinus1 * arma::trans(direction)) +
+                                            penalty_k - (penalizedFit_kMinus1 - fit_kMinus1));
+        const double trialFit = cachedModel_.fit(parameters_k,
+                                                 parameterLabels) +
+                                penaltyValue(smoothPenalty_,
+                                             parameters_k,
+                                             parameterLabels,
+                                             tuningParameters) +
+                                penalty_k;
+        const double ratio = (penalizedFit_kMinus1 - trialFit) / predictedReduction;
+
+        // if the quadratic approximation predicts no reduction, the step is (close to) zero and is
+        // only accepted if the penalized fit does not increase
+        const bool accept = std::isfinite(trialFit) &&
+                            (trialFit <= penalizedFit_kMinus1) &&
+                            ((predictedReduction <= 0.0) || (ratio > control_.trustRegion.acceptance));
+        if (!std::isfinite(trialFit) || predictedReduction > 0.0)
+          radius = updateTrustRegion(radius,
+                                     std::isfinite(trialFit) ? ratio : arma::datum::nan,
+                                     arma::max(arma::abs(direction)),
+                                     control_.trustRegion);
+
+        if (!accept)
+        {
+          // stay at the current parameters; the next inner iteration uses the smaller radius
+          rejected = true;
+          if (predictedReduction <= 0.0)
+            radius = control_.trustRegion.shrink * std::min(arma::max(arma::abs(direction)), radius);
+          parameters_k = parameters_kMinus1;
+          fit_k = fit_kMinus1;
+          penalizedFit_k = penalizedFit_kMinus1;
+          gradients_k = gradients_kMinus1;
+          Hessian_k = Hessian_kMinus1;
+          fits(outer_iteration + 1) = penalizedFit_kMinus1;
+          // no step within the collapsed trust region reduces the penalized fit:
+          // the optimizer stops, but this is not reported as convergence
+          collapsedTrustRegion = radius < control_.trustRegion.minRadius;
+          breakOuter = collapsedTrustRegion;
+        }
+      }
+      else
+      {
+        // find length of step in direction
+        parameters_k = glmnetLineSearch(cachedModel_,
+                                        penalty_,
+                                        smoothPenalty_,
+                                        parameters_kMinus1,
+                                        parameterLabels,
+                                        direction,
+                                        fit_kMinus1,
+                                        gradients_kMinus1,
+                                        Hessian_kMinus1,
+
+                                        tuningParameters,
+
+                                        control_.stepSize,
+                                        control_.sigma,
+                                        control_.gamma,
+                                        control_.maxIterLine,
+                                        control_.verbose);
+      }
 
-      // find length of step in direction
-      parameters_k = glmnetLineSearch(model_,
-                                      penalty_,
-                                      smoothPenalty_,
-                                      parameters_kMinus1,
-                                      parameterLabels,
-                                      direction,
-                                      fit_kMinus1,
-                                      gradients_kMinus1,
-                                      Hessian_kMinus1,
-
-                                      tuningParameters,
-
-                                      control_.stepSize,
-                                      control_.sigma,
-                                      control_.gamma,
-                                      control_.maxIterLine,
-                                      control_.verbose);
-
-      // get gradients of differentiable part
-      gradients_k = model_.gradients(parameters_k,
-                                     parameterLabels) +
-                    smoothPenalty_.getGradients(parameters_k,
-                                                parameterLabels,
-                                                tuningParameters);
-      // fit of the smooth part of the fit function
-      fit_k = model_.fit(parameters_k,
-                         parameterLabels) +
-              smoothPenalty_.getValue(parameters_k,
+      // rejected steps of the trust region leave the parameters unchanged
+      if (!rejected)
+      {
+        // get gradients of differentiable part
+        gradients_k = cachedModel_.gradients(parameters_k,
+                                       parameterLabels) +
+                      penaltyGradients(smoothPenalty_,
+                                       parameters_k,
+                                       parameterLabels,
+                                       tuningParameters);
+        // fit of the smooth part of the fit function
+        fit_k = cachedModel_.fit(parameters_k,
+                           parameterLabels) +
+                penaltyValue(smoothPenalty_,
+                             parameters_k,
+                             parameterLabels,
+                             tuningParameters);
+        // add non-differentiable part
+        penalizedFit_k = fit_k +
+                         penaltyValue(penalty_,
+                                      parameters_k,
                                       parameterLabels,
                                       tuningParameters);
-      // add non-differentiable part
-      penalizedFit_k = fit_k +
-                       penalty_.getValue(parameters_k,
-                                         parameterLabels,
-                                         tuningParameters);
 
-      fits(outer_iteration + 1) = penalizedFit_k;
+        fits(outer_iteration + 1) = penalizedFit_k;
 
-      // print fit info
-      if (control_.verbose > 0 && outer_iteration % control_.verbose == 0)
-      {
-        print << "Fit in iteration outer_iteration "
-              << outer_iteration + 1
-              << ": "
-              << penalizedFit_k
-              << "\n"
-              << parameters_k
-              << "\n";
-      }
-
-      // Approximate Hessian using BFGS
-      Hessian_k = lessSEM::BFGS(
-          parameters_kMinus1,
-          gradients_kMinus1,
-          Hessian_kMinus1,
-          parameters_k,
-          gradients_k,
-          true,
-          .001,
-          control_.verbose == -99);
-
-      // check convergence
-      if (control_.convergenceCriterion == GLMNET)
-      {
-        arma::mat HessDiag = arma::eye(Hessian_k.n_rows,
-                                       Hessian_k.n_cols);
-        HessDiag.fill(0.0);
-        HessDiag.diag() = Hessian_k.diag();
-        try
+        // print fit info
+        if (control_.verbose > 0 && outer_iteration % control_.verbose == 0)
         {
-          breakOuter = max(HessDiag * arma::pow(arma::trans(direction), 2)) < control_.breakOuter;
+          print << "Fit in iteration outer_iteration "
+                << outer_iteration + 1
+                << ": "
+                << penalizedFit_k
+                << "\n"
+                << parameters_k
+                << "\n";
         }
-        catch (...)
+
+        // Approximate Hessian using BFGS
+        Hessian_k = lessSEM::BFGS(
+            smoothPenalty_,
+            parameterLabels,
+            tuningParameters,
+            control_.exactPenaltyHessian,
+            parameters_kMinus1,
+            gradients_kMinus1,
+            Hessian_kMinus1,
+            parameters_k,
+            gradients_k,
+            true,
+            .001,
+            control_.verbose == -99);
+
+        // check convergence
+        if (control_.convergenceCriterion == GLMNET)
         {
-          error("Error while computing convergence criterion");
+          arma::mat HessDiag = arma::eye(Hessian_k.n_rows,
+                                         Hessian_k.n_cols);
+          HessDiag.fill(0.0);
+          HessDiag.diag() = Hessian_k.diag();
+          try
+          {
+            breakOuter = max(HessDiag * arma::pow(arma::trans(direction), 2)) < control_.breakOuter;
+          }
+          catch (...)
+          {
+            error("Error while computing convergence criterion");
+          }
         }
-      }
-      if (control_.convergenceCriterion == fitChange)
-      {
-        try
+        if (control_.convergenceCriterion == fitChange)
         {
-          breakOuter = std::abs(fits(outer_iteration + 1) -
-                                fits(outer_iteration)) <
-                       control_.breakOuter;
+          try
+          {
+            breakOuter = std::abs(fits(outer_iteration + 1) -
+                                  fits(outer_iteration)) <
+                         control_.breakOuter;
+          }
+          catch (...)
+          {
+            error("Error while computing convergence criterion");
+          }
         }
-        catch (...)
+        if (control_.convergenceCriterion == gradients)
         {
-          error("Error while computing convergence criterion");
+          try
+          {
+            arma::rowvec subGradients = penalty_.getSubgradients(
+                parameters_k,
+                gradients_k,
+                tuningParameters);
+
+            // check if all gradients are below the convergence criterion:
+            breakOuter = kktViolation(subGradients) < control_.breakOuter;
+          }
+          catch (...)
+          {
+            error("Error while computing convergence criterion");
+          }
         }
-      }
-      if (control_.convergenceCriterion == gradients)
-      {
-        try
-        {
-          arma::rowvec subGradients = penalty_.getSubgradients(
-              parameters_k,
-              gradients_k,
-              tuningParameters);
 
-          // check if all gradients are below the convergence criterion:
-          breakOuter = arma::sum(arma::abs(subGradients) < control_.breakOuter) ==
-                       subGradients.n_elem;
-        }
-        catch (...)
+        // screen parameters and check the gap bound
+        if (screening_ && screening_->update(outer_iteration, parameters_k, gradients_k))
         {
-          error("Error while computing convergence criterion");
+          breakOuter = true;
         }
       }
 
@@ -609,20 +1094,57 @@ namespace lessSEM
       gradients_kMinus1 = gradients_k;
       Hessian_kMinus1 = Hessian_k;
 
+      if (checkpointWriter_ && writeCheckpointNow(control_.checkpoint, outer_iteration))
+      {
+        checkpointWriter_->submit(
+            {checkpointGlmnet,
+             outer_iteration,
+             fit_kMinus1,
+             penalizedFit_kMinus1,
+             useTrustRegion ? radius : 0.0, // radius of the trust region in place of L_kMinus1
+             parameters_kMinus1,
+             parameters_kMinus1,
+             gradients_kMinus1,
+             fits,
+             Hessian_kMinus1,
+             getRandomState(),
+             screening_ ? screening_->results : screeningResults(),
+             0}); // momentumIteration is only used by ista
+      }
+
     } // end outer iteration
 
-    if (!breakOuter)
+    if (collapsedTrustRegion && control_.warnNotConverged)
+    {
+      warn("The trust region collapsed before the outer iterations converged");
+    }
+    else if (!breakOuter && control_.warnNotConverged)
     {
       warn("Outer iterations did not converge");
     }
 
     fitResults fitResults_;
 
-    fitResults_.convergence = breakOuter;
+    fitResults_.convergence = breakOuter && !collapsedTrustRegion;
     fitResults_.fit = penalizedFit_k;
     fitResults_.fits = fits;
     fitResults_.parameterValues = parameters_k;
-    fitResults_.Hessian = Hessian_k;
+    setHessian(fitResults_, Hessian_k, control_.returnHessian);
+    if (screening_)
+      fitResults_.screening = screening_->results;
+    if (control_.returnState)
+    {
+      // with exactPenaltyHessian, the Hessian of the state refers to the model only;
+      // the next fit adds the Hessian of its own smooth penalty (see initialHessian)
+      fitResults_.state.Hessian = removeSmoothPenaltyHessian(Hessian_k,
+                                                             smoothPenalty_,
+                                                             parameters_k,
+                                                             parameterLabels,
+                                                             tuningParameters,
+                                                             control_.exactPenaltyHessian);
+      fitResults_.state.gradients = gradients_k;
+      fitResults_.state.activeSet = getActiveSet(parameters_k);
+    }
 
     return (fitResults_);
 
@@ -634,7 +1156,8 @@ namespace lessSEM
    * @tparam nonsmoothPenalty class of type nonsmoothPenalty (e.g., lasso, scad, lsp)
    * @tparam smoothPenalty class of type smooth penalty (e.g., ridge)
    * @tparam tuning tuning parameters used by both, the nonsmootPenalty and the smoothPenalty
-   * @param model_ the model object derived from the model class in model.h
+   * @tparam modelClass class of the model (e.g., derived from model)
+   * @param model_ the model object derived from the model class in model.h or any class with the methods fit and gradients (see traits.h)
    * @param startingValues an arma::rowvec vector with starting values
    * @param parameterLabels a stringVector with parameter labels
    * @param penalty_ a penalty derived from the penalty class in penalty.h
@@ -645,8 +1168,8 @@ namespace lessSEM
    * @return fit result
    */
   template <typename nonsmoothPenalty, typename smoothPenalty,
-            typename tuning>
-  inline lessSEM::fitResults glmnet(model &model_,
+            typename tuning, typename modelClass>
+  inline lessSEM::fitResults glmnet(modelClass &model_,
                                     arma::rowvec startingValues,
                                     stringVector parameterLabels,
                                     nonsmoothPenalty &penalty_,
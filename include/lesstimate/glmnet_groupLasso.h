@@ -0,0 +1,114 @@
+#ifndef GROUPLASSO_GLMNET_H
+#define GROUPLASSO_GLMNET_H
+#include "common_headers.h"
+
+#include "penalty.h"
+#include "groupLasso.h"
+
+namespace lessSEM
+{
+  /**
+   * @brief (sparse) group lasso penalty for glmnet (see groupLasso.h)
+   *
+   * The group lasso is not separable in the parameters, so that the inner iteration of glmnet
+   * cannot update one parameter at a time. Instead, glmnetInner updates one block at a time
+   * with getBlockZ: The quadratic approximation of the block is majorized with the largest
+   * eigenvalue of the block of the Hessian (Yang & Zou, 2015), which results in one
+   * proximal operator step for the whole block.
+   *
+   * * Yang, Y., & Zou, H. (2015). A fast unified algorithm for solving group-lasso penalize learning problems.
+   * Statistics and Computing, 25(6), 1129–1141.
+   */
+  class penaltyGroupLassoGlmnet : public penalty<tuningParametersGroupLasso>
+  {
+  public:
+    /**
+     * @brief Get the value of the penalty function
+     *
+     * @param parameterValues current parameter values
+     * @param parameterLabels names of the parameters
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const stringVector &parameterLabels,
+                    const tuningParametersGroupLasso &tuningParameters)
+        override
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (getValue(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the value of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const tuningParametersGroupLasso &tuningParameters)
+    {
+      return (sparseGroupLassoValue(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the subgradients of the penalized fit function (see groupLasso.h)
+     *
+     * @param parameterValues current parameter values
+     * @param gradients gradients of the smooth part of the fit function
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
+                                 const arma::rowvec &gradients,
+                                 const tuningParametersGroupLasso &tuningParameters)
+        override
+    {
+      return (sparseGroupLassoSubgradients(parameterValues, gradients, tuningParameters));
+    }
+
+    /**
+     * @brief computes the change in the step direction for all parameters of a block
+     * in the inner iterations of glmnet
+     *
+     * @param block block which is updated
+     * @param parameters_kMinus1 parameter values at the beginning of the inner iteration
+     * @param gradient gradients of the smooth part at parameters_kMinus1
+     * @param stepDirection current step direction
+     * @param Hessian Hessian (approximation) at parameters_kMinus1
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec change of the step direction of the parameters in the block
+     */
+    arma::rowvec getBlockZ(const unsigned int block,
+                           const arma::rowvec &parameters_kMinus1,
+                           const arma::rowvec &gradient,
+                           const arma::rowvec &stepDirection,
+                           const arma::mat &Hessian,
+                           const tuningParametersGroupLasso &tuningParameters)
+    {
+      const arma::uword first = tuningParameters.blockFirst(block);
+      const arma::uword last = tuningParameters.blockLast(block);
+
+      // gradients of the quadratic approximation for the parameters of the block
+      const arma::rowvec blockGradient = gradient.cols(first, last) +
+                                         stepDirection * Hessian.cols(first, last);
+      // upper bound for the largest eigenvalue of the block (Gershgorin). The floor prevents
+      // a division by zero if the block of the Hessian is zero
+      const double bound = std::max(arma::max(arma::sum(arma::abs(Hessian.submat(first, first, last, last)), 1)),
+                                    1e-10);
+
+      const arma::rowvec current = parameters_kMinus1.cols(first, last) + stepDirection.cols(first, last);
+      const arma::rowvec updated =
+          proximalSparseGroupLasso(current - blockGradient / bound,
+                                   tuningParameters.alpha * tuningParameters.lambda *
+                                       tuningParameters.weights.cols(first, last) / bound,
+                                   (1.0 - tuningParameters.alpha) * tuningParameters.lambda *
+                                       tuningParameters.groupWeights.at(block) / bound);
+      return (updated - current);
+    }
+  };
+
+} // end namespace
+
+#endif
@@ -35,8 +35,20 @@ namespace lessSEM
                         const tuningParametersEnetGlmnet &tuningParameters)
             override
         {
+            static_cast<void>(parameterLabels); // is unused
+            return (getValue(parameterValues, tuningParameters));
+        }
 
-            static_cast<void>(parameterLabels); // is unused, but necessary for the interface to be consistent
+        /**
+         * @brief Get the value of the penalty function. Version without parameter labels (see traits.h)
+         *
+         * @param parameterValues current parameter values
+         * @param tuningParameters values of the tuning parmameters
+         * @return double
+         */
+        double getValue(const arma::rowvec &parameterValues,
+                        const tuningParametersEnetGlmnet &tuningParameters)
+        {
 
             double penaltyValue = 0.0;
             double lambda_i;
@@ -107,69 +119,31 @@ namespace lessSEM
         }
 
         /**
-         * @brief Get the subgradients of the penalty function
+         * @brief Get the subgradients of the penalized fit function (see subgradients.h)
          *
          * @param parameterValues current parameter values
-         * @param parameterLabels names of the parameters
+         * @param gradients gradients of the smooth part of the fit function
          * @param tuningParameters values of the tuning parmameters
          * @return arma::rowvec
          */
         arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
                                      const arma::rowvec &gradients,
                                      const tuningParametersEnetGlmnet &tuningParameters)
+            override
         {
 
             arma::rowvec subgradients = gradients;
-            double lower, upper;
-            int sign;
 
             for (unsigned int p = 0; p < parameterValues.n_elem; p++)
             {
-
                 // if not regularized: nothing to do here
                 if (tuningParameters.weights.at(p) == 0)
                     continue;
 
-                // check if parameter is at non-differentiable place:
-                if (parameterValues.at(p) == 0)
-                {
-                    lower = -tuningParameters.weights.at(p) *
-                            tuningParameters.alpha.at(p) *
-                            tuningParameters.lambda.at(p);
-                    // note: we don't add the ridge part here, because this part is already incorporated
-                    // in the differentiable part in gradients
-                    upper = -lower;
-
-                    if (lower < gradients.at(p))
-                    {
-                        subgradients.at(p) = gradients.at(p) + upper;
-                        continue;
-                    }
-                    else if (gradients.at(p) > upper)
-                    {
-                        subgradients.at(p) = gradients.at(p) + lower;
-                        continue;
-                    }
-                    else
-                    {
-                        error("Error in subgradient computation");
-                    }
-                }
-                else
-                {
-                    // parameter is regularized, but not zeroed
-                    sign = (parameterValues.at(p) > 0);
-                    if (parameterValues.at(p) < 0)
-                        sign = -1;
-
-                    subgradients.at(p) = gradients.at(p) +
-                                         sign *
-                                             tuningParameters.weights.at(p) *
-                                             tuningParameters.alpha.at(p) *
-                                             tuningParameters.lambda.at(p);
-                }
-
-            } // end for parameter
+                subgradients.at(p) = subgradientLasso(parameterValues.at(p),
+                                                      gradients.at(p),
+                                                      tuningParameters.weights.at(p) * tuningParameters.alpha.at(p) * tuningParameters.lambda.at(p));
+            }
 
             return (subgradients);
         }
@@ -32,6 +32,19 @@ namespace lessSEM
   };
 
 
+  /**
+   * @brief returns a vector which uses the memory of x instead of a copy. The
+   * single penalties get the tuning parameters of all parameters in each
+   * coordinate update; copying them would cost O(p) per update.
+   *
+   * @param x tuning parameter vector. Must outlive the returned vector.
+   * @return arma::rowvec
+   */
+  inline arma::rowvec tuningParameterView(const arma::rowvec &x)
+  {
+    return (arma::rowvec(const_cast<double *>(x.memptr()), x.n_elem, false, true));
+  }
+
   /**
   * @brief base class for mixed penalty for glmnet optimizer
   *
@@ -51,7 +64,7 @@ namespace lessSEM
      */
     virtual double getValue(const arma::rowvec &parameterValues,
                             const stringVector &parameterLabels,
-                            const tuningParametersMixedGlmnet &tuningParameters) = 0;
+                            const tuningParametersMixedGlmnet &tuningParameters) const = 0;
     
     /**
      * @brief computes the step direction for a single parameter j in the inner
@@ -71,56 +84,47 @@ namespace lessSEM
         const arma::rowvec &gradient,
         const arma::rowvec &stepDirection,
         const arma::mat &Hessian,
-        const tuningParametersMixedGlmnet &tuningParameters) = 0;
+        const tuningParametersMixedGlmnet &tuningParameters) const = 0;
     
     
     /**
-     * @brief Get the subgradients of the penalty function
+     * @brief Get the subgradient of the penalized fit function for a single parameter j
+     * (see subgradients.h)
      *
+     * @param whichPar index of parameter j
      * @param parameterValues current parameter values
-     * @param parameterLabels names of the parameters
+     * @param gradients gradients of the smooth part of the fit function
      * @param tuningParameters values of the tuning parmameters
-     * @return arma::rowvec
+     * @return double subgradient for parameter j
      */
-    arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
-                                 const arma::rowvec &gradients,
-                                 const tuningParametersMixedGlmnet &tuningParameters)
-    {
-
-      static_cast<void>(parameterValues); // is unused
-      static_cast<void>(gradients); // is unused
-      static_cast<void>(tuningParameters); // is unused
-      error("Subgradients are not yet implemented for mixedPenalty");
-    }
+    virtual double getSubgradient(
+        unsigned int whichPar,
+        const arma::rowvec &parameterValues,
+        const arma::rowvec &gradients,
+        const tuningParametersMixedGlmnet &tuningParameters) const = 0;
     
     /**
      * @brief Check the dimensions of the tuning parameters
      *
      * @return throws error in case of false dimensions
      */
-    void checkDimensions(const tuningParametersMixedGlmnet &tuningParameters){
-      if(!checked){
-        // check the dimensions on the first call
-        if(tuningParameters.alpha.n_elem > 0)
-          error("Incorrect length of tuning parameters");
-        if(tuningParameters.lambda.n_elem > 0)
-          error("Incorrect length of tuning parameters");
-        if(tuningParameters.weights.n_elem > 0)
-          error("Incorrect length of tuning parameters");
-        
-        checked = true;
-      }
+    void checkDimensions(const tuningParametersMixedGlmnet &tuningParameters) const{
+      if(tuningParameters.alpha.n_elem > 0)
+        error("Incorrect length of tuning parameters");
+      if(tuningParameters.lambda.n_elem > 0)
+        error("Incorrect length of tuning parameters");
+      if(tuningParameters.weights.n_elem > 0)
+        error("Incorrect length of tuning parameters");
     }
-    
-    bool checked = false;
   };
   
-  // implementations
+  // implementations. The classes below hold no state: the tuning parameters of the single
+  // penalties are set up in each call, so that one penalty can be shared between threads.
   class penaltyMixedGlmnetNone: public penaltyMixedGlmnetBase{
     
     double getValue(const arma::rowvec &parameterValues,
                     const stringVector &parameterLabels,
-                    const tuningParametersMixedGlmnet &tuningParameters) override {
+                    const tuningParametersMixedGlmnet &tuningParameters) const override {
                       static_cast<void>(parameterValues); // is unused
                       static_cast<void>(parameterLabels); // is unused
                       static_cast<void>(tuningParameters); // is unused
@@ -133,7 +137,7 @@ namespace lessSEM
         const arma::rowvec &gradient,
         const arma::rowvec &stepDirection,
         const arma::mat &Hessian,
-        const tuningParametersMixedGlmnet &tuningParameters) override{
+        const tuningParametersMixedGlmnet &tuningParameters) const override{
 
           static_cast<void>(parameters_kMinus1); // is unused, but necessary for the interface to be consistent
           static_cast<void>(tuningParameters); // is unused, but necessary for the interface to be consistent
@@ -146,16 +150,25 @@ namespace lessSEM
           return (-(g_j + hessianXdirection_j) / H_jj);
           
         }
+    
+    double getSubgradient(
+        unsigned int whichPar,
+        const arma::rowvec &parameterValues,
+        const arma::rowvec &gradients,
+        const tuningParametersMixedGlmnet &tuningParameters) const override{
+          static_cast<void>(parameterValues); // is unused
+          static_cast<void>(tuningParameters); // is unused
+          return(gradients.at(whichPar));
+        }
   };
   
-  
   class penaltyMixedGlmnetCappedL1: public penaltyMixedGlmnetBase{
-    penaltyCappedL1Glmnet pen;
-    tuningParametersCappedL1Glmnet tp;
     
     double getValue(const arma::rowvec &parameterValues,
                     const stringVector &parameterLabels,
-                    const tuningParametersMixedGlmnet &tuningParameters) override {
+                    const tuningParametersMixedGlmnet &tuningParameters) const override {
+                      penaltyCappedL1Glmnet pen;
+                      tuningParametersCappedL1Glmnet tp;
                       tp.lambda = tuningParameters.lambda(0);
                       tp.theta = tuningParameters.theta(0);
                       tp.weights = tuningParameters.weights(0);
@@ -168,11 +181,13 @@ namespace lessSEM
         const arma::rowvec &gradient,
         const arma::rowvec &stepDirection,
         const arma::mat &Hessian,
-        const tuningParametersMixedGlmnet &tuningParameters) override{
+        const tuningParametersMixedGlmnet &tuningParameters) const override{
           
-          tp.lambda = tuningParameters.lambda(whichPar);
-          tp.theta = tuningParameters.theta(whichPar);
-          tp.weights = tuningParameters.weights;
+          penaltyCappedL1Glmnet pen;
+          // the weights are only referenced, not copied (see tuningParameterView)
+          tuningParametersCappedL1Glmnet tp{tuningParameterView(tuningParameters.weights),
+                                            tuningParameters.lambda(whichPar),
+                                            tuningParameters.theta(whichPar)};
           
           return(pen.getZ(whichPar,
                           parameters_kMinus1,
@@ -181,15 +196,26 @@ namespace lessSEM
                           Hessian,
                           tp));
         }
+    
+    double getSubgradient(
+        unsigned int whichPar,
+        const arma::rowvec &parameterValues,
+        const arma::rowvec &gradients,
+        const tuningParametersMixedGlmnet &tuningParameters) const override{
+          return(subgradientCappedL1(parameterValues.at(whichPar),
+                                     gradients.at(whichPar),
+                                     tuningParameters.lambda.at(whichPar) * tuningParameters.weights.at(whichPar),
+                                     tuningParameters.theta.at(whichPar)));
+        }
   };
   
   class penaltyMixedGlmnetLasso: public penaltyMixedGlmnetBase{
-    penaltyLASSOGlmnet pen;
-    tuningParametersEnetGlmnet tp;
     
     double getValue(const arma::rowvec &parameterValues,
                     const stringVector &parameterLabels,
-                    const tuningParametersMixedGlmnet &tuningParameters) override {
+                    const tuningParametersMixedGlmnet &tuningParameters) const override {
+                      penaltyLASSOGlmnet pen;
+                      tuningParametersEnetGlmnet tp;
                       tp.alpha = tuningParameters.alpha(0);
                       tp.lambda = tuningParameters.lambda(0);
                       tp.weights = tuningParameters.weights(0);
@@ -202,11 +228,13 @@ namespace lessSEM
         const arma::rowvec &gradient,
         const arma::rowvec &stepDirection,
         const arma::mat &Hessian,
-        const tuningParametersMixedGlmnet &tuningParameters) override{
+        const tuningParametersMixedGlmnet &tuningParameters) const override{
           
-          tp.alpha = tuningParameters.alpha;
-          tp.lambda = tuningParameters.lambda;
-          tp.weights = tuningParameters.weights;
+          penaltyLASSOGlmnet pen;
+          // the tuning parameters are only referenced, not copied (see tuningParameterView)
+          tuningParametersEnetGlmnet tp{tuningParameterView(tuningParameters.lambda),
+                                        tuningParameterView(tuningParameters.alpha),
+                                        tuningParameterView(tuningParameters.weights)};
           
           return(pen.getZ(whichPar,
                           parameters_kMinus1,
@@ -215,15 +243,25 @@ namespace lessSEM
                           Hessian,
                           tp));
         }
+    
+    double getSubgradient(
+        unsigned int whichPar,
+        const arma::rowvec &parameterValues,
+        const arma::rowvec &gradients,
+        const tuningParametersMixedGlmnet &tuningParameters) const override{
+          return(subgradientLasso(parameterValues.at(whichPar),
+                                  gradients.at(whichPar),
+                                  tuningParameters.alpha.at(whichPar) * tuningParameters.lambda.at(whichPar) * tuningParameters.weights.at(whichPar)));
+        }
   };
   
   class penaltyMixedGlmnetLsp: public penaltyMixedGlmnetBase{
-    penaltyLSPGlmnet pen;
-    tuningParametersLspGlmnet tp;
     
     double getValue(const arma::rowvec &parameterValues,
                     const stringVector &parameterLabels,
-                    const tuningParametersMixedGlmnet &tuningParameters) override {
+                    const tuningParametersMixedGlmnet &tuningParameters) const override {
+                      penaltyLSPGlmnet pen;
+                      tuningParametersLspGlmnet tp;
                       tp.lambda = tuningParameters.lambda(0);
                       tp.theta = tuningParameters.theta(0);
                       tp.weights = tuningParameters.weights(0);
@@ -236,11 +274,13 @@ namespace lessSEM
         const arma::rowvec &gradient,
         const arma::rowvec &stepDirection,
         const arma::mat &Hessian,
-        const tuningParametersMixedGlmnet &tuningParameters) override{
+        const tuningParametersMixedGlmnet &tuningParameters) const override{
           
-          tp.lambda = tuningParameters.lambda(whichPar);
-          tp.theta = tuningParameters.theta(whichPar);
-          tp.weights = tuningParameters.weights;
+          penaltyLSPGlmnet pen;
+          // the weights are only referenced, not copied (see tuningParameterView)
+          tuningParametersLspGlmnet tp{tuningParameterView(tuningParameters.weights),
+                                       tuningParameters.lambda(whichPar),
+                                       tuningParameters.theta(whichPar)};
           
           return(pen.getZ(whichPar,
                           parameters_kMinus1,
@@ -249,15 +289,26 @@ namespace lessSEM
                           Hessian,
                           tp));
         }
+    
+    double getSubgradient(
+        unsigned int whichPar,
+        const arma::rowvec &parameterValues,
+        const arma::rowvec &gradients,
+        const tuningParametersMixedGlmnet &tuningParameters) const override{
+          return(subgradientLsp(parameterValues.at(whichPar),
+                                gradients.at(whichPar),
+                                tuningParameters.lambda.at(whichPar) * tuningParameters.weights.at(whichPar),
+                                tuningParameters.theta.at(whichPar)));
+        }
   };
   
   class penaltyMixedGlmnetMcp: public penaltyMixedGlmnetBase{
-    penaltyMcpGlmnet pen;
-    tuningParametersMcpGlmnet tp;
     
     double getValue(const arma::rowvec &parameterValues,
                     const stringVector &parameterLabels,
-                    const tuningParametersMixedGlmnet &tuningParameters) override {
+                    const tuningParametersMixedGlmnet &tuningParameters) const override {
+                      penaltyMcpGlmnet pen;
+                      tuningParametersMcpGlmnet tp;
                       tp.lambda = tuningParameters.lambda(0);
                       tp.theta = tuningParameters.theta(0);
                       tp.weights = tuningParameters.weights(0);
@@ -270,11 +321,13 @@ namespace lessSEM
         const arma::rowvec &gradient,
         const arma::rowvec &stepDirection,
         const arma::mat &Hessian,
-        const tuningParametersMixedGlmnet &tuningParameters) override{
+        const tuningParametersMixedGlmnet &tuningParameters) const override{
           
-          tp.lambda = tuningParameters.lambda(whichPar);
-          tp.theta = tuningParameters.theta(whichPar);
-          tp.weights = tuningParameters.weights;
+          penaltyMcpGlmnet pen;
+          // the weights are only referenced, not copied (see tuningParameterView)
+          tuningParametersMcpGlmnet tp{tuningParameterView(tuningParameters.weights),
+                                       tuningParameters.lambda(whichPar),
+                                       tuningParameters.theta(whichPar)};
           
           return(pen.getZ(whichPar,
                           parameters_kMinus1,
@@ -283,15 +336,26 @@ namespace lessSEM
                           Hessian,
                           tp));
         }
+    
+    double getSubgradient(
+        unsigned int whichPar,
+        const arma::rowvec &parameterValues,
+        const arma::rowvec &gradients,
+        const tuningParametersMixedGlmnet &tuningParameters) const override{
+          return(subgradientMcp(parameterValues.at(whichPar),
+                                gradients.at(whichPar),
+                                tuningParameters.lambda.at(whichPar) * tuningParameters.weights.at(whichPar),
+                                tuningParameters.theta.at(whichPar)));
+        }
   };
   
   class penaltyMixedGlmnetScad: public penaltyMixedGlmnetBase{
-    penaltySCADGlmnet pen;
-    tuningParametersScadGlmnet tp;
     
     double getValue(const arma::rowvec &parameterValues,
                     const stringVector &parameterLabels,
-                    const tuningParametersMixedGlmnet &tuningParameters) override {
+                    const tuningParametersMixedGlmnet &tuningParameters) const override {
+                      penaltySCADGlmnet pen;
+                      tuningParametersScadGlmnet tp;
                       tp.lambda = tuningParameters.lambda(0);
                       tp.theta = tuningParameters.theta(0);
                       tp.weights = tuningParameters.weights(0);
@@ -304,11 +368,13 @@ namespace lessSEM
         const arma::rowvec &gradient,
         const arma::rowvec &stepDirection,
         const arma::mat &Hessian,
-        const tuningParametersMixedGlmnet &tuningParameters) override{
+        const tuningParametersMixedGlmnet &tuningParameters) const override{
           
-          tp.lambda = tuningParameters.lambda(whichPar);
-          tp.theta = tuningParameters.theta(whichPar);
-          tp.weights = tuningParameters.weights;
+          penaltySCADGlmnet pen;
+          // the weights are only referenced, not copied (see tuningParameterView)
+          tuningParametersScadGlmnet tp{tuningParameterView(tuningParameters.weights),
+                                        tuningParameters.lambda(whichPar),
+                                        tuningParameters.theta(whichPar)};
           
           return(pen.getZ(whichPar,
                           parameters_kMinus1,
@@ -317,6 +383,17 @@ namespace lessSEM
                           Hessian,
                           tp));
         }
+    
+    double getSubgradient(
+        unsigned int whichPar,
+        const arma::rowvec &parameterValues,
+        const arma::rowvec &gradients,
+        const tuningParametersMixedGlmnet &tuningParameters) const override{
+          return(subgradientScad(parameterValues.at(whichPar),
+                                 gradients.at(whichPar),
+                                 tuningParameters.lambda.at(whichPar) * tuningParameters.weights.at(whichPar),
+                                 tuningParameters.theta.at(whichPar)));
+        }
   };
   
   class penaltyMixedGlmnet: public penalty<tuningParametersMixedGlmnet>{
@@ -338,6 +415,9 @@ namespace lessSEM
     override
     {
       double penVal{0.0};
+      // per-call workspace; the penalty itself holds no state and can be
+      // shared between threads
+      tuningParametersMixedGlmnet tpSinglePenalty;
       int it = 0;
       for(auto& pen: penalties){
         tpSinglePenalty.alpha = tuningParameters.alpha(it);
@@ -380,45 +460,41 @@ namespace lessSEM
         const tuningParametersMixedGlmnet &tuningParameters)
     {
       
-      tpSinglePenalty.alpha = tuningParameters.alpha;
-      tpSinglePenalty.lambda = tuningParameters.lambda;
-      tpSinglePenalty.theta = tuningParameters.theta;
-      tpSinglePenalty.weights = tuningParameters.weights;
-      
       double z = penalties.at(whichPar)->getZ(whichPar,
                                       parameters_kMinus1,
                                       gradient,
                                       stepDirection,
                                       Hessian,
-                                      tpSinglePenalty);
+                                      tuningParameters);
         
       return(z);
       
     }
     
     /**
-     * @brief Get the subgradients of the penalty function
+     * @brief Get the subgradients of the penalized fit function. Each parameter
+     * uses the subgradient of its own penalty.
      *
      * @param parameterValues current parameter values
-     * @param parameterLabels names of the parameters
+     * @param gradients gradients of the smooth part of the fit function
      * @param tuningParameters values of the tuning parmameters
      * @return arma::rowvec
      */
     arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
                                  const arma::rowvec &gradients,
                                  const tuningParametersMixedGlmnet &tuningParameters)
+    override
     {
-      static_cast<void>(parameterValues); // is unused
-      static_cast<void>(gradients); // is unused
-      static_cast<void>(tuningParameters); // is unused
-      error("Subgradients are not yet implemented for mixedPenalty");
+      arma::rowvec subgradients(parameterValues.n_elem);
+      for(unsigned int p = 0; p < parameterValues.n_elem; p++){
+        subgradients.at(p) = penalties.at(p)->getSubgradient(p,
+                                                             parameterValues,
+                                                             gradients,
+                                                             tuningParameters);
+      }
+      return(subgradients);
     }
     
-  private:
-    // we often need the tuning parameters for a single parameter. These are
-    // stored here:
-    tuningParametersMixedGlmnet tpSinglePenalty;
-    
   };
   
   void inline initializeMixedPenaltiesGlmnet(penaltyMixedGlmnet& pen, 
@@ -9,5 +9,6 @@
 #include "glmnet_mcp.h"
 #include "glmnet_lsp.h"
 #include "glmnet_mixedPenalty.h"
+#include "glmnet_groupLasso.h"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,192 @@
+#ifndef GROUPLASSO_H
+#define GROUPLASSO_H
+#include <cmath>
+#include "common_headers.h"
+
+// The (sparse) group lasso penalizes blocks of parameters jointly:
+//    p(x) = lambda * sum_g [ (1 - alpha) * w_g * ||x_g||_2 + alpha * sum_{j in g} w_j |x_j| ].
+// With alpha = 0, all parameters of a block are either zero or non-zero (group lasso); with
+// 0 < alpha < 1, single parameters within non-zero blocks can be zero as well (sparse-group lasso).
+// The blocks must be contiguous in the parameter vector (e.g., all loadings of an item across groups).
+// They are defined once in the tuning parameters and the optimizers update all parameters of
+// a block at once (see ista_groupLasso.h and glmnet_groupLasso.h).
+//
+// Yuan, M., & Lin, Y. (2006). Model selection and estimation in regression with grouped variables.
+// Journal of the Royal Statistical Society Series B, 68(1), 49–67.
+// Simon, N., Friedman, J., Hastie, T., & Tibshirani, R. (2013). A sparse-group lasso. Journal of
+// Computational and Graphical Statistics, 22(2), 231–245.
+
+namespace lessSEM
+{
+  /**
+   * @brief tuning parameters of the (sparse) group lasso penalty
+   *
+   */
+  class tuningParametersGroupLasso
+  {
+  public:
+    double lambda;             ///> lambda value >= 0
+    double alpha;              ///> relative importance of the lasso (1) and the group lasso (0)
+    arma::rowvec weights;      ///> parameter-specific weights of the lasso part
+    arma::rowvec groupWeights; ///> block-specific weights of the group lasso part (e.g., sqrt of the block size). 0 = not penalized
+    arma::uvec blockStarts;    ///> position of the first parameter of each block (increasing, starting with 0); block b ends before blockStarts(b+1)
+
+    /**
+     * @brief number of blocks
+     *
+     * @return unsigned int
+     */
+    unsigned int numberBlocks() const
+    {
+      return (blockStarts.n_elem);
+    }
+
+    /**
+     * @brief position of the first parameter of block
+     *
+     * @param block block
+     * @return unsigned int
+     */
+    unsigned int blockFirst(const unsigned int block) const
+    {
+      return (blockStarts.at(block));
+    }
+
+    /**
+     * @brief position of the last parameter of block
+     *
+     * @param block block
+     * @return unsigned int
+     */
+    unsigned int blockLast(const unsigned int block) const
+    {
+      if (block + 1 < blockStarts.n_elem)
+        return (blockStarts.at(block + 1) - 1);
+      return (weights.n_elem - 1);
+    }
+
+    /**
+     * @brief checks that the blocks cover all numberParameters parameters
+     *
+     * @param numberParameters number of parameters
+     */
+    void checkBlocks(const unsigned int numberParameters) const
+    {
+      if (weights.n_elem != numberParameters)
+        error("weights must have one element for each parameter.");
+      if (blockStarts.n_elem == 0 || blockStarts.at(0) != 0)
+        error("The first block must start with the first parameter.");
+      if (groupWeights.n_elem != blockStarts.n_elem)
+        error("groupWeights must have one element for each block.");
+      for (unsigned int b = 1; b < blockStarts.n_elem; b++)
+      {
+        if (blockStarts.at(b) <= blockStarts.at(b - 1) || blockStarts.at(b) >= numberParameters)
+          error("blockStarts must be increasing and smaller than the number of parameters.");
+      }
+    }
+  };
+
+  /**
+   * @brief proximal operator of the sparse-group lasso for a single block: soft thresholding
+   * of each parameter followed by the shrinkage of the whole block.
+   *
+   * @param u parameter values of the block after the gradient step
+   * @param lassoThresholds parameter-specific thresholds of the lasso part (alpha * lambda * w_j / L)
+   * @param groupThreshold threshold of the group lasso part ((1 - alpha) * lambda * w_g / L)
+   * @return arma::rowvec
+   */
+  inline arma::rowvec proximalSparseGroupLasso(const arma::rowvec &u,
+                                               const arma::rowvec &lassoThresholds,
+                                               const double groupThreshold)
+  {
+    arma::rowvec shrunken = arma::sign(u) % arma::clamp(arma::abs(u) - lassoThresholds, 0.0, arma::datum::inf);
+    if (groupThreshold == 0.0)
+      return (shrunken);
+    const double norm = arma::norm(shrunken, 2);
+    if (norm <= groupThreshold)
+    {
+      shrunken.zeros();
+      return (shrunken);
+    }
+    return ((1.0 - groupThreshold / norm) * shrunken);
+  }
+
+  /**
+   * @brief value of the sparse-group lasso penalty
+   *
+   * @param parameterValues parameter values
+   * @param tuningParameters tuning parameters
+   * @return double
+   */
+  inline double sparseGroupLassoValue(const arma::rowvec &parameterValues,
+                                      const tuningParametersGroupLasso &tuningParameters)
+  {
+    double penaltyValue = 0.0;
+    for (unsigned int b = 0; b < tuningParameters.numberBlocks(); b++)
+    {
+      const arma::uword first = tuningParameters.blockFirst(b);
+      const arma::uword last = tuningParameters.blockLast(b);
+      penaltyValue += (1.0 - tuningParameters.alpha) * tuningParameters.groupWeights.at(b) *
+                          arma::norm(parameterValues.cols(first, last), 2) +
+                      tuningParameters.alpha *
+                          arma::accu(tuningParameters.weights.cols(first, last) % arma::abs(parameterValues.cols(first, last)));
+    }
+    return (tuningParameters.lambda * penaltyValue);
+  }
+
+  /**
+   * @brief subgradients of the penalized fit function with the sparse-group lasso (see subgradients.h).
+   * For each block, the element of the subdifferential which is closest to zero is returned. If the
+   * block is zero, the lasso part is removed by soft thresholding and the remaining vector is shrunken
+   * by the group lasso part.
+   *
+   * @param parameterValues parameter values
+   * @param gradients gradients of the smooth part of the fit function
+   * @param tuningParameters tuning parameters
+   * @return arma::rowvec
+   */
+  inline arma::rowvec sparseGroupLassoSubgradients(const arma::rowvec &parameterValues,
+                                                   const arma::rowvec &gradients,
+                                                   const tuningParametersGroupLasso &tuningParameters)
+  {
+    tuningParameters.checkBlocks(parameterValues.n_elem);
+
+    arma::rowvec subgradients = gradients;
+    for (unsigned int b = 0; b < tuningParameters.numberBlocks(); b++)
+    {
+      const arma::uword first = tuningParameters.blockFirst(b);
+      const arma::uword last = tuningParameters.blockLast(b);
+      const double groupLambda = (1.0 - tuningParameters.alpha) * tuningParameters.lambda *
+                                 tuningParameters.groupWeights.at(b);
+      const double norm = arma::norm(parameterValues.cols(first, last), 2);
+
+      for (arma::uword j = first; j <= last; j++)
+      {
+        const double lassoLambda = tuningParameters.alpha * tuningParameters.lambda *
+                                   tuningParameters.weights.at(j);
+        const double x = parameterValues.at(j);
+        if (x > 0.0)
+          subgradients.at(j) = gradients.at(j) + lassoLambda + groupLambda * x / norm;
+        else if (x < 0.0)
+          subgradients.at(j) = gradients.at(j) - lassoLambda + groupLambda * x / norm;
+        else // soft thresholding; the group part is zero for x = 0 if the block is non-zero
+          subgradients.at(j) = std::copysign(std::max(std::abs(gradients.at(j)) - lassoLambda, 0.0),
+                                             gradients.at(j));
+      }
+
+      if (norm == 0.0)
+      {
+        // the group part is any vector with norm <= groupLambda
+        const double remaining = arma::norm(subgradients.cols(first, last), 2);
+        if (remaining <= groupLambda)
+          subgradients.cols(first, last).zeros();
+        else
+          subgradients.cols(first, last) *= 1.0 - groupLambda / remaining;
+      }
+    }
+    return (subgradients);
+  }
+
+} // end namespace
+
+#endif
@@ -0,0 +1,429 @@
+#ifndef HOMOTOPY_H
+#define HOMOTOPY_H
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "common_headers.h"
+
+// Exact lasso path for quadratic objectives.
+//
+// For the objective
+//    .5 x'Hx - b'x + lambda * sum_j w_j |x_j|
+// with positive semi-definite H (e.g., H = X'X and b = X'y for least squares, or the
+// quadratic approximation minimized by glmnetInner, see lassoHomotopyQuadraticApproximation),
+// the solution is piecewise linear in lambda. Between two breakpoints, the non-zero parameters
+// (the active set A) and their signs s_A do not change and
+//    x_A(lambda) = H_AA^(-1) (b_A - lambda * w_A * s_A).
+// The homotopy method follows this line from the largest lambda for which all penalized parameters
+// are zero and stops whenever a parameter joins the active set (its gradient reaches the bound
+// lambda * w_j) or leaves it (it crosses zero). Each breakpoint only requires a solve with the
+// Cholesky factor of H_AA, which is updated when A changes instead of being recomputed.
+//
+// Efron, B., Hastie, T., Johnstone, I., & Tibshirani, R. (2004). Least angle regression.
+// The Annals of Statistics, 32(2), 407–499.
+// Osborne, M. R., Presnell, B., & Turlach, B. A. (2000). A new approach to variable selection in least
+// squares problems. IMA Journal of Numerical Analysis, 20(3), 389–403.
+
+namespace lessSEM
+{
+
+  /**
+   * @brief Cholesky factor H = R'R of a symmetric positive definite matrix which can be updated
+   * when a row and column is added to or removed from H.
+   *
+   */
+  class updatableCholesky
+  {
+  public:
+    /**
+     * @brief number of rows and columns of H
+     *
+     * @return unsigned int
+     */
+    unsigned int size() const
+    {
+      return (R.n_rows);
+    }
+
+    /**
+     * @brief adds a row and column to H (at the end)
+     *
+     * @param crossProducts elements of the new column in the current rows of H
+     * @param diagonal new diagonal element
+     * @return bool false if H would no longer be positive definite; H is not changed in this case
+     */
+    bool add(const arma::colvec &crossProducts,
+             const double diagonal)
+    {
+      const unsigned int n = size();
+      // R' y = crossProducts
+      arma::colvec y(n);
+      for (unsigned int i = 0; i < n; i++)
+      {
+        double sum = crossProducts.at(i);
+        for (unsigned int k = 0; k < i; k++)
+          sum -= R.at(k, i) * y.at(k);
+        y.at(i) = sum / R.at(i, i);
+      }
+      const double remainder = diagonal - arma::dot(y, y);
+      if (!(remainder > 1e-12 * std::max(1.0, std::abs(diagonal))))
+        return (false);
+
+      R.resize(n + 1, n + 1);
+      for (unsigned int i = 0; i < n; i++)
+      {
+        R.at(i, n) = y.at(i);
+        R.at(n, i) = 0.0;
+      }
+      R.at(n, n) = std::sqrt(remainder);
+      return (true);
+    }
+
+    /**
+     * @brief removes row and column position from H
+     *
+     * @param position position of the row and column
+     */
+    void remove(const unsigned int position)
+    {
+      const unsigned int n = size();
+      R.shed_col(position);
+      // R is now upper Hessenberg from column position on; Givens rotations
+      // restore the triangular form
+      for (unsigned int j = position; j + 1 < n; j++)
+      {
+        const double a = R.at(j, j);
+        const double b = R.at(j + 1, j);
+        const double r = std::hypot(a, b);
+        const double c = a / r;
+        const double s = b / r;
+        for (unsigned int l = j; l + 1 < n; l++)
+        {
+          const double upper = R.at(j, l);
+          const double lower = R.at(j + 1, l);
+          R.at(j, l) = c * upper + s * lower;
+          R.at(j + 1, l) = -s * upper + c * lower;
+        }
+      }
+      R.shed_row(n - 1);
+    }
+
+    /**
+     * @brief solves H x = b
+     *
+     * @param b right hand side
+     * @return arma::colvec
+     */
+    arma::colvec solve(const arma::colvec &b) const
+    {
+      const unsigned int n = size();
+      // R' y = b
+      arma::colvec y(n);
+      for (unsigned int i = 0; i < n; i++)
+      {
+        double sum = b.at(i);
+        for (unsigned int k = 0; k < i; k++)
+          sum -= R.at(k, i) * y.at(k);
+        y.at(i) = sum / R.at(i, i);
+      }
+      // R x = y
+      arma::colvec x(n);
+      for (unsigned int i = n; i-- > 0;)
+      {
+        double sum = y.at(i);
+        for (unsigned int k = i + 1; k < n; k++)
+          sum -= R.at(i, k) * x.at(k);
+        x.at(i) = sum / R.at(i, i);
+      }
+      return (x);
+    }
+
+  private:
+    arma::mat R;
+  };
+
+  /**
+   * @struct controlHomotopy
+   * @brief settings for the homotopy
+   *
+   * @var lambdaMin the path stops at this value of lambda
+   * @var maxSteps maximal number of breakpoints
+   */
+  struct controlHomotopy
+  {
+    double lambdaMin;
+    int maxSteps;
+  };
+
+  /**
+   * @brief Returns the default settings for the homotopy
+   *
+   * @return controlHomotopy
+   */
+  inline controlHomotopy controlHomotopyDefault()
+  {
+    controlHomotopy defaultIs = {
+        0.0, // lambdaMin
+        1000 // maxSteps
+    };
+    return (defaultIs);
+  }
+
+  /**
+   * @struct homotopyPath
+   * @brief breakpoints of the lasso path. Between two breakpoints, the parameters are linear in lambda
+   * (see homotopyParameters).
+   *
+   * @var lambda values of lambda at the breakpoints (decreasing)
+   * @var parameterValues parameters at the breakpoints (one row per breakpoint)
+   * @var complete did the path reach lambdaMin? The path stops early if maxSteps is reached or if
+   * H_AA becomes singular (e.g., more active parameters than observations).
+   */
+  struct homotopyPath
+  {
+    arma::rowvec lambda;
+    arma::mat parameterValues;
+    bool complete;
+  };
+
+  /**
+   * @brief computes the exact lasso path of .5 x'Hx - b'x + lambda * sum_j w_j |x_j|
+   *
+   * @param Hessian symmetric positive semi-definite matrix H
+   * @param linear vector b
+   * @param weights weights w_j of the parameters. Parameters with weight 0 are not penalized.
+   * @param control_ settings for the homotopy
+   * @return homotopyPath
+   */
+  inline homotopyPath lassoHomotopy(const arma::mat &Hessian,
+                                    const arma::colvec &linear,
+                                    const arma::rowvec &weights,
+                                    const controlHomotopy &control_ = controlHomotopyDefault())
+  {
+    const unsigned int numberParameters = linear.n_elem;
+    if (Hessian.n_rows != numberParameters || Hessian.n_cols != numberParameters || weights.n_elem != numberParameters)
+      error("Hessian, linear, and weights must have the same number of parameters.");
+    if (arma::any(weights < 0.0))
+      error("The weights must be non-negative.");
+    if (control_.lambdaMin < 0.0)
+      error("lambdaMin must be non-negative.");
+
+    std::vector<arma::rowvec> breakpoints;
+    std::vector<double> lambdas;
+
+    std::vector<unsigned int> activeSet;
+    std::vector<double> signs; // sign of the active parameters; 0 for unpenalized parameters
+    std::vector<bool> isActive(numberParameters, false);
+    updatableCholesky cholesky;
+
+    // adds parameter j to the active set; returns false if H_AA becomes singular
+    auto activate = [&](const unsigned int j, const double sign)
+    {
+      arma::colvec crossProducts(activeSet.size());
+      for (unsigned int a = 0; a < activeSet.size(); a++)
+        crossProducts.at(a) = Hessian.at(activeSet.at(a), j);
+      if (!cholesky.add(crossProducts, Hessian.at(j, j)))
+        return (false);
+      activeSet.push_back(j);
+      signs.push_back(sign);
+      isActive.at(j) = true;
+      return (true);
+    };
+
+    // the unpenalized parameters are always active
+    for (unsigned int j = 0; j < numberParameters; j++)
+    {
+      if (weights.at(j) == 0.0 && !activate(j, 0.0))
+        error("The Hessian of the unpenalized parameters is singular.");
+    }
+
+    arma::colvec x(numberParameters, arma::fill::zeros);
+    if (!activeSet.empty())
+    {
+      arma::colvec linearActive(activeSet.size());
+      for (unsigned int a = 0; a < activeSet.size(); a++)
+        linearActive.at(a) = linear.at(activeSet.at(a));
+      const arma::colvec xActive = cholesky.solve(linearActive);
+      for (unsigned int a = 0; a < activeSet.size(); a++)
+        x.at(activeSet.at(a)) = xActive.at(a);
+    }
+    // negative gradients of the quadratic part
+    arma::colvec residual = linear - Hessian * x;
+
+    // lambda_max: the first penalized parameter joins
+    double lambda = 0.0;
+    int joining = -1;
+    for (unsigned int j = 0; j < numberParameters; j++)
+    {
+      if (isActive.at(j))
+        continue;
+      if (std::abs(residual.at(j)) / weights.at(j) > lambda)
+      {
+        lambda = std::abs(residual.at(j)) / weights.at(j);
+        joining = j;
+      }
+    }
+
+    lambdas.push_back(std::max(lambda, control_.lambdaMin));
+    breakpoints.push_back(arma::trans(x));
+
+    homotopyPath path;
+    path.complete = true;
+
+    int step = 0;
+    // without penalized parameters, lambda is 0 and the loop is skipped
+    while (lambda > control_.lambdaMin)
+    {
+      if (step++ == control_.maxSteps)
+      {
+        path.complete = false;
+        break;
+      }
+      // joining is -1 if the last event was a parameter leaving the active set
+      if (joining >= 0 && !activate(joining, residual.at(joining) >= 0.0 ? 1.0 : -1.0))
+      {
+        path.complete = false;
+        break;
+      }
+
+      // direction of the active parameters when lambda decreases by 1
+      arma::colvec weightedSigns(activeSet.size());
+      for (unsigned int a = 0; a < activeSet.size(); a++)
+        weightedSigns.at(a) = weights.at(activeSet.at(a)) * signs.at(a);
+      const arma::colvec direction = cholesky.solve(weightedSigns);
+
+      // change of the residuals of all parameters
+      arma::colvec residualChange(numberParameters, arma::fill::zeros);
+      for (unsigned int a = 0; a < activeSet.size(); a++)
+        residualChange += Hessian.col(activeSet.at(a)) * direction.at(a);
+
+      // find the next event
+      const double tolerance = 1e-12 * std::max(1.0, lambda);
+      double change = lambda - control_.lambdaMin;
+      joining = -1;
+      int leaving = -1;
+      for (unsigned int j = 0; j < numberParameters; j++)
+      {
+        if (isActive.at(j))
+          continue;
+        // |residual_j - t * residualChange_j| = (lambda - t) * w_j
+        const double candidates[2] = {(residual.at(j) - lambda * weights.at(j)) / (residualChange.at(j) - weights.at(j)),
+                                      (residual.at(j) + lambda * weights.at(j)) / (residualChange.at(j) + weights.at(j))};
+        for (const double candidate : candidates)
+        {
+          if (std::isfinite(candidate) && candidate > tolerance && candidate < change)
+          {
+            change = candidate;
+            joining = j;
+          }
+        }
+      }
+      for (unsigned int a = 0; a < activeSet.size(); a++)
+      {
+        if (signs.at(a) == 0.0 || direction.at(a) == 0.0)
+          continue;
+        // x_j + t * direction_j = 0
+        const double candidate = -x.at(activeSet.at(a)) / direction.at(a);
+        if (candidate > tolerance && candidate < change)
+        {
+          change = candidate;
+          joining = -1;
+          leaving = a;
+        }
+      }
+
+      // move to the event
+      for (unsigned int a = 0; a < activeSet.size(); a++)
+        x.at(activeSet.at(a)) += change * direction.at(a);
+      residual -= change * residualChange;
+      lambda -= change;
+
+      if (leaving >= 0)
+      {
+        x.at(activeSet.at(leaving)) = 0.0;
+        isActive.at(activeSet.at(leaving)) = false;
+        cholesky.remove(leaving);
+        activeSet.erase(activeSet.begin() + leaving);
+        signs.erase(signs.begin() + leaving);
+      }
+
+      lambdas.push_back(lambda);
+      breakpoints.push_back(arma::trans(x));
+
+      if (joining < 0 && leaving < 0)
+        break; // reached lambdaMin
+    }
+
+    path.lambda.set_size(lambdas.size());
+    path.parameterValues.set_size(lambdas.size(), numberParameters);
+    for (unsigned int b = 0; b < lambdas.size(); b++)
+    {
+      path.lambda.at(b) = lambdas.at(b);
+      path.parameterValues.row(b) = breakpoints.at(b);
+    }
+    return (path);
+  }
+
+  /**
+   * @brief computes the exact lasso path of the quadratic approximation minimized in each outer
+   * iteration of glmnet (see glmnetInner):
+   * g'(x - x_0) + .5 (x - x_0)'H(x - x_0) + lambda * sum_j w_j |x_j|.
+   * For the elastic net of glmnet, the weights are alpha * weights.
+   *
+   * @param parameterValues parameters x_0 at which the approximation is computed
+   * @param gradients gradients g at x_0
+   * @param Hessian Hessian (approximation) H at x_0 (e.g., the final Hessian in the fitResults of glmnet)
+   * @param weights weights w_j of the parameters. Parameters with weight 0 are not penalized.
+   * @param control_ settings for the homotopy
+   * @return homotopyPath
+   */
+  inline homotopyPath lassoHomotopyQuadraticApproximation(const arma::rowvec &parameterValues,
+                                                          const arma::rowvec &gradients,
+                                                          const arma::mat &Hessian,
+                                                          const arma::rowvec &weights,
+                                                          const controlHomotopy &control_ = controlHomotopyDefault())
+  {
+    // .5 x'Hx - (H x_0 - g)'x + const.
+    const arma::colvec linear = Hessian * arma::trans(parameterValues) - arma::trans(gradients);
+    return (lassoHomotopy(Hessian, linear, weights, control_));
+  }
+
+  /**
+   * @brief returns the parameters of the lasso path for any lambda by linear interpolation between
+   * the breakpoints
+   *
+   * @param path lasso path returned by lassoHomotopy
+   * @param lambda values of lambda. Must be >= the last lambda of the path.
+   * @return arma::mat with one row for each lambda
+   */
+  inline arma::mat homotopyParameters(const homotopyPath &path,
+                                      const arma::rowvec &lambda)
+  {
+    const unsigned int numberBreakpoints = path.lambda.n_elem;
+    arma::mat parameterValues(lambda.n_elem, path.parameterValues.n_cols);
+    for (unsigned int l = 0; l < lambda.n_elem; l++)
+    {
+      const double currentLambda = lambda.at(l);
+      if (currentLambda >= path.lambda.at(0))
+      {
+        // above lambda_max, only the unpenalized parameters are non-zero
+        parameterValues.row(l) = path.parameterValues.row(0);
+        continue;
+      }
+      if (currentLambda < path.lambda.at(numberBreakpoints - 1))
+        error("lambda is smaller than the last lambda of the path.");
+
+      unsigned int b = 1;
+      while (path.lambda.at(b) > currentLambda)
+        b++;
+      const double weight = (path.lambda.at(b - 1) - currentLambda) /
+                            (path.lambda.at(b - 1) - path.lambda.at(b));
+      parameterValues.row(l) = (1.0 - weight) * path.parameterValues.row(b - 1) +
+                               weight * path.parameterValues.row(b);
+    }
+    return (parameterValues);
+  }
+
+} // end namespace
+
+#endif
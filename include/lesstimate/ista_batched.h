@@ -0,0 +1,712 @@
+#ifndef ISTA_BATCHED_H
+#define ISTA_BATCHED_H
+#include <vector>
+#include "common_headers.h"
+
+#include "enet.h"
+#include "ista_lasso.h"
+#include "ista_cappedL1.h"
+#include "ista_lsp.h"
+#include "ista_mcp.h"
+#include "ista_scad.h"
+#include "ista_mixedPenalty.h"
+
+// Simulation studies fit the same small model to thousands of data sets. Calling
+// ista once per data set leaves most of the time to the overhead of the optimizer
+// (allocations, virtual calls, short loops). batchedIsta instead fits K independent
+// problems at once:
+//
+// - the parameters of all problems are stored in a K x p matrix. Because armadillo
+//   matrices are stored column by column, the values of parameter j are contiguous
+//   for all problems (structure of arrays), so that the loops over the problems can
+//   be vectorised by the compiler with one SIMD lane per problem;
+// - each problem has its own step size and convergence flag. Problems which have
+//   converged are not changed anymore, but the batch continues until all problems
+//   have converged;
+// - the proximal operators use the same kernels as ista (e.g., proximalLasso)
+//   and are applied column by column.
+//
+// All problems share the same tuning parameters. The model must return the fits and
+// gradients of all problems in a single call (see batchedModel). batchedIsta tells the
+// model which problems still have to be evaluated, so that models can skip the problems
+// which have converged or whose step was already accepted.
+
+namespace lessSEM
+{
+
+  /**
+   * @brief model for batchedIsta. Each row of parameterValues contains the parameters of one
+   * problem (e.g., one simulated data set).
+   *
+   */
+  class batchedModel
+  {
+  public:
+    virtual ~batchedModel() = default;
+
+    /**
+     * @brief fit function of all problems
+     *
+     * @param parameterValues matrix with parameter values (one row per problem)
+     * @param parameterLabels stringVector with parameterLabels
+     * @return arma::colvec fit of each problem
+     */
+    virtual arma::colvec fit(const arma::mat &parameterValues,
+                             const stringVector &parameterLabels) = 0;
+
+    /**
+     * @brief gradients of all problems
+     *
+     * @param parameterValues matrix with parameter values (one row per problem)
+     * @param parameterLabels stringVector with parameterLabels
+     * @return arma::mat gradients of each problem (one row per problem)
+     */
+    virtual arma::mat gradients(const arma::mat &parameterValues,
+                                const stringVector &parameterLabels) = 0;
+
+    /**
+     * @brief fit function of the problems selected by evaluate. batchedIsta does not use the
+     * fits of the other problems, so that they can be skipped. The default evaluates all problems.
+     *
+     * @param parameterValues matrix with parameter values (one row per problem)
+     * @param parameterLabels stringVector with parameterLabels
+     * @param evaluate evaluate.at(k) is true if problem k must be evaluated
+     * @return arma::colvec fit of each problem
+     */
+    virtual arma::colvec fit(const arma::mat &parameterValues,
+                             const stringVector &parameterLabels,
+                             const std::vector<bool> &evaluate)
+    {
+      static_cast<void>(evaluate);
+      return (fit(parameterValues, parameterLabels));
+    }
+
+    /**
+     * @brief gradients of the problems selected by evaluate. batchedIsta does not use the
+     * gradients of the other problems, so that they can be skipped. The default evaluates all problems.
+     *
+     * @param parameterValues matrix with parameter values (one row per problem)
+     * @param parameterLabels stringVector with parameterLabels
+     * @param evaluate evaluate.at(k) is true if problem k must be evaluated
+     * @return arma::mat gradients of each problem (one row per problem)
+     */
+    virtual arma::mat gradients(const arma::mat &parameterValues,
+                                const stringVector &parameterLabels,
+                                const std::vector<bool> &evaluate)
+    {
+      static_cast<void>(evaluate);
+      return (gradients(parameterValues, parameterLabels));
+    }
+  };
+
+  /**
+   * @struct controlBatchedIsta
+   * @brief settings of batchedIsta
+   *
+   * @var L0 L0 controls the step size used in the first iteration
+   * @var eta eta controls by how much the step size changes in the inner iterations with (eta^i)*L, where i is the inner iteration
+   * @var accelerate should the acceleration of Beck & Teboulle (2009) be used?
+   * @var maxIterOut maximal number of outer iterations
+   * @var maxIterIn maximal number of inner iterations
+   * @var breakOuter change in fit required to break the outer iteration of a problem
+   * @var sampleSize ista will rescale the fit by 1/sampleSize
+   * @var verbose if set to a value > 0, the number of active problems is printed every verbose iterations
+   */
+  struct controlBatchedIsta
+  {
+    double L0;
+    double eta;
+    bool accelerate;
+    int maxIterOut;
+    int maxIterIn;
+    double breakOuter;
+    double sampleSize;
+    int verbose;
+  };
+
+  /**
+   * @brief Returns default settings for batchedIsta
+   *
+   * @return controlBatchedIsta
+   */
+  inline controlBatchedIsta controlBatchedIstaDefault()
+  {
+    controlBatchedIsta defaultIs = {
+        .1,    // L0
+        2.0,   // eta
+        true,  // accelerate
+        10000, // maxIterOut
+        1000,  // maxIterIn
+        1e-8,  // breakOuter
+        1.0,   // sampleSize
+        0      // verbose
+    };
+    return (defaultIs);
+  }
+
+  /**
+   * @struct batchedFitResults
+   * @brief The fit results returned by batchedIsta (one element/row per problem).
+   * @var fit final fit values (regularized fit)
+   * @var convergence was the outer breaking condition met?
+   * @var iterations number of outer iterations
+   * @var parameterValues final parameter values (one row per problem)
+   */
+  struct batchedFitResults
+  {
+    arma::colvec fit;
+    std::vector<bool> convergence;
+    std::vector<int> iterations;
+    arma::mat parameterValues;
+  };
+
+  // The following functions apply the proximal operators of ista_penalties.h to all
+  // problems. u_k contains the parameters after the gradient step and L the step size
+  // of each problem.
+
+  /**
+   * @brief proximal operator of the elastic net (lasso part) for all problems
+   */
+  inline void batchedProximalOperator(arma::mat &parameters_kp1,
+                                      const arma::mat &u_k,
+                                      const arma::colvec &L,
+                                      const tuningParametersEnet &tuningParameters)
+  {
+    for (arma::uword p = 0; p < u_k.n_cols; p++)
+    {
+      const double lambda_i = tuningParameters.alpha *
+                              tuningParameters.lambda *
+                              tuningParameters.weights.at(p);
+      const double *u = u_k.colptr(p);
+      double *x = parameters_kp1.colptr(p);
+      for (arma::uword k = 0; k < u_k.n_rows; k++)
+        x[k] = proximalLasso(u[k], lambda_i, L.at(k));
+    }
+  }
+
+  /**
+   * @brief proximal operator of the cappedL1 penalty for all problems
+   */
+  inline void batchedProximalOperator(arma::mat &parameters_kp1,
+                                      const arma::mat &u_k,
+                                      const arma::colvec &L,
+                                      const tuningParametersCappedL1 &tuningParameters)
+  {
+    for (arma::uword p = 0; p < u_k.n_cols; p++)
+    {
+      const double lambda_i = tuningParameters.alpha *
+                              tuningParameters.lambda *
+                              tuningParameters.weights.at(p);
+      const double *u = u_k.colptr(p);
+      double *x = parameters_kp1.colptr(p);
+      for (arma::uword k = 0; k < u_k.n_rows; k++)
+        x[k] = proximalCappedL1(u[k], lambda_i, tuningParameters.theta, L.at(k));
+    }
+  }
+
+  /**
+   * @brief applies a proximal operator with tuning parameters lambda and theta
+   * (lsp, mcp, scad) to all problems. Unregularized parameters are not changed.
+   */
+  template <class proximalKernel>
+  inline void batchedProximalOperatorLambdaTheta(arma::mat &parameters_kp1,
+                                                 const arma::mat &u_k,
+                                                 const arma::colvec &L,
+                                                 const arma::rowvec &weights,
+                                                 const double lambda,
+                                                 const double theta,
+                                                 proximalKernel kernel)
+  {
+    for (arma::uword p = 0; p < u_k.n_cols; p++)
+    {
+      const double *u = u_k.colptr(p);
+      double *x = parameters_kp1.colptr(p);
+      if (weights.at(p) == 0.0)
+      {
+        // unregularized parameter
+        for (arma::uword k = 0; k < u_k.n_rows; k++)
+          x[k] = u[k];
+        continue;
+      }
+      for (arma::uword k = 0; k < u_k.n_rows; k++)
+        x[k] = kernel(u[k], lambda, theta, L.at(k));
+    }
+  }
+
+  /**
+   * @brief proximal operator of the lsp penalty for all problems
+   */
+  inline void batchedProximalOperator(arma::mat &parameters_kp1,
+                                      const arma::mat &u_k,
+                                      const arma::colvec &L,
+                                      const tuningParametersLSP &tuningParameters)
+  {
+    batchedProximalOperatorLambdaTheta(parameters_kp1, u_k, L,
+                                       tuningParameters.weights, tuningParameters.lambda, tuningParameters.theta,
+                                       proximalLsp);
+  }
+
+  /**
+   * @brief proximal operator of the mcp penalty for all problems
+   */
+  inline void batchedProximalOperator(arma::mat &parameters_kp1,
+                                      const arma::mat &u_k,
+                                      const arma::colvec &L,
+                                      const tuningParametersMcp &tuningParameters)
+  {
+    batchedProximalOperatorLambdaTheta(parameters_kp1, u_k, L,
+                                       tuningParameters.weights, tuningParameters.lambda, tuningParameters.theta,
+                                       proximalMcp);
+  }
+
+  /**
+   * @brief proximal operator of the scad penalty for all problems
+   */
+  inline void batchedProximalOperator(arma::mat &parameters_kp1,
+                                      const arma::mat &u_k,
+                                      const arma::colvec &L,
+                                      const tuningParametersScad &tuningParameters)
+  {
+    batchedProximalOperatorLambdaTheta(parameters_kp1, u_k, L,
+                                       tuningParameters.weights, tuningParameters.lambda, tuningParameters.theta,
+                                       proximalScad);
+  }
+
+  /**
+   * @brief proximal operator of the mixed penalty for all problems. The penalty type
+   * of each parameter is given by tuningParameters.pt. Fused chains are shrunken first
+   * (see proximalOperatorMixedPenalty).
+   */
+  inline void batchedProximalOperator(arma::mat &parameters_kp1,
+                                      const arma::mat &u_k,
+                                      const arma::colvec &L,
+                                      const tuningParametersMixedPenalty &tuningParameters)
+  {
+    arma::mat u_fused;
+    if (!tuningParameters.fusedChains.empty())
+    {
+      checkMixedFusedChains(tuningParameters, u_k.n_cols);
+      u_fused = u_k;
+      arma::rowvec u_row;
+      for (arma::uword k = 0; k < u_k.n_rows; k++)
+      {
+        u_row = u_fused.row(k);
+        proximalFusedChains(u_row, tuningParameters.fusedChains, tuningParameters.lambdaFused / L.at(k));
+        u_fused.row(k) = u_row;
+      }
+    }
+    const arma::mat &u_all = tuningParameters.fusedChains.empty() ? u_k : u_fused;
+
+    for (arma::uword p = 0; p < u_all.n_cols; p++)
+    {
+      const double *u = u_all.colptr(p);
+      double *x = parameters_kp1.colptr(p);
+      const double lambda = tuningParameters.lambda.at(p);
+      const double theta = tuningParameters.theta.at(p);
+      const double lambda_i = tuningParameters.alpha.at(p) * lambda * tuningParameters.weights.at(p);
+      const penaltyType pt = tuningParameters.pt.at(p);
+
+      if (pt == none || ((pt == lsp || pt == mcp || pt == scad) && tuningParameters.weights.at(p) == 0.0))
+      {
+        for (arma::uword k = 0; k < u_k.n_rows; k++)
+          x[k] = u[k];
+        continue;
+      }
+
+      switch (pt)
+      {
+      case cappedL1:
+        for (arma::uword k = 0; k < u_k.n_rows; k++)
+          x[k] = proximalCappedL1(u[k], lambda_i, theta, L.at(k));
+        break;
+      case lasso:
+        for (arma::uword k = 0; k < u_k.n_rows; k++)
+          x[k] = proximalLasso(u[k], lambda_i, L.at(k));
+        break;
+      case lsp:
+        for (arma::uword k = 0; k < u_k.n_rows; k++)
+          x[k] = proximalLsp(u[k], lambda, theta, L.at(k));
+        break;
+      case mcp:
+        for (arma::uword k = 0; k < u_k.n_rows; k++)
+          x[k] = proximalMcp(u[k], lambda, theta, L.at(k));
+        break;
+      case scad:
+        for (arma::uword k = 0; k < u_k.n_rows; k++)
+          x[k] = proximalScad(u[k], lambda, theta, L.at(k));
+        break;
+      default:
+        error("Unknown penalty type.");
+      }
+    }
+  }
+
+  /**
+   * @brief value of the non-smooth penalty of the elastic net (lasso part) for all problems
+   */
+  inline arma::colvec batchedPenaltyValue(const arma::mat &parameterValues,
+                                          const tuningParametersEnet &tuningParameters)
+  {
+    arma::colvec penaltyValues(parameterValues.n_rows, arma::fill::zeros);
+    for (arma::uword p = 0; p < parameterValues.n_cols; p++)
+    {
+      const double lambda_i = tuningParameters.alpha * tuningParameters.lambda * tuningParameters.weights.at(p);
+      for (arma::uword k = 0; k < parameterValues.n_rows; k++)
+        penaltyValues.at(k) += lambda_i * std::abs(parameterValues.at(k, p));
+    }
+    return (penaltyValues);
+  }
+
+  /**
+   * @brief value of the cappedL1 penalty for all problems
+   */
+  inline arma::colvec batchedPenaltyValue(const arma::mat &parameterValues,
+                                          const tuningParametersCappedL1 &tuningParameters)
+  {
+    arma::colvec penaltyValues(parameterValues.n_rows, arma::fill::zeros);
+    for (arma::uword p = 0; p < parameterValues.n_cols; p++)
+    {
+      const double lambda_i = tuningParameters.alpha * tuningParameters.lambda * tuningParameters.weights.at(p);
+      for (arma::uword k = 0; k < parameterValues.n_rows; k++)
+        penaltyValues.at(k) += lambda_i * std::min(std::abs(parameterValues.at(k, p)), tuningParameters.theta);
+    }
+    return (penaltyValues);
+  }
+
+  /**
+   * @brief value of a penalty with tuning parameters lambda and theta (lsp, mcp, scad)
+   * for all problems. Unregularized parameters are skipped.
+   */
+  template <class penaltyKernel>
+  inline arma::colvec batchedPenaltyValueLambdaTheta(const arma::mat &parameterValues,
+                                                     const arma::rowvec &weights,
+                                                     const double lambda,
+                                                     const double theta,
+                                                     penaltyKernel kernel)
+  {
+    arma::colvec penaltyValues(parameterValues.n_rows, arma::fill::zeros);
+    for (arma::uword p = 0; p < parameterValues.n_cols; p++)
+    {
+      if (weights.at(p) == 0.0)
+        continue;
+      for (arma::uword k = 0; k < parameterValues.n_rows; k++)
+        penaltyValues.at(k) += kernel(parameterValues.at(k, p), lambda, theta);
+    }
+    return (penaltyValues);
+  }
+
+  /**
+   * @brief value of the lsp penalty for all problems
+   */
+  inline arma::colvec batchedPenaltyValue(const arma::mat &parameterValues,
+                                          const tuningParametersLSP &tuningParameters)
+  {
+    return (batchedPenaltyValueLambdaTheta(parameterValues, tuningParameters.weights,
+                                           tuningParameters.lambda, tuningParameters.theta, lspPenalty));
+  }
+
+  /**
+   * @brief value of the mcp penalty for all problems
+   */
+  inline arma::colvec batchedPenaltyValue(const arma::mat &parameterValues,
+                                          const tuningParametersMcp &tuningParameters)
+  {
+    return (batchedPenaltyValueLambdaTheta(parameterValues, tuningParameters.weights,
+                                           tuningParameters.lambda, tuningParameters.theta, mcpPenalty));
+  }
+
+  /**
+   * @brief value of the scad penalty for all problems
+   */
+  inline arma::colvec batchedPenaltyValue(const arma::mat &parameterValues,
+                                          const tuningParametersScad &tuningParameters)
+  {
+    return (batchedPenaltyValueLambdaTheta(parameterValues, tuningParameters.weights,
+                                           tuningParameters.lambda, tuningParameters.theta, scadPenalty));
+  }
+
+  /**
+   * @brief value of the mixed penalty for all problems
+   */
+  inline arma::colvec batchedPenaltyValue(const arma::mat &parameterValues,
+                                          const tuningParametersMixedPenalty &tuningParameters)
+  {
+    arma::colvec penaltyValues(parameterValues.n_rows, arma::fill::zeros);
+    for (arma::uword p = 0; p < parameterValues.n_cols; p++)
+    {
+      const double lambda = tuningParameters.lambda.at(p);
+      const double theta = tuningParameters.theta.at(p);
+      const double lambda_i = tuningParameters.alpha.at(p) * lambda * tuningParameters.weights.at(p);
+      const penaltyType pt = tuningParameters.pt.at(p);
+      if (pt == none || ((pt == lsp || pt == mcp || pt == scad) && tuningParameters.weights.at(p) == 0.0))
+        continue;
+
+      for (arma::uword k = 0; k < parameterValues.n_rows; k++)
+      {
+        const double x = parameterValues.at(k, p);
+        switch (pt)
+        {
+        case cappedL1:
+          penaltyValues.at(k) += lambda_i * std::min(std::abs(x), theta);
+          break;
+        case lasso:
+          penaltyValues.at(k) += lambda_i * std::abs(x);
+          break;
+        case lsp:
+          penaltyValues.at(k) += lspPenalty(x, lambda, theta);
+          break;
+        case mcp:
+          penaltyValues.at(k) += mcpPenalty(x, lambda, theta);
+          break;
+        case scad:
+          penaltyValues.at(k) += scadPenalty(x, lambda, theta);
+          break;
+        default:
+          error("Unknown penalty type.");
+        }
+      }
+    }
+    if (!tuningParameters.fusedChains.empty())
+    {
+      for (arma::uword k = 0; k < parameterValues.n_rows; k++)
+        penaltyValues.at(k) += tuningParameters.lambdaFused *
+                               fusedDifferences(parameterValues.row(k), tuningParameters.fusedChains);
+    }
+    return (penaltyValues);
+  }
+
+  /**
+   * @brief ridge part of the elastic net for all problems. Returns the penalty values and
+   * adds the gradients of the ridge penalty to gradients (if not nullptr).
+   */
+  inline arma::colvec batchedSmoothPenalty(const arma::mat &parameterValues,
+                                           arma::mat *gradients,
+                                           const tuningParametersEnet &tuningParameters)
+  {
+    arma::colvec penaltyValues(parameterValues.n_rows, arma::fill::zeros);
+    // if ridge is not used:
+    if (tuningParameters.alpha == 1)
+      return (penaltyValues);
+    for (arma::uword p = 0; p < parameterValues.n_cols; p++)
+    {
+      const double lambda_i = (1.0 - tuningParameters.alpha) * tuningParameters.lambda * tuningParameters.weights.at(p);
+      for (arma::uword k = 0; k < parameterValues.n_rows; k++)
+      {
+        const double x = parameterValues.at(k, p);
+        penaltyValues.at(k) += lambda_i * x * x;
+        if (gradients != nullptr)
+          gradients->at(k, p) += 2.0 * lambda_i * x;
+      }
+    }
+    return (penaltyValues);
+  }
+
+  /**
+   * @brief all other penalties have no smooth part
+   */
+  template <typename T>
+  inline arma::colvec batchedSmoothPenalty(const arma::mat &parameterValues,
+                                           arma::mat *gradients,
+                                           const T &tuningParameters)
+  {
+    static_cast<void>(gradients);
+    static_cast<void>(tuningParameters);
+    return (arma::colvec(parameterValues.n_rows, arma::fill::zeros));
+  }
+
+  /**
+   * @brief Fits many independent problems with (fast) iterative shrinkage and thresholding
+   * (see ista). All problems share the parameter labels and the tuning parameters.
+   *
+   * @tparam T type of the tuning parameters (tuningParametersEnet, tuningParametersCappedL1,
+   * tuningParametersLSP, tuningParametersMcp, tuningParametersScad, or tuningParametersMixedPenalty).
+   * For tuningParametersEnet, the ridge part of the elastic net is added as smooth penalty.
+   * @param model_ the model object derived from the batchedModel class
+   * @param startingValues matrix with starting values (one row per problem)
+   * @param parameterLabels labels of the parameters (one per column)
+   * @param tuningParameters tuning parameters of the penalty
+   * @param control_ settings for batchedIsta
+   * @return batchedFitResults
+   */
+  template <typename T>
+  inline batchedFitResults batchedIsta(batchedModel &model_,
+                                       const arma::mat &startingValues,
+                                       const stringVector &parameterLabels,
+                                       const T &tuningParameters,
+                                       const controlBatchedIsta &control_ = controlBatchedIstaDefault())
+  {
+    const arma::uword numberProblems = startingValues.n_rows;
+    const arma::uword numberParameters = startingValues.n_cols;
+    const double scale = 1.0 / control_.sampleSize;
+
+    if (control_.eta <= 1.0)
+      error("eta must be larger than 1.");
+    if (control_.maxIterIn < 1)
+      error("maxIterIn must be at least 1.");
+
+    // smooth part (model + ridge) of the fit function and its gradients. Only the
+    // problems with evaluate.at(k) == true are used; the model may skip all other rows
+    auto smoothFit = [&](const arma::mat &parameterValues, const std::vector<bool> &evaluate) -> arma::colvec
+    {
+      return (scale * model_.fit(parameterValues, parameterLabels, evaluate) +
+              batchedSmoothPenalty(parameterValues, nullptr, tuningParameters));
+    };
+    auto smoothGradients = [&](const arma::mat &parameterValues, const std::vector<bool> &evaluate) -> arma::mat
+    {
+      arma::mat gradientValues = scale * model_.gradients(parameterValues, parameterLabels, evaluate);
+      batchedSmoothPenalty(parameterValues, &gradientValues, tuningParameters);
+      return (gradientValues);
+    };
+
+    arma::mat parameters_k = startingValues,
+              parameters_kMinus1 = startingValues,
+              y_k = startingValues,
+              u_k(numberProblems, numberParameters),
+              candidate(numberProblems, numberParameters);
+
+    // problems which are evaluated by the model
+    std::vector<bool> evaluate(numberProblems, true);
+
+    arma::colvec fit_k = smoothFit(parameters_k, evaluate);
+    arma::colvec penalizedFit_k = fit_k + batchedPenaltyValue(parameters_k, tuningParameters);
+    arma::colvec L(numberProblems);
+    L.fill(control_.L0);
+
+    // per problem flags (char instead of bool to allow for vectorised loops)
+    std::vector<char> active(numberProblems, 1);
+    std::vector<char> accepted(numberProblems, 0);
+
+    batchedFitResults fitResults_;
+    fitResults_.convergence.assign(numberProblems, false);
+    fitResults_.iterations.assign(numberProblems, control_.maxIterOut);
+
+    arma::uword numberActive = numberProblems;
+
+    for (int outer_iteration = 0; outer_iteration < control_.maxIterOut; outer_iteration++)
+    {
+
+      // check if user wants to stop the computation:
+#if USE_R
+      Rcpp::checkUserInterrupt();
+#endif
+
+      // extrapolation point (Beck & Teboulle, 2009)
+      if (control_.accelerate)
+      {
+        const double momentum = static_cast<double>(outer_iteration) / (outer_iteration + 3.0);
+        y_k = parameters_k + momentum * (parameters_k - parameters_kMinus1);
+      }
+      else
+      {
+        y_k = parameters_k;
+      }
+
+      // converged problems are not evaluated anymore
+      for (arma::uword k = 0; k < numberProblems; k++)
+        evaluate[k] = active[k];
+
+      const arma::colvec fit_y = smoothFit(y_k, evaluate);
+      const arma::mat gradient_y = smoothGradients(y_k, evaluate);
+
+      for (arma::uword k = 0; k < numberProblems; k++)
+        accepted[k] = !active[k];
+
+      arma::uword numberAccepted = numberProblems - numberActive;
+      arma::colvec fit_candidate(numberProblems, arma::fill::zeros);
+
+      for (int inner_iteration = 0; inner_iteration < control_.maxIterIn; inner_iteration++)
+      {
+        // gradient step and proximal operator for all problems
+        for (arma::uword p = 0; p < numberParameters; p++)
+        {
+          const double *y = y_k.colptr(p);
+          const double *g = gradient_y.colptr(p);
+          double *u = u_k.colptr(p);
+          for (arma::uword k = 0; k < numberProblems; k++)
+            u[k] = y[k] - g[k] / L.at(k);
+        }
+        batchedProximalOperator(candidate, u_k, L, tuningParameters);
+
+        // problems whose step was accepted keep the fit of the accepted candidate
+        for (arma::uword k = 0; k < numberProblems; k++)
+          evaluate[k] = !accepted[k];
+        const arma::colvec fit_evaluated = smoothFit(candidate, evaluate);
+        for (arma::uword k = 0; k < numberProblems; k++)
+        {
+          if (evaluate[k])
+            fit_candidate.at(k) = fit_evaluated.at(k);
+        }
+
+        // sufficient decrease (Beck & Teboulle, 2009, Remark 3.1) for each problem
+        for (arma::uword k = 0; k < numberProblems; k++)
+        {
+          if (accepted[k])
+            continue;
+
+          double linear = 0.0, quadratic = 0.0;
+          for (arma::uword p = 0; p < numberParameters; p++)
+          {
+            const double change = candidate.at(k, p) - y_k.at(k, p);
+            linear += gradient_y.at(k, p) * change;
+            quadratic += change * change;
+          }
+          const double bound = fit_y.at(k) + linear + .5 * L.at(k) * quadratic;
+
+          if (std::isfinite(fit_candidate.at(k)) && fit_candidate.at(k) <= bound)
+          {
+            accepted[k] = 1;
+            numberAccepted++;
+          }
+          else
+          {
+            L.at(k) *= control_.eta;
+          }
+        }
+
+        if (numberAccepted == numberProblems)
+          break;
+      }
+
+      // update the active problems and check convergence
+      const arma::colvec penalty_candidate = batchedPenaltyValue(candidate, tuningParameters);
+      for (arma::uword k = 0; k < numberProblems; k++)
+      {
+        if (!active[k])
+          continue;
+
+        parameters_kMinus1.row(k) = parameters_k.row(k);
+        parameters_k.row(k) = candidate.row(k);
+        fit_k.at(k) = fit_candidate.at(k);
+        const double penalizedFit_kp1 = fit_candidate.at(k) + penalty_candidate.at(k);
+
+        if (std::abs(penalizedFit_kp1 - penalizedFit_k.at(k)) < control_.breakOuter)
+        {
+          active[k] = 0;
+          numberActive--;
+          fitResults_.convergence.at(k) = true;
+          fitResults_.iterations.at(k) = outer_iteration + 1;
+        }
+        penalizedFit_k.at(k) = penalizedFit_kp1;
+      }
+
+      if (control_.verbose > 0 && outer_iteration % control_.verbose == 0)
+      {
+        print << "Iteration " << outer_iteration + 1 << ": "
+              << numberActive << " of " << numberProblems << " problems active\n";
+      }
+
+      if (numberActive == 0)
+        break;
+    }
+
+    if (numberActive != 0)
+      warn("Outer iterations did not converge for all problems");
+
+    fitResults_.fit = penalizedFit_k;
+    fitResults_.parameterValues = parameters_k;
+    return (fitResults_);
+  }
+
+} // end namespace
+
+#endif
@@ -25,6 +25,50 @@ namespace lessSEM
     double theta; ///> threshold parameter; any parameter above this threshold will only receive the constant penalty lambda_i*theta, all below will get lambda_i*parameterValue_i
   };
 
+  /**
+   * @brief proximal operator of the cappedL1 penalty for a single parameter
+   *
+   * @param u_k parameter value after the gradient step (x - g/L)
+   * @param lambda_i parameter specific lambda (alpha * lambda * weight)
+   * @param theta threshold parameter
+   * @param L step size
+   * @return double
+   */
+  inline double proximalCappedL1(const double u_k,
+                                 const double lambda_i,
+                                 const double theta,
+                                 const double L)
+  {
+    int sign = (u_k > 0);
+    if (u_k < 0)
+      sign = -1;
+
+    const double abs_u_k = std::abs(u_k);
+
+    const double x_1 = sign * std::max(abs_u_k, theta);
+    const double x_2 = sign * std::min(theta,
+                                       std::max(abs_u_k - lambda_i / L, 0.0));
+    // h_1 and h_2 will always be positive. The minimum is therefore
+    // 0 which is also the value we get if either x_1 or x_2 are
+    // equivalent to the proposed parameter u_k in descend-direction.
+    // This is the case if the absolute value of the
+    // proposed parameter is above the threshold theta -> x_1 = u_k.
+    // => IF |u_k| > THETA, WE ALWAYS SELECT u_k
+    // If the proposed parameter |u_k| is below the threshold theta
+    // x_2 comes into play. x_2 is at minimum equal to theta (upper bound)
+    // and otherwise equal to std::max(abs_u_k - lambda_i/L, 0.0)
+    // which is the proximal operator of the lasso penalty
+    // => IF |u_k| > THETA, WE ALWAYS TAKE THE NORMAL LASSO UPDATE
+    const double h_1 = .5 * std::pow(x_1 - u_k, 2) +
+                       (lambda_i / L) * std::min(std::abs(x_1), theta);
+    const double h_2 = .5 * std::pow(x_2 - u_k, 2) +
+                       (lambda_i / L) * std::min(std::abs(x_2), theta);
+
+    if (h_1 <= h_2)
+      return (x_1);
+    return (x_2);
+  }
+
   /**
    * @brief proximal operator for the cappedL1 penalty function
    *
@@ -50,17 +94,32 @@ namespace lessSEM
                                const tuningParametersCappedL1 &tuningParameters)
         override
     {
-      
-      static_cast<void>(parameterLabels); // is unused, but necessary for the interface
+      static_cast<void>(parameterLabels); // is unused
+      return (getParameters(parameterValues, gradientValues, L, tuningParameters));
+    }
 
+    /**
+     * @brief update the parameter vector. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @return arma::rowvec updated parameters
+     */
+    arma::rowvec getParameters(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradientValues,
+                               const double L,
+                               const tuningParametersCappedL1 &tuningParameters)
+    {
+      
       // step in descending direction with step size (1/L):
       arma::rowvec u_k = parameterValues - gradientValues / L;
 
       arma::rowvec parameters_kp1(parameterValues.n_elem);
       parameters_kp1.fill(arma::datum::nan);
 
-      double lambda_i, x_1, x_2, h_1, h_2, abs_u_k;
-      int sign;
+      double lambda_i;
       for (unsigned int p = 0; p < parameterValues.n_elem; p++)
       {
 
@@ -68,39 +127,10 @@ namespace lessSEM
                    tuningParameters.lambda *
                    tuningParameters.weights.at(p);
 
-        sign = (u_k.at(p) > 0);
-        if (u_k.at(p) < 0)
-          sign = -1;
-
-        abs_u_k = std::abs(u_k.at(p));
-
-        x_1 = sign * std::max(abs_u_k, tuningParameters.theta);
-        x_2 = sign * std::min(tuningParameters.theta,
-                              std::max(abs_u_k - lambda_i / L, 0.0));
-        // h_1 and h_2 will always be positive. The minimum is therefore
-        // 0 which is also the value we get if either x_1 or x_2 are
-        // equivalent to the proposed parameter u_k in descend-direction.
-        // This is the case if the absolute value of the
-        // proposed parameter is above the threshold theta -> x_1 = u_k.
-        // => IF |u_k| > THETA, WE ALWAYS SELECT u_k
-        // If the proposed parameter |u_k| is below the threshold theta
-        // x_2 comes into play. x_2 is at minimum equal to theta (upper bound)
-        // and otherwise equal to std::max(abs_u_k - lambda_i/L, 0.0)
-        // which is the proximal operator of the lasso penalty
-        // => IF |u_k| > THETA, WE ALWAYS TAKE THE NORMAL LASSO UPDATE
-        h_1 = .5 * std::pow(x_1 - u_k.at(p), 2) +
-              (lambda_i / L) * std::min(std::abs(x_1), tuningParameters.theta);
-        h_2 = .5 * std::pow(x_2 - u_k.at(p), 2) +
-              (lambda_i / L) * std::min(std::abs(x_2), tuningParameters.theta);
-
-        if (h_1 <= h_2)
-        {
-          parameters_kp1.at(p) = x_1;
-        }
-        else
-        {
-          parameters_kp1.at(p) = x_2;
-        }
+        parameters_kp1.at(p) = proximalCappedL1(u_k.at(p),
+                                                lambda_i,
+                                                tuningParameters.theta,
+                                                L);
       }
       return parameters_kp1;
     }
@@ -137,8 +167,20 @@ namespace lessSEM
                     const tuningParametersCappedL1 &tuningParameters)
         override
     {
+      static_cast<void>(parameterLabels); // is unused
+      return (getValue(parameterValues, tuningParameters));
+    }
 
-      static_cast<void>(parameterLabels); // is unused, but necessary for the interface to be consistent
+    /**
+     * @brief Get the value of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const tuningParametersCappedL1 &tuningParameters)
+    {
 
       double penaltyValue = 0.0;
       double lambda_i;
@@ -156,6 +198,37 @@ namespace lessSEM
 
       return penaltyValue;
     }
+
+    /**
+     * @brief Get the subgradients of the penalized fit function (see subgradients.h)
+     *
+     * @param parameterValues current parameter values
+     * @param gradients gradients of the smooth part of the fit function
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
+                                 const arma::rowvec &gradients,
+                                 const tuningParametersCappedL1 &tuningParameters)
+        override
+    {
+
+      arma::rowvec subgradients = gradients;
+
+      for (unsigned int p = 0; p < parameterValues.n_elem; p++)
+      {
+        // if not regularized: nothing to do here
+        if (tuningParameters.weights.at(p) == 0.0)
+          continue;
+
+        subgradients.at(p) = subgradientCappedL1(parameterValues.at(p),
+                                                 gradients.at(p),
+                                                 tuningParameters.alpha * tuningParameters.lambda * tuningParameters.weights.at(p),
+                                                 tuningParameters.theta);
+      }
+
+      return (subgradients);
+    }
   };
 
 }
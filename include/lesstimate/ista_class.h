@@ -7,10 +7,21 @@
 #include "proximalOperator.h"
 #include "penalty.h"
 #include "smoothPenalty.h"
+#include "checkpoint.h"
+#include "optimizerState.h"
+#include "screening.h"
+#include "modelCache.h"
+#include "traits.h"
+#include "fixedSize.h"
+#include "ista_lasso.h"
+#include "ista_ridge.h"
 
 // The design follows ensmallen (https://github.com/mlpack/ensmallen) in that the
 // user supplies a C++ class with methods fit and gradients which is used
-// by the optimizer
+// by the optimizer. The model, the proximal operator, and the penalties are template
+// parameters; any class with the required methods can be used (see traits.h) and
+// the calls are then resolved at compile time. Classes derived from model,
+// proximalOperator<T>, penalty<T>, and smoothPenalty<U> are one instantiation.
 
 // The implementation of ista follows that outlined in
 // Beck, A., & Teboulle, M. (2009). A Fast Iterative Shrinkage-Thresholding
@@ -85,7 +96,7 @@ namespace lessSEM
   // accelerate: if true, the extrapolation parameter is used
   // to accelerate ista (see, e.g., Parikh, N., & Boyd, S. (2013).
   // Proximal Algorithms. Foundations and Trends in Optimization, 1(3), 123–231.,
-  // p. 152)
+  // p. 152). The extrapolation is only used together with momentum.
   // maxIterOut: maximal number of outer iterations
   // maxIterIn: maximal number of inner iterations
   // breakOuter: change in fit required to break the outer iteration
@@ -97,6 +108,22 @@ namespace lessSEM
   // sampleSize: can be used to scale the fitting function down
   // verbose: if set to a value > 0, the fit every verbose iterations
   // is printed.
+  // checkpoint: settings for writing checkpoints and resuming from them (see checkpoint.h)
+  // warmStart: state of a previous fit used to initialize the optimizer (see optimizerState.h).
+  // The step size L and (if momentum is used) the momentum of the warm start are used.
+  // returnState: should the final state of the optimizer be returned in fitResults::state?
+  // screening: settings for the safe screening of parameters and the gap stopping criterion
+  // (see screening.h). Only supported for proximalOperatorLasso combined with penaltyRidge
+  // or noSmoothPenalty.
+  // breakKKT: if set to a value > 0, the outer iteration is exited once the largest absolute
+  // subgradient of the penalized fit function (the violation of the optimality conditions;
+  // see subgradients.h) is below breakKKT. This replaces the change in fit (breakOuter) as
+  // convergence criterion.
+  // momentum: if true (and accelerate is true), the step starts at the extrapolated point
+  // y_k = x_k + k / (k + 3) * (x_k - x_(k-1)) (FISTA). The step from y_k must satisfy the
+  // quadratic approximation at y_k and must not increase the penalized fit; otherwise, the
+  // step from x_k with the convCritInner criterion is used and k restarts at 0 (monotone FISTA;
+  // Beck & Teboulle, 2009). Without momentum, the step always starts at x_k.
   struct control
   {
     double L0;
@@ -110,6 +137,12 @@ namespace lessSEM
     stepSizeInheritance stepSizeIn;
     int sampleSize;
     int verbose;
+    controlCheckpoint checkpoint;
+    optimizerState warmStart;
+    bool returnState;
+    controlScreening screening;
+    double breakKKT;
+    bool momentum;
   };
   // the name "control" dates back to when there was no glmnet optimizer and is
   // kept for backwards compatability. For consistency, we also define a more
@@ -133,7 +166,13 @@ namespace lessSEM
         .1,                  // sigma
         istaStepInheritance, // stepSizeInheritance
         1,                   // sample size
-        0                    // verbose
+        0,                   // verbose
+        controlCheckpointDefault(), // checkpoint
+        optimizerState(),           // warmStart
+        false,                      // returnState
+        controlScreeningDefault(),  // screening
+        0.0,                        // breakKKT
+        false                       // momentum
     };
     return (defaultIs);
   }
@@ -143,6 +182,58 @@ namespace lessSEM
     return (controlDefault());
   }
 
+  /**
+   * @brief proximal step of ista with safe screening (see screening.h). Screening is only
+   * supported for proximalOperatorLasso, which skips the removed parameters. Other proximal
+   * operators compute the full step and the removed parameters are set to zero afterwards.
+   *
+   * @param proximalOperator_ proximal operator of the penalty
+   * @param parameterValues parameter values before the step
+   * @param gradientValues gradients at parameterValues
+   * @param parameterLabels labels of the parameters
+   * @param L step size
+   * @param tuningParameters tuning parameters of the penalty
+   * @param screening_ the screening
+   * @return arma::rowvec parameters after the step
+   */
+  template <class proximalOperatorClass, typename T>
+  inline arma::rowvec screenedProximalParameters(proximalOperatorClass &proximalOperator_,
+                                                 const arma::rowvec &parameterValues,
+                                                 const arma::rowvec &gradientValues,
+                                                 const stringVector &parameterLabels,
+                                                 const double L,
+                                                 const T &tuningParameters,
+                                                 const gapSafeScreening &screening_)
+  {
+    if constexpr (std::is_base_of<proximalOperatorLasso, proximalOperatorClass>::value)
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (proximalOperator_.proximalOperatorLasso::getParameters(parameterValues,
+                                                                     gradientValues,
+                                                                     L,
+                                                                     tuningParameters,
+                                                                     screening_.mask()));
+    }
+    else if constexpr (std::is_polymorphic<proximalOperatorClass>::value &&
+                       std::is_base_of<proximalOperatorClass, proximalOperatorLasso>::value)
+    {
+      if (proximalOperatorLasso *lasso = dynamic_cast<proximalOperatorLasso *>(&proximalOperator_))
+        return (lasso->proximalOperatorLasso::getParameters(parameterValues,
+                                                            gradientValues,
+                                                            L,
+                                                            tuningParameters,
+                                                            screening_.mask()));
+    }
+    arma::rowvec parameters_kp1 = proximalParameters(proximalOperator_,
+                                                     parameterValues,
+                                                     gradientValues,
+                                                     parameterLabels,
+                                                     L,
+                                                     tuningParameters);
+    screening_.apply(parameters_kp1);
+    return (parameters_kp1);
+  }
+
   // We provide two optimizer interfaces: One uses a combination of arma::rowvec and lessSEM::stringVector for starting
   // values and parameter labels respectively. This interface is consistent with the fit and gradient function of the
   // lessSEM::model-class. Alternatively, a numericVector can be passed to the optimizers. This design is rooted in
@@ -153,7 +244,9 @@ namespace lessSEM
   //
   // Implements (variants of) the ista optimizer.
   //
-  // @param model_ the model object derived from the model class in model.h
+  // @tparam N number of parameters if known at compile time; 0 uses dynamic storage (see fixedSize.h)
+  // @param model_ the model object derived from the model class in model.h or any class
+  // with the methods fit and gradients (see traits.h)
   // @param startingValuesRcpp an Rcpp numeric vector with starting values
   // @parma proximalOperator_ a proximal operator for the penalty function
   // @param
@@ -163,19 +256,33 @@ namespace lessSEM
   // @parma smoothTuningParameters tuning parameters for the smooth penalty function
   // @param control_ settings for the ista optimizer.
   // @return fit result
-  template <typename T, typename U> // T is the type of the tuning parameters
+  template <arma::uword N = 0,        // number of parameters if known at compile time (see fixedSize.h)
+            typename T, typename U, // T is the type of the tuning parameters
+            class modelClass,
+            class proximalOperatorClass,
+            class penaltyClass,
+            class smoothPenaltyClass>
   inline lessSEM::fitResults ista(
-      model &model_,
+      modelClass &model_,
       numericVector startingValuesRcpp,
-      proximalOperator<T> &proximalOperator_, // proximalOperator takes the tuning parameters
+      proximalOperatorClass &proximalOperator_, // proximalOperator takes the tuning parameters
       // as input -> <T>
-      penalty<T> &penalty_,             // penalty takes the tuning parameters
-      smoothPenalty<U> &smoothPenalty_, // smoothPenalty takes the smooth tuning parameters
+      penaltyClass &penalty_,             // penalty takes the tuning parameters
+      smoothPenaltyClass &smoothPenalty_, // smoothPenalty takes the smooth tuning parameters
       // as input -> <U>
       const T &tuningParameters,       // tuning parameters are of type T
       const U &smoothTuningParameters, // tuning parameters are of type U
       const control &control_ = controlDefault())
   {
+    static_assert(isModel<modelClass>::value,
+                  "The model must provide the methods fit and gradients (see model.h).");
+    static_assert(isProximalOperator<proximalOperatorClass, T>::value,
+                  "The proximal operator must provide the method getParameters (see proximalOperator.h).");
+    static_assert(isPenalty<penaltyClass, T>::value,
+                  "The penalty must provide the method getValue (see penalty.h).");
+    static_assert(isSmoothPenalty<smoothPenaltyClass, U>::value,
+                  "The smooth penalty must provide the methods getValue and getGradients (see smoothPenalty.h).");
+
     if (control_.verbose != 0)
     {
       print << "Optimizing with ista.\n"
@@ -196,37 +303,49 @@ namespace lessSEM
             << "\n"
             << " breakOuter = "
             << control_.breakOuter
+            << "\n"
+            << " breakKKT = "
+            << control_.breakKKT
             << std::endl;
     }
     // separate labels and values
     const arma::rowvec startingValues = toArmaVector(startingValuesRcpp);
     const stringVector parameterLabels = startingValuesRcpp.names();
 
+    // parameters and gradients are stored on the stack if the number of
+    // parameters is known at compile time
+    checkFixedSize<N>(startingValues.n_elem);
+    using rowvecType = typename fixedSize<N>::rowvec;
+
+    // the model is often evaluated repeatedly at the same parameter values;
+    // cachedModel_ returns stored results in this case (see modelCache.h)
+    cachedModel<modelClass, rowvecType> cachedModel_(model_);
+
     // prepare parameter vectors
-    arma::rowvec parameters_k = startingValues,
-                 parameters_kMinus1 = startingValues,
-                 parameters_kMinus2 = startingValues,
-                 y_k = startingValues; // required for acceleration
+    rowvecType parameters_k = startingValues,
+               parameters_kMinus1 = startingValues,
+               parameters_kMinus2 = startingValues,
+               y_k = startingValues; // required for acceleration
     // the following elements will be required to judge the breaking condition
-    arma::rowvec parameterChange(startingValues.n_elem);
-    arma::rowvec gradientChange(startingValues.n_elem); // necessary for Barzilai Borwein
-    arma::mat quadr, parchTimeGrad;
+    rowvecType parameterChange = startingValues;
+    rowvecType gradientChange = startingValues; // necessary for Barzilai Borwein
+    double quadr, parchTimeGrad;
     numericVector randomNumber; // for stochastic Barzilai Borwein
 
     // prepare fit elements
-    double fit_k = (1.0 / control_.sampleSize) * model_.fit(startingValues, parameterLabels) +
-                   smoothPenalty_.getValue(parameters_k, parameterLabels, smoothTuningParameters), // ridge penalty part
-        fit_kMinus1 = (1.0 / control_.sampleSize) * model_.fit(startingValues, parameterLabels) +
-                      smoothPenalty_.getValue(parameters_kMinus1, parameterLabels, smoothTuningParameters), // ridge penalty part,
+    double fit_k = (1.0 / control_.sampleSize) * cachedModel_.fit(startingValues, parameterLabels) +
+                   penaltyValue(smoothPenalty_, parameters_k, parameterLabels, smoothTuningParameters), // ridge penalty part
+        fit_kMinus1 = (1.0 / control_.sampleSize) * cachedModel_.fit(startingValues, parameterLabels) +
+                      penaltyValue(smoothPenalty_, parameters_kMinus1, parameterLabels, smoothTuningParameters), // ridge penalty part,
         penalty_k = 0.0;
     double penalizedFit_k, penalizedFit_kMinus1;
-    arma::rowvec gradients_k, gradients_kMinus1, gradient_y_k;
+    rowvecType gradients_k, gradients_kMinus1, gradient_y_k;
 
     penalizedFit_k = fit_k +
-                     penalty_.getValue(parameters_k, parameterLabels, tuningParameters); // lasso penalty part
+                     penaltyValue(penalty_, parameters_k, parameterLabels, tuningParameters); // lasso penalty part
 
     penalizedFit_kMinus1 = fit_kMinus1 +
-                           penalty_.getValue(parameters_kMinus1, parameterLabels, tuningParameters); // lasso penalty part
+                           penaltyValue(penalty_, parameters_kMinus1, parameterLabels, tuningParameters); // lasso penalty part
 
     // the following vector will save the fits of all iterations:
     arma::rowvec fits(control_.maxIterOut + 1);
@@ -236,13 +355,13 @@ namespace lessSEM
     // prepare gradient elements
     // NOTE: We combine the gradients of the smooth functions (the log-Likelihood)
     // of the model and the smooth penalty function (e.g., ridge)
-    gradients_k = (1.0 / control_.sampleSize) * model_.gradients(parameters_k, parameterLabels) +
-                  smoothPenalty_.getGradients(parameters_k, parameterLabels, smoothTuningParameters); // ridge part
-    gradients_kMinus1 = (1.0 / control_.sampleSize) * model_.gradients(parameters_kMinus1, parameterLabels) +
-                        smoothPenalty_.getGradients(parameters_kMinus1, parameterLabels, smoothTuningParameters); // ridge part
+    gradients_k = (1.0 / control_.sampleSize) * cachedModel_.gradients(parameters_k, parameterLabels) +
+                  penaltyGradients(smoothPenalty_, parameters_k, parameterLabels, smoothTuningParameters); // ridge part
+    gradients_kMinus1 = (1.0 / control_.sampleSize) * cachedModel_.gradients(parameters_kMinus1, parameterLabels) +
+                        penaltyGradients(smoothPenalty_, parameters_kMinus1, parameterLabels, smoothTuningParameters); // ridge part
     // for acceleration:
-    gradient_y_k = (1.0 / control_.sampleSize) * model_.gradients(parameters_kMinus1, parameterLabels) +
-                   smoothPenalty_.getGradients(parameters_kMinus1, parameterLabels, smoothTuningParameters); // ridge part
+    gradient_y_k = (1.0 / control_.sampleSize) * cachedModel_.gradients(parameters_kMinus1, parameterLabels) +
+                   penaltyGradients(smoothPenalty_, parameters_kMinus1, parameterLabels, smoothTuningParameters); // ridge part
 
     // breaking flags
     bool breakInner = false, // if true, the inner iteration is exited
@@ -251,8 +370,77 @@ namespace lessSEM
     // initialize step size
     double L_kMinus1 = control_.L0, L_k = control_.L0;
 
+    // warm start from a previous fit
+    if (control_.warmStart.L > 0.0)
+    {
+      L_kMinus1 = control_.warmStart.L;
+      L_k = control_.warmStart.L;
+    }
+    if (control_.warmStart.momentum.n_elem == startingValues.n_elem)
+    {
+      // continue with the momentum of the previous fit
+      parameters_kMinus2 = parameters_kMinus1 - control_.warmStart.momentum;
+    }
+
+    // safe screening (lasso and elastic net only)
+    std::unique_ptr<gapSafeScreening> screening_;
+    if (usesScreening(control_.screening))
+    {
+      if constexpr (std::is_same<T, tuningParametersEnet>::value &&
+                    std::is_same<U, tuningParametersEnet>::value)
+      {
+        if (!isInstanceOf<proximalOperatorLasso>(proximalOperator_))
+          error("Screening is only supported for proximalOperatorLasso.");
+
+        arma::rowvec ridgeCurvature_(startingValues.n_elem, arma::fill::zeros);
+        if (isInstanceOf<penaltyRidge>(smoothPenalty_))
+          ridgeCurvature_ = ridgeCurvature(smoothTuningParameters);
+        else if (!isInstanceOf<noSmoothPenalty<U>>(smoothPenalty_))
+          error("Screening is only supported for penaltyRidge or noSmoothPenalty as smooth penalty.");
+
+        screening_ = std::make_unique<gapSafeScreening>(control_.screening,
+                                                        lassoLambda(tuningParameters),
+                                                        ridgeCurvature_,
+                                                        1.0 / control_.sampleSize);
+      }
+      else
+      {
+        error("Screening is only supported for the lasso and elastic net.");
+      }
+    }
+
+    // resume from a checkpoint
+    int firstIteration = 0;
+    int resumedMomentumIteration = 0;
+    if (!control_.checkpoint.resumeFrom.empty())
+    {
+      optimizerCheckpoint checkpoint_ = readCheckpoint(control_.checkpoint.resumeFrom,
+                                                       checkpointIsta,
+                                                       startingValues.n_elem);
+      firstIteration = checkpoint_.iteration + 1;
+      fit_k = fit_kMinus1 = checkpoint_.fit_kMinus1;
+      penalizedFit_k = penalizedFit_kMinus1 = checkpoint_.penalizedFit_kMinus1;
+      penalty_k = penalizedFit_k - fit_k;
+      parameters_k = parameters_kMinus1 = checkpoint_.parameters_kMinus1;
+      parameters_kMinus2 = checkpoint_.parameters_kMinus2;
+      gradients_k = gradients_kMinus1 = checkpoint_.gradients_kMinus1;
+      L_k = L_kMinus1 = checkpoint_.L_kMinus1;
+      fits = restoreFits(checkpoint_.fits, control_.maxIterOut);
+      setRandomState(checkpoint_.randomState);
+      if (screening_)
+        screening_->restore(checkpoint_.screening);
+      resumedMomentumIteration = checkpoint_.momentumIteration;
+    }
+    std::unique_ptr<checkpointWriter> checkpointWriter_ = makeCheckpointWriter(control_.checkpoint);
+
+    // number of outer iterations since the momentum was (re)started. The momentum of a
+    // warm start is used with the weight of the second iteration.
+    int momentumIteration = (control_.warmStart.momentum.n_elem == startingValues.n_elem) ? 1 : 0;
+    if (!control_.checkpoint.resumeFrom.empty())
+      momentumIteration = resumedMomentumIteration;
+
     // outer iteration
-    for (int outer_iteration = 0; outer_iteration < control_.maxIterOut; outer_iteration++)
+    for (int outer_iteration = firstIteration; outer_iteration < control_.maxIterOut; outer_iteration++)
     {
 
       // check if user wants to stop the computation:
@@ -260,120 +448,179 @@ namespace lessSEM
       Rcpp::checkUserInterrupt();
 #endif
 
-      for (int inner_iteration = 0; inner_iteration < control_.maxIterIn; inner_iteration++)
+      // the extrapolated point y_k and its gradients do not depend on the step size
+      // (see Parikh, N., & Boyd, S. (2013). Proximal Algorithms. Foundations
+      // and Trends in Optimization, 1(3), 123–231. p. 152). Without momentum, the
+      // step starts at the current parameters.
+      bool extrapolated = false;
+      double fit_y_k = fit_kMinus1;
+      if (control_.accelerate && control_.momentum &&
+          momentumIteration > 0 && arma::max(arma::abs(parameters_kMinus1 - parameters_kMinus2)) > 0.0)
       {
-        // inner iteration: reduce step size until the convergence criterion is met
-        L_k = std::pow(control_.eta, inner_iteration) * L_kMinus1;
+        const double momentumWeight = momentumIteration / (momentumIteration + 3.0);
+        y_k = parameters_kMinus1 + momentumWeight * (parameters_kMinus1 - parameters_kMinus2);
+        fit_y_k = (1.0 / control_.sampleSize) * cachedModel_.fit(y_k, parameterLabels) +
+                  penaltyValue(smoothPenalty_, y_k, parameterLabels, smoothTuningParameters); // ridge penalty part
+        gradient_y_k = (1.0 / control_.sampleSize) * cachedModel_.gradients(y_k,
+                                                                      parameterLabels) +
+                       penaltyGradients(smoothPenalty_,
+                                        y_k,
+                                        parameterLabels,
+                                        smoothTuningParameters);
+        extrapolated = arma::is_finite(fit_y_k) && arma::is_finite(gradient_y_k);
+      }
 
-        if (control_.accelerate)
-        {
-          // with acceleration:
-          // apply proximal operator to get new parameters for given step size
-          // see Parikh, N., & Boyd, S. (2013). Proximal Algorithms. Foundations
-          // and Trends in Optimization, 1(3), 123–231. p. 152
-
-          y_k = parameters_kMinus1 +
-                (inner_iteration / (inner_iteration + 3)) * (parameters_kMinus1 - parameters_kMinus2);
-          gradient_y_k = (1.0 / control_.sampleSize) * model_.gradients(y_k,
-                                                                        parameterLabels) +
-                         smoothPenalty_.getGradients(y_k,
-                                                     parameterLabels,
-                                                     smoothTuningParameters);
-          parameters_k = proximalOperator_.getParameters(
-              y_k,
-              gradient_y_k,
-              parameterLabels,
-              L_k,
-              tuningParameters);
-        }
-        else
+      // the extrapolated step is tried first. If it fails, the step from the current
+      // parameters is used and the momentum restarts (monotone FISTA)
+      for (int pass = extrapolated ? 0 : 1; pass < 2; pass++)
+      {
+        if (pass == 1)
         {
-
-          // apply proximal operator to get new parameters for given step size
-          parameters_k = proximalOperator_.getParameters(
-              parameters_kMinus1,
-              gradients_kMinus1,
-              parameterLabels,
-              L_k,
-              tuningParameters);
+          if (extrapolated)
+            momentumIteration = 0;
+          extrapolated = false;
+          y_k = parameters_kMinus1;
+          gradient_y_k = gradients_kMinus1;
+          fit_y_k = fit_kMinus1;
         }
+        breakInner = false;
 
-        // compute new fit; if this fit is non-finite, we can jump to the next
-        // iteration
-        fit_k = (1.0 / control_.sampleSize) * model_.fit(parameters_k, parameterLabels) +
-                smoothPenalty_.getValue(parameters_k, parameterLabels, smoothTuningParameters); // ridge penalty part
-
-        if (!arma::is_finite(fit_k))
-          continue;
-
-        // fit_k is only part of the fit we are interested in. We also need
-        // the penalty values:
-        penalty_k = penalty_.getValue(parameters_k,
-                                      parameterLabels,
-                                      tuningParameters);
-
-        penalizedFit_k = fit_k +
-                         penalty_k; // lasso part
+        for (int inner_iteration = 0; inner_iteration < control_.maxIterIn; inner_iteration++)
+        {
+          // inner iteration: reduce step size until the convergence criterion is met
+          L_k = std::pow(control_.eta, inner_iteration) * L_kMinus1;
+
+          // apply proximal operator to get new parameters for given step size.
+          // Parameters removed by the screening are skipped and stay at zero
+          if (screening_)
+            parameters_k = screenedProximalParameters(
+                proximalOperator_,
+                y_k,
+                gradient_y_k,
+                parameterLabels,
+                L_k,
+                tuningParameters,
+                *screening_);
+          else
+            parameters_k = proximalParameters(
+                proximalOperator_,
+                y_k,
+                gradient_y_k,
+                parameterLabels,
+                L_k,
+                tuningParameters);
+
+          // compute new fit; if this fit is non-finite, we can jump to the next
+          // iteration
+          fit_k = (1.0 / control_.sampleSize) * cachedModel_.fit(parameters_k, parameterLabels) +
+                  penaltyValue(smoothPenalty_, parameters_k, parameterLabels, smoothTuningParameters); // ridge penalty part
+
+          if (!arma::is_finite(fit_k))
+            continue;
 
-        if (!arma::is_finite(penalizedFit_k))
-          continue;
+          // fit_k is only part of the fit we are interested in. We also need
+          // the penalty values:
+          penalty_k = penaltyValue(penalty_,
+                                   parameters_k,
+                                   parameterLabels,
+                                   tuningParameters);
 
-        // to test the convergence criterion, we offer different criteria
+          penalizedFit_k = fit_k +
+                           penalty_k; // lasso part
 
-        if (control_.convCritInner == istaCrit)
-        {
-          // ISTA:
-          // The approximated fit based on the quadratic approximation
-          // h(parameters_k) := fit(parameters_k) +
-          // (parameters_k-parameters_kMinus1)*gradients_k^T +
-          // (L/2)*(parameters_k-parameters_kMinus1)^2 +
-          // penalty(parameters_k)
-          // is compared to the exact fit
-          parameterChange = parameters_k - parameters_kMinus1;
-          quadr = parameterChange * arma::trans(parameterChange);           // always positive
-          parchTimeGrad = parameterChange * arma::trans(gradients_kMinus1); // can be
-          // positive or negative
-
-          breakInner = penalizedFit_k <= (fit_kMinus1 +
-                                          parchTimeGrad(0, 0) +
-                                          (L_k / 2.0) * quadr(0, 0) +
-                                          penalty_k);
-        }
-        else if (control_.convCritInner == gistCrit)
-        {
+          if (!arma::is_finite(penalizedFit_k))
+            continue;
 
-          // GIST:
-          // the exact fit is compared to
-          // h(parameters_k) := fit(parameters_k) +
-          // penalty(parameters_kMinus1) +
-          // L*(sigma/2)*(parameters_k-parameters_kMinus1)^2
-          //
-          parameterChange = parameters_k - parameters_kMinus1;
-          quadr = parameterChange * arma::trans(parameterChange); // always positive
-
-          breakInner = penalizedFit_k <= (penalizedFit_kMinus1 -
-                                          L_k * (control_.sigma / 2.0) * quadr(0, 0));
-        }
+          // to test the convergence criterion, we offer different criteria
+
+          if (extrapolated)
+          {
+            // the quadratic approximation must hold at the extrapolated point
+            // (Beck & Teboulle, 2009; Remark 3.1):
+            // fit(parameters_k) + penalty(parameters_k) <= fit(y_k) +
+            // (parameters_k-y_k)*gradient_y_k^T + (L/2)*(parameters_k-y_k)^2 +
+            // penalty(parameters_k)
+            parameterChange = parameters_k - y_k;
+            quadr = arma::dot(parameterChange, parameterChange);      // always positive
+            parchTimeGrad = arma::dot(parameterChange, gradient_y_k); // can be
+            // positive or negative
+
+            breakInner = penalizedFit_k <= (fit_y_k +
+                                            parchTimeGrad +
+                                            (L_k / 2.0) * quadr +
+                                            penalty_k);
+
+            // monotone FISTA: the extrapolated step must not increase the penalized fit.
+            // Smaller steps stay close to y_k and do not help; fall back to the step from
+            // the current parameters instead.
+            if (breakInner && penalizedFit_k > penalizedFit_kMinus1)
+            {
+              breakInner = false;
+              break;
+            }
+          }
+          else if (control_.convCritInner == istaCrit)
+          {
+            // ISTA:
+            // The approximated fit based on the quadratic approximation
+            // h(parameters_k) := fit(parameters_k) +
+            // (parameters_k-parameters_kMinus1)*gradients_k^T +
+            // (L/2)*(parameters_k-parameters_kMinus1)^2 +
+            // penalty(parameters_k)
+            // is compared to the exact fit
+            parameterChange = parameters_k - parameters_kMinus1;
+            quadr = arma::dot(parameterChange, parameterChange);           // always positive
+            parchTimeGrad = arma::dot(parameterChange, gradients_kMinus1); // can be
+            // positive or negative
+
+            breakInner = penalizedFit_k <= (fit_kMinus1 +
+                                            parchTimeGrad +
+                                            (L_k / 2.0) * quadr +
+                                            penalty_k);
+          }
+          else if (control_.convCritInner == gistCrit)
+          {
+
+            // GIST:
+            // the exact fit is compared to
+            // h(parameters_k) := fit(parameters_k) +
+            // penalty(parameters_kMinus1) +
+            // L*(sigma/2)*(parameters_k-parameters_kMinus1)^2
+            //
+            parameterChange = parameters_k - parameters_kMinus1;
+            quadr = arma::dot(parameterChange, parameterChange); // always positive
+
+            breakInner = penalizedFit_k <= (penalizedFit_kMinus1 -
+                                            L_k * (control_.sigma / 2.0) * quadr);
+          }
+
+          if (breakInner)
+          {
+            // compute gradients at new position
+            gradients_k = (1.0 / control_.sampleSize) * cachedModel_.gradients(parameters_k,
+                                                                         parameterLabels) +
+                          penaltyGradients(smoothPenalty_,
+                                           parameters_k,
+                                           parameterLabels,
+                                           smoothTuningParameters); // ridge part
+
+            // if any of the gradients is non-finite, we can skip to a
+            // smaller step size
+            if (!arma::is_finite(gradients_k))
+            {
+              breakInner = false;
+              continue;
+            }
+
+            // if everything worked out fine, we break the inner iteration
+            break;
+
+          } // end break inner
+        }   // end inner iteration
 
         if (breakInner)
-        {
-          // compute gradients at new position
-          gradients_k = (1.0 / control_.sampleSize) * model_.gradients(parameters_k,
-                                                                       parameterLabels) +
-                        smoothPenalty_.getGradients(parameters_k,
-                                                    parameterLabels,
-                                                    smoothTuningParameters); // ridge part
-
-          // if any of the gradients is non-finite, we can skip to a
-          // smaller step size
-          if (!arma::is_finite(gradients_k))
-            continue;
-
-          // if everything worked out fine, we break the inner iteration
           break;
-
-        } // end break inner
-      }   // end inner iteration
+      } // end pass
 
       // print fit info
       if ((control_.verbose > 0) && (outer_iteration % control_.verbose == 0))
@@ -389,16 +636,33 @@ namespace lessSEM
         continue;
       }
 
-      gradients_k = (1.0 / control_.sampleSize) * model_.gradients(parameters_k,
+      gradients_k = (1.0 / control_.sampleSize) * cachedModel_.gradients(parameters_k,
                                                                    parameterLabels) +
-                    smoothPenalty_.getGradients(parameters_k,
-                                                parameterLabels,
-                                                smoothTuningParameters); // ridge part
+                    penaltyGradients(smoothPenalty_,
+                                     parameters_k,
+                                     parameterLabels,
+                                     smoothTuningParameters); // ridge part
 
       fits(outer_iteration + 1) = penalizedFit_k;
 
       // check outer breaking condition
-      breakOuter = std::abs(fits(outer_iteration + 1) - fits(outer_iteration)) < control_.breakOuter;
+      if (control_.breakKKT > 0.0)
+      {
+        if constexpr (hasSubgradients<penaltyClass, T>::value)
+          breakOuter = kktViolation(penalty_.getSubgradients(parameters_k,
+                                                             gradients_k,
+                                                             tuningParameters)) < control_.breakKKT;
+        else
+          error("breakKKT requires a penalty with the method getSubgradients.");
+      }
+      else
+      {
+        breakOuter = std::abs(fits(outer_iteration + 1) - fits(outer_iteration)) < control_.breakOuter;
+      }
+
+      // screen parameters and check the gap bound
+      if (screening_ && screening_->update(outer_iteration, parameters_k, gradients_k))
+        breakOuter = true;
 
       if (breakOuter)
       {
@@ -418,10 +682,10 @@ namespace lessSEM
         parameterChange = parameters_k - parameters_kMinus1;
         gradientChange = gradients_k - gradients_kMinus1;
 
-        quadr = (parameterChange)*arma::trans(parameterChange);
-        parchTimeGrad = parameterChange * arma::trans(gradientChange);
+        quadr = arma::dot(parameterChange, parameterChange);
+        parchTimeGrad = arma::dot(parameterChange, gradientChange);
 
-        L_kMinus1 = parchTimeGrad(0, 0) / quadr(0, 0);
+        L_kMinus1 = parchTimeGrad / quadr;
 
         if (L_kMinus1 < 1e-10 || L_kMinus1 > 1e10)
           L_kMinus1 = control_.L0;
@@ -449,6 +713,25 @@ namespace lessSEM
       parameters_kMinus2 = parameters_kMinus1;
       parameters_kMinus1 = parameters_k;
       gradients_kMinus1 = gradients_k;
+      momentumIteration++;
+
+      if (checkpointWriter_ && writeCheckpointNow(control_.checkpoint, outer_iteration))
+      {
+        checkpointWriter_->submit(
+            {checkpointIsta,
+             outer_iteration,
+             fit_kMinus1,
+             penalizedFit_kMinus1,
+             L_kMinus1,
+             parameters_kMinus1,
+             parameters_kMinus2,
+             gradients_kMinus1,
+             fits,
+             arma::mat(), // ista does not use a Hessian
+             getRandomState(),
+             screening_ ? screening_->results : screeningResults(),
+             momentumIteration});
+      }
     }
 
     fitResults fitResults_;
@@ -457,6 +740,16 @@ namespace lessSEM
     fitResults_.fit = control_.sampleSize * penalizedFit_k; // rescale for -2log-Likelihood
     fitResults_.fits = control_.sampleSize * fits;          // rescale for -2log-Likelihood
     fitResults_.parameterValues = parameters_k;
+    if (screening_)
+      fitResults_.screening = screening_->results;
+    if (control_.returnState)
+    {
+      fitResults_.state.L = L_k;
+      // if the optimizer converged, parameters_kMinus1 has not been updated
+      fitResults_.state.momentum = breakOuter ? parameters_k - parameters_kMinus1 : parameters_kMinus1 - parameters_kMinus2;
+      fitResults_.state.gradients = gradients_k;
+      fitResults_.state.activeSet = getActiveSet(parameters_k);
+    }
 
     return (fitResults_);
   }
@@ -465,7 +758,9 @@ namespace lessSEM
   //
   // Implements (variants of) the ista optimizer.
   //
-  // @param model_ the model object derived from the model class in model.h
+  // @tparam N number of parameters if known at compile time; 0 uses dynamic storage (see fixedSize.h)
+  // @param model_ the model object derived from the model class in model.h or any class
+  // with the methods fit and gradients (see traits.h)
   // @param startingValues an arma::rowvec numeric vector with starting values
   // @param parameterLabels a lessSEM::stringVector with labels for parameters
   // @parma proximalOperator_ a proximal operator for the penalty function
@@ -476,15 +771,20 @@ namespace lessSEM
   // @parma smoothTuningParameters tuning parameters for the smooth penalty function
   // @param control_ settings for the ista optimizer.
   // @return fit result
-  template <typename T, typename U> // T is the type of the tuning parameters
+  template <arma::uword N = 0,        // number of parameters if known at compile time (see fixedSize.h)
+            typename T, typename U, // T is the type of the tuning parameters
+            class modelClass,
+            class proximalOperatorClass,
+            class penaltyClass,
+            class smoothPenaltyClass>
   inline lessSEM::fitResults ista(
-      model &model_,
+      modelClass &model_,
       arma::rowvec startingValues,
       stringVector parameterLabels,
-      proximalOperator<T> &proximalOperator_, // proximalOperator takes the tuning parameters
+      proximalOperatorClass &proximalOperator_, // proximalOperator takes the tuning parameters
       // as input -> <T>
-      penalty<T> &penalty_,             // penalty takes the tuning parameters
-      smoothPenalty<U> &smoothPenalty_, // smoothPenalty takes the smooth tuning parameters
+      penaltyClass &penalty_,             // penalty takes the tuning parameters
+      smoothPenaltyClass &smoothPenalty_, // smoothPenalty takes the smooth tuning parameters
       // as input -> <U>
       const T &tuningParameters,       // tuning parameters are of type T
       const U &smoothTuningParameters, // tuning parameters are of type U
@@ -494,7 +794,7 @@ namespace lessSEM
     startingValuesNumVec.names() = parameterLabels;
 
     return (
-        ista(
+        ista<N>(
             model_,
             startingValuesNumVec,
             proximalOperator_, // proximalOperator takes the tuning parameters
@@ -0,0 +1,125 @@
+#ifndef FUSEDLASSO_ISTA_H
+#define FUSEDLASSO_ISTA_H
+#include "common_headers.h"
+
+#include "proximalOperator.h"
+#include "penalty.h"
+#include "ista_lasso.h"
+#include "fusedLasso.h" // for definition of tuning parameters
+
+namespace lessSEM
+{
+
+  /**
+   * @brief proximal operator for the fused lasso penalty function: total variation
+   * denoising of each chain (see fusedLasso.h) followed by soft thresholding of each parameter.
+   *
+   */
+  class proximalOperatorFusedLasso : public proximalOperator<tuningParametersFusedLasso>
+  {
+  public:
+    /**
+     * @brief update the parameter vector
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param parameterLabels parameter labels
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @return arma::rowvec updated parameters
+     */
+    arma::rowvec getParameters(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradientValues,
+                               const stringVector &parameterLabels,
+                               const double L,
+                               const tuningParametersFusedLasso &tuningParameters)
+        override
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (getParameters(parameterValues, gradientValues, L, tuningParameters));
+    }
+
+    /**
+     * @brief update the parameter vector. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @return arma::rowvec updated parameters
+     */
+    arma::rowvec getParameters(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradientValues,
+                               const double L,
+                               const tuningParametersFusedLasso &tuningParameters)
+    {
+
+      checkFusedChains(tuningParameters.chains, parameterValues.n_elem);
+      for (const arma::uvec &chain : tuningParameters.chains)
+      {
+        for (arma::uword k = 1; k < chain.n_elem; k++)
+        {
+          if (tuningParameters.weights.at(chain.at(k)) != tuningParameters.weights.at(chain.at(0)))
+            error("The weights must be identical for all parameters of a chain.");
+        }
+      }
+
+      arma::rowvec parameters_kp1 = parameterValues - gradientValues / L;
+
+      proximalFusedChains(parameters_kp1, tuningParameters.chains, tuningParameters.lambdaFused / L);
+
+      for (unsigned int p = 0; p < parameters_kp1.n_elem; p++)
+      {
+        parameters_kp1.at(p) = proximalLasso(parameters_kp1.at(p),
+                                             tuningParameters.lambda * tuningParameters.weights.at(p),
+                                             L);
+      }
+      return (parameters_kp1);
+    }
+  };
+
+  /**
+   * @brief fused lasso penalty for ista
+   *
+   * The penalty function is given by:
+   * $$p( x_j) = \lambda w_j |x_j| + \lambda_{fused} \sum_k |x_{c_{k+1}} - x_{c_k}|$$
+   * where the second sum is over successive parameters of the chains.
+   */
+  class penaltyFusedLasso : public penalty<tuningParametersFusedLasso>
+  {
+  public:
+    /**
+     * @brief Get the value of the penalty function
+     *
+     * @param parameterValues current parameter values
+     * @param parameterLabels names of the parameters
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const stringVector &parameterLabels,
+                    const tuningParametersFusedLasso &tuningParameters)
+        override
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (getValue(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the value of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const tuningParametersFusedLasso &tuningParameters)
+    {
+      return (tuningParameters.lambda * arma::accu(tuningParameters.weights % arma::abs(parameterValues)) +
+              tuningParameters.lambdaFused * fusedDifferences(parameterValues, tuningParameters.chains));
+    }
+  };
+
+} // end namespace
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef GROUPLASSO_ISTA_H
+#define GROUPLASSO_ISTA_H
+#include "common_headers.h"
+
+#include "proximalOperator.h"
+#include "penalty.h"
+#include "groupLasso.h" // for definition of tuning parameters
+
+namespace lessSEM
+{
+
+  /**
+   * @brief proximal operator for the (sparse) group lasso penalty function. All parameters
+   * of a block are updated at once (see groupLasso.h).
+   *
+   */
+  class proximalOperatorGroupLasso : public proximalOperator<tuningParametersGroupLasso>
+  {
+  public:
+    /**
+     * @brief update the parameter vector
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param parameterLabels parameter labels
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @return arma::rowvec updated parameters
+     */
+    arma::rowvec getParameters(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradientValues,
+                               const stringVector &parameterLabels,
+                               const double L,
+                               const tuningParametersGroupLasso &tuningParameters)
+        override
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (getParameters(parameterValues, gradientValues, L, tuningParameters));
+    }
+
+    /**
+     * @brief update the parameter vector. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @return arma::rowvec updated parameters
+     */
+    arma::rowvec getParameters(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradientValues,
+                               const double L,
+                               const tuningParametersGroupLasso &tuningParameters)
+    {
+
+      tuningParameters.checkBlocks(parameterValues.n_elem);
+
+      const arma::rowvec u_k = parameterValues - gradientValues / L;
+      arma::rowvec parameters_kp1(parameterValues.n_elem);
+
+      for (unsigned int b = 0; b < tuningParameters.numberBlocks(); b++)
+      {
+        const arma::uword first = tuningParameters.blockFirst(b);
+        const arma::uword last = tuningParameters.blockLast(b);
+        parameters_kp1.cols(first, last) =
+            proximalSparseGroupLasso(u_k.cols(first, last),
+                                     tuningParameters.alpha * tuningParameters.lambda *
+                                         tuningParameters.weights.cols(first, last) / L,
+                                     (1.0 - tuningParameters.alpha) * tuningParameters.lambda *
+                                         tuningParameters.groupWeights.at(b) / L);
+      }
+      return (parameters_kp1);
+    }
+  };
+
+  /**
+   * @brief (sparse) group lasso penalty for ista
+   *
+   */
+  class penaltyGroupLasso : public penalty<tuningParametersGroupLasso>
+  {
+  public:
+    /**
+     * @brief Get the value of the penalty function
+     *
+     * @param parameterValues current parameter values
+     * @param parameterLabels names of the parameters
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const stringVector &parameterLabels,
+                    const tuningParametersGroupLasso &tuningParameters)
+        override
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (getValue(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the value of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const tuningParametersGroupLasso &tuningParameters)
+    {
+      return (sparseGroupLassoValue(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the subgradients of the penalized fit function (see groupLasso.h)
+     *
+     * @param parameterValues current parameter values
+     * @param gradients gradients of the smooth part of the fit function
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
+                                 const arma::rowvec &gradients,
+                                 const tuningParametersGroupLasso &tuningParameters)
+        override
+    {
+      return (sparseGroupLassoSubgradients(parameterValues, gradients, tuningParameters));
+    }
+  };
+
+} // end namespace
+
+#endif
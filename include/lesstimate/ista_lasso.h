@@ -1,5 +1,6 @@
 #ifndef LASSO_H
 #define LASSO_H
+#include <vector>
 #include "common_headers.h"
 
 #include "proximalOperator.h"
@@ -9,6 +10,24 @@
 namespace lessSEM
 {
 
+  /**
+   * @brief proximal operator of the lasso penalty for a single parameter (soft thresholding)
+   *
+   * @param u_k parameter value after the gradient step (x - g/L)
+   * @param lambda_i parameter specific lambda (alpha * lambda * weight)
+   * @param L step size
+   * @return double
+   */
+  inline double proximalLasso(const double u_k,
+                              const double lambda_i,
+                              const double L)
+  {
+    int sign = (u_k > 0);
+    if (u_k < 0)
+      sign = -1;
+    return (sign * std::max(0.0, std::abs(u_k) - lambda_i / L));
+  }
+
   /**
    * @brief proximal operator for the lasso penalty function
    *
@@ -34,8 +53,24 @@ namespace lessSEM
                                const tuningParametersEnet &tuningParameters)
         override
     {
+      static_cast<void>(parameterLabels); // is unused
+      return (getParameters(parameterValues, gradientValues, L, tuningParameters));
+    }
 
-      static_cast<void>(parameterLabels); // is unused, but necessary for the interface to be consistent
+    /**
+     * @brief update the parameter vector. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @return arma::rowvec updated parameters
+     */
+    arma::rowvec getParameters(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradientValues,
+                               const double L,
+                               const tuningParametersEnet &tuningParameters)
+    {
 
       arma::rowvec u_k = parameterValues - gradientValues / L;
 
@@ -43,7 +78,6 @@ namespace lessSEM
       parameters_kp1.fill(arma::datum::nan);
 
       double lambda_i;
-      int sign;
       for (unsigned int p = 0; p < parameterValues.n_elem; p++)
       {
 
@@ -51,11 +85,40 @@ namespace lessSEM
                    tuningParameters.lambda *
                    tuningParameters.weights.at(p);
 
-        sign = (u_k.at(p) > 0);
-        if (u_k.at(p) < 0)
-          sign = -1;
-        parameters_kp1.at(p) = sign *
-                               std::max(0.0, std::abs(u_k.at(p)) - lambda_i / L);
+        parameters_kp1.at(p) = proximalLasso(u_k.at(p), lambda_i, L);
+      }
+      return parameters_kp1;
+    }
+
+    /**
+     * @brief update the parameter vector, skipping the parameters removed by the safe
+     * screening (see screening.h). These parameters are set to zero.
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @param screened screened.at(p) is true if parameter p was removed by the screening
+     * @return arma::rowvec updated parameters
+     */
+    arma::rowvec getParameters(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradientValues,
+                               const double L,
+                               const tuningParametersEnet &tuningParameters,
+                               const std::vector<bool> &screened)
+    {
+      arma::rowvec parameters_kp1(parameterValues.n_elem, arma::fill::zeros);
+
+      for (unsigned int p = 0; p < parameterValues.n_elem; p++)
+      {
+        if (screened.at(p))
+          continue;
+
+        const double lambda_i = tuningParameters.alpha *
+                                tuningParameters.lambda *
+                                tuningParameters.weights.at(p);
+
+        parameters_kp1.at(p) = proximalLasso(parameterValues.at(p) - gradientValues.at(p) / L, lambda_i, L);
       }
       return parameters_kp1;
     }
@@ -89,8 +152,20 @@ namespace lessSEM
                     const tuningParametersEnet &tuningParameters)
         override
     {
+      static_cast<void>(parameterLabels); // is unused
+      return (getValue(parameterValues, tuningParameters));
+    }
 
-      static_cast<void>(parameterLabels); // is unused, but necessary for the interface to be consistent
+    /**
+     * @brief Get the value of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const tuningParametersEnet &tuningParameters)
+    {
 
       double penaltyValue = 0.0;
       double lambda_i;
@@ -109,69 +184,31 @@ namespace lessSEM
     }
 
     /**
-     * @brief compute subgradients of the penalty function
+     * @brief Get the subgradients of the penalized fit function (see subgradients.h)
      *
      * @param parameterValues current parameter values
-     * @param parameterLabels names of the parameters
+     * @param gradients gradients of the smooth part of the fit function
      * @param tuningParameters values of the tuning parmameters
-     * @return double
+     * @return arma::rowvec
      */
     arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
                                  const arma::rowvec &gradients,
                                  const tuningParametersEnet &tuningParameters)
+      override
     {
 
       arma::rowvec subgradients = gradients;
-      double lower, upper;
-      int sign;
 
       for (unsigned int p = 0; p < parameterValues.n_elem; p++)
       {
-
         // if not regularized: nothing to do here
         if (tuningParameters.weights.at(p) == 0)
           continue;
 
-        // check if parameter is at non-differentiable place:
-        if (parameterValues.at(p) == 0)
-        {
-          lower = -tuningParameters.weights.at(p) *
-                  tuningParameters.alpha *
-                  tuningParameters.lambda;
-          // note: we don't add the ridge part here, because this part is already incorporated
-          // in the differentiable part in gradients
-          upper = -lower;
-
-          if (lower < gradients.at(p))
-          {
-            subgradients.at(p) = gradients.at(p) + upper;
-            continue;
-          }
-          else if (gradients.at(p) > upper)
-          {
-            subgradients.at(p) = gradients.at(p) + lower;
-            continue;
-          }
-          else
-          {
-            error("Error in subgradient computation");
-          }
-        }
-        else
-        {
-          // parameter is regularized, but not zeroed
-          sign = (parameterValues.at(p) > 0);
-          if (parameterValues.at(p) < 0)
-            sign = -1;
-
-          subgradients.at(p) = gradients.at(p) +
-                               sign *
-                                   tuningParameters.weights.at(p) *
-                                   tuningParameters.alpha *
-                                   tuningParameters.lambda;
-        }
-
-      } // end for parameter
+        subgradients.at(p) = subgradientLasso(parameterValues.at(p),
+                                              gradients.at(p),
+                                              tuningParameters.weights.at(p) * tuningParameters.alpha * tuningParameters.lambda);
+      }
 
       return (subgradients);
     }
@@ -45,6 +45,55 @@ namespace lessSEM
         std::log(1.0 + std::abs(par) / theta));
   }
 
+  /**
+   * @brief proximal operator of the lsp penalty for a single parameter
+   *
+   * @param u_k parameter value after the gradient step (x - g/L)
+   * @param lambda lambda tuning parameter value
+   * @param theta theta tuning parameter value
+   * @param L step size
+   * @return double
+   */
+  inline double proximalLsp(const double u_k,
+                            const double lambda,
+                            const double theta,
+                            const double L)
+  {
+    const double abs_u_k = std::abs(u_k);
+    double x = 0.0;
+
+    const double tempValue = std::pow(L, 2) *
+                                 std::pow(abs_u_k - theta, 2) -
+                             4.0 * L * (lambda - L * abs_u_k * theta);
+
+    if (tempValue >= 0)
+    {
+      double C[3] = {0.0,
+                     std::max((L * (abs_u_k - theta) + std::sqrt(tempValue)) / (2 * L), 0.0),
+                     std::max((L * (abs_u_k - theta) - std::sqrt(tempValue)) / (2 * L), 0.0)};
+      double xVec[3];
+
+      int best = 0;
+      for (int c = 0; c < 3; c++)
+      {
+        xVec[c] = .5 * std::pow(C[c] - abs_u_k, 2) +
+                  (1.0 / L) *
+                      lambda *
+                      std::log(1.0 + C[c] / theta);
+        if (xVec[c] < xVec[best])
+          best = c;
+      }
+
+      x = C[best];
+    }
+
+    int sign = (u_k > 0);
+    if (u_k < 0)
+      sign = -1;
+
+    return (sign * x);
+  }
+
   /**
    * @brief proximal operator for the lsp penalty function
    *
@@ -70,20 +119,30 @@ namespace lessSEM
                                const tuningParametersLSP &tuningParameters)
         override
     {
+      static_cast<void>(parameterLabels); // is unused
+      return (getParameters(parameterValues, gradientValues, L, tuningParameters));
+    }
 
-      static_cast<void>(parameterLabels); // is unused, but necessary for the interface to be consistent
+    /**
+     * @brief update the parameter vector. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @return arma::rowvec updated parameters
+     */
+    arma::rowvec getParameters(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradientValues,
+                               const double L,
+                               const tuningParametersLSP &tuningParameters)
+    {
 
       arma::rowvec u_k = parameterValues - gradientValues / L;
 
       arma::rowvec parameters_kp1(parameterValues.n_elem);
       parameters_kp1.fill(arma::datum::nan);
 
-      double x, abs_u_k;
-      std::vector<double> C(3, 0.0);
-      std::vector<double> xVec(3, 0.0);
-      double tempValue;
-      int sign;
-
       for (unsigned int p = 0; p < parameterValues.n_elem; p++)
       {
         if (tuningParameters.weights.at(p) == 0.0)
@@ -93,44 +152,10 @@ namespace lessSEM
           continue;
         }
 
-        abs_u_k = std::abs(u_k.at(p));
-
-        tempValue = std::pow(L, 2) *
-                        std::pow(abs_u_k - tuningParameters.theta, 2) -
-                    4.0 * L * (tuningParameters.lambda - L * abs_u_k * tuningParameters.theta);
-
-        if (tempValue >= 0)
-        {
-          C.at(1) = std::max(
-              (L * (abs_u_k - tuningParameters.theta) + std::sqrt(tempValue)) / (2 * L),
-              0.0);
-          C.at(2) = std::max(
-              (L * (abs_u_k - tuningParameters.theta) - std::sqrt(tempValue)) / (2 * L),
-              0.0);
-
-          for (int c = 0; c < 3; c++)
-          {
-
-            xVec.at(c) = .5 * std::pow(C.at(c) - abs_u_k, 2) +
-                         (1.0 / L) *
-                             tuningParameters.lambda *
-                             std::log(1.0 + C.at(c) / tuningParameters.theta);
-          }
-
-          x = C.at(std::distance(std::begin(xVec),
-                                 std::min_element(xVec.begin(), xVec.end())));
-        }
-        else
-        {
-
-          x = 0.0;
-        }
-
-        sign = (u_k.at(p) > 0);
-        if (u_k.at(p) < 0)
-          sign = -1;
-
-        parameters_kp1.at(p) = sign * x;
+        parameters_kp1.at(p) = proximalLsp(u_k.at(p),
+                                           tuningParameters.lambda,
+                                           tuningParameters.theta,
+                                           L);
       }
       return parameters_kp1;
     }
@@ -166,8 +191,20 @@ namespace lessSEM
                     const tuningParametersLSP &tuningParameters)
         override
     {
+      static_cast<void>(parameterLabels); // is unused
+      return (getValue(parameterValues, tuningParameters));
+    }
 
-      static_cast<void>(parameterLabels); // is unused, but necessary for the interface to be consistent
+    /**
+     * @brief Get the value of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const tuningParametersLSP &tuningParameters)
+    {
 
       double penaltyValue = 0.0;
 
@@ -185,6 +222,37 @@ namespace lessSEM
 
       return penaltyValue;
     }
+
+    /**
+     * @brief Get the subgradients of the penalized fit function (see subgradients.h)
+     *
+     * @param parameterValues current parameter values
+     * @param gradients gradients of the smooth part of the fit function
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
+                                 const arma::rowvec &gradients,
+                                 const tuningParametersLSP &tuningParameters)
+        override
+    {
+
+      arma::rowvec subgradients = gradients;
+
+      for (unsigned int p = 0; p < parameterValues.n_elem; p++)
+      {
+        // if not regularized: nothing to do here
+        if (tuningParameters.weights.at(p) == 0.0)
+          continue;
+
+        subgradients.at(p) = subgradientLsp(parameterValues.at(p),
+                                            gradients.at(p),
+                                            tuningParameters.lambda,
+                                            tuningParameters.theta);
+      }
+
+      return (subgradients);
+    }
   };
 
 }
@@ -66,6 +66,63 @@ namespace lessSEM
     return 0.0;
   }
 
+  /**
+   * @brief proximal operator of the mcp penalty for a single parameter
+   *
+   * @param u_k parameter value after the gradient step (x - g/L)
+   * @param lambda lambda tuning parameter value
+   * @param theta theta tuning parameter value
+   * @param L step size
+   * @return double
+   */
+  inline double proximalMcp(const double u_k,
+                            const double lambda,
+                            const double theta,
+                            const double L)
+  {
+    double x[4];
+    double h[4];
+    const double thetaXlambda = theta * lambda;
+
+    int sign = (u_k > 0);
+    if (u_k < 0)
+      sign = -1;
+
+    const double v = 1.0 - 1.0 / (L * theta); // used repeatedly;
+    // only computed for convenience
+
+    const double abs_u_k = std::abs(u_k);
+
+    // Assume that x = 0
+    x[0] = 0.0;
+
+    // Assume that x > 0 and x <= theta*lambda
+    x[1] = std::min(
+        thetaXlambda,
+        u_k / v - 1.0 / (L * v) * lambda);
+
+    // Assume that x < 0 and x => - theta*lambda
+    x[2] = std::max(
+        -thetaXlambda,
+        u_k / v + 1.0 / (L * v) * lambda);
+
+    // Assume that |x| >  theta*lambda
+    x[3] = sign * std::max(
+                      thetaXlambda,
+                      abs_u_k);
+
+    int best = 0;
+    for (int i = 0; i < 4; i++)
+    {
+      h[i] = .5 * std::pow(x[i] - u_k, 2) + // distance between parameters
+             (1.0 / L) * mcpPenalty(x[i], lambda, theta);
+      if (h[i] < h[best])
+        best = i;
+    }
+
+    return (x[best]);
+  }
+
   /**
    * @brief proximal operator for the mcp penalty function
    *
@@ -91,20 +148,30 @@ namespace lessSEM
                                const tuningParametersMcp &tuningParameters)
         override
     {
+      static_cast<void>(parameterLabels); // is unused
+      return (getParameters(parameterValues, gradientValues, L, tuningParameters));
+    }
 
-      static_cast<void>(parameterLabels); // is unused, but necessary for the interface to be consistent
+    /**
+     * @brief update the parameter vector. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @return arma::rowvec updated parameters
+     */
+    arma::rowvec getParameters(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradientValues,
+                               const double L,
+                               const tuningParametersMcp &tuningParameters)
+    {
 
       arma::rowvec u_k = parameterValues - gradientValues / L;
 
       arma::rowvec parameters_kp1(parameterValues.n_elem);
       parameters_kp1.fill(arma::datum::nan);
 
-      double abs_u_k, v;
-      std::vector<double> x(4, 0.0);
-      std::vector<double> h(4, 0.0);
-      int sign;
-      double thetaXlambda = tuningParameters.theta * tuningParameters.lambda;
-
       for (unsigned int p = 0; p < parameterValues.n_elem; p++)
       {
 
@@ -115,43 +182,10 @@ namespace lessSEM
           continue;
         }
 
-        sign = (u_k.at(p) > 0);
-        if (u_k.at(p) < 0)
-          sign = -1;
-
-        v = 1.0 - 1.0 / (L * tuningParameters.theta); // used repeatedly;
-        // only computed for convenience
-
-        abs_u_k = std::abs(u_k.at(p));
-
-        // Assume that x = 0
-        x.at(0) = 0.0;
-
-        // Assume that x > 0 and x <= theta*lambda
-        x.at(1) = std::min(
-            thetaXlambda,
-            u_k.at(p) / v - 1.0 / (L * v) * tuningParameters.lambda);
-
-        // Assume that x < 0 and x => - theta*lambda
-        x.at(2) = std::max(
-            -thetaXlambda,
-            u_k.at(p) / v + 1.0 / (L * v) * tuningParameters.lambda);
-
-        // Assume that |x| >  theta*lambda
-        x.at(3) = sign * std::max(
-                             thetaXlambda,
-                             abs_u_k);
-
-        for (int i = 0; i < 4; i++)
-        {
-          h.at(i) = .5 * std::pow(x.at(i) - u_k.at(p), 2) + // distance between parameters
-                    (1.0 / L) * mcpPenalty(x.at(i),
+        parameters_kp1.at(p) = proximalMcp(u_k.at(p),
                                            tuningParameters.lambda,
-                                           tuningParameters.theta);
-        }
-
-        parameters_kp1.at(p) = x.at(std::distance(std::begin(h),
-                                                  std::min_element(h.begin(), h.end())));
+                                           tuningParameters.theta,
+                                           L);
       }
       return parameters_kp1;
     }
@@ -188,8 +222,20 @@ namespace lessSEM
                     const tuningParametersMcp &tuningParameters)
         override
     {
+      static_cast<void>(parameterLabels); // is unused
+      return (getValue(parameterValues, tuningParameters));
+    }
 
-      static_cast<void>(parameterLabels); // is unused, but necessary for the interface to be consistent
+    /**
+     * @brief Get the value of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const tuningParametersMcp &tuningParameters)
+    {
 
       double penaltyValue = 0.0;
 
@@ -208,6 +254,37 @@ namespace lessSEM
 
       return penaltyValue;
     }
+
+    /**
+     * @brief Get the subgradients of the penalized fit function (see subgradients.h)
+     *
+     * @param parameterValues current parameter values
+     * @param gradients gradients of the smooth part of the fit function
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
+                                 const arma::rowvec &gradients,
+                                 const tuningParametersMcp &tuningParameters)
+        override
+    {
+
+      arma::rowvec subgradients = gradients;
+
+      for (unsigned int p = 0; p < parameterValues.n_elem; p++)
+      {
+        // if not regularized: nothing to do here
+        if (tuningParameters.weights.at(p) == 0.0)
+          continue;
+
+        subgradients.at(p) = subgradientMcp(parameterValues.at(p),
+                                            gradients.at(p),
+                                            tuningParameters.lambda,
+                                            tuningParameters.theta);
+      }
+
+      return (subgradients);
+    }
   };
 
 }
@@ -11,6 +11,7 @@
 #include "ista_lsp.h"
 #include "ista_mcp.h"
 #include "ista_scad.h"
+#include "fusedLasso.h"
 
 // The proximal operator for this penalty function has been developed by
 // Gong, P., Zhang, C., Lu, Z., Huang, J., & Ye, J. (2013).
@@ -39,8 +40,42 @@ namespace lessSEM
     arma::rowvec alpha;          ///> paramter-specific alpha value
     arma::rowvec weights;        ///> paramter-specific weights
     std::vector<penaltyType> pt; ///> penalty type
+    std::vector<arma::uvec> fusedChains; ///> optional chains of parameters whose successive differences are penalized (see fusedLasso.h)
+    double lambdaFused = 0.0;            ///> lambda value of the differences in fusedChains
   };
 
+  /**
+   * @brief checks that the parameters of each fused chain are either not penalized or
+   * have a lasso penalty with identical lambda, alpha, and weight. Only then is the
+   * proximal operator of the fused chain followed by that of the single parameters exact.
+   *
+   * @param tuningParameters tuning parameters of the mixed penalty
+   * @param numberParameters number of parameters
+   */
+  inline void checkMixedFusedChains(const tuningParametersMixedPenalty &tuningParameters,
+                                    const unsigned int numberParameters)
+  {
+    checkFusedChains(tuningParameters.fusedChains, numberParameters);
+    if (tuningParameters.pt.size() != numberParameters)
+      error("pt must have one element for each parameter when using fusedChains.");
+
+    for (const arma::uvec &chain : tuningParameters.fusedChains)
+    {
+      for (arma::uword k = 0; k < chain.n_elem; k++)
+      {
+        const arma::uword p = chain.at(k);
+        const arma::uword first = chain.at(0);
+        if (tuningParameters.pt.at(p) != penaltyType::none && tuningParameters.pt.at(p) != penaltyType::lasso)
+          error("Parameters in fusedChains can only use the penalty types none and lasso.");
+        if (tuningParameters.pt.at(p) != tuningParameters.pt.at(first) ||
+            (tuningParameters.pt.at(p) == penaltyType::lasso &&
+             tuningParameters.alpha.at(p) * tuningParameters.lambda.at(p) * tuningParameters.weights.at(p) !=
+                 tuningParameters.alpha.at(first) * tuningParameters.lambda.at(first) * tuningParameters.weights.at(first)))
+          error("All parameters of a chain in fusedChains must have the same penalty.");
+      }
+    }
+  }
+
 /**
  * @brief base class for proximal operator for the mixed penalty function
  *
@@ -54,7 +89,7 @@ public:
                              const arma::rowvec &gradientValues,
                              const stringVector &parameterLabels,
                              const double L,
-                             const tuningParametersMixedPenalty &tuningParameters) = 0;
+                             const tuningParametersMixedPenalty &tuningParameters) const = 0;
 };
 
 class proximalOperatorMixedNone: public proximalOperatorMixedBase{
@@ -63,7 +98,7 @@ public:
                              const arma::rowvec &gradientValues,
                              const stringVector &parameterLabels,
                              const double L,
-                             const tuningParametersMixedPenalty &tuningParameters) override{
+                             const tuningParametersMixedPenalty &tuningParameters) const override{
                               static_cast<void>(parameterLabels); // is unused, but necessary for the interface to be consistent
                               static_cast<void>(tuningParameters); // is unused, but necessary for the interface to be consistent
                                arma::rowvec u_k = parameterValues - gradientValues / L;
@@ -78,7 +113,9 @@ public:
                              const arma::rowvec &gradientValues,
                              const stringVector &parameterLabels,
                              const double L,
-                             const tuningParametersMixedPenalty &tuningParameters) override{
+                             const tuningParametersMixedPenalty &tuningParameters) const override{
+                               proximalOperatorCappedL1 proxOp;
+                               tuningParametersCappedL1 tp;
                                
                                tp.alpha = tuningParameters.alpha(0);
                                tp.lambda = tuningParameters.lambda(0);
@@ -95,9 +132,6 @@ public:
                                  )
                                );
                              }
-private: 
-  tuningParametersCappedL1 tp;
-  proximalOperatorCappedL1 proxOp;
 };
 
 class proximalOperatorMixedLasso: public proximalOperatorMixedBase{
@@ -106,7 +140,9 @@ public:
                              const arma::rowvec &gradientValues,
                              const stringVector &parameterLabels,
                              const double L,
-                             const tuningParametersMixedPenalty &tuningParameters) override{
+                             const tuningParametersMixedPenalty &tuningParameters) const override{
+                               proximalOperatorLasso proxOp;
+                               tuningParametersEnet tp;
                                
                                tp.alpha = tuningParameters.alpha(0);
                                tp.lambda = tuningParameters.lambda(0);
@@ -122,9 +158,6 @@ public:
                                )
                                );
                              }
-private: 
-  tuningParametersEnet tp;
-  proximalOperatorLasso proxOp;
 };
 
 class proximalOperatorMixedLsp: public proximalOperatorMixedBase{
@@ -133,7 +166,9 @@ public:
                              const arma::rowvec &gradientValues,
                              const stringVector &parameterLabels,
                              const double L,
-                             const tuningParametersMixedPenalty &tuningParameters) override{
+                             const tuningParametersMixedPenalty &tuningParameters) const override{
+                               proximalOperatorLSP proxOp;
+                               tuningParametersLSP tp;
                                
                                tp.lambda = tuningParameters.lambda(0);
                                tp.theta = tuningParameters.theta(0);
@@ -149,9 +184,6 @@ public:
                                  )
                                );
                              }
-private: 
-  tuningParametersLSP tp;
-  proximalOperatorLSP proxOp;
 };
 
 class proximalOperatorMixedMcp: public proximalOperatorMixedBase{
@@ -160,7 +192,9 @@ public:
                              const arma::rowvec &gradientValues,
                              const stringVector &parameterLabels,
                              const double L,
-                             const tuningParametersMixedPenalty &tuningParameters) override{
+                             const tuningParametersMixedPenalty &tuningParameters) const override{
+                               proximalOperatorMcp proxOp;
+                               tuningParametersMcp tp;
                                
                                tp.lambda = tuningParameters.lambda(0);
                                tp.theta = tuningParameters.theta(0);
@@ -176,9 +210,6 @@ public:
                                  )
                                );
                              }
-private: 
-  tuningParametersMcp tp;
-  proximalOperatorMcp proxOp;
 };
 
 
@@ -188,7 +219,9 @@ public:
                              const arma::rowvec &gradientValues,
                              const stringVector &parameterLabels,
                              const double L,
-                             const tuningParametersMixedPenalty &tuningParameters) override{
+                             const tuningParametersMixedPenalty &tuningParameters) const override{
+                               proximalOperatorScad proxOp;
+                               tuningParametersScad tp;
                                
                                tp.lambda = tuningParameters.lambda(0);
                                tp.theta = tuningParameters.theta(0);
@@ -204,9 +237,6 @@ public:
                                  )
                                );
                              }
-private: 
-  tuningParametersScad tp;
-  proximalOperatorScad proxOp;
 };
 
 class proximalOperatorMixedPenalty: public proximalOperator<tuningParametersMixedPenalty> {
@@ -220,10 +250,23 @@ public:
      const double L,
      const tuningParametersMixedPenalty &tuningParameters) override {
         
+       // per-call workspace; the operator itself holds no state and can be
+       // shared between threads
+       tuningParametersMixedPenalty tpSinglePenalty;
        arma::rowvec parameterValue{0};
        arma::rowvec gradientValue{0};
        arma::rowvec parameters_kp1 = parameterValues;
        
+       // fused chains: the differences are shrunken first; the gradient step is then
+       // already part of the parameter values passed to the single proximal operators
+       arma::rowvec u_k;
+       const bool fused = !tuningParameters.fusedChains.empty();
+       if(fused){
+         checkMixedFusedChains(tuningParameters, parameterValues.n_elem);
+         u_k = parameterValues - gradientValues / L;
+         proximalFusedChains(u_k, tuningParameters.fusedChains, tuningParameters.lambdaFused / L);
+       }
+       
        int it = 0;
        for(auto& proxOp: proxOps){
          tpSinglePenalty.alpha = tuningParameters.alpha(it);
@@ -231,8 +274,8 @@ public:
          tpSinglePenalty.theta = tuningParameters.theta(it);
          tpSinglePenalty.weights = tuningParameters.weights(it);
          
-         parameterValue(0) = parameterValues(it);
-         gradientValue(0) = gradientValues(it);
+         parameterValue(0) = fused ? u_k(it) : parameterValues(it);
+         gradientValue(0) = fused ? 0.0 : gradientValues(it);
          
          parameters_kp1(it) = arma::as_scalar(proxOp->getParameters(
                                                         parameterValue,
@@ -247,9 +290,6 @@ public:
        return(parameters_kp1);
                                        
      }
-  
-private:
-  tuningParametersMixedPenalty tpSinglePenalty;
 };
 
 /**
@@ -259,6 +299,8 @@ private:
 class penaltyMixedPenaltyBase
 {
 public:
+  virtual ~penaltyMixedPenaltyBase() = default;
+
   /**
    * @brief Get the value of the penalty function
    *
@@ -269,19 +311,39 @@ public:
    */
   virtual double getValue(const arma::rowvec &parameterValues,
                   const stringVector &parameterLabels,
-                  const tuningParametersMixedPenalty &tuningParameters) = 0;
+                  const tuningParametersMixedPenalty &tuningParameters) const = 0;
+  
+  /**
+   * @brief Get the subgradients of the penalized fit function (see subgradients.h)
+   *
+   * @param parameterValues current parameter values
+   * @param gradients gradients of the smooth part of the fit function
+   * @param tuningParameters values of the tuning parmameters
+   * @return arma::rowvec
+   */
+  virtual arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
+                                       const arma::rowvec &gradients,
+                                       const tuningParametersMixedPenalty &tuningParameters) const = 0;
 };
 
 class penaltyMixedNone: public penaltyMixedPenaltyBase{
 public:
   double getValue(const arma::rowvec &parameterValues,
                         const stringVector &parameterLabels,
-                        const tuningParametersMixedPenalty &tuningParameters) override{
+                        const tuningParametersMixedPenalty &tuningParameters) const override{
                           static_cast<void>(parameterValues); // is unused, but necessary for the interface to be consistent
                           static_cast<void>(parameterLabels); // is unused, but necessary for the interface to be consistent
                           static_cast<void>(tuningParameters); // is unused, but necessary for the interface to be consistent
                                return(0.0);
                              }
+  
+  arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradients,
+                               const tuningParametersMixedPenalty &tuningParameters) const override{
+                                 static_cast<void>(parameterValues); // is unused, but necessary for the interface to be consistent
+                                 static_cast<void>(tuningParameters); // is unused, but necessary for the interface to be consistent
+                                 return(gradients);
+                               }
 };
 
 
@@ -289,7 +351,9 @@ class penaltyMixedCappedL1: public penaltyMixedPenaltyBase{
 public:
   double getValue(const arma::rowvec &parameterValues,
                   const stringVector &parameterLabels,
-                  const tuningParametersMixedPenalty &tuningParameters) override{
+                  const tuningParametersMixedPenalty &tuningParameters) const override{
+                               penaltyCappedL1 pen;
+                               tuningParametersCappedL1 tp;
                                
                                tp.alpha = tuningParameters.alpha(0);
                                tp.lambda = tuningParameters.lambda(0);
@@ -304,16 +368,35 @@ public:
                                  )
                                );
                              }
-private: 
-  tuningParametersCappedL1 tp;
-  penaltyCappedL1 pen;
+  
+  arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradients,
+                               const tuningParametersMixedPenalty &tuningParameters) const override{
+                                 penaltyCappedL1 pen;
+                                 tuningParametersCappedL1 tp;
+                                 
+                                 tp.alpha = tuningParameters.alpha(0);
+                                 tp.lambda = tuningParameters.lambda(0);
+                                 tp.theta = tuningParameters.theta(0);
+                                 tp.weights = tuningParameters.weights(0);
+                                 
+                                 return(
+                                   pen.getSubgradients(
+                                     parameterValues,
+                                     gradients,
+                                     tp
+                                   )
+                                 );
+                               }
 };
 
 class penaltyMixedLasso: public penaltyMixedPenaltyBase{
 public:
   double getValue(const arma::rowvec &parameterValues,
                   const stringVector &parameterLabels,
-                  const tuningParametersMixedPenalty &tuningParameters) override{
+                  const tuningParametersMixedPenalty &tuningParameters) const override{
+                               penaltyLASSO pen;
+                               tuningParametersEnet tp;
                                
                                tp.alpha = tuningParameters.alpha(0);
                                tp.lambda = tuningParameters.lambda(0);
@@ -327,16 +410,34 @@ public:
                                  )
                                );
                              }
-private: 
-  tuningParametersEnet tp;
-  penaltyLASSO pen;
+  
+  arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradients,
+                               const tuningParametersMixedPenalty &tuningParameters) const override{
+                                 penaltyLASSO pen;
+                                 tuningParametersEnet tp;
+                                 
+                                 tp.alpha = tuningParameters.alpha(0);
+                                 tp.lambda = tuningParameters.lambda(0);
+                                 tp.weights = tuningParameters.weights(0);
+                                 
+                                 return(
+                                   pen.getSubgradients(
+                                     parameterValues,
+                                     gradients,
+                                     tp
+                                   )
+                                 );
+                               }
 };
 
 class penaltyMixedLsp: public penaltyMixedPenaltyBase{
 public:
   double getValue(const arma::rowvec &parameterValues,
                   const stringVector &parameterLabels,
-                  const tuningParametersMixedPenalty &tuningParameters) override{
+                  const tuningParametersMixedPenalty &tuningParameters) const override{
+                               penaltyLSP pen;
+                               tuningParametersLSP tp;
                                
                                tp.lambda = tuningParameters.lambda(0);
                                tp.theta = tuningParameters.theta(0);
@@ -350,16 +451,34 @@ public:
                                  )
                                );
                              }
-private: 
-  tuningParametersLSP tp;
-  penaltyLSP pen;
+  
+  arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradients,
+                               const tuningParametersMixedPenalty &tuningParameters) const override{
+                                 penaltyLSP pen;
+                                 tuningParametersLSP tp;
+                                 
+                                 tp.lambda = tuningParameters.lambda(0);
+                                 tp.theta = tuningParameters.theta(0);
+                                 tp.weights = tuningParameters.weights(0);
+                                 
+                                 return(
+                                   pen.getSubgradients(
+                                     parameterValues,
+                                     gradients,
+                                     tp
+                                   )
+                                 );
+                               }
 };
 
 class penaltyMixedMcp: public penaltyMixedPenaltyBase{
 public:
   double getValue(const arma::rowvec &parameterValues,
                   const stringVector &parameterLabels,
-                  const tuningParametersMixedPenalty &tuningParameters) override{
+                  const tuningParametersMixedPenalty &tuningParameters) const override{
+                               penaltyMcp pen;
+                               tuningParametersMcp tp;
                                
                                tp.lambda = tuningParameters.lambda(0);
                                tp.theta = tuningParameters.theta(0);
@@ -373,9 +492,25 @@ public:
                                  )
                                );
                              }
-private: 
-  tuningParametersMcp tp;
-  penaltyMcp pen;
+  
+  arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradients,
+                               const tuningParametersMixedPenalty &tuningParameters) const override{
+                                 penaltyMcp pen;
+                                 tuningParametersMcp tp;
+                                 
+                                 tp.lambda = tuningParameters.lambda(0);
+                                 tp.theta = tuningParameters.theta(0);
+                                 tp.weights = tuningParameters.weights(0);
+                                 
+                                 return(
+                                   pen.getSubgradients(
+                                     parameterValues,
+                                     gradients,
+                                     tp
+                                   )
+                                 );
+                               }
 };
 
 
@@ -383,7 +518,9 @@ class penaltyMixedScad: public penaltyMixedPenaltyBase{
 public:
   double getValue(const arma::rowvec &parameterValues,
                   const stringVector &parameterLabels,
-                  const tuningParametersMixedPenalty &tuningParameters) override{
+                  const tuningParametersMixedPenalty &tuningParameters) const override{
+                               penaltyScad pen;
+                               tuningParametersScad tp;
                                
                                tp.lambda = tuningParameters.lambda(0);
                                tp.theta = tuningParameters.theta(0);
@@ -397,9 +534,25 @@ public:
                                  )
                                );
                              }
-private: 
-  tuningParametersScad tp;
-  penaltyScad pen;
+  
+  arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradients,
+                               const tuningParametersMixedPenalty &tuningParameters) const override{
+                                 penaltyScad pen;
+                                 tuningParametersScad tp;
+                                 
+                                 tp.lambda = tuningParameters.lambda(0);
+                                 tp.theta = tuningParameters.theta(0);
+                                 tp.weights = tuningParameters.weights(0);
+                                 
+                                 return(
+                                   pen.getSubgradients(
+                                     parameterValues,
+                                     gradients,
+                                     tp
+                                   )
+                                 );
+                               }
 };
 
 class penaltyMixedPenalty: public penalty<tuningParametersMixedPenalty> {
@@ -412,6 +565,9 @@ public:
         
         double penaltyValue = 0.0;
         
+        // per-call workspace; the penalty itself holds no state and can be
+        // shared between threads
+        tuningParametersMixedPenalty tpSinglePenalty;
         arma::rowvec parameterValue{0};
         arma::rowvec parameters_kp1 = parameterValues;
         
@@ -432,12 +588,47 @@ public:
           it++;
         }
         
+        if(!tuningParameters.fusedChains.empty())
+          penaltyValue += tuningParameters.lambdaFused * fusedDifferences(parameterValues, tuningParameters.fusedChains);
+        
         return(penaltyValue);
         
       }
   
-private:
-  tuningParametersMixedPenalty tpSinglePenalty;
+  arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradients,
+                               const tuningParametersMixedPenalty &tuningParameters) override{
+        
+        if(!tuningParameters.fusedChains.empty())
+          error("Subgradients are not implemented for fusedChains. Use a different convergence criterion.");
+        
+        arma::rowvec subgradients(parameterValues.n_elem);
+        
+        tuningParametersMixedPenalty tpSinglePenalty;
+        arma::rowvec parameterValue{0};
+        arma::rowvec gradient{0};
+        
+        int it = 0;
+        for(auto& pen: penalties){
+          tpSinglePenalty.alpha = tuningParameters.alpha(it);
+          tpSinglePenalty.lambda = tuningParameters.lambda(it);
+          tpSinglePenalty.theta = tuningParameters.theta(it);
+          tpSinglePenalty.weights = tuningParameters.weights(it);
+          
+          parameterValue(0) = parameterValues(it);
+          gradient(0) = gradients(it);
+          
+          subgradients(it) = arma::as_scalar(pen->getSubgradients(
+            parameterValue,
+            gradient,
+            tpSinglePenalty)
+          );
+          it++;
+        }
+        
+        return(subgradients);
+        
+      }
 };
 
 void inline initializeMixedProximalOperators(proximalOperatorMixedPenalty& proxOperators, 
@@ -7,5 +7,7 @@
 #include "ista_mixedPenalty.h"
 #include "ista_ridge.h"
 #include "ista_scad.h"
+#include "ista_groupLasso.h"
+#include "ista_fusedLasso.h"
 
 #endif
\ No newline at end of file
@@ -37,8 +37,21 @@ namespace lessSEM
                     const stringVector &parameterLabels,
                     const tuningParametersEnet &tuningParameters) override
     {
+      static_cast<void>(parameterLabels); // is unused
+      return (getValue(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the value of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const tuningParametersEnet &tuningParameters)
+    {
 
-      static_cast<void>(parameterLabels); // is unused, but necessary for the interface to be consistent
       // if ridge is not used:
       if (tuningParameters.alpha == 1)
         return (0.0);
@@ -72,9 +85,21 @@ namespace lessSEM
                               const stringVector &parameterLabels,
                               const tuningParametersEnet &tuningParameters) override
     {
+      static_cast<void>(parameterLabels); // is unused
+      return (getGradients(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the gradients of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    arma::rowvec getGradients(const arma::rowvec &parameterValues,
+                              const tuningParametersEnet &tuningParameters)
+    {
 
-      static_cast<void>(parameterLabels); // is unused, but necessary for the interface to be consistent
-      
       arma::rowvec gradients(parameterValues.n_elem);
       gradients.fill(0.0);
       // if ridge is not used:
@@ -99,6 +124,65 @@ namespace lessSEM
 
       return gradients;
     }
+
+    bool hasHessianDiagonal() override
+    {
+      return (true);
+    }
+
+    /**
+     * @brief Get the diagonal of the Hessian of the penalty function. The ridge
+     * penalty is quadratic, so the Hessian does not depend on the parameter values.
+     *
+     * @param parameterValues current parameter values
+     * @param parameterLabels names of the parameters
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    arma::rowvec getHessianDiagonal(const arma::rowvec &parameterValues,
+                                    const stringVector &parameterLabels,
+                                    const tuningParametersEnet &tuningParameters) override
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (getHessianDiagonal(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the diagonal of the Hessian of the penalty function. The ridge
+     * penalty is quadratic, so the Hessian does not depend on the parameter values.
+     * Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    arma::rowvec getHessianDiagonal(const arma::rowvec &parameterValues,
+                                    const tuningParametersEnet &tuningParameters)
+    {
+
+      arma::rowvec hessianDiagonal(parameterValues.n_elem);
+      hessianDiagonal.fill(0.0);
+      // if ridge is not used:
+      if (tuningParameters.alpha == 1)
+        return (hessianDiagonal);
+
+      // else
+
+      double lambda_i;
+
+      for (unsigned int p = 0; p < parameterValues.n_elem; p++)
+      {
+
+        lambda_i = (1.0 - tuningParameters.alpha) *
+                   tuningParameters.lambda *
+                   tuningParameters.weights.at(p);
+
+        hessianDiagonal.at(p) = lambda_i *
+                                2;
+      }
+
+      return hessianDiagonal;
+    }
   };
 }
 #endif
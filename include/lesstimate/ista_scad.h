@@ -75,6 +75,82 @@ namespace lessSEM
     return 0.0;
   }
 
+  /**
+   * @brief proximal operator of the scad penalty for a single parameter
+   *
+   * @param u_k parameter value after the gradient step (x - g/L)
+   * @param lambda lambda tuning parameter value
+   * @param theta theta tuning parameter value
+   * @param L step size
+   * @return double
+   */
+  inline double proximalScad(const double u_k,
+                             const double lambda,
+                             const double theta,
+                             const double L)
+  {
+    double x[4]; // to save the minima of the
+    // three different regions of the penalty function
+    double h[4]; // to save the function values of the
+    // four possible minima saved in x
+    const double thetaXlambda = theta * lambda;
+
+    int sign = (u_k > 0); // sign of u_k
+    if (u_k < 0)
+      sign = -1;
+
+    const double abs_u_k = std::abs(u_k);
+
+    // assume that the solution is found in
+    // |x| <= lambda. In this region, the
+    // scad penalty is identical to the lasso, so
+    // we can use the same minimizer as for the lasso
+    // with the additional bound that
+
+    // identical to Gong et al. (2013)
+    x[0] = sign * std::min(
+                      lambda,
+                      std::max(
+                          0.0,
+                          abs_u_k - lambda / L));
+
+    // assume that lambda <= |u| <= theta*lambda
+    // The following differs from Gong et al. (2013)
+
+    const double v = 1.0 - 1.0 / (L * (theta - 1.0)); // used repeatedly;
+    // only computed for convenience
+
+    x[1] = std::min(
+        thetaXlambda,
+        std::max(
+            lambda,
+            (u_k / v) - (thetaXlambda) / (L * (theta - 1.0) * v)));
+
+    x[2] = std::max(
+        -thetaXlambda,
+        std::min(
+            -lambda,
+            (u_k / v) + (thetaXlambda) / (L * (theta - 1.0) * v)));
+
+    // assume that |u| >= lambda*theta
+    // identical to Gong et al. (2013)
+
+    x[3] = sign * std::max(
+                      thetaXlambda,
+                      abs_u_k);
+
+    int best = 0;
+    for (int i = 0; i < 4; i++)
+    {
+      h[i] = .5 * std::pow(x[i] - u_k, 2) + // distance between parameters
+             (1.0 / L) * scadPenalty(x[i], lambda, theta);
+      if (h[i] < h[best])
+        best = i;
+    }
+
+    return (x[best]);
+  }
+
   /**
    * @brief proximal operator for the scad penalty function
    *
@@ -100,22 +176,30 @@ namespace lessSEM
                                const tuningParametersScad &tuningParameters)
         override
     {
+      static_cast<void>(parameterLabels); // is unused
+      return (getParameters(parameterValues, gradientValues, L, tuningParameters));
+    }
 
-      static_cast<void>(parameterLabels); // is unused, but necessary for the interface to be consistent
+    /**
+     * @brief update the parameter vector. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @return arma::rowvec updated parameters
+     */
+    arma::rowvec getParameters(const arma::rowvec &parameterValues,
+                               const arma::rowvec &gradientValues,
+                               const double L,
+                               const tuningParametersScad &tuningParameters)
+    {
 
       arma::rowvec u_k = parameterValues - gradientValues / L;
 
       arma::rowvec parameters_kp1(parameterValues.n_elem);
       parameters_kp1.fill(arma::datum::nan);
 
-      double abs_u_k, v;
-      std::vector<double> x(4, 0.0); // to save the minima of the
-      // three different regions of the penalty function
-      std::vector<double> h(4, 0.0); // to save the function values of the
-      // four possible minima saved in x
-      int sign; // sign of u_k
-      double thetaXlambda = tuningParameters.theta * tuningParameters.lambda;
-
       for (unsigned int p = 0; p < parameterValues.n_elem; p++)
       {
 
@@ -126,58 +210,10 @@ namespace lessSEM
           continue;
         }
 
-        sign = (u_k.at(p) > 0);
-        if (u_k.at(p) < 0)
-          sign = -1;
-
-        abs_u_k = std::abs(u_k.at(p));
-
-        // assume that the solution is found in
-        // |x| <= lambda. In this region, the
-        // scad penalty is identical to the lasso, so
-        // we can use the same minimizer as for the lasso
-        // with the additional bound that
-
-        // identical to Gong et al. (2013)
-        x.at(0) = sign * std::min(
-                             tuningParameters.lambda,
-                             std::max(
-                                 0.0,
-                                 abs_u_k - tuningParameters.lambda / L));
-
-        // assume that lambda <= |u| <= theta*lambda
-        // The following differs from Gong et al. (2013)
-
-        v = 1.0 - 1.0 / (L * (tuningParameters.theta - 1.0)); // used repeatedly;
-        // only computed for convenience
-
-        x.at(1) = std::min(
-            thetaXlambda,
-            std::max(
-                tuningParameters.lambda,
-                (u_k.at(p) / v) - (thetaXlambda) / (L * (tuningParameters.theta - 1.0) * v)));
-
-        x.at(2) = std::max(
-            -thetaXlambda,
-            std::min(
-                -tuningParameters.lambda,
-                (u_k.at(p) / v) + (thetaXlambda) / (L * (tuningParameters.theta - 1.0) * v)));
-
-        // assume that |u| >= lambda*theta
-        // identical to Gong et al. (2013)
-
-        x.at(3) = sign * std::max(
-                             thetaXlambda,
-                             abs_u_k);
-
-        for (int i = 0; i < 4; i++)
-        {
-          h.at(i) = .5 * std::pow(x.at(i) - u_k.at(p), 2) + // distance between parameters
-                    (1.0 / L) * scadPenalty(x.at(i), tuningParameters.lambda, tuningParameters.theta);
-        }
-
-        parameters_kp1.at(p) = x.at(std::distance(std::begin(h),
-                                                  std::min_element(h.begin(), h.end())));
+        parameters_kp1.at(p) = proximalScad(u_k.at(p),
+                                            tuningParameters.lambda,
+                                            tuningParameters.theta,
+                                            L);
       }
 
       return parameters_kp1;
@@ -218,8 +254,20 @@ namespace lessSEM
                     const tuningParametersScad &tuningParameters)
         override
     {
+      static_cast<void>(parameterLabels); // is unused
+      return (getValue(parameterValues, tuningParameters));
+    }
 
-      static_cast<void>(parameterLabels); // is unused, but necessary for the interface to be consistent
+    /**
+     * @brief Get the value of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const tuningParametersScad &tuningParameters)
+    {
 
       double penaltyValue = 0.0;
 
@@ -237,6 +285,37 @@ namespace lessSEM
 
       return penaltyValue;
     }
+
+    /**
+     * @brief Get the subgradients of the penalized fit function (see subgradients.h)
+     *
+     * @param parameterValues current parameter values
+     * @param gradients gradients of the smooth part of the fit function
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    arma::rowvec getSubgradients(const arma::rowvec &parameterValues,
+                                 const arma::rowvec &gradients,
+                                 const tuningParametersScad &tuningParameters)
+        override
+    {
+
+      arma::rowvec subgradients = gradients;
+
+      for (unsigned int p = 0; p < parameterValues.n_elem; p++)
+      {
+        // if not regularized: nothing to do here
+        if (tuningParameters.weights.at(p) == 0.0)
+          continue;
+
+        subgradients.at(p) = subgradientScad(parameterValues.at(p),
+                                             gradients.at(p),
+                                             tuningParameters.lambda,
+                                             tuningParameters.theta);
+      }
+
+      return (subgradients);
+    }
   };
 
 }
@@ -0,0 +1,220 @@
+#ifndef LEAVEONEOUT_H
+#define LEAVEONEOUT_H
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "common_headers.h"
+#include "fitResults.h"
+#include "optimizerState.h"
+#include "parallel.h"
+
+// Approximate leave-one-out cross-validation (ALO).
+//
+// Let the fit function of the model be the sum of the contributions l_i of the observations,
+// f(x) = sum_i l_i(x), and let x* be the estimate for the penalized fit function with all
+// observations. At x*, the subgradient of the penalized fit function is zero. Removing
+// observation i changes the gradients by -grad l_i(x*), and a single Newton step gives the
+// leave-one-out estimate
+//    x_(-i) = x* + (H - H_i)^(-1) grad l_i(x*),
+// where H is the Hessian of the smooth part of the fit function and H_i the Hessian of l_i.
+// For L1 penalties, the step is restricted to the non-zero parameters (the active set):
+// Small changes of the data do not change which parameters are zero. The held-out loss of
+// observation i is l_i(x_(-i)).
+//
+// H is the final Hessian approximation returned by glmnet and bfgsOptim in the fitResults. If the
+// model provides the Hessians H_i, the step uses H - H_i; otherwise H_i is ignored and a single
+// decomposition of H is used for all observations (infinitesimal jackknife).
+//
+// Beirami, A., Razaviyayn, M., Shahrampour, S., & Tarokh, V. (2017). On optimal generalizability in
+// parametric learning. Advances in Neural Information Processing Systems, 30.
+// Rad, K. R., & Maleki, A. (2020). A scalable estimate of the out-of-sample prediction error via
+// approximate leave-one-out cross-validation. Journal of the Royal Statistical Society Series B, 82(4), 965–996.
+
+namespace lessSEM
+{
+
+  /**
+   * @brief checks if modelClass has the methods numberObservations(),
+   * double observationFit(arma::rowvec, unsigned int) and
+   * arma::rowvec observationGradients(arma::rowvec, unsigned int), which return the
+   * contribution of a single observation to the fit and the gradients.
+   *
+   * @tparam modelClass class of the model
+   */
+  template <class modelClass, class = void>
+  struct hasObservationContributions : std::false_type
+  {
+  };
+  template <class modelClass>
+  struct hasObservationContributions<modelClass,
+                                     std::void_t<decltype(static_cast<unsigned int>(std::declval<modelClass &>().numberObservations())),
+                                                 decltype(static_cast<double>(std::declval<modelClass &>().observationFit(std::declval<const arma::rowvec &>(),
+                                                                                                                           std::declval<unsigned int>()))),
+                                                 decltype(arma::rowvec(std::declval<modelClass &>().observationGradients(std::declval<const arma::rowvec &>(),
+                                                                                                                          std::declval<unsigned int>())))>>
+      : std::true_type
+  {
+  };
+
+  /**
+   * @brief checks if modelClass has the (optional) method
+   * arma::mat observationHessian(arma::rowvec, unsigned int)
+   *
+   * @tparam modelClass class of the model
+   */
+  template <class modelClass, class = void>
+  struct hasObservationHessian : std::false_type
+  {
+  };
+  template <class modelClass>
+  struct hasObservationHessian<modelClass,
+                               std::void_t<decltype(arma::mat(std::declval<modelClass &>().observationHessian(std::declval<const arma::rowvec &>(),
+                                                                                                               std::declval<unsigned int>())))>>
+      : std::true_type
+  {
+  };
+
+  /**
+   * @struct aloResults
+   * @brief results of the approximate leave-one-out cross-validation
+   *
+   * @var observationLoss approximate held-out loss of each observation (rows) for each fit (columns)
+   * @var aloLoss approximate leave-one-out loss per observation for each fit
+   * @var activeSetSize number of non-zero parameters of each fit
+   * @var selected index of the fit with the smallest aloLoss
+   */
+  struct aloResults
+  {
+    arma::mat observationLoss;
+    arma::rowvec aloLoss;
+    arma::uvec activeSetSize;
+    unsigned int selected;
+  };
+
+  /**
+   * @brief returns the final Hessian stored in the fit results (full or packed)
+   *
+   * @param fitResults_ fit results
+   * @return arma::mat
+   */
+  inline arma::mat storedHessian(const fitResults &fitResults_)
+  {
+    if (fitResults_.Hessian.n_elem != 0)
+      return (fitResults_.Hessian);
+    if (fitResults_.HessianPacked.n_rows != 0)
+      return (fitResults_.HessianPacked.unpack());
+    error("The approximate leave-one-out cross-validation requires the final Hessian. Use returnFullHessian or returnPackedHessian.");
+    return (arma::mat());
+  }
+
+  /**
+   * @brief approximate leave-one-out cross-validation of one or multiple fits (e.g., the fits
+   * along a regularization path). Each fit requires only one pass over the observations.
+   *
+   * @tparam modelClass class of the model. Must provide numberObservations, observationFit, and
+   * observationGradients (see hasObservationContributions) and can provide observationHessian.
+   * @param model_ the model using all observations. The fit of the model must be the sum of the observationFit.
+   * @param fits fit results of glmnet or bfgsOptim with the final Hessian
+   * @param threads number of threads used for the observations (see parallel.h). The observation
+   * methods of the model must be safe to call from multiple threads if threads != 1.
+   * @return aloResults
+   */
+  template <class modelClass>
+  inline aloResults approximateLeaveOneOut(modelClass &model_,
+                                           const std::vector<fitResults> &fits,
+                                           const int threads = 1)
+  {
+    static_assert(hasObservationContributions<modelClass>::value,
+                  "The model must provide the methods numberObservations, observationFit, and observationGradients (see leaveOneOut.h).");
+
+    const unsigned int numberObservations = model_.numberObservations();
+    const unsigned int numberFits = fits.size();
+
+    aloResults aloResults_;
+    aloResults_.observationLoss.set_size(numberObservations, numberFits);
+    aloResults_.aloLoss.set_size(numberFits);
+    aloResults_.activeSetSize.set_size(numberFits);
+
+    for (unsigned int f = 0; f < numberFits; f++)
+    {
+      const arma::rowvec &parameterValues = fits.at(f).parameterValues;
+      const std::vector<unsigned int> activeSet_ = getActiveSet(parameterValues);
+      const arma::uvec activeSet = arma::conv_to<arma::uvec>::from(activeSet_);
+      aloResults_.activeSetSize.at(f) = activeSet.n_elem;
+
+      const arma::mat Hessian = storedHessian(fits.at(f));
+      if (Hessian.n_rows != parameterValues.n_elem)
+        error("The Hessian does not match the number of parameters.");
+      const arma::mat activeHessian = Hessian.submat(activeSet, activeSet);
+
+      // without the Hessians of the observations, all steps use the same matrix;
+      // its inverse is computed only once
+      arma::mat inverseHessian;
+      if constexpr (!hasObservationHessian<modelClass>::value)
+      {
+        if (activeSet.n_elem > 0 && !arma::inv_sympd(inverseHessian, activeHessian))
+          error("The Hessian of the active set is not positive definite.");
+      }
+
+      parallelFor(numberObservations, threads, [&](const unsigned int i)
+                  {
+        arma::rowvec leaveOneOut = parameterValues;
+        if (activeSet.n_elem > 0)
+        {
+          const arma::rowvec observationGradients = model_.observationGradients(parameterValues, i);
+          const arma::colvec gradients = observationGradients.elem(activeSet);
+          arma::colvec step;
+          if constexpr (hasObservationHessian<modelClass>::value)
+          {
+            const arma::mat observationHessian = model_.observationHessian(parameterValues, i);
+            step = arma::solve(activeHessian - observationHessian.submat(activeSet, activeSet), gradients);
+          }
+          else
+          {
+            step = inverseHessian * gradients;
+          }
+          for (unsigned int a = 0; a < activeSet.n_elem; a++)
+            leaveOneOut.at(activeSet.at(a)) += step.at(a);
+        }
+        aloResults_.observationLoss.at(i, f) = model_.observationFit(leaveOneOut, i); });
+
+      aloResults_.aloLoss.at(f) = arma::accu(aloResults_.observationLoss.col(f)) / numberObservations;
+    }
+
+    // non-finite losses are never selected
+    aloResults_.selected = 0;
+    double smallestLoss = arma::datum::inf;
+    for (unsigned int f = 0; f < numberFits; f++)
+    {
+      if (std::isfinite(aloResults_.aloLoss.at(f)) && aloResults_.aloLoss.at(f) < smallestLoss)
+      {
+        smallestLoss = aloResults_.aloLoss.at(f);
+        aloResults_.selected = f;
+      }
+    }
+
+    return (aloResults_);
+  }
+
+  /**
+   * @brief approximate leave-one-out cross-validation of a single fit
+   *
+   * @tparam modelClass class of the model (see approximateLeaveOneOut above)
+   * @param model_ the model using all observations
+   * @param fitResults_ fit results of glmnet or bfgsOptim with the final Hessian
+   * @param threads number of threads used for the observations
+   * @return aloResults
+   */
+  template <class modelClass>
+  inline aloResults approximateLeaveOneOut(modelClass &model_,
+                                           const fitResults &fitResults_,
+                                           const int threads = 1)
+  {
+    return (approximateLeaveOneOut(model_,
+                                   std::vector<fitResults>{fitResults_},
+                                   threads));
+  }
+
+} // end namespace
+
+#endif
@@ -2,13 +2,17 @@
 #define MODEL_H
 
 #include "common_headers.h"
+#include "parallel.h"
 
 namespace lessSEM
 {
   /**
    * @brief model is the base class used in every optimizer implemented in lesstimate.
    * The user specified model should inherit from the model class and must implement
-   * the two methods defined therein
+   * a fit method. The fit method can either take the parameter values and labels or
+   * only the parameter values. Models which do not need the labels should implement
+   * the version without labels: The optimizers then call it directly and never copy
+   * the labels (see traits.h). The versions with labels forward to it.
    */
   class model
   {
@@ -19,17 +23,36 @@ namespace lessSEM
     /**
      * @brief fit method  with arguments parameterValues (arma::rowvec) and parameterLabels (stringVector; see common_headers.h)
      * specifying the parameter values and the labels of the paramters. The function should return the fit value (double).
+     * By default, the fit method without parameter labels is called.
      *
      * @param parameterValues numericVector with parameter values
      * @param parameterLabels stringVector with parameterLabels
      * @return double
      */
     virtual double fit(arma::rowvec parameterValues,
-                       stringVector parameterLabels) = 0;
+                       stringVector parameterLabels)
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (fit(parameterValues));
+    }
+
+    /**
+     * @brief fit method without parameter labels. Models which do not need the labels can implement
+     * this method instead of fit(arma::rowvec, stringVector).
+     *
+     * @param parameterValues parameter values
+     * @return double
+     */
+    virtual double fit(const arma::rowvec &parameterValues)
+    {
+      static_cast<void>(parameterValues); // is unused
+      error("The model must implement one of the fit methods (see model.h).");
+    }
 
     /**
      * @brief gradients method with arguments parameterValues(arma::rowvec) and parameterLabels(stringVector; see common_headers.h) * specifying the parameter values and the labels of the paramters. The function should return the gradients(arma::rowvec).
-     * By default, a central gradient approximation with step size 1e-5 is used
+     * By default, a central gradient approximation with step size 1e-5 is used. The fits required by the
+     * approximation are computed with fitBatch in blocks of batchSize() parameters.
      *
      * @param parameterValues numericVector with parameter values
      * @param parameterLabels stringVector with parameterLabels
@@ -42,27 +65,111 @@ namespace lessSEM
       gradients.fill(arma::fill::zeros);
       // define stepSize used in numerically approximated gradients:
       double stepSize = 1e-5;
-      
-      for (unsigned int i = 0; i < parameterValues.n_elem; i++)
+      const unsigned int blockSize = std::max(1, batchSize());
+
+      for (unsigned int first = 0; first < parameterValues.n_elem; first += blockSize)
       {
+        const unsigned int nBlock = std::min<unsigned int>(blockSize, parameterValues.n_elem - first);
 
-        // step forward
-        parameterValues(i) += stepSize;
-        gradients(i) = fit(parameterValues,
-                           parameterLabels);
+        // rows 2*j and 2*j+1 step forward and backward in parameter first + j
+        arma::mat points(2 * nBlock, parameterValues.n_elem);
+        for (unsigned int j = 0; j < nBlock; j++)
+        {
+          points.row(2 * j) = parameterValues;
+          points.row(2 * j + 1) = parameterValues;
+          points.at(2 * j, first + j) += stepSize;
+          points.at(2 * j + 1, first + j) -= stepSize;
+        }
 
-        // step backward
-        parameterValues(i) -= 2.0 * stepSize;
-        gradients(i) -= fit(parameterValues,
-                            parameterLabels);
-        // reset
-        parameterValues(i) += stepSize;
+        const arma::colvec fits = fitBatch(points, parameterLabels, 1);
 
         // compute gradient
-        gradients(i) /= 2.0 * stepSize;
+        for (unsigned int j = 0; j < nBlock; j++)
+          gradients(first + j) = (fits.at(2 * j) - fits.at(2 * j + 1)) / (2.0 * stepSize);
       }
       return (gradients);
     }
+
+    /**
+     * @brief gradients method without parameter labels. Models which implement the fit method without
+     * parameter labels can implement this method instead of gradients(arma::rowvec, stringVector). By
+     * default, the central gradient approximation of gradients(arma::rowvec, stringVector) is used;
+     * the labels passed to fitBatch are then empty.
+     *
+     * @param parameterValues parameter values
+     * @return arma::rowvec gradients
+     */
+    virtual arma::rowvec gradients(const arma::rowvec &parameterValues)
+    {
+      return (gradients(parameterValues, stringVector()));
+    }
+
+    /**
+     * @brief fit method for several points at once. Each row of points is one vector of
+     * parameter values. By default, fit is called for each row; the rows are distributed
+     * over threads threads. Models which can evaluate several points more efficiently
+     * (e.g., with matrix-matrix products or shared precomputations) can override this method
+     * together with batchSize.
+     *
+     * @param points matrix where each row contains parameter values
+     * @param parameterLabels stringVector with parameterLabels
+     * @param threads number of threads (0 = all available cores). Requires a thread-safe fit method if threads != 1.
+     * @return arma::colvec fit for each row of points
+     */
+    virtual arma::colvec fitBatch(const arma::mat &points,
+                                  const stringVector &parameterLabels,
+                                  const int threads)
+    {
+      arma::colvec fits(points.n_rows);
+      parallelFor(points.n_rows, threads, [&](const unsigned int i)
+                  { fits.at(i) = fit(points.row(i), parameterLabels); });
+      return (fits);
+    }
+
+    /**
+     * @brief gradients method for several points at once. Each row of points is one vector of
+     * parameter values. By default, gradients is called for each row; the rows are distributed
+     * over threads threads. Models can override this method together with batchSize.
+     *
+     * @param points matrix where each row contains parameter values
+     * @param parameterLabels stringVector with parameterLabels
+     * @param threads number of threads (0 = all available cores). Requires a thread-safe gradients method if threads != 1.
+     * @return arma::mat gradients for each row of points
+     */
+    virtual arma::mat gradientsBatch(const arma::mat &points,
+                                     const stringVector &parameterLabels,
+                                     const int threads)
+    {
+      arma::mat gradientValues(points.n_rows, points.n_cols);
+      parallelFor(points.n_rows, threads, [&](const unsigned int i)
+                  { gradientValues.row(i) = gradients(points.row(i), parameterLabels); });
+      return (gradientValues);
+    }
+
+    /**
+     * @brief number of points the model prefers to evaluate in one call to fitBatch. If > 1,
+     * the line searches of glmnet and bfgsOptim evaluate the fits of several step sizes at once
+     * and the default gradients method approximates batchSize gradients per call.
+     *
+     * @return int
+     */
+    virtual int batchSize()
+    {
+      return (1);
+    }
+
+    /**
+     * @brief the optimizers store the last few evaluations of fit and gradients and
+     * reuse them if the model is evaluated at the same parameter values again (see modelCache.h).
+     * This requires that fit and gradients only depend on the parameter values. Override this
+     * method and return false if this is not the case for your model.
+     *
+     * @return bool
+     */
+    virtual bool useCache()
+    {
+      return (true);
+    }
   };
 
 }
@@ -0,0 +1,300 @@
+#ifndef MODELCACHE_H
+#define MODELCACHE_H
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "common_headers.h"
+#include "traits.h"
+
+// The optimizers often evaluate the model at the same parameter values more than
+// once (e.g., glmnet computes the fit and the gradients at the new parameters
+// after the line search already did so). cachedModel wraps a model and remembers the
+// last few fits and gradients. A repeated call with exactly the same parameter values
+// returns the stored result instead of evaluating the model again.
+//
+// This requires that fit and gradients only depend on the parameter values. Models
+// for which this is not the case (e.g., because the result depends on an internal
+// state which is changed by other calls) can disable the cache by overriding
+// model::useCache.
+//
+// cachedModel is a template on the class of the wrapped model so that the calls
+// to the wrapped model can be resolved at compile time (see traits.h). The second
+// template parameter is the type of the stored parameter and gradient vectors. With
+// a fixed-size vector (see fixedSize.h), the entries are allocated once when the
+// cache is constructed and a cache hit does not allocate.
+
+namespace lessSEM
+{
+
+  /**
+   * @brief model which stores the last few evaluations of another model
+   *
+   * @tparam modelClass class of the wrapped model (see isModel in traits.h)
+   * @tparam rowvecType vector type of the stored parameters and gradients
+   */
+  template <class modelClass, class rowvecType = arma::rowvec>
+  class cachedModel
+  {
+    static_assert(isModel<modelClass>::value,
+                  "modelClass must provide the methods fit and gradients (see model.h).");
+
+  public:
+    unsigned int fitEvaluations = 0;      ///> number of times the fit of the wrapped model was evaluated
+    unsigned int gradientEvaluations = 0; ///> number of times the gradients of the wrapped model were evaluated
+    unsigned int cacheHits = 0;           ///> number of evaluations which were answered from the cache
+
+    /**
+     * @brief Construct a new cached model
+     *
+     * @param model_ model which should be wrapped. Must outlive the cached model.
+     * @param capacity_ number of parameter vectors for which results are stored
+     */
+    explicit cachedModel(modelClass &model_, const unsigned int capacity_ = 4) : wrapped(model_),
+                                                                                 capacity(modelUseCache(model_) ? capacity_ : 0)
+    {
+      entries.reserve(capacity);
+    }
+
+    /**
+     * @brief returns the fit of the wrapped model. The parameter labels are assumed to be the same
+     * in all calls.
+     *
+     * @param parameterValues numericVector with parameter values
+     * @param parameterLabels stringVector with parameterLabels
+     * @return double
+     */
+    double fit(const arma::rowvec &parameterValues,
+               const stringVector &parameterLabels)
+    {
+      if (capacity == 0)
+      {
+        fitEvaluations++;
+        return (modelFit(wrapped, parameterValues, parameterLabels));
+      }
+
+      const std::uint64_t hash = hashParameters(parameterValues);
+      entry *cached = find(parameterValues, hash);
+      if (cached != nullptr && cached->hasFit)
+      {
+        cacheHits++;
+        return (cached->fit);
+      }
+
+      fitEvaluations++;
+      const double fitValue = modelFit(wrapped, parameterValues, parameterLabels);
+      if (cached == nullptr)
+        cached = &insert(parameterValues, hash);
+      cached->fit = fitValue;
+      cached->hasFit = true;
+      return (fitValue);
+    }
+
+    /**
+     * @brief returns the gradients of the wrapped model. The parameter labels are assumed to be the same
+     * in all calls.
+     *
+     * @param parameterValues numericVector with parameter values
+     * @param parameterLabels stringVector with parameterLabels
+     * @return rowvecType
+     */
+    rowvecType gradients(const arma::rowvec &parameterValues,
+                           const stringVector &parameterLabels)
+    {
+      if (capacity == 0)
+      {
+        gradientEvaluations++;
+        return (modelGradients(wrapped, parameterValues, parameterLabels));
+      }
+
+      const std::uint64_t hash = hashParameters(parameterValues);
+      entry *cached = find(parameterValues, hash);
+      if (cached != nullptr && cached->hasGradients)
+      {
+        cacheHits++;
+        return (cached->gradients);
+      }
+
+      gradientEvaluations++;
+      rowvecType gradientValues = modelGradients(wrapped, parameterValues, parameterLabels);
+      if (cached == nullptr)
+        cached = &insert(parameterValues, hash);
+      cached->gradients = gradientValues;
+      cached->hasGradients = true;
+      return (gradientValues);
+    }
+
+    /**
+     * @brief returns the fits of the wrapped model for several points. Points which are
+     * not in the cache are evaluated with one call to fitBatch of the wrapped model.
+     *
+     * @param points matrix where each row contains parameter values
+     * @param parameterLabels stringVector with parameterLabels
+     * @param threads number of threads passed to the wrapped model
+     * @return arma::colvec
+     */
+    arma::colvec fitBatch(const arma::mat &points,
+                          const stringVector &parameterLabels,
+                          const int threads)
+    {
+      arma::colvec fits(points.n_rows);
+      std::vector<unsigned int> missing;
+      for (unsigned int i = 0; i < points.n_rows; i++)
+      {
+        const arma::rowvec point = points.row(i);
+        entry *cached = capacity == 0 ? nullptr : find(point, hashParameters(point));
+        if (cached != nullptr && cached->hasFit)
+        {
+          cacheHits++;
+          fits.at(i) = cached->fit;
+          continue;
+        }
+        missing.push_back(i);
+      }
+      if (missing.empty())
+        return (fits);
+
+      arma::mat missingPoints(missing.size(), points.n_cols);
+      for (unsigned int m = 0; m < missing.size(); m++)
+        missingPoints.row(m) = points.row(missing.at(m));
+
+      fitEvaluations += missing.size();
+      const arma::colvec missingFits = modelFitBatch(wrapped, missingPoints, parameterLabels, threads);
+
+      for (unsigned int m = 0; m < missing.size(); m++)
+      {
+        fits.at(missing.at(m)) = missingFits.at(m);
+        if (capacity == 0)
+          continue;
+        const arma::rowvec point = missingPoints.row(m);
+        const std::uint64_t hash = hashParameters(point);
+        entry *cached = find(point, hash);
+        if (cached == nullptr)
+          cached = &insert(point, hash);
+        cached->fit = missingFits.at(m);
+        cached->hasFit = true;
+      }
+      return (fits);
+    }
+
+    /**
+     * @brief returns the gradients of the wrapped model for several points. The points are
+     * evaluated with one call to gradientsBatch of the wrapped model and are not cached.
+     *
+     * @param points matrix where each row contains parameter values
+     * @param parameterLabels stringVector with parameterLabels
+     * @param threads number of threads passed to the wrapped model
+     * @return arma::mat
+     */
+    arma::mat gradientsBatch(const arma::mat &points,
+                             const stringVector &parameterLabels,
+                             const int threads)
+    {
+      gradientEvaluations += points.n_rows;
+      return (modelGradientsBatch(wrapped, points, parameterLabels, threads));
+    }
+
+    /**
+     * @brief number of points the wrapped model prefers to evaluate in one call to fitBatch
+     *
+     * @return int
+     */
+    int batchSize()
+    {
+      return (modelBatchSize(wrapped));
+    }
+
+    /**
+     * @brief removes all stored evaluations
+     *
+     */
+    void clear()
+    {
+      entries.clear();
+      nextSlot = 0;
+    }
+
+  private:
+    struct entry
+    {
+      std::uint64_t hash;
+      rowvecType parameters;
+      bool hasFit = false;
+      double fit = 0.0;
+      bool hasGradients = false;
+      rowvecType gradients;
+    };
+
+    modelClass &wrapped;
+    unsigned int capacity;
+    std::vector<entry> entries;
+    unsigned int nextSlot = 0;
+
+    /**
+     * @brief FNV-1a hash of the bit patterns of the parameter values
+     *
+     * @param parameterValues parameter values
+     * @return std::uint64_t
+     */
+    static std::uint64_t hashParameters(const arma::rowvec &parameterValues)
+    {
+      std::uint64_t hash = 14695981039346656037ULL;
+      for (unsigned int p = 0; p < parameterValues.n_elem; p++)
+      {
+        std::uint64_t bits;
+        const double value = parameterValues.at(p);
+        std::memcpy(&bits, &value, sizeof(bits));
+        hash ^= bits;
+        hash *= 1099511628211ULL;
+      }
+      return (hash);
+    }
+
+    /**
+     * @brief returns the stored entry for parameterValues or a nullptr
+     *
+     * @param parameterValues parameter values
+     * @param hash hash of the parameter values
+     * @return entry*
+     */
+    entry *find(const arma::rowvec &parameterValues, const std::uint64_t hash)
+    {
+      for (entry &e : entries)
+      {
+        if (e.hash != hash || e.parameters.n_elem != parameterValues.n_elem)
+          continue;
+        // exact comparison of the bit patterns
+        if (std::memcmp(e.parameters.memptr(),
+                        parameterValues.memptr(),
+                        parameterValues.n_elem * sizeof(double)) == 0)
+          return (&e);
+      }
+      return (nullptr);
+    }
+
+    /**
+     * @brief stores a new entry. If the cache is full, the oldest entry is replaced.
+     *
+     * @param parameterValues parameter values
+     * @param hash hash of the parameter values
+     * @return entry&
+     */
+    entry &insert(const arma::rowvec &parameterValues, const std::uint64_t hash)
+    {
+      entry newEntry;
+      newEntry.hash = hash;
+      newEntry.parameters = parameterValues;
+      if (entries.size() < capacity)
+      {
+        entries.push_back(newEntry);
+        return (entries.back());
+      }
+      entries.at(nextSlot) = newEntry;
+      entry &inserted = entries.at(nextSlot);
+      nextSlot = (nextSlot + 1) % capacity;
+      return (inserted);
+    }
+  };
+
+} // end namespace
+
+#endif
@@ -0,0 +1,405 @@
+#ifndef MULTISTART_H
+#define MULTISTART_H
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "common_headers.h"
+#include "fitResults.h"
+#include "optimizerState.h"
+#include "parallel.h"
+#include "glmnet_class.h"
+#include "ista_class.h"
+
+// Multi-start optimization for non-convex penalties.
+//
+// scad, mcp, lsp, and cappedL1 result in non-convex objectives, and glmnet and ista only
+// find a local minimum close to the starting values. The multi-start driver fits the model
+// from several starting values in parallel:
+//
+//  - the starting values passed to the optimizer,
+//  - a vector of zeros,
+//  - user specified starts (e.g., the solution for the previous tuning parameter of a path or
+//    the unregularized solution), and
+//  - random starts around the starting values.
+//
+// Each start runs with its own random number stream: the random starts and the random
+// numbers drawn by the optimizer (e.g., the order of the coordinate updates of glmnet) are
+// reproducible and independent of the number of threads. When using R, all random numbers
+// come from R's random number generator instead and are reproducible with set.seed; the
+// starts are then always fitted sequentially. All starts are first optimized for
+// pruneAfter outer iterations. Starts whose penalized fit is far from the best fit at this
+// checkpoint are stopped; all other starts are continued with a warm start (see optimizerState.h)
+// and the remaining outer iterations.
+// Finally, the solutions are grouped into distinct local optima.
+
+namespace lessSEM
+{
+
+  /**
+   * @struct controlMultiStart
+   * @brief settings for the multi-start optimization
+   *
+   * @var numberRandomStarts number of random starts. The random starts are the starting values plus
+   * normally distributed noise with standard deviation randomScale.
+   * @var randomScale standard deviation of the noise of the random starts
+   * @var zeroStart should a vector of zeros be used as start?
+   * @var starts additional starts (one row per start; e.g., the solution of the previous tuning parameter
+   * of a regularization path or the unregularized solution)
+   * @var seed seed of the random number streams. Each start re-seeds randomEngine (see common_headers.h)
+   * of the thread it runs in; the previous state of randomEngine is restored after the start. Not used in R, where the random numbers come from R's random number
+   * generator (use set.seed).
+   * @var threads number of threads (see parallel.h). 0 uses all available cores. All starts share the
+   * model, which must be safe to use from multiple threads if threads != 1. Defaults to 1.
+   * @var pruneAfter number of outer iterations after which hopeless starts are pruned. The remaining starts are continued
+   * with the remaining outer iterations of the optimizer. Set to 0 to disable pruning.
+   * @var pruneTolerance starts are pruned if their penalized fit at the checkpoint is larger than
+   * best + pruneTolerance * max(1, |best|)
+   * @var distinctTolerance two solutions are the same local optimum if no parameter differs by more than distinctTolerance
+   */
+  struct controlMultiStart
+  {
+    unsigned int numberRandomStarts;
+    double randomScale;
+    bool zeroStart;
+    arma::mat starts;
+    unsigned int seed;
+    int threads;
+    int pruneAfter;
+    double pruneTolerance;
+    double distinctTolerance;
+  };
+
+  /**
+   * @brief Returns the default settings for the multi-start optimization
+   *
+   * @return controlMultiStart
+   */
+  inline controlMultiStart controlMultiStartDefault()
+  {
+    controlMultiStart defaultIs = {
+        10,        // numberRandomStarts
+        1.0,       // randomScale
+        true,      // zeroStart
+        arma::mat(), // starts
+        1234,      // seed
+        1,         // threads
+        20,        // pruneAfter
+        .1,        // pruneTolerance
+        1e-4       // distinctTolerance
+    };
+    return (defaultIs);
+  }
+
+  /**
+   * @struct multiStartResults
+   * @brief results of the multi-start optimization
+   *
+   * @var best fit results of the start with the smallest penalized fit
+   * @var optima distinct local optima, sorted by their penalized fit (the first is best)
+   * @var startingValues all starts (one row per start)
+   * @var fits penalized fit of each start (at the checkpoint for pruned starts)
+   * @var pruned was the start pruned at the checkpoint?
+   * @var bestStart index of the start which resulted in best
+   */
+  struct multiStartResults
+  {
+    fitResults best;
+    std::vector<fitResults> optima;
+    arma::mat startingValues;
+    arma::rowvec fits;
+    std::vector<bool> pruned;
+    unsigned int bestStart;
+  };
+
+  /**
+   * @brief creates the starts of the multi-start optimization
+   *
+   * @param startingValues starting values
+   * @param control_ settings for the multi-start optimization
+   * @return arma::mat with one row per start
+   */
+  inline arma::mat multiStartValues(const arma::rowvec &startingValues,
+                                    const controlMultiStart &control_)
+  {
+    if (control_.starts.n_rows > 0 && control_.starts.n_cols != startingValues.n_elem)
+      error("The additional starts must have one column for each parameter.");
+
+    const unsigned int numberStarts = 1 + control_.zeroStart + control_.starts.n_rows + control_.numberRandomStarts;
+    arma::mat starts(numberStarts, startingValues.n_elem);
+    unsigned int s = 0;
+    starts.row(s++) = startingValues;
+    if (control_.zeroStart)
+      starts.row(s++).fill(0.0);
+    for (unsigned int i = 0; i < control_.starts.n_rows; i++)
+      starts.row(s++) = control_.starts.row(i);
+
+    for (unsigned int i = 0; i < control_.numberRandomStarts; i++, s++)
+    {
+#if USE_R
+      // R owns the random number generator (see set.seed)
+      numericVector noise = Rcpp::rnorm(startingValues.n_elem, 0.0, control_.randomScale);
+      for (unsigned int p = 0; p < startingValues.n_elem; p++)
+        starts.at(s, p) = startingValues.at(p) + noise[p];
+#else
+      // each random start has its own stream
+      std::seed_seq seeds{control_.seed, s};
+      std::mt19937_64 engine(seeds);
+      std::normal_distribution<double> noise(0.0, control_.randomScale);
+      for (unsigned int p = 0; p < startingValues.n_elem; p++)
+        starts.at(s, p) = startingValues.at(p) + noise(engine);
+#endif
+    }
+    return (starts);
+  }
+
+  /**
+   * @brief multi-start optimization with any optimizer.
+   *
+   * @tparam fitFunction function with the arguments (startingValues, maxIterOut, usedIterations, warmStart) which
+   * returns the fitResults of the optimizer. If maxIterOut > 0, the optimizer is stopped after at most maxIterOut
+   * outer iterations (phase before pruning); it should not warn if it did not converge. If maxIterOut is 0, the optimizer
+   * runs for its maximal number of outer iterations minus the usedIterations of the previous phase.
+   * @param startingValues starting values
+   * @param fit_ function which fits the model
+   * @param control_ settings for the multi-start optimization
+   * @return multiStartResults
+   */
+  template <class fitFunction>
+  inline multiStartResults multiStart(const arma::rowvec &startingValues,
+                                      fitFunction fit_,
+                                      const controlMultiStart &control_ = controlMultiStartDefault())
+  {
+    multiStartResults multiStartResults_;
+    multiStartResults_.startingValues = multiStartValues(startingValues, control_);
+    const unsigned int numberStarts = multiStartResults_.startingValues.n_rows;
+
+    std::vector<fitResults> fits(numberStarts);
+    multiStartResults_.fits.set_size(numberStarts);
+    multiStartResults_.pruned = std::vector<bool>(numberStarts, false);
+
+    // the random numbers drawn by the optimizer come from randomEngine; each start gets its own stream.
+    // The state of randomEngine of the caller is restored afterwards, so that multiStart does not change
+    // the random numbers drawn after it. In R, the random numbers come from R's random number generator.
+    auto fitStream = [&](const unsigned int s, const unsigned int phase, auto fitStart)
+    {
+#if USE_R
+      static_cast<void>(s);     // is unused
+      static_cast<void>(phase); // is unused
+      fitStart();
+#else
+      const std::mt19937_64 previousEngine = randomEngine();
+      std::seed_seq seeds{control_.seed, s, phase};
+      randomEngine().seed(seeds);
+      try
+      {
+        fitStart();
+      }
+      catch (...)
+      {
+        randomEngine() = previousEngine;
+        throw;
+      }
+      randomEngine() = previousEngine;
+#endif
+    };
+
+    // 1) optimize all starts until the checkpoint
+    parallelFor(numberStarts, control_.threads, [&](const unsigned int s)
+                { fitStream(s, 0, [&]()
+                            {
+      fits.at(s) = fit_(arma::rowvec(multiStartResults_.startingValues.row(s)),
+                        control_.pruneAfter,
+                        0,
+                        optimizerState());
+      multiStartResults_.fits.at(s) = fits.at(s).fit; }); });
+
+    // 2) prune hopeless starts and continue the others
+    if (control_.pruneAfter > 0)
+    {
+      double bestFit = arma::datum::inf;
+      for (unsigned int s = 0; s < numberStarts; s++)
+      {
+        if (std::isfinite(fits.at(s).fit))
+          bestFit = std::min(bestFit, fits.at(s).fit);
+      }
+      const double threshold = bestFit + control_.pruneTolerance * std::max(1.0, std::abs(bestFit));
+
+      std::vector<unsigned int> continued;
+      for (unsigned int s = 0; s < numberStarts; s++)
+      {
+        if (!std::isfinite(fits.at(s).fit) || fits.at(s).fit > threshold)
+          multiStartResults_.pruned.at(s) = true;
+        else if (!fits.at(s).convergence)
+          continued.push_back(s);
+      }
+
+      parallelFor(continued.size(), control_.threads, [&](const unsigned int c)
+                  {
+        const unsigned int s = continued.at(c);
+        fitStream(s, 1, [&]()
+                  {
+        const arma::rowvec checkpointFits = fits.at(s).fits;
+        fits.at(s) = fit_(fits.at(s).parameterValues,
+                          0,
+                          control_.pruneAfter,
+                          fits.at(s).state);
+        fits.at(s).fits = arma::join_rows(checkpointFits, fits.at(s).fits);
+        multiStartResults_.fits.at(s) = fits.at(s).fit; }); });
+    }
+
+    // 3) collect the distinct local optima
+    std::vector<unsigned int> order;
+    for (unsigned int s = 0; s < numberStarts; s++)
+    {
+      if (!multiStartResults_.pruned.at(s) && std::isfinite(fits.at(s).fit))
+        order.push_back(s);
+    }
+    if (order.empty())
+      error("All starts of the multi-start optimization failed.");
+    std::stable_sort(order.begin(), order.end(), [&](const unsigned int a, const unsigned int b)
+                     { return (fits.at(a).fit < fits.at(b).fit); });
+
+    multiStartResults_.bestStart = order.at(0);
+    for (const unsigned int s : order)
+    {
+      bool isNew = true;
+      for (const fitResults &optimum : multiStartResults_.optima)
+      {
+        if (arma::max(arma::abs(optimum.parameterValues - fits.at(s).parameterValues)) <= control_.distinctTolerance)
+        {
+          isNew = false;
+          break;
+        }
+      }
+      if (isNew)
+        multiStartResults_.optima.push_back(fits.at(s));
+    }
+    multiStartResults_.best = multiStartResults_.optima.at(0);
+
+    return (multiStartResults_);
+  }
+
+  /**
+   * @brief multi-start optimization with the glmnet optimizer. The model and the penalties are shared
+   * by the starts, which can be fitted in parallel (see controlMultiStart::threads).
+   *
+   * @tparam nonsmoothPenalty class of type nonsmoothPenalty (e.g., lasso, scad, lsp)
+   * @tparam smoothPenalty class of type smooth penalty (e.g., ridge)
+   * @tparam tuning tuning parameters used by both, the nonsmootPenalty and the smoothPenalty
+   * @tparam modelClass class of the model (e.g., derived from model)
+   * @param model_ the model object derived from the model class in model.h or any class with the methods fit and gradients (see traits.h)
+   * @param startingValues an arma::rowvec vector with starting values
+   * @param parameterLabels a stringVector with parameter labels
+   * @param penalty_ a penalty derived from the penalty class in penalty.h
+   * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
+   * @param tuningParameters tuning parameters for the penalty functions
+   * @param controlOptimizer settings for the glmnet optimizer. Checkpoints are not written and the
+   * warm starts are set by the multi-start optimization.
+   * @param control_ settings for the multi-start optimization
+   * @return multiStartResults
+   */
+  template <typename nonsmoothPenalty, typename smoothPenalty,
+            typename tuning, typename modelClass>
+  inline multiStartResults multiStartGlmnet(modelClass &model_,
+                                            const arma::rowvec &startingValues,
+                                            const stringVector &parameterLabels,
+                                            nonsmoothPenalty &penalty_,
+                                            smoothPenalty &smoothPenalty_,
+                                            const tuning &tuningParameters,
+                                            const controlGLMNET &controlOptimizer = controlGlmnetDefault(),
+                                            const controlMultiStart &control_ = controlMultiStartDefault())
+  {
+    auto fit_ = [&](const arma::rowvec &parameterValues,
+                    const int maxIterOut,
+                    const int usedIterations,
+                    const optimizerState &warmStart)
+    {
+      controlGLMNET controlFit = controlOptimizer;
+      controlFit.checkpoint = controlCheckpointDefault();
+      controlFit.warmStart = warmStart;
+      controlFit.returnState = true;
+      if (maxIterOut > 0)
+      {
+        // the start is stopped deliberately before the pruning
+        controlFit.maxIterOut = std::min(maxIterOut, controlOptimizer.maxIterOut);
+        controlFit.warnNotConverged = false;
+      }
+      else
+      {
+        controlFit.maxIterOut = std::max(1, controlOptimizer.maxIterOut - usedIterations);
+      }
+      return (glmnet(model_,
+                     parameterValues,
+                     parameterLabels,
+                     penalty_,
+                     smoothPenalty_,
+                     tuningParameters,
+                     controlFit));
+    };
+    return (multiStart(startingValues, fit_, control_));
+  }
+
+  /**
+   * @brief multi-start optimization with the ista optimizer. The model, the proximal operator, and the
+   * penalties are shared by the starts, which can be fitted in parallel (see controlMultiStart::threads).
+   *
+   * @tparam T type of the tuning parameters of the proximal operator and the penalty
+   * @tparam U type of the tuning parameters of the smooth penalty
+   * @tparam modelClass class of the model (e.g., derived from model)
+   * @param model_ the model object derived from the model class in model.h or any class with the methods fit and gradients (see traits.h)
+   * @param startingValues an arma::rowvec vector with starting values
+   * @param parameterLabels a stringVector with parameter labels
+   * @param proximalOperator_ proximal operator used to compute the next parameters
+   * @param penalty_ non-smooth penalty
+   * @param smoothPenalty_ smooth penalty
+   * @param tuningParameters tuning parameters of the proximal operator and the penalty
+   * @param smoothTuningParameters tuning parameters of the smooth penalty
+   * @param controlOptimizer settings for the ista optimizer. Checkpoints are not written and the
+   * warm starts are set by the multi-start optimization.
+   * @param control_ settings for the multi-start optimization
+   * @return multiStartResults
+   */
+  template <typename T, typename U, class modelClass,
+            class proximalOperatorClass, class penaltyClass, class smoothPenaltyClass>
+  inline multiStartResults multiStartIsta(modelClass &model_,
+                                          const arma::rowvec &startingValues,
+                                          const stringVector &parameterLabels,
+                                          proximalOperatorClass &proximalOperator_,
+                                          penaltyClass &penalty_,
+                                          smoothPenaltyClass &smoothPenalty_,
+                                          const T &tuningParameters,
+                                          const U &smoothTuningParameters,
+                                          const control &controlOptimizer = controlDefault(),
+                                          const controlMultiStart &control_ = controlMultiStartDefault())
+  {
+    auto fit_ = [&](const arma::rowvec &parameterValues,
+                    const int maxIterOut,
+                    const int usedIterations,
+                    const optimizerState &warmStart)
+    {
+      control controlFit = controlOptimizer;
+      controlFit.checkpoint = controlCheckpointDefault();
+      controlFit.warmStart = warmStart;
+      controlFit.returnState = true;
+      // ista does not warn if it did not converge
+      if (maxIterOut > 0)
+        controlFit.maxIterOut = std::min(maxIterOut, controlOptimizer.maxIterOut);
+      else
+        controlFit.maxIterOut = std::max(1, controlOptimizer.maxIterOut - usedIterations);
+      return (ista(model_,
+                   parameterValues,
+                   parameterLabels,
+                   proximalOperator_,
+                   penalty_,
+                   smoothPenalty_,
+                   tuningParameters,
+                   smoothTuningParameters,
+                   controlFit));
+    };
+    return (multiStart(startingValues, fit_, control_));
+  }
+
+} // end namespace
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef OPTIMIZERSTATE_H
+#define OPTIMIZERSTATE_H
+#include <vector>
+#include "common_headers.h"
+
+namespace lessSEM
+{
+
+  /**
+   * @struct optimizerState
+   * @brief Internal state of an optimizer at the end of a fit. The state can be passed
+   * to the next fit (e.g., the next tuning parameter value on a regularization path, the next
+   * bootstrap sample, or an update of the data) with the warmStart setting of the optimizer.
+   * The next fit then starts close to the previous solution instead of from scratch. Elements
+   * which are empty are ignored.
+   *
+   * @var Hessian Hessian approximation (glmnet, bfgsOptim)
+   * @var L last accepted step size parameter (ista)
+   * @var momentum last change in parameters (parameters_k - parameters_kMinus1); used by the accelerated ista
+   * @var gradients gradients of the smooth part of the fit function at the final parameters
+   * @var activeSet indices of the parameters which are non-zero at the end of the fit. glmnet
+   * optimizes these parameters first in its first inner iteration.
+   */
+  struct optimizerState
+  {
+    arma::mat Hessian;
+    double L = 0.0;
+    arma::rowvec momentum;
+    arma::rowvec gradients;
+    std::vector<unsigned int> activeSet;
+  };
+
+  /**
+   * @brief returns the indices of all non-zero parameters
+   *
+   * @param parameterValues parameter values
+   * @return std::vector<unsigned int>
+   */
+  inline std::vector<unsigned int> getActiveSet(const arma::rowvec &parameterValues)
+  {
+    std::vector<unsigned int> activeSet;
+    for (unsigned int p = 0; p < parameterValues.n_elem; p++)
+    {
+      if (parameterValues.at(p) != 0.0)
+        activeSet.push_back(p);
+    }
+    return (activeSet);
+  }
+
+  /**
+   * @brief checks if a warm start Hessian can be used for a model with numberParameters parameters
+   *
+   * @param state warm start state
+   * @param numberParameters number of parameters
+   * @return bool
+   */
+  inline bool hasWarmStartHessian(const optimizerState &state,
+                                  const unsigned int numberParameters)
+  {
+    if (state.Hessian.n_elem == 0)
+      return (false);
+    if (state.Hessian.n_rows != numberParameters || state.Hessian.n_cols != numberParameters)
+      error("The Hessian of the warm start does not match the number of parameters.");
+    return (true);
+  }
+
+} // end namespace
+
+#endif
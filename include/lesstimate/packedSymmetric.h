@@ -0,0 +1,237 @@
+#ifndef PACKEDSYMMETRIC_H
+#define PACKEDSYMMETRIC_H
+#include <cmath>
+#include <cstdint>
+#include "common_headers.h"
+
+namespace lessSEM
+{
+
+  /**
+   * @brief returns the number of elements in the upper triangle (including the diagonal)
+   * of a symmetric numberParameters x numberParameters matrix
+   *
+   * @param numberParameters number of rows and columns
+   * @return std::uint64_t
+   */
+  inline std::uint64_t packedSize(const std::uint64_t numberParameters)
+  {
+    return (numberParameters * (numberParameters + 1) / 2);
+  }
+
+  /**
+   * @brief symmetric matrix of which only the upper triangle (including the diagonal)
+   * is stored. The elements are saved column by column: (0,0), (0,1), (1,1), (0,2), ...
+   * This halves the memory required for Hessian matrices.
+   *
+   */
+  class packedSymmetricMatrix
+  {
+  public:
+    using elem_type = double; // as in armadillo (see precision.h)
+
+    arma::uword n_rows = 0;
+    arma::uword n_cols = 0;
+    arma::vec packed;
+
+    packedSymmetricMatrix() {}
+
+    /**
+     * @brief Construct a new packed symmetric matrix with all elements set to zero
+     *
+     * @param n number of rows and columns
+     */
+    explicit packedSymmetricMatrix(const arma::uword n) : n_rows(n),
+                                                          n_cols(n),
+                                                          packed(packedSize(n), arma::fill::zeros)
+    {
+    }
+
+    /**
+     * @brief Construct a new packed symmetric matrix from a dense matrix. Only
+     * the upper triangle of the dense matrix is used.
+     *
+     * @param dense symmetric matrix
+     */
+    explicit packedSymmetricMatrix(const arma::mat &dense) : n_rows(dense.n_rows),
+                                                             n_cols(dense.n_cols),
+                                                             packed(packedSize(dense.n_rows))
+    {
+      if (dense.n_rows != dense.n_cols)
+        error("Only square matrices can be packed.");
+      for (arma::uword c = 0; c < n_cols; c++)
+        for (arma::uword r = 0; r <= c; r++)
+          packed.at(index(r, c)) = dense.at(r, c);
+    }
+
+    /**
+     * @brief returns the position of element (row, col) in the packed vector
+     *
+     * @param row row index
+     * @param col column index
+     * @return arma::uword
+     */
+    static arma::uword index(arma::uword row, arma::uword col)
+    {
+      if (row > col)
+        std::swap(row, col);
+      return (packedSize(col) + row);
+    }
+
+    /**
+     * @brief access element (row, col)
+     *
+     * @param row row index
+     * @param col column index
+     * @return double&
+     */
+    double &at(const arma::uword row, const arma::uword col)
+    {
+      return (packed.at(index(row, col)));
+    }
+
+    /**
+     * @brief access element (row, col)
+     *
+     * @param row row index
+     * @param col column index
+     * @return double
+     */
+    double at(const arma::uword row, const arma::uword col) const
+    {
+      return (packed.at(index(row, col)));
+    }
+
+    /**
+     * @brief returns the diagonal elements
+     *
+     * @return arma::colvec
+     */
+    arma::colvec diag() const
+    {
+      arma::colvec diagonal(n_rows);
+      for (arma::uword i = 0; i < n_rows; i++)
+        diagonal.at(i) = packed.at(index(i, i));
+      return (diagonal);
+    }
+
+    /**
+     * @brief returns the dense matrix
+     *
+     * @return arma::mat
+     */
+    arma::mat unpack() const
+    {
+      arma::mat dense(n_rows, n_cols);
+      for (arma::uword c = 0; c < n_cols; c++)
+      {
+        for (arma::uword r = 0; r <= c; r++)
+        {
+          dense.at(r, c) = packed.at(index(r, c));
+          dense.at(c, r) = packed.at(index(r, c));
+        }
+      }
+      return (dense);
+    }
+
+    /**
+     * @brief computes the product of the matrix with the vector x. Each stored
+     * element is read once.
+     *
+     * @param x vector with n_cols elements
+     * @return arma::colvec
+     */
+    arma::colvec times(const arma::colvec &x) const
+    {
+      arma::colvec result(n_rows, arma::fill::zeros);
+      arma::uword position = 0;
+      for (arma::uword c = 0; c < n_cols; c++)
+      {
+        double sum = 0.0;
+        for (arma::uword r = 0; r < c; r++)
+        {
+          const double element = packed.at(position++);
+          result.at(r) += element * x.at(c);
+          sum += element * x.at(r);
+        }
+        result.at(c) += sum + packed.at(position++) * x.at(c);
+      }
+      return (result);
+    }
+
+    /**
+     * @brief symmetric rank one update: matrix = matrix + alpha * x * x^T
+     *
+     * @param alpha scaling of the update
+     * @param x vector with n_rows elements
+     */
+    void rankOneUpdate(const double alpha, const arma::colvec &x)
+    {
+      arma::uword position = 0;
+      for (arma::uword c = 0; c < n_cols; c++)
+      {
+        const double scaled = alpha * x.at(c);
+        for (arma::uword r = 0; r <= c; r++)
+          packed.at(position++) += scaled * x.at(r);
+      }
+    }
+
+    /**
+     * @brief solves matrix * solution = rightHandSide with a Cholesky decomposition
+     * matrix = U^T U. The factor U is stored in the same packed form and both triangular
+     * systems are solved column by column, so that the packed elements are read in order.
+     *
+     * @param solution vector with the solution
+     * @param rightHandSide vector with n_rows elements
+     * @return false if the matrix is not positive definite; solution is then unchanged
+     */
+    bool choleskySolve(arma::colvec &solution, const arma::colvec &rightHandSide) const
+    {
+      // factorize (see e.g., Golub, G. H., & Van Loan, C. F. (2013). Matrix computations
+      // (4th ed). Johns Hopkins University Press, Algorithm 4.2.2)
+      arma::vec factor(packed.n_elem);
+      for (arma::uword c = 0; c < n_cols; c++)
+      {
+        const arma::uword column = packedSize(c);
+        double diagonal = packed.at(column + c);
+        for (arma::uword r = 0; r < c; r++)
+        {
+          const arma::uword row = packedSize(r);
+          double element = packed.at(column + r);
+          for (arma::uword k = 0; k < r; k++)
+            element -= factor.at(row + k) * factor.at(column + k);
+          element /= factor.at(row + r);
+          factor.at(column + r) = element;
+          diagonal -= element * element;
+        }
+        if (!(diagonal > 0.0) || !std::isfinite(diagonal))
+          return (false);
+        factor.at(column + c) = std::sqrt(diagonal);
+      }
+
+      // U^T z = rightHandSide
+      arma::colvec z = rightHandSide;
+      for (arma::uword c = 0; c < n_cols; c++)
+      {
+        const arma::uword column = packedSize(c);
+        for (arma::uword r = 0; r < c; r++)
+          z.at(c) -= factor.at(column + r) * z.at(r);
+        z.at(c) /= factor.at(column + c);
+      }
+
+      // U solution = z
+      for (arma::uword c = n_cols; c-- > 0;)
+      {
+        const arma::uword column = packedSize(c);
+        z.at(c) /= factor.at(column + c);
+        for (arma::uword r = 0; r < c; r++)
+          z.at(r) -= factor.at(column + r) * z.at(c);
+      }
+      solution = z;
+      return (true);
+    }
+  };
+
+} // end namespace
+
+#endif
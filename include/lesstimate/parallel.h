@@ -0,0 +1,87 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "common_headers.h"
+
+namespace lessSEM
+{
+
+  /**
+   * @brief returns the number of threads which should be used
+   *
+   * @param threads requested number of threads. 0 uses all available cores.
+   * @param numberTasks number of independent tasks
+   * @return int
+   */
+  inline int numberThreads(int threads, const unsigned int numberTasks)
+  {
+#if USE_R
+    // the R API must not be called from multiple threads
+    threads = 1;
+#endif
+    if (threads <= 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<int>(threads, std::max(1u, numberTasks));
+    return (threads);
+  }
+
+  /**
+   * @brief calls task(i) for i = 0, ..., numberTasks-1 distributed over several threads.
+   * The tasks must be independent of each other. Exceptions thrown by a task are rethrown
+   * after all threads have finished.
+   *
+   * @param numberTasks number of tasks
+   * @param threads number of threads. 0 uses all available cores; 1 runs all tasks in the
+   * calling thread.
+   * @param task function called with the index of the task
+   */
+  inline void parallelFor(const unsigned int numberTasks,
+                          const int threads,
+                          const std::function<void(unsigned int)> &task)
+  {
+    const int usedThreads = numberThreads(threads, numberTasks);
+
+    if (usedThreads <= 1)
+    {
+      for (unsigned int i = 0; i < numberTasks; i++)
+        task(i);
+      return;
+    }
+
+    std::atomic<unsigned int> next(0);
+    std::exception_ptr failure = nullptr;
+    std::mutex failureMutex;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < usedThreads; t++)
+    {
+      workers.emplace_back([&]()
+                           {
+        for (unsigned int i = next++; i < numberTasks; i = next++)
+        {
+          try
+          {
+            task(i);
+          }
+          catch (...)
+          {
+            std::lock_guard<std::mutex> lock(failureMutex);
+            if (!failure)
+              failure = std::current_exception();
+          }
+        } });
+    }
+    for (std::thread &worker : workers)
+      worker.join();
+    if (failure)
+      std::rethrow_exception(failure);
+  }
+
+} // end namespace
+
+#endif
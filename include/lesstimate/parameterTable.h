@@ -0,0 +1,135 @@
+#ifndef PARAMETERTABLE_H
+#define PARAMETERTABLE_H
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common_headers.h"
+
+// The parameters are passed to the models and penalties as an arma::rowvec with
+// the values and a stringVector with the labels. Most models and penalties only
+// need the position of a parameter, not its label. Looking up labels (or copying
+// the stringVector) in every evaluation of the fit function is expensive when the
+// model is evaluated millions of times.
+//
+// parameterTable maps each label to its position once. A model can create the
+// table in its constructor and then use the indices in fit and gradients. Models and
+// penalties which do not need the labels at all can implement the methods without
+// the parameterLabels argument (e.g., double fit(const arma::rowvec &parameterValues));
+// the optimizers then do not pass the labels (see traits.h). The label-based methods
+// remain supported.
+
+namespace lessSEM
+{
+
+  /**
+   * @brief maps the labels of the parameters to their position in the parameter vector
+   *
+   */
+  class parameterTable
+  {
+  public:
+    /**
+     * @brief Construct a new parameter table. Throws an error if a label is used twice.
+     *
+     * @param parameterLabels labels of the parameters
+     */
+    explicit parameterTable(const stringVector &parameterLabels)
+    {
+      const unsigned int numberParameters = parameterLabels.size();
+      labels.reserve(numberParameters);
+      indices.reserve(numberParameters);
+      for (unsigned int p = 0; p < numberParameters; p++)
+      {
+        labels.push_back(std::string(parameterLabels.at(p)));
+        if (!indices.emplace(labels.back(), p).second)
+          error("The parameter label " + labels.back() + " is used more than once.");
+      }
+    }
+
+    /**
+     * @brief number of parameters
+     *
+     * @return unsigned int
+     */
+    unsigned int size() const
+    {
+      return (labels.size());
+    }
+
+    /**
+     * @brief checks if the table contains a parameter with this label
+     *
+     * @param label label of the parameter
+     * @return bool
+     */
+    bool contains(const std::string &label) const
+    {
+      return (indices.find(label) != indices.end());
+    }
+
+    /**
+     * @brief returns the position of the parameter with this label. Throws an error if
+     * the label is unknown.
+     *
+     * @param label label of the parameter
+     * @return unsigned int
+     */
+    unsigned int index(const std::string &label) const
+    {
+      const auto found = indices.find(label);
+      if (found == indices.end())
+        error("Unknown parameter label " + label + ".");
+      return (found->second);
+    }
+
+    /**
+     * @brief returns the positions of several parameters
+     *
+     * @param parameterLabels labels of the parameters
+     * @return arma::uvec
+     */
+    arma::uvec index(const stringVector &parameterLabels) const
+    {
+      arma::uvec positions(parameterLabels.size());
+      for (unsigned int p = 0; p < positions.n_elem; p++)
+        positions.at(p) = index(std::string(parameterLabels.at(p)));
+      return (positions);
+    }
+
+    /**
+     * @brief returns the label of the parameter at position whichPar
+     *
+     * @param whichPar position of the parameter
+     * @return const std::string&
+     */
+    const std::string &label(const unsigned int whichPar) const
+    {
+      return (labels.at(whichPar));
+    }
+
+    /**
+     * @brief checks if parameterLabels lists the parameters of the table in the same order
+     *
+     * @param parameterLabels labels of the parameters
+     * @return bool
+     */
+    bool matches(const stringVector &parameterLabels) const
+    {
+      if ((unsigned int)parameterLabels.size() != labels.size())
+        return (false);
+      for (unsigned int p = 0; p < labels.size(); p++)
+      {
+        if (std::string(parameterLabels.at(p)) != labels.at(p))
+          return (false);
+      }
+      return (true);
+    }
+
+  private:
+    std::vector<std::string> labels;
+    std::unordered_map<std::string, unsigned int> indices;
+  };
+
+} // end namespace
+
+#endif
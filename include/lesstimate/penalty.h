@@ -1,6 +1,7 @@
 #ifndef PENALTY_H
 #define PENALTY_H
 #include "common_headers.h"
+#include "subgradients.h"
 
 namespace lessSEM{
 
@@ -26,6 +27,25 @@ public:
   virtual double getValue(const arma::rowvec& parameterValues,
                           const stringVector& parameterLabels,
                           const T& tuningParameters) = 0;
+  
+  /**
+   * @brief return the subgradients of the penalized fit function (see subgradients.h). At
+   * an optimum, all subgradients are zero. Penalties which do not implement this
+   * function cannot be used with the KKT based convergence criteria.
+   * 
+   * @param parameterValues current parameter values
+   * @param gradients gradients of the smooth part of the fit function
+   * @param tuningParameters tuning parameters of the penalty function
+   * @return arma::rowvec 
+   */
+  virtual arma::rowvec getSubgradients(const arma::rowvec& parameterValues,
+                                       const arma::rowvec& gradients,
+                                       const T& tuningParameters){
+    static_cast<void>(parameterValues); // is unused
+    static_cast<void>(tuningParameters); // is unused
+    error("Subgradients are not implemented for this penalty. Use a different convergence criterion.");
+    return(gradients);
+  }
 };
 }
 
@@ -0,0 +1,207 @@
+#ifndef PRECISION_H
+#define PRECISION_H
+#include <type_traits>
+#include "common_headers.h"
+#include "packedSymmetric.h"
+
+// The Hessian approximation is the only object of the optimizers which grows with
+// the square of the number of parameters. For large models, storing it in single
+// precision halves the memory and the memory bandwidth of the BFGS updates and of
+// the solves for the step direction. bfgsOptim therefore takes the scalar type of
+// the Hessian as an optional template parameter (e.g., less::bfgsOptim<0, float>(...)).
+//
+// This is a mixed precision mode: Parameters, gradients, and fits are always computed
+// in double (the model returns doubles), and all sums in the BFGS update are accumulated
+// in double before the result is rounded to the scalar type of the Hessian. Once the
+// single precision optimization stops, bfgsOptim polishes the solution with at most
+// maxPolishIterations iterations in double precision (see bfgsOptim.h).
+//
+// The scope of this mode is the storage of the Hessian in bfgsOptim: the models, the
+// penalties, and the proximal operators (and therefore ista and glmnet) always work in
+// double precision.
+//
+// The functions below convert between the storage of the Hessian and double. They also
+// support the packed storage of the upper triangle (packedSymmetricMatrix, see
+// packedSymmetric.h), which bfgsOptim uses with controlBFGS::packedHessian.
+
+namespace lessSEM
+{
+
+  // maximal number of double precision iterations which polish a single precision solution
+  const int maxPolishIterations = 10;
+
+  /**
+   * @brief converts a double precision Hessian to the storage used by the optimizer
+   *
+   * @tparam matType storage of the Hessian (arma::mat, arma::fmat, the fixed versions, see fixedSize.h, or packedSymmetricMatrix)
+   * @param Hessian double precision Hessian
+   * @return matType
+   */
+  template <class matType>
+  inline matType toHessianType(const arma::mat &Hessian)
+  {
+    using eT = typename matType::elem_type;
+    static_assert(std::is_floating_point<eT>::value,
+                  "The Hessian must be stored as float or double.");
+    if constexpr (std::is_same<matType, packedSymmetricMatrix>::value)
+    {
+      return (packedSymmetricMatrix(Hessian));
+    }
+    else if constexpr (std::is_same<eT, double>::value)
+    {
+      matType converted = Hessian;
+      return (converted);
+    }
+    else
+    {
+      matType converted;
+      converted = arma::conv_to<arma::Mat<eT>>::from(Hessian);
+      return (converted);
+    }
+  }
+
+  /**
+   * @brief converts a Hessian to double precision
+   *
+   * @tparam eT scalar type of the Hessian
+   * @param Hessian Hessian
+   * @return arma::mat
+   */
+  template <typename eT>
+  inline arma::mat toDoubleMatrix(const arma::Mat<eT> &Hessian)
+  {
+    if constexpr (std::is_same<eT, double>::value)
+      return (Hessian);
+    else
+      return (arma::conv_to<arma::mat>::from(Hessian));
+  }
+
+  /**
+   * @brief returns the diagonal of a Hessian in double precision
+   *
+   * @tparam eT scalar type of the Hessian
+   * @param Hessian Hessian
+   * @return arma::colvec
+   */
+  template <typename eT>
+  inline arma::colvec hessianDiagonal(const arma::Mat<eT> &Hessian)
+  {
+    if constexpr (std::is_same<eT, double>::value)
+      return (Hessian.diag());
+    else
+      return (arma::conv_to<arma::colvec>::from(Hessian.diag()));
+  }
+
+  /**
+   * @brief computes x * Hessian * x' with accumulation in double precision
+   *
+   * @tparam eT scalar type of the Hessian
+   * @param x vector
+   * @param Hessian Hessian
+   * @return double
+   */
+  template <typename eT>
+  inline double quadraticForm(const arma::rowvec &x,
+                              const arma::Mat<eT> &Hessian)
+  {
+    if constexpr (std::is_same<eT, double>::value)
+    {
+      return (arma::as_scalar(x * Hessian * arma::trans(x)));
+    }
+    else
+    {
+      double result = 0.0;
+      for (arma::uword c = 0; c < Hessian.n_cols; c++)
+      {
+        double column = 0.0;
+        for (arma::uword r = 0; r < Hessian.n_rows; r++)
+          column += static_cast<double>(Hessian.at(r, c)) * x.at(r);
+        result += column * x.at(c);
+      }
+      return (result);
+    }
+  }
+
+  /**
+   * @brief computes the quasi-Newton step direction -Hessian^(-1) * gradients. For a single
+   * precision Hessian, the linear system is solved in single precision and the
+   * direction is returned in double.
+   *
+   * @tparam eT scalar type of the Hessian
+   * @param Hessian Hessian
+   * @param gradients gradients
+   * @return arma::rowvec
+   */
+  template <typename eT>
+  inline arma::rowvec quasiNewtonDirection(const arma::Mat<eT> &Hessian,
+                                           const arma::rowvec &gradients)
+  {
+    if constexpr (std::is_same<eT, double>::value)
+    {
+      return (-arma::trans(arma::solve(Hessian, arma::trans(gradients))));
+    }
+    else
+    {
+      const arma::Col<eT> rightHandSide = arma::conv_to<arma::Col<eT>>::from(gradients);
+      const arma::Col<eT> step = arma::solve(Hessian, rightHandSide);
+      return (-arma::conv_to<arma::rowvec>::from(step));
+    }
+  }
+
+  /**
+   * @brief converts a packed Hessian to a dense matrix
+   *
+   * @param Hessian packed Hessian
+   * @return arma::mat
+   */
+  inline arma::mat toDoubleMatrix(const packedSymmetricMatrix &Hessian)
+  {
+    return (Hessian.unpack());
+  }
+
+  /**
+   * @brief returns the diagonal of a packed Hessian
+   *
+   * @param Hessian packed Hessian
+   * @return arma::colvec
+   */
+  inline arma::colvec hessianDiagonal(const packedSymmetricMatrix &Hessian)
+  {
+    return (Hessian.diag());
+  }
+
+  /**
+   * @brief computes x * Hessian * x' for a packed Hessian
+   *
+   * @param x vector
+   * @param Hessian packed Hessian
+   * @return double
+   */
+  inline double quadraticForm(const arma::rowvec &x,
+                              const packedSymmetricMatrix &Hessian)
+  {
+    const arma::colvec column = arma::trans(x);
+    return (arma::dot(column, Hessian.times(column)));
+  }
+
+  /**
+   * @brief computes the quasi-Newton step direction -Hessian^(-1) * gradients for a packed
+   * Hessian with a packed Cholesky decomposition. If the Hessian is not positive definite,
+   * the dense matrix is solved instead.
+   *
+   * @param Hessian packed Hessian
+   * @param gradients gradients
+   * @return arma::rowvec
+   */
+  inline arma::rowvec quasiNewtonDirection(const packedSymmetricMatrix &Hessian,
+                                           const arma::rowvec &gradients)
+  {
+    arma::colvec step;
+    if (!Hessian.choleskySolve(step, arma::trans(gradients)))
+      step = arma::solve(Hessian.unpack(), arma::colvec(arma::trans(gradients)));
+    return (-arma::trans(step));
+  }
+
+} // end namespace
+
+#endif
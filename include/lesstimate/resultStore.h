@@ -0,0 +1,696 @@
+#ifndef RESULTSTORE_H
+#define RESULTSTORE_H
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include "common_headers.h"
+#include "fitResults.h"
+#include "packedSymmetric.h"
+
+// memory mapping is only used on POSIX systems; all other systems read the files into memory
+#if defined(__unix__) || defined(__APPLE__)
+#define LESSTIMATE_MMAP 1
+#else
+#define LESSTIMATE_MMAP 0
+#endif
+
+#if LESSTIMATE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Regularization paths and cross-validation produce thousands of fitResults.
+// Keeping all of them in memory is expensive (especially the Hessians). The
+// result store writes the results column by column to a set of binary files
+// which share a common prefix:
+//
+// <prefix>.meta   header (magic, version, number of parameters, number of tuning values, hessian flag)
+// <prefix>.fit    double per result: final fit
+// <prefix>.conv   uint8 per result: convergence
+// <prefix>.tun    numberTuning doubles per result: tuning parameter values (e.g., lambda, alpha)
+// <prefix>.par    sparse parameter vectors (see encodeSparseParameters)
+// <prefix>.paro   uint64 per result: end of the result in <prefix>.par (in bytes)
+// <prefix>.hess   p(p+1)/2 doubles per result: upper triangle of the Hessian in column-major order (optional)
+// <prefix>.trc    fit traces (fits of the outer iterations without trailing NAs)
+// <prefix>.trco   uint64 per result: end of the trace in <prefix>.trc (in doubles)
+//
+// Results can be appended while the optimization is still running. The fit
+// column is written last and is used to determine the number of complete
+// results. The reader maps all files into memory; fits, tuning values,
+// Hessians and traces can be accessed without copying the data.
+//
+// The store is not included by lesstimate.h; include lesstimate/resultStore.h
+// explicitly to use it.
+
+namespace lessSEM
+{
+
+  const char resultStoreMagic[4] = {'L', 'S', 'R', 'S'};
+  const std::uint32_t resultStoreVersion = 1;
+
+  /**
+   * @brief sparse encoding of a parameter vector. The vector is stored as a sequence
+   * of runs; each run consists of an uint32 with the number of zeros, an uint32 with the
+   * number of non-zero elements which follow, and the non-zero elements themselves.
+   * Regularized models often set many parameters to zero, so that long runs of zeros
+   * are stored in 4 bytes.
+   *
+   * @param parameterValues parameter values
+   * @return std::vector<char>
+   */
+  inline std::vector<char> encodeSparseParameters(const arma::rowvec &parameterValues)
+  {
+    std::vector<char> encoded;
+    std::uint32_t p = 0;
+    const std::uint32_t nElem = parameterValues.n_elem;
+    while (p < nElem)
+    {
+      std::uint32_t zeros = 0;
+      while (p + zeros < nElem && parameterValues.at(p + zeros) == 0.0)
+        zeros++;
+      std::uint32_t nonZeros = 0;
+      while (p + zeros + nonZeros < nElem && parameterValues.at(p + zeros + nonZeros) != 0.0)
+        nonZeros++;
+
+      const std::size_t start = encoded.size();
+      encoded.resize(start + 2 * sizeof(std::uint32_t) + nonZeros * sizeof(double));
+      std::memcpy(&encoded[start], &zeros, sizeof(std::uint32_t));
+      std::memcpy(&encoded[start + sizeof(std::uint32_t)], &nonZeros, sizeof(std::uint32_t));
+      if (nonZeros > 0)
+        std::memcpy(&encoded[start + 2 * sizeof(std::uint32_t)],
+                    parameterValues.memptr() + p + zeros,
+                    nonZeros * sizeof(double));
+      p += zeros + nonZeros;
+    }
+    return (encoded);
+  }
+
+  /**
+   * @brief decode a sparse parameter vector (see encodeSparseParameters)
+   *
+   * @param data pointer to the start of the encoded vector
+   * @param nBytes length of the encoded vector
+   * @param numberParameters number of parameters
+   * @return arma::rowvec
+   */
+  inline arma::rowvec decodeSparseParameters(const char *data,
+                                             const std::uint64_t nBytes,
+                                             const std::uint64_t numberParameters)
+  {
+    arma::rowvec parameterValues(numberParameters, arma::fill::zeros);
+    std::uint64_t position = 0, p = 0;
+    while (position < nBytes)
+    {
+      std::uint32_t zeros, nonZeros;
+      std::memcpy(&zeros, data + position, sizeof(std::uint32_t));
+      std::memcpy(&nonZeros, data + position + sizeof(std::uint32_t), sizeof(std::uint32_t));
+      position += 2 * sizeof(std::uint32_t);
+      p += zeros;
+      if (p + nonZeros > numberParameters)
+        error("Corrupted parameter vector in result store.");
+      std::memcpy(parameterValues.memptr() + p, data + position, nonZeros * sizeof(double));
+      position += nonZeros * sizeof(double);
+      p += nonZeros;
+    }
+    return (parameterValues);
+  }
+
+  /**
+   * @brief writes fit results to a result store. Results are appended to the
+   * files; the store can be read while it is being written.
+   *
+   */
+  class resultStoreWriter
+  {
+  public:
+    /**
+     * @brief Construct a new result store writer. If a store with the same prefix
+     * already exists, the new results are appended to that store.
+     *
+     * @param prefix_ prefix of the files
+     * @param numberParameters_ number of parameters of each result
+     * @param numberTuning_ number of tuning parameter values stored with each result
+     * @param storeHessian_ should the Hessians be stored?
+     */
+    resultStoreWriter(const std::string &prefix_,
+                      const unsigned int numberParameters_,
+                      const unsigned int numberTuning_ = 0,
+                      const bool storeHessian_ = false) : prefix(prefix_),
+                                                          numberParameters(numberParameters_),
+                                                          numberTuning(numberTuning_),
+                                                          storeHessian(storeHessian_)
+    {
+      std::ifstream existing(prefix + ".meta", std::ios::binary);
+      if (existing)
+      {
+        checkMeta(existing);
+        existing.close();
+        truncateIncomplete();
+      }
+      else
+      {
+        std::ofstream meta(prefix + ".meta", std::ios::binary | std::ios::trunc);
+        meta.write(resultStoreMagic, 4);
+        writeValue(meta, resultStoreVersion);
+        writeValue<std::uint64_t>(meta, numberParameters);
+        writeValue<std::uint64_t>(meta, numberTuning);
+        writeValue<std::uint8_t>(meta, storeHessian);
+        if (!meta)
+          error("Could not create result store " + prefix);
+      }
+
+      open(fitFile, ".fit");
+      open(convergenceFile, ".conv");
+      open(tuningFile, ".tun");
+      open(parameterFile, ".par");
+      open(parameterOffsetFile, ".paro");
+      open(hessianFile, ".hess");
+      open(traceFile, ".trc");
+      open(traceOffsetFile, ".trco");
+    }
+
+    /**
+     * @brief append a result to the store
+     *
+     * @param fitResults_ fit results returned by the optimizer
+     * @param tuningValues tuning parameter values used in this fit (must be of length numberTuning)
+     */
+    void append(const fitResults &fitResults_,
+                const arma::rowvec &tuningValues = arma::rowvec())
+    {
+      if (fitResults_.parameterValues.n_elem != numberParameters)
+        error("Number of parameters does not match the result store.");
+      if (tuningValues.n_elem != numberTuning)
+        error("Number of tuning values does not match the result store.");
+
+      // parameters
+      std::vector<char> encoded = encodeSparseParameters(fitResults_.parameterValues);
+      parameterFile.write(encoded.data(), encoded.size());
+      parameterEnd += encoded.size();
+      writeValue(parameterOffsetFile, parameterEnd);
+
+      // tuning values
+      tuningFile.write(reinterpret_cast<const char *>(tuningValues.memptr()),
+                       sizeof(double) * numberTuning);
+
+      // Hessian (upper triangle)
+      if (storeHessian)
+      {
+        if (fitResults_.HessianPacked.n_rows == numberParameters)
+        {
+          // already packed; same layout as in the store
+          hessianFile.write(reinterpret_cast<const char *>(fitResults_.HessianPacked.packed.memptr()),
+                            sizeof(double) * packedSize(numberParameters));
+        }
+        else if (fitResults_.Hessian.n_rows == numberParameters &&
+                 fitResults_.Hessian.n_cols == numberParameters)
+        {
+          for (unsigned int c = 0; c < numberParameters; c++)
+            hessianFile.write(reinterpret_cast<const char *>(fitResults_.Hessian.colptr(c)),
+                              sizeof(double) * (c + 1));
+        }
+        else
+        {
+          error("The fit results do not contain a full or packed Hessian of the correct size.");
+        }
+      }
+
+      // trace: drop trailing iterations which have not been used
+      std::uint64_t traceLength = fitResults_.fits.n_elem;
+      while (traceLength > 0 && !arma::is_finite(fitResults_.fits.at(traceLength - 1)))
+        traceLength--;
+      traceFile.write(reinterpret_cast<const char *>(fitResults_.fits.memptr()),
+                      sizeof(double) * traceLength);
+      traceEnd += traceLength;
+      writeValue(traceOffsetFile, traceEnd);
+
+      writeValue<std::uint8_t>(convergenceFile, fitResults_.convergence);
+
+      // flush all columns before writing the fit which marks the result as complete
+      for (std::ofstream *file : {&parameterFile, &parameterOffsetFile, &tuningFile,
+                                  &hessianFile, &traceFile, &traceOffsetFile, &convergenceFile})
+        file->flush();
+      writeValue(fitFile, fitResults_.fit);
+      fitFile.flush();
+
+      if (!fitFile)
+        error("Could not write to result store " + prefix);
+    }
+
+  private:
+    std::string prefix;
+    std::uint64_t numberParameters;
+    std::uint64_t numberTuning;
+    bool storeHessian;
+    std::uint64_t parameterEnd = 0;
+    std::uint64_t traceEnd = 0;
+    std::ofstream fitFile, convergenceFile, tuningFile, parameterFile,
+        parameterOffsetFile, hessianFile, traceFile, traceOffsetFile;
+
+    template <typename T>
+    static void writeValue(std::ostream &out, const T &value)
+    {
+      out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static T readValue(std::istream &in)
+    {
+      T value;
+      in.read(reinterpret_cast<char *>(&value), sizeof(T));
+      return (value);
+    }
+
+    static std::uint64_t fileSize(const std::string &file)
+    {
+      std::ifstream in(file, std::ios::binary | std::ios::ate);
+      if (!in)
+        return (0);
+      return (static_cast<std::uint64_t>(in.tellg()));
+    }
+
+    static std::uint64_t readOffset(const std::string &file, const std::uint64_t index)
+    {
+      std::ifstream in(file, std::ios::binary);
+      in.seekg(index * sizeof(std::uint64_t));
+      std::uint64_t offset = readValue<std::uint64_t>(in);
+      if (!in)
+        error("Corrupted result store: could not read " + file);
+      return (offset);
+    }
+
+    // If the program stopped while a result was appended, some columns
+    // contain data of an incomplete result. All columns are truncated to
+    // the results which have a fit (the fit is written last).
+    void truncateIncomplete()
+    {
+      const std::uint64_t numberResults = fileSize(prefix + ".fit") / sizeof(double);
+      parameterEnd = numberResults == 0 ? 0 : readOffset(prefix + ".paro", numberResults - 1);
+      traceEnd = numberResults == 0 ? 0 : readOffset(prefix + ".trco", numberResults - 1);
+
+      const std::vector<std::pair<std::string, std::uint64_t>> expectedSizes = {
+          {".fit", numberResults * sizeof(double)},
+          {".conv", numberResults * sizeof(std::uint8_t)},
+          {".tun", numberResults * numberTuning * sizeof(double)},
+          {".par", parameterEnd},
+          {".paro", numberResults * sizeof(std::uint64_t)},
+          {".hess", storeHessian ? numberResults * packedSize(numberParameters) * sizeof(double) : 0},
+          {".trc", traceEnd * sizeof(double)},
+          {".trco", numberResults * sizeof(std::uint64_t)}};
+
+      for (const auto &expected : expectedSizes)
+      {
+        const std::string file = prefix + expected.first;
+        if (fileSize(file) < expected.second)
+          error("Corrupted result store: " + file + " is too short.");
+        if (fileSize(file) > expected.second)
+          std::filesystem::resize_file(file, expected.second);
+      }
+    }
+
+    void open(std::ofstream &file, const std::string &suffix)
+    {
+      file.open(prefix + suffix, std::ios::binary | std::ios::app);
+      if (!file)
+        error("Could not open " + prefix + suffix);
+    }
+
+    void checkMeta(std::istream &meta)
+    {
+      char magic[4];
+      meta.read(magic, 4);
+      if (!meta || !std::equal(magic, magic + 4, resultStoreMagic))
+        error(prefix + " is not a lesstimate result store.");
+      if (readValue<std::uint32_t>(meta) != resultStoreVersion)
+        error("Unsupported result store version in " + prefix);
+      if (readValue<std::uint64_t>(meta) != numberParameters ||
+          readValue<std::uint64_t>(meta) != numberTuning ||
+          (readValue<std::uint8_t>(meta) != 0) != storeHessian)
+        error("The existing result store " + prefix + " uses different settings.");
+    }
+  };
+
+  /**
+   * @brief read-only memory mapping of a file. On systems without POSIX memory
+   * mapping (e.g., Windows), the file is read into memory instead.
+   *
+   */
+  class mappedFile
+  {
+  public:
+    /**
+     * @brief map a file into memory
+     *
+     * @param file name of the file
+     */
+    explicit mappedFile(const std::string &file)
+    {
+#if LESSTIMATE_MMAP
+      int fd = ::open(file.c_str(), O_RDONLY);
+      if (fd < 0)
+        error("Could not open " + file);
+      struct stat info;
+      if (::fstat(fd, &info) != 0)
+      {
+        ::close(fd);
+        error("Could not open " + file);
+      }
+      length = static_cast<std::uint64_t>(info.st_size);
+      if (length > 0)
+      {
+        // private mapping: accidental writes through the arma views
+        // are never written back to the file
+        void *mapped = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED)
+        {
+          ::close(fd);
+          error("Could not map " + file);
+        }
+        data_ = static_cast<char *>(mapped);
+      }
+      ::close(fd);
+#else
+      std::FILE *in = std::fopen(file.c_str(), "rb");
+      if (in == nullptr)
+        error("Could not open " + file);
+      std::fseek(in, 0, SEEK_END);
+      length = static_cast<std::uint64_t>(std::ftell(in));
+      std::fseek(in, 0, SEEK_SET);
+      buffer.resize(length);
+      const bool complete = std::fread(buffer.data(), 1, length, in) == length;
+      std::fclose(in);
+      if (!complete)
+        error("Could not read " + file);
+      data_ = buffer.data();
+#endif
+    }
+
+    mappedFile(const mappedFile &) = delete;
+    mappedFile &operator=(const mappedFile &) = delete;
+
+    ~mappedFile()
+    {
+#if LESSTIMATE_MMAP
+      if (data_ != nullptr)
+        ::munmap(data_, length);
+#endif
+    }
+
+    /**
+     * @brief pointer to the start of the file
+     *
+     * @return char*
+     */
+    char *data() const
+    {
+      return (data_);
+    }
+
+    /**
+     * @brief size of the file in bytes
+     *
+     * @return std::uint64_t
+     */
+    std::uint64_t size() const
+    {
+      return (length);
+    }
+
+  private:
+    char *data_ = nullptr;
+    std::uint64_t length = 0;
+#if !LESSTIMATE_MMAP
+    std::vector<char> buffer;
+#endif
+  };
+
+  /**
+   * @brief reads a result store. All columns are memory mapped. The number of results
+   * is fixed when the reader is created; create a new reader to see results which were
+   * appended later on.
+   *
+   */
+  class resultStoreReader
+  {
+  public:
+    /**
+     * @brief open a result store
+     *
+     * @param prefix_ prefix of the files
+     */
+    explicit resultStoreReader(const std::string &prefix_) : prefix(prefix_)
+    {
+      std::ifstream meta(prefix + ".meta", std::ios::binary);
+      char magic[4];
+      meta.read(magic, 4);
+      if (!meta || !std::equal(magic, magic + 4, resultStoreMagic))
+        error(prefix + " is not a lesstimate result store.");
+      std::uint32_t version;
+      meta.read(reinterpret_cast<char *>(&version), sizeof(version));
+      if (version != resultStoreVersion)
+        error("Unsupported result store version in " + prefix);
+      meta.read(reinterpret_cast<char *>(&numberParameters), sizeof(numberParameters));
+      meta.read(reinterpret_cast<char *>(&numberTuning), sizeof(numberTuning));
+      std::uint8_t hessianFlag;
+      meta.read(reinterpret_cast<char *>(&hessianFlag), sizeof(hessianFlag));
+      if (!meta)
+        error("Corrupted result store " + prefix);
+      hasHessian = hessianFlag != 0;
+
+      fitFile = std::make_unique<mappedFile>(prefix + ".fit");
+      convergenceFile = std::make_unique<mappedFile>(prefix + ".conv");
+      tuningFile = std::make_unique<mappedFile>(prefix + ".tun");
+      parameterFile = std::make_unique<mappedFile>(prefix + ".par");
+      parameterOffsetFile = std::make_unique<mappedFile>(prefix + ".paro");
+      hessianFile = std::make_unique<mappedFile>(prefix + ".hess");
+      traceFile = std::make_unique<mappedFile>(prefix + ".trc");
+      traceOffsetFile = std::make_unique<mappedFile>(prefix + ".trco");
+
+      // the fit is written last; it defines the number of complete results
+      numberResults = fitFile->size() / sizeof(double);
+    }
+
+    /**
+     * @brief number of results in the store
+     *
+     * @return std::uint64_t
+     */
+    std::uint64_t size() const
+    {
+      return (numberResults);
+    }
+
+    /**
+     * @brief number of parameters of each result
+     *
+     * @return std::uint64_t
+     */
+    std::uint64_t nParameters() const
+    {
+      return (numberParameters);
+    }
+
+    /**
+     * @brief returns true if the Hessians were stored
+     *
+     * @return bool
+     */
+    bool storesHessian() const
+    {
+      return (hasHessian);
+    }
+
+    /**
+     * @brief final fit of result i
+     *
+     * @param i index of the result
+     * @return double
+     */
+    double fit(const std::uint64_t i) const
+    {
+      check(i);
+      return (column<double>(*fitFile)[i]);
+    }
+
+    /**
+     * @brief returns all final fits without copying
+     *
+     * @return arma::rowvec
+     */
+    arma::rowvec fits() const
+    {
+      return (view(column<double>(*fitFile), numberResults));
+    }
+
+    /**
+     * @brief convergence of result i
+     *
+     * @param i index of the result
+     * @return bool
+     */
+    bool convergence(const std::uint64_t i) const
+    {
+      check(i);
+      return (column<std::uint8_t>(*convergenceFile)[i] != 0);
+    }
+
+    /**
+     * @brief tuning parameter values of result i (without copying)
+     *
+     * @param i index of the result
+     * @return arma::rowvec
+     */
+    arma::rowvec tuning(const std::uint64_t i) const
+    {
+      check(i);
+      return (view(column<double>(*tuningFile) + i * numberTuning, numberTuning));
+    }
+
+    /**
+     * @brief parameter values of result i. The parameters are stored sparsely
+     * and have to be decoded.
+     *
+     * @param i index of the result
+     * @return arma::rowvec
+     */
+    arma::rowvec parameters(const std::uint64_t i) const
+    {
+      check(i);
+      const std::uint64_t *offsets = column<std::uint64_t>(*parameterOffsetFile);
+      const std::uint64_t start = i == 0 ? 0 : offsets[i - 1];
+      return (decodeSparseParameters(parameterFile->data() + start,
+                                     offsets[i] - start,
+                                     numberParameters));
+    }
+
+    /**
+     * @brief fit trace of result i (without copying)
+     *
+     * @param i index of the result
+     * @return arma::rowvec
+     */
+    arma::rowvec trace(const std::uint64_t i) const
+    {
+      check(i);
+      const std::uint64_t *offsets = column<std::uint64_t>(*traceOffsetFile);
+      const std::uint64_t start = i == 0 ? 0 : offsets[i - 1];
+      return (view(column<double>(*traceFile) + start, offsets[i] - start));
+    }
+
+    /**
+     * @brief packed upper triangle (column-major) of the Hessian of result i (without copying)
+     *
+     * @param i index of the result
+     * @return arma::rowvec
+     */
+    arma::rowvec packedHessian(const std::uint64_t i) const
+    {
+      check(i);
+      if (!hasHessian)
+        error("The result store does not contain Hessians.");
+      const std::uint64_t nPacked = packedSize(numberParameters);
+      return (view(column<double>(*hessianFile) + i * nPacked, nPacked));
+    }
+
+    /**
+     * @brief element (row, col) of the Hessian of result i
+     *
+     * @param i index of the result
+     * @param row row of the Hessian
+     * @param col column of the Hessian
+     * @return double
+     */
+    double hessianElement(const std::uint64_t i,
+                          std::uint64_t row,
+                          std::uint64_t col) const
+    {
+      check(i);
+      if (!hasHessian)
+        error("The result store does not contain Hessians.");
+      if (row > col)
+        std::swap(row, col);
+      return (column<double>(*hessianFile)[i * packedSize(numberParameters) + packedSize(col) + row]);
+    }
+
+    /**
+     * @brief returns the full Hessian of result i. This creates a copy.
+     *
+     * @param i index of the result
+     * @return arma::mat
+     */
+    arma::mat hessian(const std::uint64_t i) const
+    {
+      check(i);
+      if (!hasHessian)
+        error("The result store does not contain Hessians.");
+      const double *packed = column<double>(*hessianFile) + i * packedSize(numberParameters);
+      arma::mat Hessian(numberParameters, numberParameters);
+      for (std::uint64_t c = 0; c < numberParameters; c++)
+      {
+        for (std::uint64_t r = 0; r <= c; r++)
+        {
+          Hessian.at(r, c) = packed[packedSize(c) + r];
+          Hessian.at(c, r) = packed[packedSize(c) + r];
+        }
+      }
+      return (Hessian);
+    }
+
+    /**
+     * @brief reconstruct the fitResults of result i. This creates copies of all elements.
+     *
+     * @param i index of the result
+     * @return fitResults
+     */
+    fitResults get(const std::uint64_t i) const
+    {
+      fitResults fitResults_;
+      fitResults_.fit = fit(i);
+      fitResults_.fits = trace(i);
+      fitResults_.convergence = convergence(i);
+      fitResults_.parameterValues = parameters(i);
+      if (hasHessian)
+        fitResults_.Hessian = hessian(i);
+      return (fitResults_);
+    }
+
+  private:
+    std::string prefix;
+    std::uint64_t numberParameters = 0;
+    std::uint64_t numberTuning = 0;
+    std::uint64_t numberResults = 0;
+    bool hasHessian = false;
+    std::unique_ptr<mappedFile> fitFile, convergenceFile, tuningFile, parameterFile,
+        parameterOffsetFile, hessianFile, traceFile, traceOffsetFile;
+
+    template <typename T>
+    static T *column(const mappedFile &file)
+    {
+      return (reinterpret_cast<T *>(file.data()));
+    }
+
+    // arma vector using the mapped memory directly (no copy)
+    static arma::rowvec view(double *data, const std::uint64_t nElem)
+    {
+      if (nElem == 0)
+        return (arma::rowvec());
+      return (arma::rowvec(data, nElem, false, true));
+    }
+
+    void check(const std::uint64_t i) const
+    {
+      if (i >= numberResults)
+        error("Index out of range in result store " + prefix);
+    }
+  };
+
+} // end namespace
+
+#endif
@@ -0,0 +1,275 @@
+#ifndef SCREENING_H
+#define SCREENING_H
+#include <vector>
+#include "common_headers.h"
+#include "enet.h"
+#include "subgradients.h"
+
+// Safe screening for lasso and elastic net penalties.
+//
+// The models optimized with lesstimate only provide a fit and gradients, so that
+// the dual problem used by the gap safe rules of Ndiaye et al. (2017) for
+// least squares and generalized linear models is not available. Instead, we use
+// the strong convexity of the smooth part f (model fit + ridge) of the objective
+// P(x) = f(x) + sum_j lambda_j |x_j|:
+//
+// 1) Let s be the subgradient of P at x with minimal norm. If f is mu-strongly convex,
+//    P(x) - P(x*) <= ||s||^2 / (2 mu)   (gap bound)
+//    ||x - x*||   <= ||s|| / mu         (radius of the safe region)
+// 2) A parameter is zero at the optimum if |grad_j f(x*)| < lambda_j. If the gradients
+//    of f are L-Lipschitz, |grad_j f(x*)| <= |grad_j f(x)| + L ||x - x*||. Therefore, parameter
+//    j can be removed from the optimization if |grad_j f(x)| + L ||s|| / mu < lambda_j.
+//
+// Ndiaye, E., Fercoq, O., Gramfort, A., & Salmon, J. (2017). Gap Safe screening rules
+// for sparsity enforcing penalties. Journal of Machine Learning Research, 18(128), 1–33.
+
+namespace lessSEM
+{
+
+  /**
+   * @struct controlScreening
+   * @brief settings for the safe screening of lasso and elastic net penalties
+   *
+   * @var interval screening is performed every interval outer iterations. Set to 0 to disable screening.
+   * @var strongConvexity strong convexity constant mu of the model fit function (e.g., the smallest
+   * eigenvalue of X'X for least squares). The ridge part of the elastic net is added automatically.
+   * @var lipschitz Lipschitz constant L of the gradients of the model fit function (e.g., the largest
+   * eigenvalue of X'X for least squares). The ridge part of the elastic net is added automatically.
+   * @var breakGap the optimization stops once the gap bound P(x) - P(x*) <= ||s||^2 / (2 mu) falls below breakGap.
+   * Set to 0 to disable.
+   */
+  struct controlScreening
+  {
+    int interval;
+    double strongConvexity;
+    double lipschitz;
+    double breakGap;
+  };
+
+  /**
+   * @brief Returns the default settings for the screening (disabled)
+   *
+   * @return controlScreening
+   */
+  inline controlScreening controlScreeningDefault()
+  {
+    controlScreening defaultIs = {
+        0,   // interval
+        0.0, // strongConvexity
+        0.0, // lipschitz
+        0.0  // breakGap
+    };
+    return (defaultIs);
+  }
+
+  /**
+   * @struct screeningResults
+   * @brief statistics of the screening
+   *
+   * @var screened indices of the parameters which were removed from the optimization
+   * @var screenedInIteration outer iteration in which the parameter was removed
+   * @var checks number of times the screening rule was evaluated
+   * @var gap last gap bound
+   * @var gapConverged did the optimizer stop because of the gap bound?
+   */
+  struct screeningResults
+  {
+    std::vector<unsigned int> screened;
+    std::vector<int> screenedInIteration;
+    int checks = 0;
+    double gap = arma::datum::nan;
+    bool gapConverged = false;
+  };
+
+  /**
+   * @brief returns true if screening or the gap stopping criterion is used
+   *
+   * @param control_ screening settings
+   * @return bool
+   */
+  inline bool usesScreening(const controlScreening &control_)
+  {
+    return ((control_.interval > 0) || (control_.breakGap > 0.0));
+  }
+
+  /**
+   * @brief parameter-specific lasso tuning parameters (alpha * lambda * weight)
+   *
+   * @param tuningParameters tuning parameters of the elastic net
+   * @return arma::rowvec
+   */
+  inline arma::rowvec lassoLambda(const tuningParametersEnet &tuningParameters)
+  {
+    return (tuningParameters.alpha * tuningParameters.lambda * tuningParameters.weights);
+  }
+
+  /**
+   * @brief parameter-specific lasso tuning parameters (alpha * lambda * weight)
+   *
+   * @param tuningParameters tuning parameters of the elastic net
+   * @return arma::rowvec
+   */
+  inline arma::rowvec lassoLambda(const tuningParametersEnetGlmnet &tuningParameters)
+  {
+    return (tuningParameters.alpha % tuningParameters.lambda % tuningParameters.weights);
+  }
+
+  /**
+   * @brief second derivatives of the ridge penalty (2 * (1-alpha) * lambda * weight)
+   *
+   * @param tuningParameters tuning parameters of the elastic net
+   * @return arma::rowvec
+   */
+  inline arma::rowvec ridgeCurvature(const tuningParametersEnet &tuningParameters)
+  {
+    return (2.0 * (1.0 - tuningParameters.alpha) * tuningParameters.lambda * tuningParameters.weights);
+  }
+
+  /**
+   * @brief second derivatives of the ridge penalty (2 * (1-alpha) * lambda * weight)
+   *
+   * @param tuningParameters tuning parameters of the elastic net
+   * @return arma::rowvec
+   */
+  inline arma::rowvec ridgeCurvature(const tuningParametersEnetGlmnet &tuningParameters)
+  {
+    return (2.0 * (1.0 - tuningParameters.alpha) % tuningParameters.lambda % tuningParameters.weights);
+  }
+
+  /**
+   * @brief implements the safe screening rule and the gap bound
+   *
+   */
+  class gapSafeScreening
+  {
+  public:
+    screeningResults results;
+
+    /**
+     * @brief Construct a new screening object
+     *
+     * @param control_ screening settings
+     * @param lambda_ parameter-specific lasso tuning parameters (alpha * lambda * weight)
+     * @param ridgeCurvature second derivatives of the ridge penalty (2 * (1-alpha) * lambda * weight); zero if no ridge is used
+     * @param scale scaling of the model fit used by the optimizer (ista divides by the sample size)
+     */
+    gapSafeScreening(const controlScreening &control_,
+                     const arma::rowvec &lambda_,
+                     const arma::rowvec &ridgeCurvature,
+                     const double scale) : control(control_),
+                                           lambda(lambda_)
+    {
+      screened.assign(lambda.n_elem, false);
+      mu = scale * control.strongConvexity + arma::min(ridgeCurvature);
+      L = scale * control.lipschitz + arma::max(ridgeCurvature);
+      if (mu <= 0.0)
+        error("Screening requires a strongly convex smooth part. Set strongConvexity > 0 or use a ridge penalty for all parameters.");
+      if ((control.interval > 0) && (L < mu))
+        error("The lipschitz constant must be at least as large as strongConvexity.");
+    }
+
+    /**
+     * @brief returns true if parameter p was removed from the optimization
+     *
+     * @param p index of the parameter
+     * @return bool
+     */
+    bool isScreened(const unsigned int p) const
+    {
+      return (screened.at(p));
+    }
+
+    /**
+     * @brief returns the mask of removed parameters
+     *
+     * @return const std::vector<bool>&
+     */
+    const std::vector<bool> &mask() const
+    {
+      return (screened);
+    }
+
+    /**
+     * @brief set all removed parameters to zero
+     *
+     * @param parameterValues parameter values
+     */
+    void apply(arma::rowvec &parameterValues) const
+    {
+      for (unsigned int p : results.screened)
+        parameterValues.at(p) = 0.0;
+    }
+
+    /**
+     * @brief restore the screening from a checkpoint (see checkpoint.h)
+     *
+     * @param results_ statistics of the screening saved in the checkpoint
+     */
+    void restore(const screeningResults &results_)
+    {
+      results = results_;
+      screened.assign(lambda.n_elem, false);
+      for (unsigned int p : results.screened)
+      {
+        if (p >= screened.size())
+          error("The screening of the checkpoint does not match the number of parameters.");
+        screened.at(p) = true;
+      }
+    }
+
+    /**
+     * @brief update the gap bound and (if requested by interval) screen parameters
+     *
+     * @param outerIteration current outer iteration
+     * @param parameterValues current parameter values
+     * @param gradients gradients of the smooth part (model + ridge) at parameterValues
+     * @return bool true if the gap bound is below breakGap
+     */
+    bool update(const int outerIteration,
+                const arma::rowvec &parameterValues,
+                const arma::rowvec &gradients)
+    {
+      // minimal norm subgradient of the objective
+      double squaredNorm = 0.0;
+      for (unsigned int p = 0; p < parameterValues.n_elem; p++)
+      {
+        const double s_p = subgradientLasso(parameterValues.at(p),
+                                            gradients.at(p),
+                                            lambda.at(p));
+        squaredNorm += s_p * s_p;
+      }
+
+      results.gap = squaredNorm / (2.0 * mu);
+
+      if ((control.interval > 0) && ((outerIteration + 1) % control.interval == 0))
+      {
+        results.checks++;
+        const double radius = std::sqrt(squaredNorm) / mu;
+        for (unsigned int p = 0; p < parameterValues.n_elem; p++)
+        {
+          if (screened.at(p) || parameterValues.at(p) != 0.0)
+            continue;
+          if (std::abs(gradients.at(p)) + L * radius < lambda.at(p))
+          {
+            screened.at(p) = true;
+            results.screened.push_back(p);
+            results.screenedInIteration.push_back(outerIteration);
+          }
+        }
+      }
+
+      results.gapConverged = (control.breakGap > 0.0) && (results.gap < control.breakGap);
+      return (results.gapConverged);
+    }
+
+  private:
+    controlScreening control;
+    arma::rowvec lambda;
+    std::vector<bool> screened;
+    double mu = 0.0;
+    double L = 0.0;
+  };
+
+} // end namespace
+
+#endif
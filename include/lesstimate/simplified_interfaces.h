@@ -75,7 +75,9 @@ namespace lessSEM
       initialHessian.fill(0.0);
       initialHessian.diag() += hessianValue;
 
-      warn("Setting initial Hessian to identity matrix. We recommend passing a better Hessian.");
+      // the finite difference approximation replaces the initial Hessian later on
+      if (controlOptimizer.initialHessianEstimate.type == userHessian)
+        warn("Setting initial Hessian to identity matrix. We recommend passing a better Hessian or setting controlOptimizer.initialHessianEstimate.");
     }
 
     controlOptimizer.initialHessian = initialHessian;
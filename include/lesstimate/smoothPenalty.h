@@ -37,6 +37,38 @@ namespace lessSEM
     virtual arma::rowvec getGradients(const arma::rowvec &parameterValues,
                                       const stringVector &parameterLabels,
                                       const T &tuningParameters) = 0;
+
+    /**
+     * @brief returns true if the Hessian of the penalty function is diagonal and
+     * getHessianDiagonal is implemented. In this case, glmnet and bfgsOptim add the
+     * exact Hessian of the penalty to the BFGS approximation of the model Hessian
+     * instead of approximating both together.
+     *
+     * @return bool
+     */
+    virtual bool hasHessianDiagonal()
+    {
+      return (false);
+    }
+
+    /**
+     * @brief returns the diagonal of the Hessian of the penalty function. Only
+     * used if hasHessianDiagonal returns true.
+     *
+     * @param parameterValues current parameter values
+     * @param parameterLabels names of the parameters
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    virtual arma::rowvec getHessianDiagonal(const arma::rowvec &parameterValues,
+                                            const stringVector &parameterLabels,
+                                            const T &tuningParameters)
+    {
+      static_cast<void>(parameterLabels);  // is unused
+      static_cast<void>(tuningParameters); // is unused
+      error("The Hessian is not implemented for this smooth penalty.");
+      return (arma::rowvec(parameterValues.n_elem));
+    }
   };
 
   // define some smooth penalties:
@@ -61,8 +93,21 @@ namespace lessSEM
                     const stringVector &parameterLabels,
                     const T &tuningParameters) override
     {
-      static_cast<void>(parameterValues); // is unused
       static_cast<void>(parameterLabels); // is unused
+      return (getValue(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the value of the penalty function. Returns zero. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const T &tuningParameters)
+    {
+      static_cast<void>(parameterValues); // is unused
       static_cast<void>(tuningParameters); // is unused
       return (0.0);
     };
@@ -79,11 +124,61 @@ namespace lessSEM
                               const T &tuningParameters) override
     {
       static_cast<void>(parameterLabels); // is unused
+      return (getGradients(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief returns gradients of the penalty function. Returns a vector of zeros. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    arma::rowvec getGradients(const arma::rowvec &parameterValues,
+                              const T &tuningParameters)
+    {
       static_cast<void>(tuningParameters); // is unused
       arma::rowvec gradients(parameterValues.n_elem);
       gradients.fill(0.0);
       return (gradients);
     };
+
+    bool hasHessianDiagonal() override
+    {
+      return (true);
+    }
+
+    /**
+     * @brief returns the diagonal of the Hessian of the penalty function. Returns a vector of zeros
+     *
+     * @param parameterValues current parameter values
+     * @param parameterLabels names of the parameters
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    arma::rowvec getHessianDiagonal(const arma::rowvec &parameterValues,
+                                    const stringVector &parameterLabels,
+                                    const T &tuningParameters) override
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (getHessianDiagonal(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief returns the diagonal of the Hessian of the penalty function. Returns a vector of zeros. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    arma::rowvec getHessianDiagonal(const arma::rowvec &parameterValues,
+                                    const T &tuningParameters)
+    {
+      static_cast<void>(tuningParameters); // is unused
+      arma::rowvec hessianDiagonal(parameterValues.n_elem);
+      hessianDiagonal.fill(0.0);
+      return (hessianDiagonal);
+    }
   };
 
 /**
@@ -119,8 +214,21 @@ namespace lessSEM
                     const tuningParametersSmoothElasticNet &tuningParameters)
         override
     {
+      static_cast<void>(parameterLabels); // is unused
+      return (getValue(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the value of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return double
+     */
+    double getValue(const arma::rowvec &parameterValues,
+                    const tuningParametersSmoothElasticNet &tuningParameters)
+    {
 
-      static_cast<void>(parameterLabels); // is unused, but necessary for the interface
       double penalty = 0.0;
       double lambda_i;
 
@@ -157,8 +265,21 @@ namespace lessSEM
                               const stringVector &parameterLabels,
                               const tuningParametersSmoothElasticNet &tuningParameters) override
     {
+      static_cast<void>(parameterLabels); // is unused
+      return (getGradients(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the gradients of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    arma::rowvec getGradients(const arma::rowvec &parameterValues,
+                              const tuningParametersSmoothElasticNet &tuningParameters)
+    {
 
-      static_cast<void>(parameterLabels); // is unused, but necessary for the interface
       arma::rowvec gradients(parameterValues.n_elem);
       gradients.fill(0.0);
       double lambda_i;
@@ -191,6 +312,70 @@ namespace lessSEM
 
       return (gradients);
     }
+
+    bool hasHessianDiagonal() override
+    {
+      return (true);
+    }
+
+    /**
+     * @brief Get the diagonal of the Hessian of the penalty function
+     *
+     * @param parameterValues current parameter values
+     * @param parameterLabels names of the parameters
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    arma::rowvec getHessianDiagonal(const arma::rowvec &parameterValues,
+                                    const stringVector &parameterLabels,
+                                    const tuningParametersSmoothElasticNet &tuningParameters) override
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (getHessianDiagonal(parameterValues, tuningParameters));
+    }
+
+    /**
+     * @brief Get the diagonal of the Hessian of the penalty function. Version without parameter labels (see traits.h)
+     *
+     * @param parameterValues current parameter values
+     * @param tuningParameters values of the tuning parmameters
+     * @return arma::rowvec
+     */
+    arma::rowvec getHessianDiagonal(const arma::rowvec &parameterValues,
+                                    const tuningParametersSmoothElasticNet &tuningParameters)
+    {
+
+      arma::rowvec hessianDiagonal(parameterValues.n_elem);
+      hessianDiagonal.fill(0.0);
+      double lambda_i;
+
+      for (unsigned int p = 0; p < parameterValues.n_elem; p++)
+      {
+
+        // if not regularized: nothing to do here
+        if (tuningParameters.weights.at(p) == 0)
+          continue;
+
+        // lasso part: d^2/dx^2 sqrt(x^2 + epsilon) = epsilon / (x^2 + epsilon)^(3/2)
+        lambda_i = tuningParameters.alpha *
+                   tuningParameters.lambda *
+                   tuningParameters.weights.at(p);
+
+        hessianDiagonal.at(p) += lambda_i * tuningParameters.epsilon /
+                                 std::pow(std::pow(parameterValues.at(p), 2) +
+                                              tuningParameters.epsilon,
+                                          1.5);
+
+        // ridge part
+        lambda_i = (1.0 - tuningParameters.alpha) *
+                   tuningParameters.lambda *
+                   tuningParameters.weights.at(p);
+        hessianDiagonal.at(p) += lambda_i * 2.0;
+
+      } // end for parameter
+
+      return (hessianDiagonal);
+    }
   };
 
 } // end namespace
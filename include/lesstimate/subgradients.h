@@ -0,0 +1,162 @@
+#ifndef SUBGRADIENTS_H
+#define SUBGRADIENTS_H
+#include "common_headers.h"
+
+// Kernels for the subgradients of the penalized fit function
+// f(x) + sum_j p_j(x_j), where f is the smooth part (model fit + smooth penalty)
+// and p_j is a penalty which is non-differentiable at zero.
+//
+// Each kernel returns the element of the subdifferential of f(x) + p_j(x_j) with
+// respect to x_j which is closest to zero. At an optimum, all of these elements are
+// zero (Karush-Kuhn-Tucker conditions); the absolute value is therefore a measure
+// of how much parameter j violates the optimality conditions. For the non-convex
+// penalties (scad, mcp, lsp, cappedL1), the Clarke subdifferential is used.
+
+namespace lessSEM
+{
+
+  /**
+   * @brief minimal subgradient for penalties which are differentiable everywhere except at zero
+   *
+   * @param parameterValue value of the parameter
+   * @param gradient gradient of the smooth part of the fit function
+   * @param derivative derivative of the penalty with respect to |x| at |parameterValue| (only used if parameterValue != 0)
+   * @param derivativeAtZero right derivative of the penalty with respect to |x| at zero
+   * @return double
+   */
+  inline double minimumNormSubgradient(const double parameterValue,
+                                       const double gradient,
+                                       const double derivative,
+                                       const double derivativeAtZero)
+  {
+    if (parameterValue > 0.0)
+      return (gradient + derivative);
+    if (parameterValue < 0.0)
+      return (gradient - derivative);
+    // at zero, the subdifferential is gradient + [-derivativeAtZero, derivativeAtZero]
+    if (gradient > derivativeAtZero)
+      return (gradient - derivativeAtZero);
+    if (gradient < -derivativeAtZero)
+      return (gradient + derivativeAtZero);
+    return (0.0);
+  }
+
+  /**
+   * @brief minimal subgradient for the lasso penalty lambda |x|
+   *
+   * @param parameterValue value of the parameter
+   * @param gradient gradient of the smooth part of the fit function
+   * @param lambda tuning parameter lambda
+   * @return double
+   */
+  inline double subgradientLasso(const double parameterValue,
+                                 const double gradient,
+                                 const double lambda)
+  {
+    return (minimumNormSubgradient(parameterValue, gradient, lambda, lambda));
+  }
+
+  /**
+   * @brief minimal subgradient for the scad penalty
+   *
+   * @param parameterValue value of the parameter
+   * @param gradient gradient of the smooth part of the fit function
+   * @param lambda tuning parameter lambda
+   * @param theta tuning parameter theta > 2
+   * @return double
+   */
+  inline double subgradientScad(const double parameterValue,
+                                const double gradient,
+                                const double lambda,
+                                const double theta)
+  {
+    const double absPar = std::abs(parameterValue);
+    double derivative;
+    if (absPar <= lambda)
+      derivative = lambda;
+    else if (absPar <= lambda * theta)
+      derivative = (theta * lambda - absPar) / (theta - 1.0);
+    else
+      derivative = 0.0;
+    return (minimumNormSubgradient(parameterValue, gradient, derivative, lambda));
+  }
+
+  /**
+   * @brief minimal subgradient for the mcp penalty
+   *
+   * @param parameterValue value of the parameter
+   * @param gradient gradient of the smooth part of the fit function
+   * @param lambda tuning parameter lambda
+   * @param theta tuning parameter theta > 0
+   * @return double
+   */
+  inline double subgradientMcp(const double parameterValue,
+                               const double gradient,
+                               const double lambda,
+                               const double theta)
+  {
+    const double absPar = std::abs(parameterValue);
+    const double derivative = absPar <= lambda * theta ? lambda - absPar / theta : 0.0;
+    return (minimumNormSubgradient(parameterValue, gradient, derivative, lambda));
+  }
+
+  /**
+   * @brief minimal subgradient for the lsp penalty lambda log(1 + |x|/theta)
+   *
+   * @param parameterValue value of the parameter
+   * @param gradient gradient of the smooth part of the fit function
+   * @param lambda tuning parameter lambda
+   * @param theta tuning parameter theta > 0
+   * @return double
+   */
+  inline double subgradientLsp(const double parameterValue,
+                               const double gradient,
+                               const double lambda,
+                               const double theta)
+  {
+    const double derivative = lambda / (theta + std::abs(parameterValue));
+    return (minimumNormSubgradient(parameterValue, gradient, derivative, lambda / theta));
+  }
+
+  /**
+   * @brief minimal subgradient for the cappedL1 penalty lambda min(|x|, theta)
+   *
+   * @param parameterValue value of the parameter
+   * @param gradient gradient of the smooth part of the fit function
+   * @param lambda tuning parameter lambda
+   * @param theta tuning parameter theta > 0
+   * @return double
+   */
+  inline double subgradientCappedL1(const double parameterValue,
+                                    const double gradient,
+                                    const double lambda,
+                                    const double theta)
+  {
+    const double absPar = std::abs(parameterValue);
+    if (absPar == theta)
+    {
+      // kink of the cap: the derivative with respect to |x| is in [0, lambda]
+      const double sign = parameterValue > 0.0 ? 1.0 : -1.0;
+      const double shift = std::min(std::max(-sign * gradient, 0.0), lambda);
+      return (gradient + sign * shift);
+    }
+    const double derivative = absPar < theta ? lambda : 0.0;
+    return (minimumNormSubgradient(parameterValue, gradient, derivative, lambda));
+  }
+
+  /**
+   * @brief largest violation of the optimality conditions
+   *
+   * @param subgradients subgradients returned by getSubgradients
+   * @return double
+   */
+  inline double kktViolation(const arma::rowvec &subgradients)
+  {
+    if (subgradients.n_elem == 0)
+      return (0.0);
+    return (arma::max(arma::abs(subgradients)));
+  }
+
+} // end namespace
+
+#endif
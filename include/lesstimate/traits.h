@@ -0,0 +1,634 @@
+#ifndef TRAITS_H
+#define TRAITS_H
+#include <type_traits>
+#include <utility>
+#include "common_headers.h"
+#include "parallel.h"
+#include "model.h"
+
+// The optimizers are templates which accept any model, penalty, proximal operator,
+// and smooth penalty that provides the required methods. Classes derived from the
+// abstract base classes (model, penalty<T>, proximalOperator<T>, smoothPenalty<T>)
+// are one possible instantiation; the methods are then called virtually if the
+// optimizer is called with a reference to the base class. Passing the derived
+// class directly (ideally marked final) allows the compiler to resolve and inline
+// the calls at compile time. This matters for very small models which are
+// evaluated millions of times (e.g., in simulation studies).
+//
+// The traits below check the required methods. Optional methods (e.g., fitBatch
+// or getSubgradients) are detected as well; if they are missing, a default is used.
+//
+// Models and penalties which do not need the parameter labels can implement fit,
+// gradients, getValue, getGradients, getHessianDiagonal, and getParameters without
+// the parameterLabels argument. The optimizers call these versions through the
+// functions modelFit, modelGradients, penaltyValue, ... below (see parameterTable.h).
+
+namespace lessSEM
+{
+
+  /**
+   * @brief checks if modelClass has the methods
+   * double fit(arma::rowvec, stringVector) and arma::rowvec gradients(arma::rowvec, stringVector)
+   *
+   * @tparam modelClass class of the model
+   */
+  template <class modelClass, class = void>
+  struct isLabeledModel : std::false_type
+  {
+  };
+  template <class modelClass>
+  struct isLabeledModel<modelClass,
+                        std::void_t<decltype(static_cast<double>(std::declval<modelClass &>().fit(std::declval<arma::rowvec>(),
+                                                                                                    std::declval<stringVector>()))),
+                                    decltype(arma::rowvec(std::declval<modelClass &>().gradients(std::declval<arma::rowvec>(),
+                                                                                                 std::declval<stringVector>())))>>
+      : std::true_type
+  {
+  };
+
+  /**
+   * @brief checks if modelClass has the methods
+   * double fit(arma::rowvec) and arma::rowvec gradients(arma::rowvec) without parameter labels
+   *
+   * @tparam modelClass class of the model
+   */
+  template <class modelClass, class = void>
+  struct isUnlabeledModel : std::false_type
+  {
+  };
+  template <class modelClass>
+  struct isUnlabeledModel<modelClass,
+                          std::void_t<decltype(static_cast<double>(std::declval<modelClass &>().fit(std::declval<const arma::rowvec &>()))),
+                                      decltype(arma::rowvec(std::declval<modelClass &>().gradients(std::declval<const arma::rowvec &>())))>>
+      : std::true_type
+  {
+  };
+
+  /**
+   * @brief should the optimizers call fit and gradients without parameter labels? This is the case if
+   * the model provides these methods. Classes derived from less::model in which both versions are visible
+   * (e.g., less::model itself) are called with labels: The virtual methods with labels forward to the
+   * versions without labels if the model does not override them (see model.h).
+   *
+   * @tparam modelClass class of the model
+   */
+  template <class modelClass>
+  struct callsUnlabeledModel : std::integral_constant<bool,
+                                                      isUnlabeledModel<modelClass>::value &&
+                                                          !(isLabeledModel<modelClass>::value &&
+                                                            std::is_base_of<model, modelClass>::value)>
+  {
+  };
+
+  /**
+   * @brief checks if modelClass has the methods fit and gradients (with or without parameter labels)
+   *
+   * @tparam modelClass class of the model
+   */
+  template <class modelClass>
+  struct isModel : std::integral_constant<bool,
+                                          isLabeledModel<modelClass>::value ||
+                                              isUnlabeledModel<modelClass>::value>
+  {
+  };
+
+  /**
+   * @brief checks if penaltyClass has the method double getValue(arma::rowvec, stringVector, T)
+   * or double getValue(arma::rowvec, T)
+   *
+   * @tparam penaltyClass class of the (smooth or non-smooth) penalty
+   * @tparam T tuning parameters
+   */
+  template <class penaltyClass, class T, class = void>
+  struct hasLabeledValue : std::false_type
+  {
+  };
+  template <class penaltyClass, class T>
+  struct hasLabeledValue<penaltyClass, T,
+                         std::void_t<decltype(static_cast<double>(std::declval<penaltyClass &>().getValue(std::declval<const arma::rowvec &>(),
+                                                                                                           std::declval<const stringVector &>(),
+                                                                                                           std::declval<const T &>())))>>
+      : std::true_type
+  {
+  };
+  template <class penaltyClass, class T, class = void>
+  struct hasUnlabeledValue : std::false_type
+  {
+  };
+  template <class penaltyClass, class T>
+  struct hasUnlabeledValue<penaltyClass, T,
+                           std::void_t<decltype(static_cast<double>(std::declval<penaltyClass &>().getValue(std::declval<const arma::rowvec &>(),
+                                                                                                             std::declval<const T &>())))>>
+      : std::true_type
+  {
+  };
+  template <class penaltyClass, class T>
+  struct isPenalty : std::integral_constant<bool,
+                                            hasLabeledValue<penaltyClass, T>::value ||
+                                                hasUnlabeledValue<penaltyClass, T>::value>
+  {
+  };
+
+  /**
+   * @brief checks if smoothPenaltyClass has the methods getValue and
+   * arma::rowvec getGradients(arma::rowvec, stringVector, T) or arma::rowvec getGradients(arma::rowvec, T)
+   *
+   * @tparam smoothPenaltyClass class of the smooth penalty
+   * @tparam T tuning parameters
+   */
+  template <class smoothPenaltyClass, class T, class = void>
+  struct hasLabeledGradients : std::false_type
+  {
+  };
+  template <class smoothPenaltyClass, class T>
+  struct hasLabeledGradients<smoothPenaltyClass, T,
+                             std::void_t<decltype(arma::rowvec(std::declval<smoothPenaltyClass &>().getGradients(std::declval<const arma::rowvec &>(),
+                                                                                                                 std::declval<const stringVector &>(),
+                                                                                                                 std::declval<const T &>())))>>
+      : std::true_type
+  {
+  };
+  template <class smoothPenaltyClass, class T, class = void>
+  struct hasUnlabeledGradients : std::false_type
+  {
+  };
+  template <class smoothPenaltyClass, class T>
+  struct hasUnlabeledGradients<smoothPenaltyClass, T,
+                               std::void_t<decltype(arma::rowvec(std::declval<smoothPenaltyClass &>().getGradients(std::declval<const arma::rowvec &>(),
+                                                                                                                   std::declval<const T &>())))>>
+      : std::true_type
+  {
+  };
+  template <class smoothPenaltyClass, class T>
+  struct isSmoothPenalty : std::integral_constant<bool,
+                                                  isPenalty<smoothPenaltyClass, T>::value &&
+                                                      (hasLabeledGradients<smoothPenaltyClass, T>::value ||
+                                                       hasUnlabeledGradients<smoothPenaltyClass, T>::value)>
+  {
+  };
+
+  /**
+   * @brief checks if proximalOperatorClass has the method
+   * arma::rowvec getParameters(arma::rowvec, arma::rowvec, stringVector, double, T)
+   * or arma::rowvec getParameters(arma::rowvec, arma::rowvec, double, T)
+   *
+   * @tparam proximalOperatorClass class of the proximal operator
+   * @tparam T tuning parameters
+   */
+  template <class proximalOperatorClass, class T, class = void>
+  struct hasLabeledParameters : std::false_type
+  {
+  };
+  template <class proximalOperatorClass, class T>
+  struct hasLabeledParameters<proximalOperatorClass, T,
+                              std::void_t<decltype(arma::rowvec(std::declval<proximalOperatorClass &>().getParameters(std::declval<const arma::rowvec &>(),
+                                                                                                                      std::declval<const arma::rowvec &>(),
+                                                                                                                      std::declval<const stringVector &>(),
+                                                                                                                      std::declval<const double>(),
+                                                                                                                      std::declval<const T &>())))>>
+      : std::true_type
+  {
+  };
+  template <class proximalOperatorClass, class T, class = void>
+  struct hasUnlabeledParameters : std::false_type
+  {
+  };
+  template <class proximalOperatorClass, class T>
+  struct hasUnlabeledParameters<proximalOperatorClass, T,
+                                std::void_t<decltype(arma::rowvec(std::declval<proximalOperatorClass &>().getParameters(std::declval<const arma::rowvec &>(),
+                                                                                                                        std::declval<const arma::rowvec &>(),
+                                                                                                                        std::declval<const double>(),
+                                                                                                                        std::declval<const T &>())))>>
+      : std::true_type
+  {
+  };
+  template <class proximalOperatorClass, class T>
+  struct isProximalOperator : std::integral_constant<bool,
+                                                     hasLabeledParameters<proximalOperatorClass, T>::value ||
+                                                         hasUnlabeledParameters<proximalOperatorClass, T>::value>
+  {
+  };
+
+  /**
+   * @brief checks if penaltyClass has the (optional) method
+   * arma::rowvec getSubgradients(arma::rowvec, arma::rowvec, T)
+   *
+   * @tparam penaltyClass class of the penalty
+   * @tparam T tuning parameters
+   */
+  template <class penaltyClass, class T, class = void>
+  struct hasSubgradients : std::false_type
+  {
+  };
+  template <class penaltyClass, class T>
+  struct hasSubgradients<penaltyClass, T,
+                         std::void_t<decltype(std::declval<penaltyClass &>().getSubgradients(std::declval<const arma::rowvec &>(),
+                                                                                             std::declval<const arma::rowvec &>(),
+                                                                                             std::declval<const T &>()))>>
+      : std::true_type
+  {
+  };
+
+  /**
+   * @brief checks if penaltyClass has the method
+   * arma::rowvec getBlockZ(unsigned int, arma::rowvec, arma::rowvec, arma::rowvec, arma::mat, T),
+   * which updates all parameters of a block in the inner iteration of glmnet (see glmnet_groupLasso.h)
+   *
+   * @tparam penaltyClass class of the penalty
+   * @tparam T tuning parameters
+   */
+  template <class penaltyClass, class T, class = void>
+  struct hasBlockUpdates : std::false_type
+  {
+  };
+  template <class penaltyClass, class T>
+  struct hasBlockUpdates<penaltyClass, T,
+                         std::void_t<decltype(arma::rowvec(std::declval<penaltyClass &>().getBlockZ(std::declval<const unsigned int>(),
+                                                                                                    std::declval<const arma::rowvec &>(),
+                                                                                                    std::declval<const arma::rowvec &>(),
+                                                                                                    std::declval<const arma::rowvec &>(),
+                                                                                                    std::declval<const arma::mat &>(),
+                                                                                                    std::declval<const T &>())))>>
+      : std::true_type
+  {
+  };
+
+  /**
+   * @brief checks if smoothPenaltyClass has the (optional) methods hasHessianDiagonal and getHessianDiagonal
+   *
+   * @tparam smoothPenaltyClass class of the smooth penalty
+   */
+  template <class smoothPenaltyClass, class = void>
+  struct hasHessianDiagonal : std::false_type
+  {
+  };
+  template <class smoothPenaltyClass>
+  struct hasHessianDiagonal<smoothPenaltyClass,
+                            std::void_t<decltype(std::declval<smoothPenaltyClass &>().hasHessianDiagonal())>>
+      : std::true_type
+  {
+  };
+
+  // optional methods of the model
+  template <class modelClass, class = void>
+  struct hasFitBatch : std::false_type
+  {
+  };
+  template <class modelClass>
+  struct hasFitBatch<modelClass,
+                     std::void_t<decltype(std::declval<modelClass &>().fitBatch(std::declval<const arma::mat &>(),
+                                                                                std::declval<const stringVector &>(),
+                                                                                std::declval<const int>()))>>
+      : std::true_type
+  {
+  };
+
+  template <class modelClass, class = void>
+  struct hasGradientsBatch : std::false_type
+  {
+  };
+  template <class modelClass>
+  struct hasGradientsBatch<modelClass,
+                           std::void_t<decltype(std::declval<modelClass &>().gradientsBatch(std::declval<const arma::mat &>(),
+                                                                                            std::declval<const stringVector &>(),
+                                                                                            std::declval<const int>()))>>
+      : std::true_type
+  {
+  };
+
+  template <class modelClass, class = void>
+  struct hasBatchSize : std::false_type
+  {
+  };
+  template <class modelClass>
+  struct hasBatchSize<modelClass,
+                      std::void_t<decltype(std::declval<modelClass &>().batchSize())>>
+      : std::true_type
+  {
+  };
+
+  template <class modelClass, class = void>
+  struct hasUseCache : std::false_type
+  {
+  };
+  template <class modelClass>
+  struct hasUseCache<modelClass,
+                     std::void_t<decltype(std::declval<modelClass &>().useCache())>>
+      : std::true_type
+  {
+  };
+
+  /**
+   * @brief fit of the model. Calls fit without parameter labels if the model provides it (see callsUnlabeledModel).
+   *
+   * @param model_ the model
+   * @param parameterValues parameter values
+   * @param parameterLabels stringVector with parameterLabels
+   * @return double
+   */
+  template <class modelClass>
+  inline double modelFit(modelClass &model_,
+                         const arma::rowvec &parameterValues,
+                         const stringVector &parameterLabels)
+  {
+    if constexpr (callsUnlabeledModel<modelClass>::value)
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (model_.fit(parameterValues));
+    }
+    else
+    {
+      return (model_.fit(parameterValues, parameterLabels));
+    }
+  }
+
+  /**
+   * @brief gradients of the model. Calls gradients without parameter labels if the model provides it (see callsUnlabeledModel).
+   *
+   * @param model_ the model
+   * @param parameterValues parameter values
+   * @param parameterLabels stringVector with parameterLabels
+   * @return the vector returned by the called method (a fixed-size vector is kept, see fixedSize.h)
+   */
+  template <class modelClass>
+  inline auto modelGradients(modelClass &model_,
+                             const arma::rowvec &parameterValues,
+                             const stringVector &parameterLabels)
+  {
+    if constexpr (callsUnlabeledModel<modelClass>::value)
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (model_.gradients(parameterValues));
+    }
+    else
+    {
+      return (model_.gradients(parameterValues, parameterLabels));
+    }
+  }
+
+  /**
+   * @brief value of a (smooth or non-smooth) penalty. Calls getValue without parameter labels
+   * if the penalty provides it.
+   *
+   * @param penalty_ the penalty
+   * @param parameterValues parameter values
+   * @param parameterLabels stringVector with parameterLabels
+   * @param tuningParameters tuning parameters of the penalty
+   * @return double
+   */
+  template <class penaltyClass, typename T>
+  inline double penaltyValue(penaltyClass &penalty_,
+                             const arma::rowvec &parameterValues,
+                             const stringVector &parameterLabels,
+                             const T &tuningParameters)
+  {
+    if constexpr (hasUnlabeledValue<penaltyClass, T>::value)
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (penalty_.getValue(parameterValues, tuningParameters));
+    }
+    else
+    {
+      return (penalty_.getValue(parameterValues, parameterLabels, tuningParameters));
+    }
+  }
+
+  /**
+   * @brief gradients of a smooth penalty. Calls getGradients without parameter labels
+   * if the penalty provides it.
+   *
+   * @param smoothPenalty_ the smooth penalty
+   * @param parameterValues parameter values
+   * @param parameterLabels stringVector with parameterLabels
+   * @param tuningParameters tuning parameters of the penalty
+   * @return the vector returned by the called method (a fixed-size vector is kept, see fixedSize.h)
+   */
+  template <class smoothPenaltyClass, typename T>
+  inline auto penaltyGradients(smoothPenaltyClass &smoothPenalty_,
+                               const arma::rowvec &parameterValues,
+                               const stringVector &parameterLabels,
+                               const T &tuningParameters)
+  {
+    if constexpr (hasUnlabeledGradients<smoothPenaltyClass, T>::value)
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (smoothPenalty_.getGradients(parameterValues, tuningParameters));
+    }
+    else
+    {
+      return (smoothPenalty_.getGradients(parameterValues, parameterLabels, tuningParameters));
+    }
+  }
+
+  /**
+   * @brief checks if smoothPenaltyClass has the method
+   * arma::rowvec getHessianDiagonal(arma::rowvec, T) without parameter labels
+   *
+   * @tparam smoothPenaltyClass class of the smooth penalty
+   * @tparam T tuning parameters
+   */
+  template <class smoothPenaltyClass, class T, class = void>
+  struct hasUnlabeledHessianDiagonal : std::false_type
+  {
+  };
+  template <class smoothPenaltyClass, class T>
+  struct hasUnlabeledHessianDiagonal<smoothPenaltyClass, T,
+                                     std::void_t<decltype(arma::rowvec(std::declval<smoothPenaltyClass &>().getHessianDiagonal(std::declval<const arma::rowvec &>(),
+                                                                                                                               std::declval<const T &>())))>>
+      : std::true_type
+  {
+  };
+
+  /**
+   * @brief diagonal of the Hessian of a smooth penalty (see providesHessianDiagonal). Calls
+   * getHessianDiagonal without parameter labels if the penalty provides it.
+   *
+   * @param smoothPenalty_ the smooth penalty
+   * @param parameterValues parameter values
+   * @param parameterLabels stringVector with parameterLabels
+   * @param tuningParameters tuning parameters of the penalty
+   * @return the vector returned by the called method (a fixed-size vector is kept, see fixedSize.h)
+   */
+  template <class smoothPenaltyClass, typename T>
+  inline auto penaltyHessianDiagonal(smoothPenaltyClass &smoothPenalty_,
+                                     const arma::rowvec &parameterValues,
+                                     const stringVector &parameterLabels,
+                                     const T &tuningParameters)
+  {
+    if constexpr (hasUnlabeledHessianDiagonal<smoothPenaltyClass, T>::value)
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (smoothPenalty_.getHessianDiagonal(parameterValues, tuningParameters));
+    }
+    else
+    {
+      return (smoothPenalty_.getHessianDiagonal(parameterValues, parameterLabels, tuningParameters));
+    }
+  }
+
+  /**
+   * @brief parameters returned by a proximal operator. Calls getParameters without parameter
+   * labels if the proximal operator provides it.
+   *
+   * @param proximalOperator_ the proximal operator
+   * @param parameterValues parameter values
+   * @param gradientValues gradient values
+   * @param parameterLabels stringVector with parameterLabels
+   * @param L step size
+   * @param tuningParameters tuning parameters of the penalty
+   * @return the vector returned by the called method (a fixed-size vector is kept, see fixedSize.h)
+   */
+  template <class proximalOperatorClass, typename T>
+  inline auto proximalParameters(proximalOperatorClass &proximalOperator_,
+                                 const arma::rowvec &parameterValues,
+                                 const arma::rowvec &gradientValues,
+                                 const stringVector &parameterLabels,
+                                 const double L,
+                                 const T &tuningParameters)
+  {
+    if constexpr (hasUnlabeledParameters<proximalOperatorClass, T>::value)
+    {
+      static_cast<void>(parameterLabels); // is unused
+      return (proximalOperator_.getParameters(parameterValues, gradientValues, L, tuningParameters));
+    }
+    else
+    {
+      return (proximalOperator_.getParameters(parameterValues, gradientValues, parameterLabels, L, tuningParameters));
+    }
+  }
+
+  /**
+   * @brief fits of the model at several points (see model::fitBatch). Uses fit for each row
+   * if the model has no fitBatch method.
+   *
+   * @param model_ the model
+   * @param points matrix where each row contains parameter values
+   * @param parameterLabels stringVector with parameterLabels
+   * @param threads number of threads (0 = all available cores)
+   * @return arma::colvec
+   */
+  template <class modelClass>
+  inline arma::colvec modelFitBatch(modelClass &model_,
+                                    const arma::mat &points,
+                                    const stringVector &parameterLabels,
+                                    const int threads)
+  {
+    if constexpr (hasFitBatch<modelClass>::value)
+    {
+      return (model_.fitBatch(points, parameterLabels, threads));
+    }
+    else
+    {
+      arma::colvec fits(points.n_rows);
+      parallelFor(points.n_rows, threads, [&](const unsigned int i)
+                  { fits.at(i) = modelFit(model_, points.row(i), parameterLabels); });
+      return (fits);
+    }
+  }
+
+  /**
+   * @brief gradients of the model at several points (see model::gradientsBatch). Uses gradients
+   * for each row if the model has no gradientsBatch method.
+   *
+   * @param model_ the model
+   * @param points matrix where each row contains parameter values
+   * @param parameterLabels stringVector with parameterLabels
+   * @param threads number of threads (0 = all available cores)
+   * @return arma::mat
+   */
+  template <class modelClass>
+  inline arma::mat modelGradientsBatch(modelClass &model_,
+                                       const arma::mat &points,
+                                       const stringVector &parameterLabels,
+                                       const int threads)
+  {
+    if constexpr (hasGradientsBatch<modelClass>::value)
+    {
+      return (model_.gradientsBatch(points, parameterLabels, threads));
+    }
+    else
+    {
+      arma::mat gradientValues(points.n_rows, points.n_cols);
+      parallelFor(points.n_rows, threads, [&](const unsigned int i)
+                  { gradientValues.row(i) = modelGradients(model_, points.row(i), parameterLabels); });
+      return (gradientValues);
+    }
+  }
+
+  /**
+   * @brief preferred batch size of the model (see model::batchSize); 1 if the model has no batchSize method
+   *
+   * @param model_ the model
+   * @return int
+   */
+  template <class modelClass>
+  inline int modelBatchSize(modelClass &model_)
+  {
+    if constexpr (hasBatchSize<modelClass>::value)
+      return (std::max(1, static_cast<int>(model_.batchSize())));
+    else
+      return (1);
+  }
+
+  /**
+   * @brief can evaluations of the model be cached (see model::useCache)? true if the model has no useCache method
+   *
+   * @param model_ the model
+   * @return bool
+   */
+  template <class modelClass>
+  inline bool modelUseCache(modelClass &model_)
+  {
+    if constexpr (hasUseCache<modelClass>::value)
+      return (model_.useCache());
+    else
+      return (true);
+  }
+
+  /**
+   * @brief does the smooth penalty provide the diagonal of its Hessian (see smoothPenalty::hasHessianDiagonal)?
+   * false if the smooth penalty has no hasHessianDiagonal method
+   *
+   * @param smoothPenalty_ the smooth penalty
+   * @return bool
+   */
+  template <class smoothPenaltyClass>
+  inline bool providesHessianDiagonal(smoothPenaltyClass &smoothPenalty_)
+  {
+    if constexpr (hasHessianDiagonal<smoothPenaltyClass>::value)
+      return (smoothPenalty_.hasHessianDiagonal());
+    else
+      return (false);
+  }
+
+  /**
+   * @brief checks if object is of class targetClass. Uses dynamic_cast for
+   * polymorphic classes and the static type otherwise.
+   *
+   * @tparam targetClass class to check for
+   * @param object object to check
+   * @return bool
+   */
+  template <class targetClass, class objectClass>
+  inline bool isInstanceOf(objectClass &object)
+  {
+    if constexpr (std::is_base_of<targetClass, objectClass>::value)
+    {
+      static_cast<void>(object);
+      return (true);
+    }
+    else if constexpr (std::is_polymorphic<objectClass>::value &&
+                       std::is_base_of<objectClass, targetClass>::value)
+    {
+      return (dynamic_cast<targetClass *>(&object) != nullptr);
+    }
+    else
+    {
+      static_cast<void>(object);
+      return (false);
+    }
+  }
+
+} // end namespace
+
+#endif
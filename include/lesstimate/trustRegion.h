@@ -0,0 +1,102 @@
+#ifndef TRUSTREGION_H
+#define TRUSTREGION_H
+#include <algorithm>
+#include <cmath>
+#include "common_headers.h"
+
+// Trust-region globalization of the glmnet outer iteration.
+//
+// By default, glmnet searches along the step direction returned by the inner iteration
+// with a line search. If the quadratic approximation is poor (e.g., for non-convex penalties
+// or badly scaled models), the line search can reject long steps many times in a row, and each
+// rejection costs an evaluation of the model fit. With the trust region, the inner iteration
+// minimizes the quadratic approximation subject to the box constraint |direction_j| <= radius.
+// The step is only evaluated once: the ratio of the actual reduction of the penalized fit to the
+// reduction predicted by the quadratic approximation decides whether the step is accepted and
+// how the radius is changed (Nocedal & Wright, 2006, Chapter 4).
+//
+// Nocedal, J., & Wright, S. J. (2006). Numerical optimization (2nd ed). Springer.
+
+namespace lessSEM
+{
+
+  /**
+   * @struct controlTrustRegion
+   * @brief settings for the trust-region globalization of glmnet
+   *
+   * @var initialRadius initial radius of the box trust region. Set to 0 to use the line search instead.
+   * @var maxRadius largest radius
+   * @var acceptance steps are accepted if the ratio of the actual to the predicted reduction is larger than acceptance
+   * @var shrink if the ratio is smaller than .25, the radius is set to shrink times the largest absolute step
+   * @var expand if the ratio is larger than .75 and the step is on the boundary, the radius is multiplied with expand
+   * @var minRadius the outer iteration stops if the radius falls below minRadius. The fit is then reported as not converged
+   */
+  struct controlTrustRegion
+  {
+    double initialRadius;
+    double maxRadius;
+    double acceptance;
+    double shrink;
+    double expand;
+    double minRadius;
+  };
+
+  /**
+   * @brief Returns the default settings for the trust region (disabled)
+   *
+   * @return controlTrustRegion
+   */
+  inline controlTrustRegion controlTrustRegionDefault()
+  {
+    controlTrustRegion defaultIs = {
+        0.0,               // initialRadius
+        arma::datum::inf, // maxRadius
+        1e-4,              // acceptance
+        .25,               // shrink
+        2.0,               // expand
+        1e-12              // minRadius
+    };
+    return (defaultIs);
+  }
+
+  /**
+   * @brief restricts the change z_j of the step direction so that the updated step direction
+   * stays in the box [-radius, radius]. For convex one-dimensional subproblems, this is the
+   * constrained minimizer.
+   *
+   * @param direction current step direction of the parameter
+   * @param z_j change of the step direction
+   * @param radius radius of the trust region
+   * @return double
+   */
+  inline double restrictToTrustRegion(const double direction,
+                                      const double z_j,
+                                      const double radius)
+  {
+    return (std::min(std::max(direction + z_j, -radius), radius) - direction);
+  }
+
+  /**
+   * @brief updates the radius of the trust region
+   *
+   * @param radius current radius
+   * @param ratio ratio of the actual to the predicted reduction
+   * @param stepLength largest absolute element of the step direction
+   * @param control_ settings for the trust region
+   * @return double new radius
+   */
+  inline double updateTrustRegion(const double radius,
+                                  const double ratio,
+                                  const double stepLength,
+                                  const controlTrustRegion &control_)
+  {
+    if (!std::isfinite(ratio) || ratio < .25)
+      return (control_.shrink * std::min(stepLength, radius));
+    if (ratio > .75 && stepLength >= .99 * radius)
+      return (std::min(control_.expand * radius, control_.maxRadius));
+    return (radius);
+  }
+
+} // end namespace
+
+#endif